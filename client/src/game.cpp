@@ -24,6 +24,7 @@
 #include "log.hpp"
 #include "game.hpp"
 #include "xmlconf.hpp"
+#include "netbundle.hpp"
 #include "initview.hpp"
 #include "sysconst.hpp"
 #include "pngtexdbn.hpp"
@@ -267,6 +268,22 @@ void Game::OnServerMessage(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
                 }
                 break;
             }
+        case SM_BUNDLE:
+            {
+                // messages sent to us by server in one tick
+                // dispatch them in order as if they were received one by one
+                // SM_BUNDLE can't be inside a bundle, so m_BundleBuf won't be overwritten during dispatching
+                auto nCount = NetBundle::Unpack<SMSGParam>(pData, nDataLen, &m_BundleBuf, [this](uint8_t nBundleHC, const uint8_t *pBundleData, size_t nBundleDataLen)
+                {
+                    OnServerMessage(nBundleHC, pBundleData, nBundleDataLen);
+                });
+
+                if(nCount < 0){
+                    extern Log *g_Log;
+                    g_Log->AddLog(LOGTYPE_WARNING, "Corrupted bundle message: DataLen = %d", (int)(nDataLen));
+                }
+                break;
+            }
         default:
             {
                 break;
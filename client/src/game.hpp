@@ -20,6 +20,7 @@
 
 #pragma once 
 #include <atomic>
+#include <vector>
 #include <SDL2/SDL.h>
 #include "cachequeue.hpp"
 
@@ -36,6 +37,10 @@ class Game final
     private:
         NetIO m_NetIO;
 
+    private:
+        // decoded SM_BUNDLE, messages inside refer to it when dispatching
+        std::vector<uint8_t> m_BundleBuf;
+
     private:
         int m_RequestProcess;
         Process *m_CurrentProcess;
@@ -24,11 +24,11 @@
 #include "compress.hpp"
 #include "condcheck.hpp"
 
-NetIO::SendPack::SendPack(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::function<void()> &&fnOnDone)
+NetIO::SendPack::SendPack(uint8_t nHC, uint32_t nDoneToken, const uint8_t *pData, size_t nDataLen)
     : HC(nHC)
+    , DoneToken(nDoneToken)
     , Data(pData)
     , DataLen(nDataLen)
-    , OnDone(std::move(fnOnDone))
 {
     auto fnReportAndExit = [this](){
         extern Log *g_Log;
@@ -105,11 +105,13 @@ NetIO::NetIO()
     : m_IO()
     , m_Resolver(m_IO)
     , m_Socket(m_IO)
-    , m_ReadHC(0)
-    , m_ReadLen {0, 0, 0, 0}
-    , m_ReadBuf(1024)
+    , m_Connected(false)
+    , m_ReadParser()
     , m_OnReadDone()
     , m_SendQueue()
+    , m_SendHead(0)
+    , m_SendHC(0)
+    , m_DoneTable()
     , m_MemoryPN()
 {}
 
@@ -120,20 +122,13 @@ NetIO::~NetIO()
 
 void NetIO::Shutdown()
 {
+    m_Connected = false;
     m_Socket.close();
 }
 
-void NetIO::DoReadHC()
+void NetIO::DoRead()
 {
-    auto fnReportCurrentMessage = [this](){
-        extern Log *g_Log;
-        g_Log->AddLog(LOGTYPE_WARNING, "Current SMSGParam::HC      = %d", (int)(m_ReadHC));
-        g_Log->AddLog(LOGTYPE_WARNING, "                 ::Type    = %d", (int)(SMSGParam(m_ReadHC).Type()));
-        g_Log->AddLog(LOGTYPE_WARNING, "                 ::MaskLen = %d", (int)(SMSGParam(m_ReadHC).MaskLen()));
-        g_Log->AddLog(LOGTYPE_WARNING, "                 ::DataLen = %d", (int)(SMSGParam(m_ReadHC).DataLen()));
-    };
-
-    auto fnOnNetError = [this, fnReportCurrentMessage](std::error_code stEC){
+    m_Socket.async_read_some(asio::buffer(m_ReadParser.WriteBuf(), m_ReadParser.WriteLen()), [this](std::error_code stEC, size_t nReadBytes){
         if(stEC){
             // 1. close the asio socket
             Shutdown();
@@ -141,250 +136,59 @@ void NetIO::DoReadHC()
             // 2. record the error code to log
             extern Log *g_Log;
             g_Log->AddLog(LOGTYPE_WARNING, "Network error: %s", stEC.message().c_str());
-            fnReportCurrentMessage();
+            return;
         }
-    };
 
-    auto fnOnReadHC = [this, fnOnNetError, fnReportCurrentMessage](std::error_code stEC, size_t){
-        if(stEC){ fnOnNetError(stEC); }
-        else{
-            SMSGParam stSMSG(m_ReadHC);
-            switch(stSMSG.Type()){
-                case 0:
-                    {
-                        if(m_OnReadDone){ m_OnReadDone(m_ReadHC, nullptr, 0); }
-                        DoReadHC();
-                        return;
-                    }
-                case 1:
-                    {
-                        auto fnOnReadLen0 = [this, stSMSG, fnOnNetError, fnReportCurrentMessage](std::error_code stEC, size_t){
-                            if(stEC){ fnOnNetError(stEC); }
-                            else{
-                                if(m_ReadLen[0] != 255){
-                                    if((size_t)(m_ReadLen[0]) > stSMSG.DataLen()){
-                                        // 1. close the asio socket
-                                        Shutdown();
-
-                                        // 2. record the error code but not exit?
-                                        extern Log *g_Log;
-                                        g_Log->AddLog(LOGTYPE_WARNING, "Invalid package: CompLen = %d", (int)(m_ReadLen[0]));
-                                        fnReportCurrentMessage();
-
-                                        // 3. we stop here
-                                        //    should we have some method to save it?
-                                        return;
-                                    }else{ DoReadBody(stSMSG.MaskLen(), m_ReadLen[0]); }
-                                }else{
-                                    auto fnOnReadLen1 = [this, stSMSG, fnReportCurrentMessage, fnOnNetError](std::error_code stEC, size_t){
-                                        if(stEC){ fnOnNetError(stEC); }
-                                        else{
-                                            condcheck(m_ReadLen[0] == 255);
-                                            auto nCompLen = (size_t)(m_ReadLen[1]) + 255;
-
-                                            if(nCompLen > stSMSG.DataLen()){
-                                                // 1. close the asio socket
-                                                Shutdown();
-
-                                                // 2. record the error code but not exit?
-                                                extern Log *g_Log;
-                                                g_Log->AddLog(LOGTYPE_WARNING, "Invalid package: CompLen = %d", (int)(nCompLen));
-                                                fnReportCurrentMessage();
-
-                                                // 3. we stop here
-                                                //    should we have some method to save it?
-                                                return;
-                                            }else{ DoReadBody(stSMSG.MaskLen(), nCompLen); }
-                                        }
-                                    };
-                                    asio::async_read(m_Socket, asio::buffer(m_ReadLen + 1, 1), fnOnReadLen1);
-                                }
-                            }
-                        };
-                        asio::async_read(m_Socket, asio::buffer(m_ReadLen, 1), fnOnReadLen0);
-                        return;
-                    }
-                case 2:
-                    {
-                        DoReadBody(0, stSMSG.DataLen());
-                        return;
-                    }
-                case 3:
-                    {
-                        auto fnOnReadLen = [this, fnOnNetError](std::error_code stEC, size_t){
-                            if(stEC){ fnOnNetError(stEC); }
-                            else{
-                                uint32_t nDataLenU32 = 0;
-                                std::memcpy(&nDataLenU32, m_ReadLen, 4);
-                                DoReadBody(0, nDataLenU32);
-                            }
-                        };
-                        asio::async_read(m_Socket, asio::buffer(m_ReadLen, 4), fnOnReadLen);
-                        return;
-                    }
-                default:
-                    {
-                        Shutdown();
-                        fnReportCurrentMessage();
-                        return;
-                    }
+        // call completion handler for all complete messages
+        // data passed to handler is only valid during the invocation
+        m_ReadParser.Commit(nReadBytes);
+        auto nParsed = m_ReadParser.Parse([this](uint8_t nHC, const uint8_t *pData, size_t nDataLen){
+            if(m_OnReadDone){
+                m_OnReadDone(nHC, pData, nDataLen);
             }
-        }
-    };
-    asio::async_read(m_Socket, asio::buffer(&m_ReadHC, 1), fnOnReadHC);
-}
-
-bool NetIO::DoReadBody(size_t nMaskLen, size_t nBodyLen)
-{
-    auto fnReportCurrentMessage = [this](){
-        extern Log *g_Log;
-        g_Log->AddLog(LOGTYPE_WARNING, "Current SMSGParam::HC      = %d", (int)(m_ReadHC));
-        g_Log->AddLog(LOGTYPE_WARNING, "                 ::Type    = %d", (int)(SMSGParam(m_ReadHC).Type()));
-        g_Log->AddLog(LOGTYPE_WARNING, "                 ::MaskLen = %d", (int)(SMSGParam(m_ReadHC).MaskLen()));
-        g_Log->AddLog(LOGTYPE_WARNING, "                 ::DataLen = %d", (int)(SMSGParam(m_ReadHC).DataLen()));
-    };
+        });
 
-    auto fnOnNetError = [this, fnReportCurrentMessage](std::error_code stEC){
-        if(stEC){
-            // 1. close the asio socket
+        if(nParsed < 0){
+            // stream is corrupted
+            // no way to find where next message starts
             Shutdown();
 
-            // 2. record the error code to log
             extern Log *g_Log;
-            g_Log->AddLog(LOGTYPE_WARNING, "Network error: %s", stEC.message().c_str());
-            fnReportCurrentMessage();
+            g_Log->AddLog(LOGTYPE_WARNING, "Invalid message: %s", m_ReadParser.ErrorInfo().c_str());
+            return;
         }
-    };
-
-    auto fnReportInvalidArg = [nMaskLen, nBodyLen, fnReportCurrentMessage]()
-    {
-        extern Log *g_Log;
-        g_Log->AddLog(LOGTYPE_WARNING, "Invalid argument to DoReadBody(MaskLen = %d, BodyLen = %d)", (int)(nMaskLen), (int)(nBodyLen));
-        fnReportCurrentMessage();
-    };
-
-    SMSGParam stSMSG(m_ReadHC);
-    switch(stSMSG.Type()){
-        case 0:
-            {
-                fnReportInvalidArg();
-                return false;
-            }
-        case 1:
-            {
-                if(!((nMaskLen == stSMSG.MaskLen()) && (nBodyLen <= stSMSG.DataLen()))){
-                    fnReportInvalidArg();
-                    return false;
-                }
-                m_ReadBuf.resize(nMaskLen + nBodyLen + 8 + stSMSG.DataLen());
-                break;
-            }
-        case 2:
-            {
-                if(nMaskLen || (nBodyLen != stSMSG.DataLen())){
-                    fnReportInvalidArg();
-                    return false;
-                }
-                m_ReadBuf.resize(stSMSG.DataLen());
-                break;
-            }
-        case 3:
-            {
-                if(nMaskLen || (nBodyLen > 0XFFFFFFFF)){
-                    fnReportInvalidArg();
-                    return false;
-                }
-                m_ReadBuf.resize(stSMSG.DataLen());
-                break;
-            }
-        default:
-            {
-                fnReportInvalidArg();
-                return false;
-            }
-    }
-
-    if(auto nDataLen = nMaskLen + nBodyLen){
-        auto fnDoneReadData = [this, nMaskLen, nBodyLen, stSMSG, fnReportCurrentMessage, fnOnNetError](std::error_code stEC, size_t){
-            if(stEC){ fnOnNetError(stEC); }
-            else{
-                if(nMaskLen){
-                    auto nMaskCount = Compress::CountMask(&(m_ReadBuf[0]), nMaskLen);
-                    if(nMaskCount != (int)(nBodyLen)){
-                        // we get corrupted data
-                        // should we ignore current package or kill the process?
-
-                        // 1. keep a log for the corrupted message
-                        extern Log *g_Log;
-                        g_Log->AddLog(LOGTYPE_WARNING, "Corrupted data: MaskCount = %d, CompLen = %d", nMaskCount, (int)(nBodyLen));
-                        fnReportCurrentMessage();
-
-                        // 2. we ignore this message
-                        //    won't shutdown current session, just return?
-                        return;
-                    }
-
-                    if(nBodyLen <= stSMSG.DataLen()){
-                        auto pMaskData = &(m_ReadBuf[0]);
-                        auto pCompData = &(m_ReadBuf[nMaskLen]);
-                        auto pOrigData = &(m_ReadBuf[((nMaskLen + nBodyLen + 7) / 8) * 8]);
-                        if(Compress::Decode(pOrigData, stSMSG.DataLen(), pMaskData, pCompData) != (int)(nBodyLen)){
-                            extern Log *g_Log;
-                            g_Log->AddLog(LOGTYPE_WARNING, "Decode failed: MaskCount = %d, CompLen = %d", nMaskCount, (int)(nBodyLen));
-                            fnReportCurrentMessage();
-                            return;
-                        }
-                    }else{
-                        extern Log *g_Log;
-                        g_Log->AddLog(LOGTYPE_WARNING, "Corrupted data: DataLen = %d, CompLen = %d", (int)(stSMSG.DataLen()), (int)(nBodyLen));
-                        fnReportCurrentMessage();
-                        return;
-                    }
-                }
-
-                // no matter decoding is needed or not
-                // we should call the completion handler here
-
-                // 1. call completion on decompressed data
-                if(m_OnReadDone){
-                    m_OnReadDone(m_ReadHC, &(m_ReadBuf[nMaskLen ? ((nMaskLen + nBodyLen + 7) / 8 * 8) : 0]), nMaskLen ? stSMSG.DataLen() : nBodyLen);
-                }
-
-                // 2. read next DoReadHC()
-                DoReadHC();
-            }
-        };
-        asio::async_read(m_Socket, asio::buffer(&(m_ReadBuf[0]), nDataLen), fnDoneReadData);
-        return true;
-    }
-
-    // I report error when read boyd at mode-0 
-    // but still if in mode3 and we're transfering empty message we can reach here
-    if(m_OnReadDone){ m_OnReadDone(m_ReadHC, nullptr, 0); }
-    DoReadHC();
-    return true;
+        DoRead();
+    });
 }
 
 void NetIO::DoSendNext()
 {
-    condcheck(!m_SendQueue.empty());
+    condcheck(m_SendHead < m_SendQueue.size());
 
-    if(m_SendQueue.front().OnDone){
-        m_SendQueue.front().OnDone();
+    // copy it out, the callback may grow the queue
+    auto stPack = m_SendQueue[m_SendHead++];
+    if(stPack.DoneToken){
+        if(auto fnDone = m_DoneTable.Take(stPack.DoneToken)){
+            fnDone();
+        }
     }
 
-    if(m_SendQueue.front().Data){
-        m_MemoryPN.Free(const_cast<uint8_t *>(m_SendQueue.front().Data));
+    if(stPack.Data){
+        m_MemoryPN.Free(const_cast<uint8_t *>(stPack.Data));
     }
 
-    m_SendQueue.pop();
-    if(!m_SendQueue.empty()){ DoSendHC(); }
+    if(m_SendHead < m_SendQueue.size()){
+        DoSendHC();
+    }else{
+        m_SendQueue.clear();
+        m_SendHead = 0;
+    }
 }
 
 void NetIO::DoSendBuf()
 {
-    condcheck(!m_SendQueue.empty());
-    if(m_SendQueue.front().Data && m_SendQueue.front().DataLen){
+    condcheck(m_SendHead < m_SendQueue.size());
+    if(m_SendQueue[m_SendHead].Data && m_SendQueue[m_SendHead].DataLen){
         auto fnDoSendValidBuf = [this](std::error_code stEC, size_t){
             if(stEC){
                 // 1. close the asio socket
@@ -395,13 +199,15 @@ void NetIO::DoSendBuf()
                 g_Log->AddLog(LOGTYPE_WARNING, "Network error: %s", stEC.message().c_str());
             }else{ DoSendNext(); }
         };
-        asio::async_write(m_Socket, asio::buffer(m_SendQueue.front().Data, m_SendQueue.front().DataLen), fnDoSendValidBuf);
+        asio::async_write(m_Socket, asio::buffer(m_SendQueue[m_SendHead].Data, m_SendQueue[m_SendHead].DataLen), fnDoSendValidBuf);
     }else{ DoSendNext(); }
 }
 
 void NetIO::DoSendHC()
 {
-    asio::async_write(m_Socket, asio::buffer(&(m_SendQueue.front().HC), 1),
+    // the queue may reallocate when writing, refer to the copy
+    m_SendHC = m_SendQueue[m_SendHead].HC;
+    asio::async_write(m_Socket, asio::buffer(&m_SendHC, 1),
         [this](std::error_code stEC, size_t){
             if(stEC){
                 // 1. close the asio socket
@@ -528,10 +334,11 @@ bool NetIO::Send(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::functi
     }
 
     // post the handler to the main loop
-    // we'll change fnDone in lambda so have to make it mutable
-    m_IO.post([this, nHC, pEncodeData, nEncodeSize, fnDone = std::move(fnDone)]() mutable {
-        bool bEmpty = m_SendQueue.empty();
-        m_SendQueue.emplace(nHC, pEncodeData, nEncodeSize, std::move(fnDone));
+    // only the trivial pack is captured, callback waits in the table
+    SendPack stPack(nHC, m_DoneTable.Add(std::move(fnDone)), pEncodeData, nEncodeSize);
+    m_IO.post([this, stPack](){
+        bool bEmpty = (m_SendHead == m_SendQueue.size());
+        m_SendQueue.push_back(stPack);
 
         //  if this is the only task
         //  we should start the flush procedure
@@ -573,9 +380,12 @@ bool NetIO::InitIO(const char *szIP, const char * szPort, const std::function<vo
                 // 3. the main loop can check socket::is_open()
                 //    to inform the user that current socket is working or run into errors
 
-                // 4. else call DoReadHC() to get the first HC
-                //    all DoReadHC() should be called after the invocation of completion handler
-            }else{ DoReadHC(); }
+                // 4. else call DoRead() to start receiving
+                //    DoRead() calls itself after all received messages are handled
+            }else{
+                m_Connected = true;
+                DoRead();
+            }
         }
     );
 
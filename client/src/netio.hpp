@@ -28,11 +28,15 @@
 
 #pragma once
 
-#include <queue>
+#include <vector>
 #include <asio.hpp>
 #include <functional>
+#include <type_traits>
 
+#include "message.hpp"
+#include "donetable.hpp"
 #include "memorychunkpn.hpp"
+#include "netframeparser.hpp"
 
 class NetIO final
 {
@@ -40,27 +44,36 @@ class NetIO final
         struct SendPack
         {
             uint8_t  HC;
+            uint32_t DoneToken;         // callback in m_DoneTable, 0 if no callback
 
             const uint8_t *Data;        // buffer from internal pool
             size_t         DataLen;     // data size rather the buffer capacity
 
-            std::function<void()> OnDone;
+            SendPack() = default;
 
             // constructor of SendPack
             // we don't define the destructor of SendPack
             // Data will be explicitly released in DoSendNext()
-            SendPack(uint8_t, const uint8_t *, size_t, std::function<void()> &&);
+            SendPack(uint8_t, uint32_t, const uint8_t *, size_t);
         };
 
+        // trivial pack is posted to the io loop by value
+        // then sending without callback never allocates a std::function
+        static_assert(std::is_pod<SendPack>::value, "SendPack should be trivial");
+
     private:
         asio::io_service        m_IO;
         asio::ip::tcp::resolver m_Resolver;
         asio::ip::tcp::socket   m_Socket;
 
     private:
-        uint8_t              m_ReadHC;
-        uint8_t              m_ReadLen[4];
-        std::vector<uint8_t> m_ReadBuf;
+        // set when connection established, reset by Shutdown()
+        // send before connected fails the async_write and closes the socket
+        bool m_Connected;
+
+    private:
+        // read by chunks, one read may contain many messages
+        NetFrameParser<SMSGParam> m_ReadParser;
 
     private:
         // Game::InitASIO() provide the completion handler for read messages
@@ -68,7 +81,16 @@ class NetIO final
         std::function<void(uint8_t, const uint8_t *, size_t)> m_OnReadDone;
 
     private:
-        std::queue<SendPack> m_SendQueue;
+        // packs are sent from m_SendHead one by one, the queue is cleared when all sent
+        // then the capacity is reused, m_SendHC is the copy of HC in writing since the queue may grow
+        std::vector<SendPack> m_SendQueue;
+        size_t                m_SendHead;
+        uint8_t               m_SendHC;
+
+    private:
+        // callbacks of packs in m_SendQueue
+        // Send() is called by the thread polling NetIO, so no lock
+        DoneTable m_DoneTable;
 
     private:
         MemoryChunkPN<64, 256, 1> m_MemoryPN;
@@ -82,6 +104,12 @@ class NetIO final
         void PollIO();
         void StopIO();
 
+    public:
+        bool Connected() const
+        {
+            return m_Connected;
+        }
+
     private:
         void Shutdown();
 
@@ -138,6 +166,5 @@ class NetIO final
         void DoSendNext();
 
     private:
-        void DoReadHC();
-        bool DoReadBody(size_t, size_t);
+        void DoRead();
 };
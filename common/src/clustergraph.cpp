@@ -0,0 +1,445 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: clustergraph.cpp
+ *        Created: 10/19/2026 02:14:51
+ *  Last Modified: 10/19/2026 02:14:51
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstdio>
+#include <string>
+#include <algorithm>
+#include <unordered_map>
+#include "clustergraph.hpp"
+
+// cache file layout, all in native byte order:
+//
+//      header
+//      m_NodeV, m_EdgeOffV, m_EdgeV, m_ClusterOffV, m_ClusterNodeV, m_KeyNodeV
+//
+// size of each array is in the header
+struct ClusterGraphFileHeader
+{
+    uint32_t Magic;
+    int32_t  W;
+    int32_t  H;
+    int32_t  ClusterSize;
+    uint64_t Hash;
+
+    uint32_t NodeCount;
+    uint32_t EdgeOffCount;
+    uint32_t EdgeCount;
+    uint32_t ClusterOffCount;
+    uint32_t ClusterNodeCount;
+    uint32_t KeyNodeCount;
+};
+
+// "HPA1", change it if the layout changes
+const uint32_t CLUSTERGRAPH_MAGIC = 0X31415048;
+
+uint64_t ClusterGraph::BuildHash(const GroundMask &rstGround, int nClusterSize, const std::vector<PathFind::PathNode> &rstKeyV)
+{
+    uint64_t nHash = rstGround.Hash();
+    auto fnMix = [&nHash](int nValue)
+    {
+        nHash ^= (uint64_t)(uint32_t)(nValue);
+        nHash *= 0X00000100000001B3ULL;
+    };
+
+    fnMix(nClusterSize);
+    fnMix((int)(rstKeyV.size()));
+
+    for(auto &rstKey: rstKeyV){
+        fnMix(rstKey.X);
+        fnMix(rstKey.Y);
+    }
+    return nHash;
+}
+
+void ClusterGraph::FloodCluster(const GroundMask &rstGround, int nX, int nY, std::vector<uint16_t> *pDistV, std::vector<int> *pQueueV) const
+{
+    int nCX0 = (nX / m_ClusterSize) * m_ClusterSize;
+    int nCY0 = (nY / m_ClusterSize) * m_ClusterSize;
+    int nCW  = std::min<int>(m_ClusterSize, m_W - nCX0);
+    int nCH  = std::min<int>(m_ClusterSize, m_H - nCY0);
+
+    pDistV->assign(m_ClusterSize * m_ClusterSize, 0XFFFF);
+    pQueueV->clear();
+
+    if(!rstGround.Valid(nX, nY)){
+        return;
+    }
+
+    (*pDistV)[(nY - nCY0) * m_ClusterSize + (nX - nCX0)] = 0;
+    pQueueV->push_back((nY - nCY0) * m_ClusterSize + (nX - nCX0));
+
+    for(size_t nHead = 0; nHead < pQueueV->size(); ++nHead){
+        int nIndex = (*pQueueV)[nHead];
+        int nCurrX = nIndex % m_ClusterSize;
+        int nCurrY = nIndex / m_ClusterSize;
+
+        auto nNextDist = (uint16_t)((*pDistV)[nIndex] + 1);
+        for(int nDY = -1; nDY <= 1; ++nDY){
+            for(int nDX = -1; nDX <= 1; ++nDX){
+                int nNextX = nCurrX + nDX;
+                int nNextY = nCurrY + nDY;
+
+                if(false
+                        || (nDX == 0 && nDY == 0)
+                        || nNextX < 0
+                        || nNextY < 0
+                        || nNextX >= nCW
+                        || nNextY >= nCH){
+                    continue;
+                }
+
+                int nNextIndex = nNextY * m_ClusterSize + nNextX;
+                if(true
+                        && (*pDistV)[nNextIndex] == 0XFFFF
+                        && rstGround.Valid(nCX0 + nNextX, nCY0 + nNextY)){
+                    (*pDistV)[nNextIndex] = nNextDist;
+                    pQueueV->push_back(nNextIndex);
+                }
+            }
+        }
+    }
+}
+
+void ClusterGraph::Build(const GroundMask &rstGround, int nClusterSize, const std::vector<PathFind::PathNode> &rstKeyV)
+{
+    m_W           = rstGround.W();
+    m_H           = rstGround.H();
+    m_ClusterSize = std::max<int>(4, nClusterSize);
+    m_ClusterW    = (m_W + m_ClusterSize - 1) / m_ClusterSize;
+    m_ClusterH    = (m_H + m_ClusterSize - 1) / m_ClusterSize;
+    m_Hash        = BuildHash(rstGround, nClusterSize, rstKeyV);
+
+    m_NodeV.clear();
+    m_EdgeOffV.clear();
+    m_EdgeV.clear();
+    m_ClusterOffV.clear();
+    m_ClusterNodeV.clear();
+    m_KeyNodeV.clear();
+
+    std::unordered_map<int, int> stNodeOffset;
+    auto fnAddNode = [this, &stNodeOffset](int nX, int nY) -> int
+    {
+        auto pOffset = stNodeOffset.find(nY * m_W + nX);
+        if(pOffset != stNodeOffset.end()){
+            return pOffset->second;
+        }
+
+        stNodeOffset[nY * m_W + nX] = (int)(m_NodeV.size());
+        m_NodeV.push_back({nX, nY});
+        return (int)(m_NodeV.size()) - 1;
+    };
+
+    std::vector<std::vector<Edge>> stAdjV;
+    auto fnAddPortal = [&fnAddNode, &stAdjV](int nX0, int nY0, int nX1, int nY1)
+    {
+        int nNode0 = fnAddNode(nX0, nY0);
+        int nNode1 = fnAddNode(nX1, nY1);
+
+        stAdjV.resize(std::max<size_t>(stAdjV.size(), std::max<int>(nNode0, nNode1) + 1));
+        stAdjV[nNode0].push_back({nNode1, 1});
+        stAdjV[nNode1].push_back({nNode0, 1});
+    };
+
+    // 1. portals on the borders
+    //    one entrance is a run of cell pairs facing each other across the border, inside one
+    //    cluster pair, short entrance gets one portal in the middle, long one gets one at each end
+    //
+    //    with 8 directions two clusters can also touch only by a corner, i.e. (x0, y) and (x1, y + 1)
+    //    are valid but (x1, y) and (x0, y + 1) are not, add a portal for it, otherwise the path
+    //    can go through one of the two cells and is covered by the straight entrances
+    auto fnScanBorder = [this, &rstGround, &fnAddPortal](bool bVertical, int nBorder)
+    {
+        // map (nAlong, nSide) to cells, nSide 0 is the cell before the border
+        auto fnCellX = [bVertical, nBorder](int nAlong, int nSide) -> int { return bVertical ? (nBorder - 1 + nSide) : nAlong; };
+        auto fnCellY = [bVertical, nBorder](int nAlong, int nSide) -> int { return bVertical ? nAlong : (nBorder - 1 + nSide); };
+        auto fnValid = [&rstGround, &fnCellX, &fnCellY](int nAlong, int nSide) -> bool
+        {
+            return rstGround.Valid(fnCellX(nAlong, nSide), fnCellY(nAlong, nSide));
+        };
+
+        auto fnAddEntrance = [&fnAddPortal, &fnCellX, &fnCellY](int nAlong0, int nAlong1)
+        {
+            if(nAlong1 - nAlong0 + 1 < 6){
+                int nMid = (nAlong0 + nAlong1) / 2;
+                fnAddPortal(fnCellX(nMid, 0), fnCellY(nMid, 0), fnCellX(nMid, 1), fnCellY(nMid, 1));
+            }else{
+                fnAddPortal(fnCellX(nAlong0, 0), fnCellY(nAlong0, 0), fnCellX(nAlong0, 1), fnCellY(nAlong0, 1));
+                fnAddPortal(fnCellX(nAlong1, 0), fnCellY(nAlong1, 0), fnCellX(nAlong1, 1), fnCellY(nAlong1, 1));
+            }
+        };
+
+        int nLength = bVertical ? m_H : m_W;
+        int nStart  = -1;
+
+        for(int nAlong = 0; nAlong < nLength; ++nAlong){
+            bool bOpen = fnValid(nAlong, 0) && fnValid(nAlong, 1);
+            if(bOpen && nStart < 0){
+                nStart = nAlong;
+            }
+
+            // entrance ends at a blocked pair, or at the border of the cluster
+            if(nStart >= 0 && (!bOpen || (nAlong + 1) % m_ClusterSize == 0 || nAlong + 1 == nLength)){
+                fnAddEntrance(nStart, bOpen ? nAlong : (nAlong - 1));
+                nStart = -1;
+            }
+
+            if(nAlong + 1 < nLength){
+                if(true
+                        && fnValid(nAlong, 0) && fnValid(nAlong + 1, 1)
+                        && !fnValid(nAlong, 1) && !fnValid(nAlong + 1, 0)){
+                    fnAddPortal(fnCellX(nAlong, 0), fnCellY(nAlong, 0), fnCellX(nAlong + 1, 1), fnCellY(nAlong + 1, 1));
+                }
+
+                if(true
+                        && fnValid(nAlong + 1, 0) && fnValid(nAlong, 1)
+                        && !fnValid(nAlong, 0) && !fnValid(nAlong + 1, 1)){
+                    fnAddPortal(fnCellX(nAlong + 1, 0), fnCellY(nAlong + 1, 0), fnCellX(nAlong, 1), fnCellY(nAlong, 1));
+                }
+            }
+        }
+    };
+
+    for(int nBorderX = m_ClusterSize; nBorderX < m_W; nBorderX += m_ClusterSize){
+        fnScanBorder(true, nBorderX);
+    }
+
+    for(int nBorderY = m_ClusterSize; nBorderY < m_H; nBorderY += m_ClusterSize){
+        fnScanBorder(false, nBorderY);
+    }
+
+    // 2. key cells
+    for(auto &rstKey: rstKeyV){
+        if(rstGround.Valid(rstKey.X, rstKey.Y)){
+            m_KeyNodeV.push_back(fnAddNode(rstKey.X, rstKey.Y));
+        }else{
+            m_KeyNodeV.push_back(-1);
+        }
+    }
+
+    stAdjV.resize(m_NodeV.size());
+
+    // 3. group nodes by cluster
+    m_ClusterOffV.assign(m_ClusterW * m_ClusterH + 1, 0);
+    for(auto &rstNode: m_NodeV){
+        m_ClusterOffV[ClusterIndex(rstNode.X, rstNode.Y) + 1]++;
+    }
+
+    for(size_t nIndex = 1; nIndex < m_ClusterOffV.size(); ++nIndex){
+        m_ClusterOffV[nIndex] += m_ClusterOffV[nIndex - 1];
+    }
+
+    {
+        auto stFillV = m_ClusterOffV;
+        m_ClusterNodeV.resize(m_NodeV.size());
+        for(int nIndex = 0; nIndex < (int)(m_NodeV.size()); ++nIndex){
+            m_ClusterNodeV[stFillV[ClusterIndex(m_NodeV[nIndex].X, m_NodeV[nIndex].Y)]++] = nIndex;
+        }
+    }
+
+    // 4. edges inside each cluster
+    //    one flood per node, a cluster has only a few nodes
+    std::vector<uint16_t> stDistV;
+    std::vector<int>      stQueueV;
+
+    for(int nCluster = 0; nCluster < m_ClusterW * m_ClusterH; ++nCluster){
+        for(int nOff0 = m_ClusterOffV[nCluster]; nOff0 < m_ClusterOffV[nCluster + 1]; ++nOff0){
+            int  nNode0 = m_ClusterNodeV[nOff0];
+            auto stNode0 = m_NodeV[nNode0];
+
+            FloodCluster(rstGround, stNode0.X, stNode0.Y, &stDistV, &stQueueV);
+            for(int nOff1 = m_ClusterOffV[nCluster]; nOff1 < m_ClusterOffV[nCluster + 1]; ++nOff1){
+                int  nNode1 = m_ClusterNodeV[nOff1];
+                auto stNode1 = m_NodeV[nNode1];
+
+                auto nDist = stDistV[(stNode1.Y % m_ClusterSize) * m_ClusterSize + (stNode1.X % m_ClusterSize)];
+                if(nNode1 != nNode0 && nDist != 0XFFFF){
+                    stAdjV[nNode0].push_back({nNode1, (int32_t)(nDist)});
+                }
+            }
+        }
+    }
+
+    // 5. flatten, keep the cheapest one of duplicated edges
+    m_EdgeOffV.push_back(0);
+    for(auto &rstEdgeV: stAdjV){
+        std::sort(rstEdgeV.begin(), rstEdgeV.end(), [](const Edge &rstLHS, const Edge &rstRHS) -> bool
+        {
+            return (rstLHS.To != rstRHS.To) ? (rstLHS.To < rstRHS.To) : (rstLHS.Cost < rstRHS.Cost);
+        });
+
+        for(size_t nIndex = 0; nIndex < rstEdgeV.size(); ++nIndex){
+            if(nIndex == 0 || rstEdgeV[nIndex].To != rstEdgeV[nIndex - 1].To){
+                m_EdgeV.push_back(rstEdgeV[nIndex]);
+            }
+        }
+        m_EdgeOffV.push_back((int32_t)(m_EdgeV.size()));
+    }
+}
+
+int ClusterGraph::Connect(const GroundMask &rstGround, int nX, int nY, int nEndX, int nEndY, std::vector<Edge> *pEdgeV) const
+{
+    if(pEdgeV){
+        pEdgeV->clear();
+    }
+
+    if(!(Valid() && rstGround.Valid(nX, nY))){
+        return -1;
+    }
+
+    std::vector<uint16_t> stDistV;
+    std::vector<int>      stQueueV;
+    FloodCluster(rstGround, nX, nY, &stDistV, &stQueueV);
+
+    int nCluster = ClusterIndex(nX, nY);
+    if(pEdgeV){
+        for(int nOff = m_ClusterOffV[nCluster]; nOff < m_ClusterOffV[nCluster + 1]; ++nOff){
+            auto &rstNode = m_NodeV[m_ClusterNodeV[nOff]];
+            auto  nDist   = stDistV[(rstNode.Y % m_ClusterSize) * m_ClusterSize + (rstNode.X % m_ClusterSize)];
+            if(nDist != 0XFFFF){
+                pEdgeV->push_back({m_ClusterNodeV[nOff], (int32_t)(nDist)});
+            }
+        }
+    }
+
+    if(true
+            && rstGround.Valid(nEndX, nEndY)
+            && ClusterIndex(nEndX, nEndY) == nCluster){
+        auto nDist = stDistV[(nEndY % m_ClusterSize) * m_ClusterSize + (nEndX % m_ClusterSize)];
+        return (nDist == 0XFFFF) ? -1 : (int)(nDist);
+    }
+    return -1;
+}
+
+bool ClusterGraph::Load(const char *szFileName, const GroundMask &rstGround, int nClusterSize, const std::vector<PathFind::PathNode> &rstKeyV)
+{
+    auto fp = std::fopen(szFileName ? szFileName : "", "rb");
+    if(!fp){
+        return false;
+    }
+
+    ClusterGraphFileHeader stHeader;
+    auto fnRead = [fp](void *pData, size_t nSize) -> bool
+    {
+        return !nSize || std::fread(pData, nSize, 1, fp) == 1;
+    };
+
+    bool bLoadOK = false;
+    if(true
+            && fnRead(&stHeader, sizeof(stHeader))
+            && stHeader.Magic        == CLUSTERGRAPH_MAGIC
+            && stHeader.W            == rstGround.W()
+            && stHeader.H            == rstGround.H()
+            && stHeader.ClusterSize  == std::max<int>(4, nClusterSize)
+            && stHeader.Hash         == BuildHash(rstGround, nClusterSize, rstKeyV)
+            && stHeader.KeyNodeCount == rstKeyV.size()
+            && stHeader.EdgeOffCount == stHeader.NodeCount + 1){
+
+        m_NodeV       .resize(stHeader.NodeCount);
+        m_EdgeOffV    .resize(stHeader.EdgeOffCount);
+        m_EdgeV       .resize(stHeader.EdgeCount);
+        m_ClusterOffV .resize(stHeader.ClusterOffCount);
+        m_ClusterNodeV.resize(stHeader.ClusterNodeCount);
+        m_KeyNodeV    .resize(stHeader.KeyNodeCount);
+
+        bLoadOK = true
+            && fnRead(m_NodeV       .data(), m_NodeV       .size() * sizeof(m_NodeV       [0]))
+            && fnRead(m_EdgeOffV    .data(), m_EdgeOffV    .size() * sizeof(m_EdgeOffV    [0]))
+            && fnRead(m_EdgeV       .data(), m_EdgeV       .size() * sizeof(m_EdgeV       [0]))
+            && fnRead(m_ClusterOffV .data(), m_ClusterOffV .size() * sizeof(m_ClusterOffV [0]))
+            && fnRead(m_ClusterNodeV.data(), m_ClusterNodeV.size() * sizeof(m_ClusterNodeV[0]))
+            && fnRead(m_KeyNodeV    .data(), m_KeyNodeV    .size() * sizeof(m_KeyNodeV    [0]));
+    }
+    std::fclose(fp);
+
+    if(bLoadOK){
+        m_W           = stHeader.W;
+        m_H           = stHeader.H;
+        m_ClusterSize = stHeader.ClusterSize;
+        m_ClusterW    = (m_W + m_ClusterSize - 1) / m_ClusterSize;
+        m_ClusterH    = (m_H + m_ClusterSize - 1) / m_ClusterSize;
+        m_Hash        = stHeader.Hash;
+
+        // the hash doesn't cover the arrays, check they're consistent before any use
+        bLoadOK = true
+            && m_ClusterOffV.size() == (size_t)(m_ClusterW * m_ClusterH + 1)
+            && m_ClusterOffV.back() == (int32_t)(m_ClusterNodeV.size())
+            && m_EdgeOffV.back()    == (int32_t)(m_EdgeV.size())
+            && std::all_of(m_EdgeV.begin(), m_EdgeV.end(), [this](const Edge &rstEdge){ return rstEdge.To >= 0 && rstEdge.To < NodeCount(); });
+    }
+
+    if(!bLoadOK){
+        *this = ClusterGraph();
+    }
+    return bLoadOK;
+}
+
+bool ClusterGraph::Save(const char *szFileName) const
+{
+    if(!Valid()){
+        return false;
+    }
+
+    ClusterGraphFileHeader stHeader;
+    stHeader.Magic            = CLUSTERGRAPH_MAGIC;
+    stHeader.W                = m_W;
+    stHeader.H                = m_H;
+    stHeader.ClusterSize      = m_ClusterSize;
+    stHeader.Hash             = m_Hash;
+    stHeader.NodeCount        = (uint32_t)(m_NodeV       .size());
+    stHeader.EdgeOffCount     = (uint32_t)(m_EdgeOffV    .size());
+    stHeader.EdgeCount        = (uint32_t)(m_EdgeV       .size());
+    stHeader.ClusterOffCount  = (uint32_t)(m_ClusterOffV .size());
+    stHeader.ClusterNodeCount = (uint32_t)(m_ClusterNodeV.size());
+    stHeader.KeyNodeCount     = (uint32_t)(m_KeyNodeV    .size());
+
+    if(!szFileName){
+        return false;
+    }
+
+    // write a temp file and rename it, then a reader never sees a half-written file
+    // and a crash during saving leaves the old cache untouched
+    auto szTempFileName = std::string(szFileName) + ".tmp";
+    auto fp = std::fopen(szTempFileName.c_str(), "wb");
+    if(!fp){
+        return false;
+    }
+
+    auto fnWrite = [fp](const void *pData, size_t nSize) -> bool
+    {
+        return !nSize || std::fwrite(pData, nSize, 1, fp) == 1;
+    };
+
+    bool bSaveOK = true
+        && fnWrite(&stHeader, sizeof(stHeader))
+        && fnWrite(m_NodeV       .data(), m_NodeV       .size() * sizeof(m_NodeV       [0]))
+        && fnWrite(m_EdgeOffV    .data(), m_EdgeOffV    .size() * sizeof(m_EdgeOffV    [0]))
+        && fnWrite(m_EdgeV       .data(), m_EdgeV       .size() * sizeof(m_EdgeV       [0]))
+        && fnWrite(m_ClusterOffV .data(), m_ClusterOffV .size() * sizeof(m_ClusterOffV [0]))
+        && fnWrite(m_ClusterNodeV.data(), m_ClusterNodeV.size() * sizeof(m_ClusterNodeV[0]))
+        && fnWrite(m_KeyNodeV    .data(), m_KeyNodeV    .size() * sizeof(m_KeyNodeV    [0]));
+
+    bSaveOK = (std::fclose(fp) == 0) && bSaveOK;
+    if(bSaveOK && std::rename(szTempFileName.c_str(), szFileName) == 0){
+        return true;
+    }
+
+    std::remove(szTempFileName.c_str());
+    return false;
+}
@@ -0,0 +1,168 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: clustergraph.hpp
+ *        Created: 10/19/2026 02:14:51
+ *  Last Modified: 10/19/2026 02:14:51
+ *
+ *    Description: abstract graph of one map for hierarchical path finding (HPA*)
+ *
+ *                 map is split into clusters of ClusterSize x ClusterSize cells, nodes are:
+ *
+ *                      1. portals, two cells facing each other across a cluster border,
+ *                         one portal for a short entrance, two for a long one
+ *                      2. key cells given by the caller, like the map switch points
+ *
+ *                 edges are:
+ *
+ *                      1. between two cells of a portal, cost 1
+ *                      2. between nodes of the same cluster, cost is the step count of
+ *                         the shortest path staying inside the cluster
+ *
+ *                 steps are 8 directions and each costs 1, same as motions on the server
+ *
+ *                 a route search runs on this graph instead of the grid, start and goal
+ *                 are connected to nodes of their clusters by Connect(), consecutive nodes
+ *                 of a route are in one cluster, then refining it needs only small searches
+ *
+ *                 graph is immutable after Build() / Load(), can be shared by threads
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "pathfinder.hpp"
+#include "groundmask.hpp"
+
+class ClusterGraph final
+{
+    public:
+        struct Node
+        {
+            int32_t X;
+            int32_t Y;
+        };
+
+        struct Edge
+        {
+            int32_t To;
+            int32_t Cost;
+        };
+
+    private:
+        int m_W;
+        int m_H;
+        int m_ClusterSize;
+        int m_ClusterW;
+        int m_ClusterH;
+
+    private:
+        // hash of the ground, cluster size and key cells the graph is built from
+        // cache on disk is outdated if it doesn't match
+        uint64_t m_Hash;
+
+    private:
+        std::vector<Node> m_NodeV;
+
+        // edges of node i are m_EdgeV[m_EdgeOffV[i]] ~ m_EdgeV[m_EdgeOffV[i + 1] - 1]
+        std::vector<int32_t> m_EdgeOffV;
+        std::vector<Edge>    m_EdgeV;
+
+        // nodes of cluster i are m_ClusterNodeV[m_ClusterOffV[i]] ~ m_ClusterNodeV[m_ClusterOffV[i + 1] - 1]
+        std::vector<int32_t> m_ClusterOffV;
+        std::vector<int32_t> m_ClusterNodeV;
+
+        // node of each key cell, -1 if the key cell is not on valid ground
+        std::vector<int32_t> m_KeyNodeV;
+
+    public:
+        ClusterGraph()
+            : m_W(0)
+            , m_H(0)
+            , m_ClusterSize(0)
+            , m_ClusterW(0)
+            , m_ClusterH(0)
+            , m_Hash(0)
+            , m_NodeV()
+            , m_EdgeOffV()
+            , m_EdgeV()
+            , m_ClusterOffV()
+            , m_ClusterNodeV()
+            , m_KeyNodeV()
+        {}
+
+    public:
+        void Build(const GroundMask &, int, const std::vector<PathFind::PathNode> &);
+
+    public:
+        // load from the cache file, fails if it's built from different arguments
+        bool Load(const char *, const GroundMask &, int, const std::vector<PathFind::PathNode> &);
+        bool Save(const char *) const;
+
+    public:
+        bool Valid() const
+        {
+            return !m_EdgeOffV.empty();
+        }
+
+        int NodeCount() const
+        {
+            return (int)(m_NodeV.size());
+        }
+
+        int EdgeCount() const
+        {
+            return (int)(m_EdgeV.size());
+        }
+
+        const Node &GetNode(int nIndex) const
+        {
+            return m_NodeV[nIndex];
+        }
+
+        const Edge *EdgeBegin(int nIndex) const
+        {
+            return m_EdgeV.data() + m_EdgeOffV[nIndex];
+        }
+
+        const Edge *EdgeEnd(int nIndex) const
+        {
+            return m_EdgeV.data() + m_EdgeOffV[nIndex + 1];
+        }
+
+        int KeyNode(int nKeyIndex) const
+        {
+            if(nKeyIndex >= 0 && nKeyIndex < (int)(m_KeyNodeV.size())){
+                return m_KeyNodeV[nKeyIndex];
+            }
+            return -1;
+        }
+
+    public:
+        // connect (nX, nY) to nodes of its cluster, the path stays inside the cluster
+        // return the step count to (nEndX, nEndY) if it's reachable inside the same cluster, otherwise -1
+        int Connect(const GroundMask &, int, int, int, int, std::vector<Edge> *) const;
+
+    private:
+        int ClusterIndex(int nX, int nY) const
+        {
+            return (nY / m_ClusterSize) * m_ClusterW + (nX / m_ClusterSize);
+        }
+
+    private:
+        // BFS from (nX, nY) inside its cluster, pDistV is indexed by the offset in the cluster
+        void FloodCluster(const GroundMask &, int, int, std::vector<uint16_t> *, std::vector<int> *) const;
+
+    private:
+        static uint64_t BuildHash(const GroundMask &, int, const std::vector<PathFind::PathNode> &);
+};
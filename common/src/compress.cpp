@@ -3,7 +3,7 @@
  *
  *       Filename: compress.cpp
  *        Created: 04/23/2017 21:34:23
- *  Last Modified: 12/15/2017 19:31:43
+ *  Last Modified: 10/18/2026 18:02:37
  *
  *    Description: 
  *
@@ -18,58 +18,372 @@
  * =====================================================================================
  */
 
-#include <memory>
 #include <cstring>
 #include "compress.hpp"
 
-int Compress::CountMask(const uint8_t *pData, size_t nDataLen)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COMPRESS_USE_X86
+#include <immintrin.h>
+#endif
+
+// compress scheme:
+//
+//      [Mask: (DataLen + 7) / 8 bytes][CompData: bytes of Data which are not zero]
+//
+// bit (i % 8) of Mask[i / 8] set means Data[i] is not zero and it's in CompData
+// all kernels below produce exactly the same output, they only differ in speed
+//
+// kernels assume arguments are checked by the Compress:: entries
+
+static int CountMaskScalar(const uint8_t *pData, size_t nDataLen)
 {
-    if(pData){
-        int  nMaskCount = 0;
-        auto pOrigBegin = pData;
+    int    nMaskCount = 0;
+    size_t nIndex     = 0;
+
+    // memcpy avoids the strict-aliasing / alignment issue of casting pData
+    for(; nIndex + 8 <= nDataLen; nIndex += 8){
+        uint64_t nWord = 0;
+        std::memcpy(&nWord, pData + nIndex, 8);
+        nMaskCount += __builtin_popcountll(nWord);
+    }
+
+    for(; nIndex < nDataLen; ++nIndex){
+        nMaskCount += __builtin_popcount((unsigned int)(pData[nIndex]));
+    }
+    return nMaskCount;
+}
+
+static int CountDataScalar(const uint8_t *pData, size_t nDataLen)
+{
+    int nCount = 0;
+    for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
+        nCount += (pData[nIndex] ? 1 : 0);
+    }
+    return nCount;
+}
+
+static int EncodeScalar(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
+{
+    auto nMaskLen = ((nDataLen + 7) / 8);
+    auto pMask = pDst;
+    auto pComp = pDst + nMaskLen;
 
-        for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
-            nMaskCount += __builtin_popcount(pData[nIndex]);
+    std::memset(pMask, 0, nMaskLen);
+
+    int nDataCount = 0;
+    for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
+        if(pData[nIndex]){
+            pMask[nIndex / 8  ] |= (0X01 << (nIndex % 8));
+            pComp[nDataCount++]  = pData[nIndex];
         }
-        return nMaskCount;
+    }
+    return nDataCount;
+}
+
+static int DecodeScalar(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
+{
+    int nDecodeCount = 0;
+    for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
+        pOrig[nIndex] = (pMask[nIndex / 8] & (0x01 << (nIndex % 8))) ? pComp[nDecodeCount++] : 0;
+    }
+    return nDecodeCount;
+}
 
-        // need better understanding of std::align()
-        // http://en.cppreference.com/w/cpp/memory/align
-        // document says it does nothing if the given buffer is too small to fit
+#ifdef COMPRESS_USE_X86
 
-        // we may have smaller memory chunk at the begin and end of pData
-        // but [pData, pData + nDataLen) is enough to hold at least one unsign long long if not return nullptr
+// pshufb control for 8 bytes by one mask byte, used by Decode
+// s_ExpandShuffle[m]: scatter packed bytes to positions with bit set in m, others zero, used by Decode
+// 0X80 makes pshufb output zero
+static uint8_t s_ExpandShuffle[256][8];
 
-        // nasty casts, std::align only accpet (void * &)
-        auto pCastData = static_cast<void *>(const_cast<uint8_t *>(pData));
+static void InitShuffleTable()
+{
+    for(int nMask = 0; nMask < 256; ++nMask){
+        int nRank = 0;
+        for(int nBit = 0; nBit < 8; ++nBit){
+            s_ExpandShuffle[nMask][nBit] = 0X80;
+        }
 
-        // if succeed after this call pData and nDataLen will be adjusted
-        if(std::align(alignof(unsigned long long), sizeof(unsigned long long), pCastData, nDataLen)){
-            for(size_t nIndex = 0; nIndex < nDataLen; nIndex += sizeof(unsigned long long)){
-                // TODO remove the strict-aliasing issue here
-                nMaskCount += __builtin_popcountll(*((unsigned long long *)((const uint8_t *)(pCastData) + nIndex)));
+        for(int nBit = 0; nBit < 8; ++nBit){
+            if(nMask & (1 << nBit)){
+                s_ExpandShuffle[nMask][nBit] = (uint8_t)(nRank);
+                nRank++;
             }
         }
+    }
+}
+
+// scalar tail of the x86 kernels, nIndex should be multiple of 8
+static int EncodeTail(uint8_t *pMask, uint8_t *pComp, int nDataCount, const uint8_t *pData, size_t nIndex, size_t nDataLen)
+{
+    std::memset(pMask + nIndex / 8, 0, (nDataLen + 7) / 8 - nIndex / 8);
+    for(; nIndex < nDataLen; ++nIndex){
+        if(pData[nIndex]){
+            pMask[nIndex / 8  ] |= (0X01 << (nIndex % 8));
+            pComp[nDataCount++]  = pData[nIndex];
+        }
+    }
+    return nDataCount;
+}
+
+static int DecodeTail(uint8_t *pOrig, int nDecodeCount, const uint8_t *pMask, const uint8_t *pComp, size_t nIndex, size_t nDataLen)
+{
+    for(; nIndex < nDataLen; ++nIndex){
+        pOrig[nIndex] = (pMask[nIndex / 8] & (0x01 << (nIndex % 8))) ? pComp[nDecodeCount++] : 0;
+    }
+    return nDecodeCount;
+}
 
-        // we always do it no matter align succeed or not
-        pData = (const uint8_t *)(pCastData);
+__attribute__((target("sse2"))) static int CountMaskSSE2(const uint8_t *pData, size_t nDataLen)
+{
+    const __m128i stM1   = _mm_set1_epi8(0X55);
+    const __m128i stM2   = _mm_set1_epi8(0X33);
+    const __m128i stM4   = _mm_set1_epi8(0X0F);
+    const __m128i stZero = _mm_setzero_si128();
 
-        // for (possible) memory chunk at the begin
-        // pData could be adjusted by std::align() if succeed
-        for(const uint8_t *pBegin = pOrigBegin; pBegin < pData; ++pBegin){
-            nMaskCount += __builtin_popcount((unsigned int)(*pBegin));
+    // bit-slice popcount of each byte, then horizontal sum by psadbw
+    __m128i stSum  = _mm_setzero_si128();
+    size_t  nIndex = 0;
+    for(; nIndex + 16 <= nDataLen; nIndex += 16){
+        auto stData = _mm_loadu_si128((const __m128i *)(pData + nIndex));
+        stData = _mm_sub_epi8(stData, _mm_and_si128(_mm_srli_epi16(stData, 1), stM1));
+        stData = _mm_add_epi8(_mm_and_si128(stData, stM2), _mm_and_si128(_mm_srli_epi16(stData, 2), stM2));
+        stData = _mm_and_si128(_mm_add_epi8(stData, _mm_srli_epi16(stData, 4)), stM4);
+        stSum  = _mm_add_epi64(stSum, _mm_sad_epu8(stData, stZero));
+    }
+
+    uint64_t nSum[2];
+    _mm_storeu_si128((__m128i *)(nSum), stSum);
+    return (int)(nSum[0] + nSum[1]) + CountMaskScalar(pData + nIndex, nDataLen - nIndex);
+}
+
+__attribute__((target("sse2"))) static int CountDataSSE2(const uint8_t *pData, size_t nDataLen)
+{
+    const __m128i stZero = _mm_setzero_si128();
+
+    // count zero bytes, cmpeq gives 0XFF for zero byte, so subtract it to count
+    // byte counter overflows after 255 rounds, flush to 64-bit sum before that
+    size_t nZeroCount = 0;
+    size_t nIndex     = 0;
+    while(nIndex + 16 <= nDataLen){
+        __m128i stCount = _mm_setzero_si128();
+        for(int nRound = 0; (nRound < 255) && (nIndex + 16 <= nDataLen); ++nRound, nIndex += 16){
+            auto stData = _mm_loadu_si128((const __m128i *)(pData + nIndex));
+            stCount = _mm_sub_epi8(stCount, _mm_cmpeq_epi8(stData, stZero));
         }
 
-        // for (possible) memory chunk at the end
-        // pData and nDataLen could be adjusted by std::align() if succeed
-        if(auto nRest = nDataLen % sizeof(unsigned long long)){
-            for(size_t nIndex = nDataLen - nRest; nIndex < nDataLen; ++nIndex){
-                nMaskCount += __builtin_popcount((unsigned int)(pData[nIndex]));
+        uint64_t nSum[2];
+        _mm_storeu_si128((__m128i *)(nSum), _mm_sad_epu8(stCount, stZero));
+        nZeroCount += (size_t)(nSum[0] + nSum[1]);
+    }
+    return (int)(nIndex - nZeroCount) + CountDataScalar(pData + nIndex, nDataLen - nIndex);
+}
+
+__attribute__((target("sse2"))) static int EncodeSSE2(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
+{
+    auto pMask = pDst;
+    auto pComp = pDst + ((nDataLen + 7) / 8);
+
+    const __m128i stZero = _mm_setzero_si128();
+
+    int    nDataCount = 0;
+    size_t nIndex     = 0;
+    for(; nIndex + 16 <= nDataLen; nIndex += 16){
+        auto stData = _mm_loadu_si128((const __m128i *)(pData + nIndex));
+        auto nBits  = (~(unsigned int)(_mm_movemask_epi8(_mm_cmpeq_epi8(stData, stZero)))) & 0XFFFF;
+
+        pMask[nIndex / 8 + 0] = (uint8_t)(nBits & 0XFF);
+        pMask[nIndex / 8 + 1] = (uint8_t)(nBits >> 8);
+
+        if(nBits == 0XFFFF){
+            _mm_storeu_si128((__m128i *)(pComp + nDataCount), stData);
+            nDataCount += 16;
+        }else{
+            // can't pack by pshufb and store 8 bytes to pComp directly
+            // caller only allocates exactly CountData() bytes for the compressed data
+            while(nBits){
+                pComp[nDataCount++] = pData[nIndex + __builtin_ctz(nBits)];
+                nBits &= (nBits - 1);
+            }
+        }
+    }
+    return EncodeTail(pMask, pComp, nDataCount, pData, nIndex, nDataLen);
+}
+
+__attribute__((target("sse2"))) static int DecodeSSE2(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
+{
+    int    nDecodeCount = 0;
+    size_t nIndex       = 0;
+    for(; nIndex + 8 <= nDataLen; nIndex += 8){
+        auto nBits = (unsigned int)(pMask[nIndex / 8]);
+        if(nBits == 0XFF){
+            std::memcpy(pOrig + nIndex, pComp + nDecodeCount, 8);
+            nDecodeCount += 8;
+        }else{
+            _mm_storel_epi64((__m128i *)(pOrig + nIndex), _mm_setzero_si128());
+            while(nBits){
+                pOrig[nIndex + __builtin_ctz(nBits)] = pComp[nDecodeCount++];
+                nBits &= (nBits - 1);
             }
         }
+    }
+    return DecodeTail(pOrig, nDecodeCount, pMask, pComp, nIndex, nDataLen);
+}
+
+__attribute__((target("avx2,popcnt"))) static int CountMaskAVX2(const uint8_t *pData, size_t nDataLen)
+{
+    // nibble lookup popcount
+    const __m256i stTable = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i stLow4 = _mm256_set1_epi8(0X0F);
+    const __m256i stZero = _mm256_setzero_si256();
+
+    __m256i stSum  = _mm256_setzero_si256();
+    size_t  nIndex = 0;
+    for(; nIndex + 32 <= nDataLen; nIndex += 32){
+        auto stData  = _mm256_loadu_si256((const __m256i *)(pData + nIndex));
+        auto stCount = _mm256_add_epi8(
+                _mm256_shuffle_epi8(stTable, _mm256_and_si256(stData, stLow4)),
+                _mm256_shuffle_epi8(stTable, _mm256_and_si256(_mm256_srli_epi16(stData, 4), stLow4)));
+        stSum = _mm256_add_epi64(stSum, _mm256_sad_epu8(stCount, stZero));
+    }
+
+    uint64_t nSum[4];
+    _mm256_storeu_si256((__m256i *)(nSum), stSum);
+
+    int nMaskCount = (int)(nSum[0] + nSum[1] + nSum[2] + nSum[3]);
+    for(; nIndex + 8 <= nDataLen; nIndex += 8){
+        uint64_t nWord = 0;
+        std::memcpy(&nWord, pData + nIndex, 8);
+        nMaskCount += __builtin_popcountll(nWord);
+    }
+
+    for(; nIndex < nDataLen; ++nIndex){
+        nMaskCount += __builtin_popcount((unsigned int)(pData[nIndex]));
+    }
+    return nMaskCount;
+}
+
+__attribute__((target("avx2"))) static int CountDataAVX2(const uint8_t *pData, size_t nDataLen)
+{
+    const __m256i stZero = _mm256_setzero_si256();
+
+    size_t nZeroCount = 0;
+    size_t nIndex     = 0;
+    while(nIndex + 32 <= nDataLen){
+        __m256i stCount = _mm256_setzero_si256();
+        for(int nRound = 0; (nRound < 255) && (nIndex + 32 <= nDataLen); ++nRound, nIndex += 32){
+            auto stData = _mm256_loadu_si256((const __m256i *)(pData + nIndex));
+            stCount = _mm256_sub_epi8(stCount, _mm256_cmpeq_epi8(stData, stZero));
+        }
+
+        uint64_t nSum[4];
+        _mm256_storeu_si256((__m256i *)(nSum), _mm256_sad_epu8(stCount, stZero));
+        nZeroCount += (size_t)(nSum[0] + nSum[1] + nSum[2] + nSum[3]);
+    }
+    return (int)(nIndex - nZeroCount) + CountDataScalar(pData + nIndex, nDataLen - nIndex);
+}
+
+__attribute__((target("avx2,popcnt"))) static int DecodeAVX2(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
+{
+    // 16 bytes loaded from pComp for each 16 output bytes
+    // only safe when at least 16 compressed bytes left, otherwise goes to the 8-byte loop
+    // bits of the last mask byte beyond nDataLen are not counted, they don't consume pComp
+    auto nCompCount = CountMaskAVX2(pMask, nDataLen / 8);
+
+    int    nDecodeCount = 0;
+    size_t nIndex       = 0;
+    for(; (nIndex + 16 <= nDataLen) && (nDecodeCount + 16 <= nCompCount); nIndex += 16){
+        auto nBits0 = pMask[nIndex / 8 + 0];
+        auto nBits1 = pMask[nIndex / 8 + 1];
+        auto nCount = (int)(__builtin_popcount(nBits0));
+
+        // control of the high 8 bytes is offset by the count of the low 8 bytes
+        // 0X80 + offset still has the high bit set, output stays zero
+        auto stShuffle = _mm_unpacklo_epi64(
+                _mm_loadl_epi64((const __m128i *)(s_ExpandShuffle[nBits0])),
+                _mm_add_epi8(_mm_loadl_epi64((const __m128i *)(s_ExpandShuffle[nBits1])), _mm_set1_epi8((char)(nCount))));
+
+        auto stComp = _mm_loadu_si128((const __m128i *)(pComp + nDecodeCount));
+        _mm_storeu_si128((__m128i *)(pOrig + nIndex), _mm_shuffle_epi8(stComp, stShuffle));
+        nDecodeCount += nCount + (int)(__builtin_popcount(nBits1));
+    }
+
+    for(; nIndex + 8 <= nDataLen; nIndex += 8){
+        auto nBits = (unsigned int)(pMask[nIndex / 8]);
+        _mm_storel_epi64((__m128i *)(pOrig + nIndex), _mm_setzero_si128());
+        while(nBits){
+            pOrig[nIndex + __builtin_ctz(nBits)] = pComp[nDecodeCount++];
+            nBits &= (nBits - 1);
+        }
+    }
+    return DecodeTail(pOrig, nDecodeCount, pMask, pComp, nIndex, nDataLen);
+}
+
+#endif
+
+#ifdef COMPRESS_USE_X86
+// no avx2 Encode, packing the bytes is the bottleneck, 32-byte compare doesn't help
+// and pshufb packing needs to store 8 bytes to pComp which can overflow
+static const Compress::KernelEntry s_KernelAVX2 {"avx2", CountMaskAVX2, CountDataAVX2, EncodeSSE2, DecodeAVX2};
+static const Compress::KernelEntry s_KernelSSE2 {"sse2", CountMaskSSE2, CountDataSSE2, EncodeSSE2, DecodeSSE2};
+#endif
 
-        // done, return the count
-        return nMaskCount;
+static const Compress::KernelEntry s_KernelScalar {"scalar", CountMaskScalar, CountDataScalar, EncodeScalar, DecodeScalar};
+
+static Compress::KernelEntry SelectKernel()
+{
+#ifdef COMPRESS_USE_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")){
+        InitShuffleTable();
+        return s_KernelAVX2;
+    }
+
+    if(__builtin_cpu_supports("sse2")){
+        return s_KernelSSE2;
+    }
+#endif
+    return s_KernelScalar;
+}
+
+// selected once when first used
+// function static makes it safe to call during static initialization of other files
+static const Compress::KernelEntry &Kernel()
+{
+    static const Compress::KernelEntry s_Kernel = SelectKernel();
+    return s_Kernel;
+}
+
+const char *Compress::KernelName()
+{
+    return Kernel().Name;
+}
+
+std::vector<Compress::KernelEntry> Compress::KernelList()
+{
+    // the avx2 kernel needs the shuffle table, which is initialized only when it's selected
+    // avx2 is always selected when supported, so select first to get the table ready
+    Kernel();
+
+    std::vector<Compress::KernelEntry> stKernelList {s_KernelScalar};
+#ifdef COMPRESS_USE_X86
+    if(__builtin_cpu_supports("sse2")){
+        stKernelList.push_back(s_KernelSSE2);
+    }
+
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt")){
+        stKernelList.push_back(s_KernelAVX2);
+    }
+#endif
+    return stKernelList;
+}
+
+int Compress::CountMask(const uint8_t *pData, size_t nDataLen)
+{
+    if(pData){
+        return Kernel().CountMask(pData, nDataLen);
     }
     return -1;
 }
@@ -77,11 +391,7 @@ int Compress::CountMask(const uint8_t *pData, size_t nDataLen)
 int Compress::CountData(const uint8_t *pData, size_t nDataLen)
 {
     if(pData){
-        int nCount = 0;
-        for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
-            nCount += (pData[nIndex] ? 1 : 0);
-        }
-        return nCount;
+        return Kernel().CountData(pData, nDataLen);
     }
     return -1;
 }
@@ -89,20 +399,7 @@ int Compress::CountData(const uint8_t *pData, size_t nDataLen)
 int Compress::Encode(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
 {
     if(pDst && pData && nDataLen){
-        auto nMaskLen = ((nDataLen + 7) / 8);
-        auto pMask = pDst;
-        auto pComp = pDst + nMaskLen;
-
-        std::memset(pMask, 0, nMaskLen);
-
-        int nDataCount = 0;
-        for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
-            if(pData[nIndex]){
-                pMask[nIndex / 8  ] |= (0X01 << (nIndex % 8));
-                pComp[nDataCount++]  = pData[nIndex];
-            }
-        }
-        return nDataCount;
+        return Kernel().Encode(pDst, pData, nDataLen);
     }
     return -1;
 }
@@ -110,11 +407,7 @@ int Compress::Encode(uint8_t *pDst, const uint8_t *pData, size_t nDataLen)
 int Compress::Decode(uint8_t *pOrig, size_t nDataLen, const uint8_t *pMask, const uint8_t *pComp)
 {
     if(pOrig && nDataLen && pMask && pComp){
-        int nDecodeCount = 0;
-        for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
-            pOrig[nIndex] = (pMask[nIndex / 8] & (0x01 << (nIndex % 8))) ? pComp[nDecodeCount++] : 0;
-        }
-        return nDecodeCount;
+        return Kernel().Decode(pOrig, nDataLen, pMask, pComp);
     }
     return -1;
 }
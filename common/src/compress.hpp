@@ -3,9 +3,12 @@
  *
  *       Filename: compress.hpp
  *        Created: 04/23/2017 21:33:02
- *  Last Modified: 04/24/2017 15:33:52
+ *  Last Modified: 10/18/2026 18:02:37
  *
- *    Description: 
+ *    Description: mask compression for fixed size messages
+ *
+ *                 implementation is selected by CPU features when first used:
+ *                 avx2, sse2 or scalar, all produce the same output
  *
  *        Version: 1.0
  *       Revision: none
@@ -21,6 +24,7 @@
 #pragma once
 #include <cstdint>
 #include <cstddef>
+#include <vector>
 
 namespace Compress
 {
@@ -29,4 +33,22 @@ namespace Compress
 
     int Encode(uint8_t *, const uint8_t *, size_t);
     int Decode(uint8_t *, size_t, const uint8_t *, const uint8_t *);
+
+    // name of the selected implementation, for log
+    const char *KernelName();
+
+    struct KernelEntry
+    {
+        const char *Name;
+
+        int (*CountMask)(const uint8_t *, size_t);
+        int (*CountData)(const uint8_t *, size_t);
+
+        int (*Encode)(uint8_t *, const uint8_t *, size_t);
+        int (*Decode)(uint8_t *, size_t, const uint8_t *, const uint8_t *);
+    };
+
+    // all implementations supported by current CPU, scalar first
+    // entries take no argument check, only for tools/compressbench to compare kernels
+    std::vector<KernelEntry> KernelList();
 }
@@ -0,0 +1,91 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: donetable.hpp
+ *        Created: 10/18/2026 22:30:17
+ *  Last Modified: 10/18/2026 22:30:17
+ *
+ *    Description: table of completion callbacks referred by token
+ *
+ *                 send tasks only keep a uint32_t token instead of a std::function, then
+ *                 tasks are trivial and messages without callback cost nothing for it
+ *
+ *                      auto nToken = stTable.Add(std::move(fnDone));   // 0 if fnDone is empty
+ *                      ...
+ *                      auto fnDone = stTable.Take(nToken);             // slot is recycled
+ *
+ *                 slots are reused by a free list, the table only grows to the max count of
+ *                 callbacks pending at the same time, not thread-safe
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+class DoneTable final
+{
+    private:
+        std::vector<std::function<void()>> m_DoneList;
+        std::vector<uint32_t>              m_FreeList;
+
+    public:
+        DoneTable()
+            : m_DoneList()
+            , m_FreeList()
+        {}
+
+    public:
+        // return the token of the callback
+        // token is index + 1 then 0 means no callback
+        uint32_t Add(std::function<void()> &&fnDone)
+        {
+            if(!fnDone){
+                return 0;
+            }
+
+            if(m_FreeList.empty()){
+                m_DoneList.emplace_back(std::move(fnDone));
+                return (uint32_t)(m_DoneList.size());
+            }
+
+            auto nToken = m_FreeList.back();
+            m_FreeList.pop_back();
+
+            m_DoneList[nToken - 1] = std::move(fnDone);
+            return nToken;
+        }
+
+        // move the callback out and recycle the slot
+        // return empty callback for token 0
+        std::function<void()> Take(uint32_t nToken)
+        {
+            if(!(nToken && (nToken <= m_DoneList.size()))){
+                return {};
+            }
+
+            auto fnDone = std::move(m_DoneList[nToken - 1]);
+            m_DoneList[nToken - 1] = nullptr;
+
+            m_FreeList.push_back(nToken);
+            return fnDone;
+        }
+
+    public:
+        // count of callbacks not taken yet
+        std::size_t Size() const
+        {
+            return m_DoneList.size() - m_FreeList.size();
+        }
+};
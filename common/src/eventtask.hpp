@@ -28,10 +28,22 @@ class EventTask: public Task
     protected:
 		uint32_t m_EventID;
 
+    protected:
+        // intrusive links for the timing wheel in EventTaskHub
+        // a task can only stay in one wheel slot, m_Slot points to the head of the slot list
+        uint64_t    m_ExpireTick;
+        EventTask  *m_Prev;
+        EventTask  *m_Next;
+        EventTask **m_Slot;
+
 	protected:
 		EventTask(uint32_t nDelayMS, const std::function<void()>& fnOp)
             : Task(nDelayMS, fnOp)
             , m_EventID(0)
+            , m_ExpireTick(0)
+            , m_Prev(nullptr)
+            , m_Next(nullptr)
+            , m_Slot(nullptr)
         {}
 
         virtual ~EventTask() = default;
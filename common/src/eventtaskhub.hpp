@@ -16,6 +16,18 @@
  *                 I don't want to make a Suspend() / Restart() since doesn't make
  *                 sense
  *
+ *                 pending tasks are kept in a hierarchical timing wheel with 1ms tick
+ *
+ *                      level-0 : 256 slots, 1ms     per slot
+ *                      level-1 :  64 slots, 256ms   per slot
+ *                      level-2 :  64 slots, 16.4s   per slot
+ *                      level-3 :  64 slots, 17.5min per slot
+ *
+ *                 when level-0 wraps, one slot of the upper level is cascaded down
+ *                 tasks longer than the wheel span are parked in the last slot and get
+ *                 re-inserted when cascaded, so add / dismiss are O(1) and a dismissed
+ *                 task is removed and freed immediately
+ *
  *        Version: 1.0
  *       Revision: none
  *       Compiler: gcc
@@ -29,8 +41,11 @@
 #pragma once
 
 #include <mutex>
-#include <queue>
-#include <unordered_set>
+#include <array>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
 #include <condition_variable>
 
 #include "basehub.hpp"
@@ -40,25 +55,32 @@
 using EventTaskBlockPN = MemoryBlockPN<sizeof(EventTask), 1024, 4>;
 class EventTaskHub: public BaseHub
 {
-    private:
-        struct TaskCycleComp
-        {
-            bool operator()(const EventTask* pLHS, const EventTask* pRHS) const
-            {
-                return (pLHS && pRHS) ? (pLHS->Cycle() > pRHS->Cycle()) : true;
-            }
-        };
+    protected:
+        constexpr static int WHEEL_ROOTBITS = 8;
+        constexpr static int WHEEL_NODEBITS = 6;
+
+        constexpr static uint64_t WHEEL_ROOTSIZE = (1 << WHEEL_ROOTBITS);
+        constexpr static uint64_t WHEEL_NODESIZE = (1 << WHEEL_NODEBITS);
+        constexpr static uint64_t WHEEL_MAXDELAY = (1ULL << (WHEEL_ROOTBITS + 3 * WHEEL_NODEBITS)) - 1;
 
     protected:
-        uint32_t                         m_LastEventID;
-        std::mutex                       m_EventLock;
-        std::condition_variable          m_EventCV;
-        std::unordered_set<uint32_t>     m_EventIDRecord;
-        std::function<void(EventTask *)> m_Exec;
-        EventTaskBlockPN                 m_EventTaskBlockPN;
+        uint32_t                                  m_LastEventID;
+        std::mutex                                m_EventLock;
+        std::condition_variable                   m_EventCV;
+        std::unordered_map<uint32_t, EventTask *> m_EventIDRecord;
+        std::function<void(EventTask *)>          m_Exec;
+        EventTaskBlockPN                          m_EventTaskBlockPN;
 
     protected:
-        std::priority_queue<EventTask*, std::deque<EventTask *>, TaskCycleComp> m_EventQ;
+        // wheel time in ticks since the hub created
+        // m_CurrTick is the next tick to process, m_WakeTick is when MainLoop() plans to wake up
+        const std::chrono::steady_clock::time_point m_StartTime;
+        uint64_t                                    m_CurrTick;
+        uint64_t                                    m_WakeTick;
+
+    protected:
+        std::array<EventTask *, WHEEL_ROOTSIZE> m_RootWheel;
+        std::array<std::array<EventTask *, WHEEL_NODESIZE>, 3> m_NodeWheel;
 
     public:
         EventTaskHub(const std::function<void(EventTask *)> &fnExec = [](EventTask *pTask){ if(pTask){ (*pTask)(); } })
@@ -69,7 +91,15 @@ class EventTaskHub: public BaseHub
             , m_EventIDRecord()
             , m_Exec(fnExec)
             , m_EventTaskBlockPN()
-        {}
+            , m_StartTime(std::chrono::steady_clock::now())
+            , m_CurrTick(0)
+            , m_WakeTick(UINT64_MAX)
+        {
+            m_RootWheel.fill(nullptr);
+            for(auto &rstWheel: m_NodeWheel){
+                rstWheel.fill(nullptr);
+            }
+        }
 
         // 1. do shutdown manually
         // 2. call the destructor, I didn't call it inside
@@ -79,10 +109,19 @@ class EventTaskHub: public BaseHub
         bool Dismiss(uint32_t nID)
         {
             if(nID){
-                std::lock_guard<std::mutex> stLockGuard(m_EventLock);
-                auto pRecord = m_EventIDRecord.find(nID);
-                if(pRecord != m_EventIDRecord.end()){
-                    m_EventIDRecord.erase(pRecord);
+                EventTask *pTask = nullptr;
+                {
+                    std::lock_guard<std::mutex> stLockGuard(m_EventLock);
+                    auto pRecord = m_EventIDRecord.find(nID);
+                    if(pRecord != m_EventIDRecord.end()){
+                        pTask = pRecord->second;
+                        UnlinkTask(pTask);
+                        m_EventIDRecord.erase(pRecord);
+                    }
+                }
+
+                if(pTask){
+                    DeleteEventTask(pTask);
                     return true;
                 }
             }
@@ -120,14 +159,18 @@ class EventTaskHub: public BaseHub
             {
                 std::lock_guard<std::mutex> stLockGuard(m_EventLock);
 
-                // 1. clean the priority queue of handlers
-                while(!m_EventQ.empty()){
-                    DeleteEventTask(m_EventQ.top());
-                    m_EventQ.pop();
+                // 1. clean all handlers in the wheel
+                //    every pending handler has an entry in the ID record
+                for(auto &rstRecord: m_EventIDRecord){
+                    DeleteEventTask(rstRecord.second);
                 }
 
-                // 2. clean the ID record for all handlers
+                // 2. clean the ID record and the wheel
                 m_EventIDRecord.clear();
+                m_RootWheel.fill(nullptr);
+                for(auto &rstWheel: m_NodeWheel){
+                    rstWheel.fill(nullptr);
+                }
             }
             m_EventCV.notify_one();
         }
@@ -143,6 +186,154 @@ class EventTaskHub: public BaseHub
             return Add(nDelayMS, std::function<void()>(fnOp));
         }
 
+    protected:
+        // friendship of EventTask is not inherited
+        // derived hubs driving the wheel by their own clock use these, i.e. tools/timerbench
+        static uint64_t ExpireTick(const EventTask *pTask)
+        {
+            return pTask->m_ExpireTick;
+        }
+
+        static void ExpireTick(EventTask *pTask, uint64_t nExpireTick)
+        {
+            pTask->m_ExpireTick = nExpireTick;
+        }
+
+    protected:
+        uint64_t CurrTick() const
+        {
+            return (uint64_t)(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_StartTime).count());
+        }
+
+        void LinkTask(EventTask **ppSlot, EventTask *pTask)
+        {
+            pTask->m_Slot = ppSlot;
+            pTask->m_Prev = nullptr;
+            pTask->m_Next = *ppSlot;
+
+            if(*ppSlot){
+                (*ppSlot)->m_Prev = pTask;
+            }
+            *ppSlot = pTask;
+        }
+
+        void UnlinkTask(EventTask *pTask)
+        {
+            if(pTask->m_Prev){
+                pTask->m_Prev->m_Next = pTask->m_Next;
+            }else{
+                *(pTask->m_Slot) = pTask->m_Next;
+            }
+
+            if(pTask->m_Next){
+                pTask->m_Next->m_Prev = pTask->m_Prev;
+            }
+
+            pTask->m_Slot = nullptr;
+            pTask->m_Prev = nullptr;
+            pTask->m_Next = nullptr;
+        }
+
+        // put a task into the wheel by its expire tick
+        // expired task goes to the current root slot and will be executed in next RunTick()
+        void InsertTask(EventTask *pTask)
+        {
+            auto nExpireTick = pTask->m_ExpireTick;
+            if(nExpireTick < m_CurrTick){
+                nExpireTick = m_CurrTick;
+            }
+
+            // too far away, park it in the farthest slot
+            // it will be re-inserted when cascaded down
+            if(nExpireTick - m_CurrTick > WHEEL_MAXDELAY){
+                nExpireTick = m_CurrTick + WHEEL_MAXDELAY;
+            }
+
+            auto nDelay = nExpireTick - m_CurrTick;
+            if(nDelay < WHEEL_ROOTSIZE){
+                LinkTask(&(m_RootWheel[nExpireTick & (WHEEL_ROOTSIZE - 1)]), pTask);
+                return;
+            }
+
+            for(int nLevel = 0; nLevel < 3; ++nLevel){
+                auto nShift = WHEEL_ROOTBITS + (nLevel + 1) * WHEEL_NODEBITS;
+                if((nLevel == 2) || (nDelay < (1ULL << nShift))){
+                    auto nIndex = (nExpireTick >> (nShift - WHEEL_NODEBITS)) & (WHEEL_NODESIZE - 1);
+                    LinkTask(&(m_NodeWheel[nLevel][nIndex]), pTask);
+                    return;
+                }
+            }
+        }
+
+        // move all tasks in one upper slot down to lower levels
+        // return the index of the slot cascaded
+        uint64_t Cascade(int nLevel)
+        {
+            auto nIndex = (m_CurrTick >> (WHEEL_ROOTBITS + nLevel * WHEEL_NODEBITS)) & (WHEEL_NODESIZE - 1);
+            auto pTask  = m_NodeWheel[nLevel][nIndex];
+
+            m_NodeWheel[nLevel][nIndex] = nullptr;
+            while(pTask){
+                auto pNext = pTask->m_Next;
+                InsertTask(pTask);
+                pTask = pNext;
+            }
+            return nIndex;
+        }
+
+        // process tick m_CurrTick and advance it by one
+        // expired tasks are removed from the ID record and appended to rstExpiredV
+        void RunTick(std::vector<EventTask *> &rstExpiredV)
+        {
+            auto nRootIndex = m_CurrTick & (WHEEL_ROOTSIZE - 1);
+            if(nRootIndex == 0){
+                for(int nLevel = 0; nLevel < 3; ++nLevel){
+                    if(Cascade(nLevel)){
+                        break;
+                    }
+                }
+            }
+
+            auto pTask = m_RootWheel[nRootIndex];
+            m_RootWheel[nRootIndex] = nullptr;
+
+            while(pTask){
+                auto pNext = pTask->m_Next;
+                pTask->m_Slot = nullptr;
+                pTask->m_Prev = nullptr;
+                pTask->m_Next = nullptr;
+
+                m_EventIDRecord.erase(pTask->ID());
+                rstExpiredV.push_back(pTask);
+                pTask = pNext;
+            }
+            m_CurrTick++;
+        }
+
+        // the first tick we have to wake up at
+        // scan the root wheel till it wraps, otherwise wake up at the next cascade
+        uint64_t NextWakeTick() const
+        {
+            if(m_EventIDRecord.empty()){
+                return UINT64_MAX;
+            }
+
+            // m_CurrTick itself is a wrap, cascade of it is not done yet
+            // the root wheel can't tell if tasks come down for the next 256 ticks
+            if(!(m_CurrTick & (WHEEL_ROOTSIZE - 1))){
+                return m_CurrTick;
+            }
+
+            auto nTick = m_CurrTick;
+            do{
+                if(m_RootWheel[nTick & (WHEEL_ROOTSIZE - 1)]){
+                    return nTick;
+                }
+                nTick++;
+            }while(nTick & (WHEEL_ROOTSIZE - 1));
+            return nTick;
+        }
+
     protected:
         uint32_t Add(EventTask *pTask)
         {
@@ -156,27 +347,13 @@ class EventTaskHub: public BaseHub
                     // check if the event has a valid id
                     if(pTask->ID() == 0){
                         // if not generate one
+                        // dismissed tasks are removed immediately, so the ID record
+                        // always has exactly all pending tasks
+                        m_LastEventID = (m_EventIDRecord.empty() ? 1 : (m_LastEventID + 1));
 
-                        // for most case m_EventIDRecord.size() == m_EventQ.size()
-                        // but when trying to dismiss an event we only called m_EventIDRecord.erase()
-                        // then during the executation of event we check if it's dismissed already
-                        //
-                        // so here we use (m_EventIDRecord.empty() && m_EventQ.empty())
-                        // otherwise take the following case:
-                        //
-                        // 0. empty event queue
-                        // 1. add(e0) -> get handler 1
-                        // 2. dismiss(1)
-                        // 3. add(e1) -> get handler 1
-                        // 4. error
-                        //
-                        // drawback is if we push an event with a very large delay and dismissed it
-                        // the m_LastEventID won't reset to 1 unless we reach that time
-
-                        m_LastEventID = ((m_EventIDRecord.empty() && m_EventQ.empty()) ? 1 : (m_LastEventID + 1));
-
-                        // overflowed, find a valid ID here by testing in a loop
-                        if(!m_LastEventID){
+                        // overflowed or taken, find a valid ID here by testing in a loop
+                        if(!m_LastEventID || m_EventIDRecord.find(m_LastEventID) != m_EventIDRecord.end()){
+                            m_LastEventID = 0;
                             for(uint32_t nID = 1; nID; ++nID){
                                 if(m_EventIDRecord.find(nID) == m_EventIDRecord.end()){
                                     m_LastEventID = nID;
@@ -197,13 +374,19 @@ class EventTaskHub: public BaseHub
                     // ok now pTask has a valid ID
                     // put the handler and its ID to record
 
+                    // round up to the first tick not before the cycle, a task never runs early
+                    // truncating both the delay and the current time to ms makes it up to 2ms early
+                    auto nDelayNS = std::chrono::duration_cast<std::chrono::nanoseconds>(pTask->Cycle() - std::chrono::system_clock::now()).count();
+                    auto nCurrNS  = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_StartTime).count();
+                    pTask->m_ExpireTick = (uint64_t)(nCurrNS + ((nDelayNS > 0) ? nDelayNS : 0) + 999999) / 1000000;
+
                     nValidID = pTask->ID();
-                    m_EventIDRecord.insert(nValidID);
-                    m_EventQ.push(pTask);
+                    m_EventIDRecord[nValidID] = pTask;
+                    InsertTask(pTask);
 
-                    // if the list was empty or this event is the top in the list
-                    // means we need to take care of the newly added handler, we have to notify
-                    bNotify = (pTask == m_EventQ.top());
+                    // if main loop is to wake up later than this task
+                    // we have to notify it to re-calculate the wake up time
+                    bNotify = (pTask->m_ExpireTick < m_WakeTick);
                 }else{
                     // the hub is temerminated or stopped
                     m_EventLock.unlock();
@@ -225,41 +408,46 @@ class EventTaskHub: public BaseHub
     protected:
         void MainLoop()
         {
+            std::vector<EventTask *> stExpiredV;
             std::unique_lock<std::mutex> stUniqueLock(m_EventLock, std::defer_lock);
+
             while(State()){
-                std::cv_status stRet = std::cv_status::no_timeout;
                 stUniqueLock.lock();
-                if(m_EventQ.empty()){
-                    // wait until new handler added in
-                    m_EventCV.wait(stUniqueLock);
-                }else{
-                    // or wait for a shorter time
-                    stRet = m_EventCV.wait_until(stUniqueLock, m_EventQ.top()->Cycle());
+
+                // expire all ticks till now in one batch
+                // if nothing pending we can jump to current tick directly
+                auto nCurrTick = CurrTick();
+                while(m_CurrTick <= nCurrTick){
+                    if(m_EventIDRecord.empty()){
+                        m_CurrTick = nCurrTick + 1;
+                        break;
+                    }
+                    RunTick(stExpiredV);
                 }
 
-                // the mutex is locked again now...
-                if(stRet == std::cv_status::timeout){
-                    // ok we had a timeout
-                    // so there has to be an event we *have to* execute
-                    // because time is up!
-                    auto pTask = m_EventQ.top();
-                    m_EventQ.pop();
-
-                    // check if the event was dismissed
-                    auto pRecord = m_EventIDRecord.find(pTask->ID());
-                    if(pRecord == m_EventIDRecord.end()){
-                        stUniqueLock.unlock();
-                        DeleteEventTask(pTask);
-                        continue;
+                if(stExpiredV.empty()){
+                    m_WakeTick = NextWakeTick();
+                    if(m_WakeTick == UINT64_MAX){
+                        // wait until new handler added in
+                        m_EventCV.wait(stUniqueLock);
+                    }else{
+                        // or wait till the first non-empty slot
+                        m_EventCV.wait_until(stUniqueLock, m_StartTime + std::chrono::milliseconds(m_WakeTick));
                     }
-                    m_EventIDRecord.erase(pRecord);
+                    m_WakeTick = UINT64_MAX;
                     stUniqueLock.unlock();
+                    continue;
+                }
+
+                stUniqueLock.unlock();
 
-                    // it's time to execute it
+                // it's time to execute them
+                // executed task is no longer in the ID record, free it here
+                for(auto pTask: stExpiredV){
                     if(m_Exec){ m_Exec(pTask); }
-                }else{
-                    stUniqueLock.unlock();
+                    DeleteEventTask(pTask);
                 }
+                stExpiredV.clear();
             }
         }
 };
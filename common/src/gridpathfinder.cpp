@@ -0,0 +1,379 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: gridpathfinder.cpp
+ *        Created: 10/18/2026 23:05:41
+ *  Last Modified: 10/18/2026 23:05:41
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstdlib>
+#include <algorithm>
+#include "gridpathfinder.hpp"
+
+namespace
+{
+    // same direction index as AStarPathFinderNode
+    const int g_DX[] = { 0, +1, +1, +1,  0, -1, -1, -1};
+    const int g_DY[] = {-1, -1,  0, +1, +1, +1,  0, -1};
+
+    int DirIndex(int nDX, int nDY)
+    {
+        return PathFind::GetDirection(0, 0, nDX, nDY) - (DIR_NONE + 1);
+    }
+
+    // cost of one cell of a hop if CO is checked
+    // lock only counts for the first and last cell, same as ServerMap::MoveCost(true, true, true, ...)
+    float CellCost(uint8_t nState, bool bEndCell)
+    {
+        if(false
+                || ((nState & GridPathFinder::CELL_CO))
+                || ((nState & GridPathFinder::CELL_LOCK) && bEndCell)){
+            return 100.0f;
+        }
+        return 1.0f;
+    }
+
+    // straight or diagonal step cost for JPS
+    const float g_StepCost[] {1.01f, 1.11f};
+}
+
+int GridPathFinder::SearchCore(int nW, int nH, int nX0, int nY0, int nX1, int nY1, int nMaxStep, bool bCheckCO, size_t nMaxExpand, CellQuery fnQuery, const void *pQueryArg)
+{
+    m_PathV.clear();
+    m_OpenV.clear();
+    m_ExpandCount = 0;
+
+    if(false
+            || nW <= 0
+            || nH <= 0
+            || nX0 < 0 || nX0 >= nW
+            || nY0 < 0 || nY0 >= nH
+            || nX1 < 0 || nX1 >= nW
+            || nY1 < 0 || nY1 >= nH
+            || nMaxStep < 1
+            || nMaxStep > 3
+            || !fnQuery){
+        return SEARCH_INVALID;
+    }
+
+    m_W        = nW;
+    m_H        = nH;
+    m_MaxStep  = nMaxStep;
+    m_CheckCO  = bCheckCO;
+    m_Query    = fnQuery;
+    m_QueryArg = pQueryArg;
+
+    // new nodes get Gen = 0, never equal to m_Gen
+    if(m_NodeV.size() < (size_t)(nW) * (size_t)(nH)){
+        m_NodeV.resize((size_t)(nW) * (size_t)(nH));
+    }
+
+    // start a new generation, all nodes of last search become invalid
+    // reset the stamps when it wraps, happens every 4G searches
+    if(++m_Gen == 0){
+        for(auto &rstNode: m_NodeV){
+            rstNode.Gen = 0;
+        }
+        m_Gen = 1;
+    }
+
+    // goal never reachable if its ground is invalid
+    // fail immediately rather than flooding the whole region
+    if(!(Walkable(nX0, nY0) && Walkable(nX1, nY1))){
+        return SEARCH_FAILED;
+    }
+
+    const int nGoalIndex = nY1 * m_W + nX1;
+    Relax(nY0 * m_W + nX0, -1, -1, 0.0f, Heuristic(nX0, nY0, nX1, nY1));
+
+    int nIndex = -1;
+    while(PopOpen(&nIndex)){
+        if(nIndex == nGoalIndex){
+            BuildPath(nIndex);
+            return SEARCH_SUCCEEDED;
+        }
+
+        if(nMaxExpand && (m_ExpandCount >= nMaxExpand)){
+            return SEARCH_BUDGET;
+        }
+
+        m_ExpandCount++;
+        if(UseJPS()){
+            ExpandJPS(nIndex, nX1, nY1);
+        }else{
+            ExpandAStar(nIndex, nX1, nY1);
+        }
+    }
+    return SEARCH_FAILED;
+}
+
+float GridPathFinder::Heuristic(int nX0, int nY0, int nX1, int nY1) const
+{
+    auto nDX = std::abs(nX1 - nX0);
+    auto nDY = std::abs(nY1 - nY0);
+
+    if(UseJPS()){
+        // octile distance with the step cost
+        return g_StepCost[0] * (std::max<int>(nDX, nDY) - std::min<int>(nDX, nDY)) + g_StepCost[1] * std::min<int>(nDX, nDY);
+    }
+
+    // Chebyshev's distance in hops as AStarPathFinderNode::GoalDistanceEstimate()
+    // if CO checked each hop counts at least two cells, then at least cost 2.0
+    auto nHop = std::max<int>((nDX + m_MaxStep - 1) / m_MaxStep, (nDY + m_MaxStep - 1) / m_MaxStep);
+    return nHop * (m_CheckCO ? 2.0f : 1.0f);
+}
+
+bool GridPathFinder::OpenNodeLess(const OpenNode &rstLHS, const OpenNode &rstRHS)
+{
+    // min-heap on F, prefer larger G for tie which is closer to the goal
+    return (rstLHS.F > rstRHS.F) || ((rstLHS.F == rstRHS.F) && (rstLHS.G < rstRHS.G));
+}
+
+void GridPathFinder::PushOpen(int nIndex, float fG, float fH)
+{
+    m_OpenV.push_back({fG + fH, fG, nIndex});
+    std::push_heap(m_OpenV.begin(), m_OpenV.end(), OpenNodeLess);
+}
+
+bool GridPathFinder::PopOpen(int *pIndex)
+{
+    while(!m_OpenV.empty()){
+        std::pop_heap(m_OpenV.begin(), m_OpenV.end(), OpenNodeLess);
+
+        auto stOpenNode = m_OpenV.back();
+        m_OpenV.pop_back();
+
+        // node is not removed from the heap when its G gets updated
+        // skip the outdated entries and the closed nodes
+        auto &rstNode = m_NodeV[stOpenNode.Index];
+        if(rstNode.Closed || (rstNode.G != stOpenNode.G)){
+            continue;
+        }
+
+        rstNode.Closed = 1;
+        *pIndex = stOpenNode.Index;
+        return true;
+    }
+    return false;
+}
+
+void GridPathFinder::Relax(int nIndex, int nParent, int nDir, float fG, float fH)
+{
+    // closed node is reopened if a better G found
+    // the turn cost makes the heuristic inconsistent, stlastar does the same
+    auto &rstNode = Node(nIndex);
+    if(rstNode.G >= 0.0f && fG >= rstNode.G){
+        return;
+    }
+
+    rstNode.G      = fG;
+    rstNode.Parent = nParent;
+    rstNode.Dir    = (int8_t)(nDir);
+    rstNode.Closed = 0;
+    PushOpen(nIndex, fG, fH);
+}
+
+void GridPathFinder::ExpandAStar(int nIndex, int nX1, int nY1)
+{
+    const int nX = nIndex % m_W;
+    const int nY = nIndex / m_W;
+
+    const auto fG      = m_NodeV[nIndex].G;
+    const auto nState  = m_NodeV[nIndex].State;
+    const auto nParent = m_NodeV[nIndex].Parent;
+    const auto nOldDir = m_NodeV[nIndex].Dir;
+
+    for(int nStepIndex = 0; nStepIndex < ((m_MaxStep > 1) ? 2 : 1); ++nStepIndex){
+        const int nStep = (nStepIndex == 0) ? m_MaxStep : 1;
+        for(int nDir = 0; nDir < 8; ++nDir){
+            const int nNewX = nX + g_DX[nDir] * nStep;
+            const int nNewY = nY + g_DY[nDir] * nStep;
+
+            if(true
+                    && nParent >= 0
+                    && nParent == nNewY * m_W + nNewX){
+                continue;
+            }
+
+            // all cells of the hop need valid ground
+            // current cell is always valid since it's expanded
+            bool  bValid = true;
+            float fCost  = m_CheckCO ? CellCost(nState, true) : 1.0f;
+
+            for(int nCell = 1; nCell <= nStep; ++nCell){
+                auto nCellState = CellState(nX + g_DX[nDir] * nCell, nY + g_DY[nDir] * nCell);
+                if(!(nCellState & CELL_FREE)){
+                    bValid = false;
+                    break;
+                }
+
+                if(m_CheckCO){
+                    fCost += CellCost(nCellState, nCell == nStep);
+                }
+            }
+
+            if(!bValid){
+                continue;
+            }
+
+            fCost += 0.01f * nStep + ((nDir % 2) ? 0.10f : 0.00f);
+            if(nOldDir >= 0){
+                auto nDDir = ((nDir - nOldDir) + 8) % 8;
+                fCost += (float)(std::min<int>(nDDir, 8 - nDDir));
+            }
+
+            Relax(nNewY * m_W + nNewX, nIndex, nDir, fG + fCost, Heuristic(nNewX, nNewY, nX1, nY1));
+        }
+    }
+}
+
+void GridPathFinder::ExpandJPS(int nIndex, int nX1, int nY1)
+{
+    const int nX = nIndex % m_W;
+    const int nY = nIndex / m_W;
+
+    const auto fG   = m_NodeV[nIndex].G;
+    const auto nDir = m_NodeV[nIndex].Dir;
+
+    // pruned neighbours, diagonal move only needs both ends valid
+    // then the forced neighbour rules are of the corner-cutting version
+    int nDirCount = 0;
+    int nDXV[8];
+    int nDYV[8];
+
+    auto fnAddDir = [&nDirCount, &nDXV, &nDYV](int nDX, int nDY)
+    {
+        nDXV[nDirCount] = nDX;
+        nDYV[nDirCount] = nDY;
+        nDirCount++;
+    };
+
+    if(nDir < 0){
+        for(int nDirIndex = 0; nDirIndex < 8; ++nDirIndex){
+            fnAddDir(g_DX[nDirIndex], g_DY[nDirIndex]);
+        }
+    }else{
+        const int nDX = g_DX[nDir];
+        const int nDY = g_DY[nDir];
+
+        if(nDX && nDY){
+            fnAddDir(nDX, nDY);
+            fnAddDir(nDX,   0);
+            fnAddDir(  0, nDY);
+
+            if(!Walkable(nX - nDX, nY)){ fnAddDir(-nDX,  nDY); }
+            if(!Walkable(nX, nY - nDY)){ fnAddDir( nDX, -nDY); }
+        }else if(nDX){
+            fnAddDir(nDX, 0);
+
+            if(!Walkable(nX, nY + 1)){ fnAddDir(nDX, +1); }
+            if(!Walkable(nX, nY - 1)){ fnAddDir(nDX, -1); }
+        }else{
+            fnAddDir(0, nDY);
+
+            if(!Walkable(nX + 1, nY)){ fnAddDir(+1, nDY); }
+            if(!Walkable(nX - 1, nY)){ fnAddDir(-1, nDY); }
+        }
+    }
+
+    for(int nDirIndex = 0; nDirIndex < nDirCount; ++nDirIndex){
+        auto nJumpIndex = Jump(nX, nY, nDXV[nDirIndex], nDYV[nDirIndex], nX1, nY1);
+        if(nJumpIndex >= 0){
+            const int nJumpX = nJumpIndex % m_W;
+            const int nJumpY = nJumpIndex / m_W;
+
+            // jump point is always on a straight or diagonal line
+            auto nLen = std::max<int>(std::abs(nJumpX - nX), std::abs(nJumpY - nY));
+            auto fCost = nLen * g_StepCost[(nDXV[nDirIndex] && nDYV[nDirIndex]) ? 1 : 0];
+
+            Relax(nJumpIndex, nIndex, DirIndex(nDXV[nDirIndex], nDYV[nDirIndex]), fG + fCost, Heuristic(nJumpX, nJumpY, nX1, nY1));
+        }
+    }
+}
+
+int GridPathFinder::Jump(int nX, int nY, int nDX, int nDY, int nX1, int nY1)
+{
+    // return index of the jump point, -1 if none
+    // diagonal jump checks straight jumps at each cell, recursion depth is at most 1
+    while(true){
+        nX += nDX;
+        nY += nDY;
+
+        if(!Walkable(nX, nY)){
+            return -1;
+        }
+
+        if(nX == nX1 && nY == nY1){
+            return nY * m_W + nX;
+        }
+
+        if(nDX && nDY){
+            if(false
+                    || (!Walkable(nX - nDX, nY) && Walkable(nX - nDX, nY + nDY))
+                    || (!Walkable(nX, nY - nDY) && Walkable(nX + nDX, nY - nDY))){
+                return nY * m_W + nX;
+            }
+
+            if(false
+                    || (Jump(nX, nY, nDX, 0, nX1, nY1) >= 0)
+                    || (Jump(nX, nY, 0, nDY, nX1, nY1) >= 0)){
+                return nY * m_W + nX;
+            }
+        }else if(nDX){
+            if(false
+                    || (!Walkable(nX, nY + 1) && Walkable(nX + nDX, nY + 1))
+                    || (!Walkable(nX, nY - 1) && Walkable(nX + nDX, nY - 1))){
+                return nY * m_W + nX;
+            }
+        }else{
+            if(false
+                    || (!Walkable(nX + 1, nY) && Walkable(nX + 1, nY + nDY))
+                    || (!Walkable(nX - 1, nY) && Walkable(nX - 1, nY + nDY))){
+                return nY * m_W + nX;
+            }
+        }
+    }
+}
+
+void GridPathFinder::BuildPath(int nGoalIndex)
+{
+    // collect from goal to start then reverse
+    // JPS path is expanded to single steps between jump points
+    m_PathV.clear();
+    for(int nIndex = nGoalIndex; nIndex >= 0; nIndex = m_NodeV[nIndex].Parent){
+        int nX = nIndex % m_W;
+        int nY = nIndex / m_W;
+
+        m_PathV.emplace_back(nX, nY);
+        if(UseJPS() && (m_NodeV[nIndex].Parent >= 0)){
+            const int nParentX = m_NodeV[nIndex].Parent % m_W;
+            const int nParentY = m_NodeV[nIndex].Parent / m_W;
+
+            const int nDX = (nParentX > nX) - (nParentX < nX);
+            const int nDY = (nParentY > nY) - (nParentY < nY);
+
+            while(true){
+                nX += nDX;
+                nY += nDY;
+
+                if(nX == nParentX && nY == nParentY){
+                    break;
+                }
+                m_PathV.emplace_back(nX, nY);
+            }
+        }
+    }
+    std::reverse(m_PathV.begin(), m_PathV.end());
+}
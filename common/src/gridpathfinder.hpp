@@ -0,0 +1,219 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: gridpathfinder.hpp
+ *        Created: 10/18/2026 23:05:41
+ *  Last Modified: 10/18/2026 23:05:41
+ *
+ *    Description: A-Star / Jump-Point-Search path finder specialized for map grids
+ *
+ *                 same steps and cost model as AStarPathFinder with the server cost, but:
+ *
+ *                      1. nodes are cells, kept in a flat array indexed by (y * w + x)
+ *                         reused by all searches, a generation stamp marks the nodes
+ *                         touched by current search, no clear or allocation per search
+ *                      2. open list is a flat binary heap, outdated entries are skipped
+ *                      3. cell state is queried at most once per cell per search
+ *                      4. search stops when the node budget is used up
+ *
+ *                 cell state is provided by the caller:
+ *
+ *                      stFinder.Search(nW, nH, nX0, nY0, nX1, nY1, 1, true, 0, [](int nX, int nY) -> uint8_t
+ *                      {
+ *                          return GridPathFinder::CELL_FREE | ...;
+ *                      });
+ *
+ *                 cost of hop (x0, y0) -> (x1, y1) with n = max(dx, dy):
+ *
+ *                      check CO : sum of cost of cell 0 ~ n, 100.0 for cell with CO, or
+ *                                 locked and it's the first or last, otherwise 1.0
+ *                      no CO    : 1.0
+ *
+ *                 plus 0.01 * n, 0.10 for diagonal hop, and 1.0 for each 45 degree turn
+ *
+ *                 if no CO checked and MaxStep is 1 the cost is uniform, then JPS is used,
+ *                 which ignores the turn cost, the result path is expanded to single steps
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "pathfinder.hpp"
+
+class GridPathFinder final
+{
+    public:
+        enum: uint8_t
+        {
+            CELL_BLOCK = 0,         // ground invalid, can't pass
+            CELL_FREE  = 1 << 0,    // ground valid
+            CELL_CO    = 1 << 1,    // has char object, can pass with high cost
+            CELL_LOCK  = 1 << 2,    // locked, only counted as the first or last cell of a hop
+        };
+
+        enum: int
+        {
+            SEARCH_SUCCEEDED = 0,
+            SEARCH_FAILED,          // no path
+            SEARCH_BUDGET,          // node budget used up before reaching the goal
+            SEARCH_INVALID,         // invalid argument
+        };
+
+    private:
+        // 16 bytes per cell
+        // all fields are valid only if Gen == m_Gen
+        struct GridNode
+        {
+            uint32_t Gen;
+            float    G;
+            int32_t  Parent;        // cell index, -1 for start
+
+            uint8_t  State;         // CELL_XXXX
+            int8_t   Dir;           // 0 ~ 7 for DIR_UP ~ DIR_UPLEFT of the hop stopping here, -1 for start
+            uint8_t  Closed;
+            uint8_t  Padding;
+        };
+
+        struct OpenNode
+        {
+            float   F;
+            float   G;
+            int32_t Index;
+        };
+
+    private:
+        using CellQuery = uint8_t (*)(const void *, int, int);
+
+    private:
+        std::vector<GridNode> m_NodeV;
+        std::vector<OpenNode> m_OpenV;
+        uint32_t              m_Gen;
+
+    private:
+        // arguments of current search
+        int  m_W;
+        int  m_H;
+        int  m_MaxStep;
+        bool m_CheckCO;
+
+    private:
+        CellQuery   m_Query;
+        const void *m_QueryArg;
+
+    private:
+        size_t m_ExpandCount;
+        std::vector<PathFind::PathNode> m_PathV;
+
+    public:
+        GridPathFinder()
+            : m_NodeV()
+            , m_OpenV()
+            , m_Gen(0)
+            , m_W(0)
+            , m_H(0)
+            , m_MaxStep(1)
+            , m_CheckCO(false)
+            , m_Query(nullptr)
+            , m_QueryArg(nullptr)
+            , m_ExpandCount(0)
+            , m_PathV()
+        {}
+
+    public:
+        // fnCellState(x, y) -> CELL_XXXX, only called for (x, y) inside [0, nW) x [0, nH)
+        // nMaxExpand is the max count of expanded nodes, 0 means no limit
+        template<typename F> int Search(int nW, int nH, int nX0, int nY0, int nX1, int nY1, int nMaxStep, bool bCheckCO, size_t nMaxExpand, const F &fnCellState)
+        {
+            return SearchCore(nW, nH, nX0, nY0, nX1, nY1, nMaxStep, bCheckCO, nMaxExpand, [](const void *pArg, int nX, int nY) -> uint8_t
+            {
+                return (*(const F *)(pArg))(nX, nY);
+            }, &fnCellState);
+        }
+
+    public:
+        // path of last succeeded search, including start and goal
+        // hops are of length 1 ~ MaxStep, or all single steps if JPS is used
+        const std::vector<PathFind::PathNode> &Path() const
+        {
+            return m_PathV;
+        }
+
+        size_t ExpandCount() const
+        {
+            return m_ExpandCount;
+        }
+
+    private:
+        int SearchCore(int, int, int, int, int, int, int, bool, size_t, CellQuery, const void *);
+
+    private:
+        bool UseJPS() const
+        {
+            return (m_MaxStep == 1) && !m_CheckCO;
+        }
+
+    private:
+        GridNode &Node(int nIndex)
+        {
+            auto &rstNode = m_NodeV[nIndex];
+            if(rstNode.Gen != m_Gen){
+                rstNode.Gen    = m_Gen;
+                rstNode.G      = -1.0f;
+                rstNode.Parent = -1;
+                rstNode.State  = m_Query(m_QueryArg, nIndex % m_W, nIndex / m_W);
+                rstNode.Dir    = -1;
+                rstNode.Closed = 0;
+            }
+            return rstNode;
+        }
+
+        uint8_t CellState(int nX, int nY)
+        {
+            if(true
+                    && nX >= 0
+                    && nY >= 0
+                    && nX < m_W
+                    && nY < m_H){
+                return Node(nY * m_W + nX).State;
+            }
+            return CELL_BLOCK;
+        }
+
+        bool Walkable(int nX, int nY)
+        {
+            return CellState(nX, nY) & CELL_FREE;
+        }
+
+    private:
+        float Heuristic(int, int, int, int) const;
+
+    private:
+        static bool OpenNodeLess(const OpenNode &, const OpenNode &);
+
+    private:
+        void PushOpen(int, float, float);
+        bool PopOpen(int *);
+
+    private:
+        void Relax(int, int, int, float, float);
+
+    private:
+        void ExpandAStar(int, int, int);
+        void ExpandJPS  (int, int, int);
+
+    private:
+        int Jump(int, int, int, int, int, int);
+
+    private:
+        void BuildPath(int);
+};
@@ -0,0 +1,187 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: groundmask.hpp
+ *        Created: 10/19/2026 00:40:27
+ *  Last Modified: 10/19/2026 00:40:27
+ *
+ *    Description: packed bitmap of cells with valid ground, derived from Mir2xMapData
+ *
+ *                 bit is set if Cell(x, y).CanThrough(), means walk or fly, one cell is
+ *                 one bit instead of the whole cell struct with two OBJ's
+ *
+ *                 kept twice, row-major and column-major, then a horizontal or vertical
+ *                 line checks 64 cells per word:
+ *
+ *                      row : m_RowBitV[y * m_RowWord + x / 64] >> (x % 64)
+ *                      col : m_ColBitV[x * m_ColWord + y / 64] >> (y % 64)
+ *
+ *                 ground never changes after the map is loaded, it's immutable and can be
+ *                 shared by other threads
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include "mir2xmapdata.hpp"
+
+class GroundMask final
+{
+    private:
+        int m_W;
+        int m_H;
+
+    private:
+        int m_RowWord;
+        int m_ColWord;
+
+    private:
+        std::vector<uint64_t> m_RowBitV;
+        std::vector<uint64_t> m_ColBitV;
+
+    public:
+        GroundMask(const Mir2xMapData &rstMapData)
+            : m_W(rstMapData.Valid() ? rstMapData.W() : 0)
+            , m_H(rstMapData.Valid() ? rstMapData.H() : 0)
+            , m_RowWord((m_W + 63) / 64)
+            , m_ColWord((m_H + 63) / 64)
+            , m_RowBitV((size_t)(m_RowWord) * (size_t)(m_H), 0)
+            , m_ColBitV((size_t)(m_ColWord) * (size_t)(m_W), 0)
+        {
+            for(int nY = 0; nY < m_H; ++nY){
+                for(int nX = 0; nX < m_W; ++nX){
+                    if(rstMapData.Cell(nX, nY).CanThrough()){
+                        m_RowBitV[nY * m_RowWord + nX / 64] |= ((uint64_t)(1) << (nX % 64));
+                        m_ColBitV[nX * m_ColWord + nY / 64] |= ((uint64_t)(1) << (nY % 64));
+                    }
+                }
+            }
+        }
+
+    public:
+        int W() const { return m_W; }
+        int H() const { return m_H; }
+
+    public:
+        bool ValidC(int nX, int nY) const
+        {
+            return nX >= 0 && nX < m_W && nY >= 0 && nY < m_H;
+        }
+
+    public:
+        bool Valid(int nX, int nY) const
+        {
+            return ValidC(nX, nY) && ((m_RowBitV[nY * m_RowWord + nX / 64] >> (nX % 64)) & 1);
+        }
+
+        // all cells of (nX0, nY) ~ (nX1, nY) are valid, inclusive
+        bool RowValid(int nY, int nX0, int nX1) const
+        {
+            if(nX0 > nX1){
+                std::swap(nX0, nX1);
+            }
+
+            if(!(ValidC(nX0, nY) && ValidC(nX1, nY))){
+                return false;
+            }
+            return AllSet(m_RowBitV.data() + nY * m_RowWord, nX0, nX1);
+        }
+
+        // all cells of (nX, nY0) ~ (nX, nY1) are valid, inclusive
+        bool ColValid(int nX, int nY0, int nY1) const
+        {
+            if(nY0 > nY1){
+                std::swap(nY0, nY1);
+            }
+
+            if(!(ValidC(nX, nY0) && ValidC(nX, nY1))){
+                return false;
+            }
+            return AllSet(m_ColBitV.data() + nX * m_ColWord, nY0, nY1);
+        }
+
+        // all cells of a horizontal, vertical or diagonal line are valid, inclusive
+        // return false for other lines
+        bool LineValid(int nX0, int nY0, int nX1, int nY1) const
+        {
+            if(nY0 == nY1){
+                return RowValid(nY0, nX0, nX1);
+            }
+
+            if(nX0 == nX1){
+                return ColValid(nX0, nY0, nY1);
+            }
+
+            int nDX = (nX1 > nX0) - (nX1 < nX0);
+            int nDY = (nY1 > nY0) - (nY1 < nY0);
+
+            if(nDX * (nX1 - nX0) != nDY * (nY1 - nY0)){
+                return false;
+            }
+
+            for(int nX = nX0, nY = nY0; ; nX += nDX, nY += nDY){
+                if(!Valid(nX, nY)){
+                    return false;
+                }
+
+                if(nX == nX1){
+                    return true;
+                }
+            }
+        }
+
+    public:
+        // FNV-1a of the size and all bits
+        // used to check if data derived from the ground is outdated
+        uint64_t Hash() const
+        {
+            uint64_t nHash = 0XCBF29CE484222325ULL;
+            auto fnMix = [&nHash](uint64_t nWord)
+            {
+                for(int nByte = 0; nByte < 8; ++nByte){
+                    nHash ^= ((nWord >> (nByte * 8)) & 0XFF);
+                    nHash *= 0X00000100000001B3ULL;
+                }
+            };
+
+            fnMix((uint64_t)(m_W));
+            fnMix((uint64_t)(m_H));
+
+            for(auto nWord: m_RowBitV){
+                fnMix(nWord);
+            }
+            return nHash;
+        }
+
+    private:
+        // bits nBit0 ~ nBit1 all set, inclusive
+        static bool AllSet(const uint64_t *pWord, int nBit0, int nBit1)
+        {
+            for(int nWord = nBit0 / 64; nWord <= nBit1 / 64; ++nWord){
+                uint64_t nMask = ~(uint64_t)(0);
+                if(nWord == nBit0 / 64){
+                    nMask &= (~(uint64_t)(0) << (nBit0 % 64));
+                }
+
+                if(nWord == nBit1 / 64){
+                    nMask &= (~(uint64_t)(0) >> (63 - nBit1 % 64));
+                }
+
+                if((pWord[nWord] & nMask) != nMask){
+                    return false;
+                }
+            }
+            return true;
+        }
+};
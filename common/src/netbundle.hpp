@@ -0,0 +1,164 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: netbundle.hpp
+ *        Created: 10/18/2026 19:12:40
+ *  Last Modified: 10/18/2026 19:12:40
+ *
+ *    Description: pack many small messages to one session into one frame
+ *
+ *                 messages of type 0 / 1 / 2 have length known by HC, then they can be
+ *                 concatenated without any length info as the raw data:
+ *
+ *                      [HC][Data][HC][Data][HC]...
+ *
+ *                 Data in raw is not compressed, the whole raw data is compressed once
+ *                 by the mask scheme, the bundle is sent as the body of a type 3 message:
+ *
+ *                      [RawLen: 4 bytes][Mask: (RawLen + 7) / 8 bytes][CompData]
+ *
+ *                 then the header, length and mask overhead is paid once per bundle
+ *                 instead of once per message
+ *
+ *                 receiver calls Unpack() and handles messages inside as if they were
+ *                 received one by one, in the same order
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include "compress.hpp"
+
+namespace NetBundle
+{
+    // append one message to the raw data
+    // return false if the message can't be bundled, the raw data is not changed
+    template<typename MSGParam> bool Append(std::vector<uint8_t> *pRawBuf, uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+    {
+        MSGParam stMSG(nHC);
+        switch(stMSG.Type()){
+            case 0:
+                {
+                    if(pData || nDataLen){
+                        return false;
+                    }
+
+                    pRawBuf->push_back(nHC);
+                    return true;
+                }
+            case 1:
+            case 2:
+                {
+                    if(!(pData && (nDataLen == stMSG.DataLen()))){
+                        return false;
+                    }
+
+                    pRawBuf->push_back(nHC);
+                    pRawBuf->insert(pRawBuf->end(), pData, pData + nDataLen);
+                    return true;
+                }
+            default:
+                {
+                    return false;
+                }
+        }
+    }
+
+    // length of the encoded bundle
+    // nCountData is Compress::CountData() of the raw data
+    inline size_t EncodeLen(size_t nRawLen, int nCountData)
+    {
+        return 4 + (nRawLen + 7) / 8 + (size_t)(nCountData);
+    }
+
+    // encode raw data to pDst, which has at least EncodeLen() bytes
+    // return false if the raw data is too long
+    inline bool Encode(uint8_t *pDst, const uint8_t *pRaw, size_t nRawLen)
+    {
+        if(!(pDst && pRaw && nRawLen && nRawLen <= 0XFFFFFFFF)){
+            return false;
+        }
+
+        auto nRawLenU32 = (uint32_t)(nRawLen);
+        std::memcpy(pDst, &nRawLenU32, 4);
+        return Compress::Encode(pDst + 4, pRaw, nRawLen) >= 0;
+    }
+
+    // call fnOnMessage(uint8_t, const uint8_t *, size_t) for each message in the bundle
+    // data passed to fnOnMessage is in pRawBuf, copy it if needed
+    //
+    // return the count of messages, or -1 if the bundle is corrupted
+    // messages before the corrupted part are already handled
+    template<typename MSGParam, typename F> int Unpack(const uint8_t *pData, size_t nDataLen, std::vector<uint8_t> *pRawBuf, F &&fnOnMessage)
+    {
+        if(!(pData && nDataLen > 4 && pRawBuf)){
+            return -1;
+        }
+
+        uint32_t nRawLenU32 = 0;
+        std::memcpy(&nRawLenU32, pData, 4);
+
+        // mask should be inside the bundle
+        // and compressed data should exactly match the mask
+        auto nRawLen  = (size_t)(nRawLenU32);
+        auto nMaskLen = (nRawLen + 7) / 8;
+        if(!nRawLen || (nMaskLen > nDataLen - 4)){
+            return -1;
+        }
+
+        auto pMask = pData + 4;
+        auto pComp = pMask + nMaskLen;
+        if(Compress::CountMask(pMask, nMaskLen) != (int)(nDataLen - 4 - nMaskLen)){
+            return -1;
+        }
+
+        pRawBuf->resize(nRawLen);
+        if(Compress::Decode(pRawBuf->data(), nRawLen, pMask, pComp) < 0){
+            return -1;
+        }
+
+        int    nCount = 0;
+        size_t nIndex = 0;
+        while(nIndex < nRawLen){
+            auto nHC = (*pRawBuf)[nIndex];
+
+            MSGParam stMSG(nHC);
+            switch(stMSG.Type()){
+                case 0:
+                    {
+                        nIndex += 1;
+                        fnOnMessage(nHC, nullptr, 0);
+                        break;
+                    }
+                case 1:
+                case 2:
+                    {
+                        if(nIndex + 1 + stMSG.DataLen() > nRawLen){
+                            return -1;
+                        }
+
+                        nIndex += 1 + stMSG.DataLen();
+                        fnOnMessage(nHC, pRawBuf->data() + nIndex - stMSG.DataLen(), stMSG.DataLen());
+                        break;
+                    }
+                default:
+                    {
+                        return -1;
+                    }
+            }
+            nCount++;
+        }
+        return nCount;
+    }
+}
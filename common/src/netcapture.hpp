@@ -0,0 +1,275 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: netcapture.hpp
+ *        Created: 10/18/2026 21:10:36
+ *  Last Modified: 10/18/2026 21:10:36
+ *
+ *    Description: binary log of messages between server and clients
+ *
+ *                 server writes every received CM_* and every sent SM_* message, then the
+ *                 replay tool feeds the CM_* messages back to a server to reproduce the load
+ *
+ *                      file   : [Magic: 8 bytes "M2XNCAP\0"][Version: 4 bytes]
+ *                      record : [Head][Mask: (DataLen + 7) / 8 bytes][CompData: CompLen bytes]
+ *
+ *                 data is the decoded message body, not what on the wire, it's compressed by
+ *                 the mask scheme no matter the message type, most bodies are mostly zero
+ *
+ *                 tick is in us since the writer opened, records of one session are in order
+ *                 but records of different sessions may be slightly out of order since they
+ *                 are written by different io threads
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include "compress.hpp"
+
+namespace NetCapture
+{
+    enum: uint8_t
+    {
+        DIR_CM = 0,     // client -> server
+        DIR_SM = 1,     // server -> client
+
+        // session closed by server, no data
+        // NetDriver reuses session ID, following records with the same ID belong to a new connection
+        DIR_CLOSE = 2,
+    };
+
+    // session ID 0 is never used by NetDriver
+    // records with it are broadcast to all sessions
+    const uint32_t BROADCAST_SESSIONID = 0;
+
+    const char     MAGIC[8] = {'M', '2', 'X', 'N', 'C', 'A', 'P', '\0'};
+    const uint32_t VERSION  = 1;
+
+#pragma pack(push, 1)
+    struct RecordHead
+    {
+        uint64_t Tick;
+        uint32_t SessionID;
+
+        uint8_t Dir;
+        uint8_t HC;
+
+        uint32_t DataLen;
+        uint32_t CompLen;
+    };
+#pragma pack(pop)
+}
+
+class NetCaptureWriter final
+{
+    private:
+        std::FILE *m_File;
+        std::mutex m_FileLock;
+
+    private:
+        std::chrono::steady_clock::time_point m_StartTime;
+
+    private:
+        // checked by every message without lock
+        // set after the file is ready and never reset
+        std::atomic<bool>     m_Valid;
+        std::atomic<uint64_t> m_RecordCount;
+
+    public:
+        NetCaptureWriter()
+            : m_File(nullptr)
+            , m_FileLock()
+            , m_StartTime(std::chrono::steady_clock::now())
+            , m_Valid(false)
+            , m_RecordCount(0)
+        {}
+
+       ~NetCaptureWriter()
+        {
+            if(m_File){
+                std::fclose(m_File);
+            }
+        }
+
+    public:
+        bool Valid() const
+        {
+            return m_Valid.load(std::memory_order_relaxed);
+        }
+
+        uint64_t RecordCount() const
+        {
+            return m_RecordCount.load(std::memory_order_relaxed);
+        }
+
+    public:
+        // only call it once before any Write()
+        bool Open(const char *szFileName)
+        {
+            if(m_File || !szFileName){
+                return false;
+            }
+
+            if(!(m_File = std::fopen(szFileName, "wb"))){
+                return false;
+            }
+
+            if(false
+                    || std::fwrite(NetCapture::MAGIC, sizeof(NetCapture::MAGIC), 1, m_File) != 1
+                    || std::fwrite(&NetCapture::VERSION, sizeof(NetCapture::VERSION), 1, m_File) != 1){
+                std::fclose(m_File);
+                m_File = nullptr;
+                return false;
+            }
+
+            m_StartTime = std::chrono::steady_clock::now();
+            m_Valid.store(true);
+            return true;
+        }
+
+        // thread-safe, called by io threads and actor threads
+        // compress without lock, only the fwrite() is serialized
+        bool Write(uint32_t nSessionID, uint8_t nDir, uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+        {
+            if(!Valid()){
+                return false;
+            }
+
+            if(!pData || nDataLen > 0XFFFFFFFF){
+                nDataLen = 0;
+            }
+
+            thread_local std::vector<uint8_t> s_RecordBuf;
+            s_RecordBuf.resize(sizeof(NetCapture::RecordHead) + (nDataLen + 7) / 8 + nDataLen);
+
+            NetCapture::RecordHead stHead;
+            stHead.Tick      = (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_StartTime).count());
+            stHead.SessionID = nSessionID;
+            stHead.Dir       = nDir;
+            stHead.HC        = nHC;
+            stHead.DataLen   = (uint32_t)(nDataLen);
+            stHead.CompLen   = 0;
+
+            if(nDataLen){
+                auto nCompLen = Compress::Encode(s_RecordBuf.data() + sizeof(stHead), pData, nDataLen);
+                if(nCompLen < 0){
+                    return false;
+                }
+                stHead.CompLen = (uint32_t)(nCompLen);
+            }
+
+            std::memcpy(s_RecordBuf.data(), &stHead, sizeof(stHead));
+            auto nRecordLen = sizeof(stHead) + (nDataLen + 7) / 8 + stHead.CompLen;
+
+            {
+                std::lock_guard<std::mutex> stLockGuard(m_FileLock);
+                if(std::fwrite(s_RecordBuf.data(), nRecordLen, 1, m_File) != 1){
+                    return false;
+                }
+            }
+
+            m_RecordCount.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+};
+
+class NetCaptureReader final
+{
+    private:
+        std::FILE *m_File;
+
+    private:
+        std::vector<uint8_t> m_CompBuf;
+
+    public:
+        NetCaptureReader()
+            : m_File(nullptr)
+            , m_CompBuf()
+        {}
+
+       ~NetCaptureReader()
+        {
+            if(m_File){
+                std::fclose(m_File);
+            }
+        }
+
+    public:
+        bool Open(const char *szFileName)
+        {
+            if(m_File || !szFileName){
+                return false;
+            }
+
+            if(!(m_File = std::fopen(szFileName, "rb"))){
+                return false;
+            }
+
+            char     szMagic[sizeof(NetCapture::MAGIC)];
+            uint32_t nVersion = 0;
+
+            if(false
+                    || std::fread(szMagic, sizeof(szMagic), 1, m_File) != 1
+                    || std::fread(&nVersion, sizeof(nVersion), 1, m_File) != 1
+                    || std::memcmp(szMagic, NetCapture::MAGIC, sizeof(szMagic))
+                    || nVersion != NetCapture::VERSION){
+                std::fclose(m_File);
+                m_File = nullptr;
+                return false;
+            }
+            return true;
+        }
+
+        // read next record, decoded data is put in pData
+        // return 1 if succeeds, 0 at the end, -1 if the file is corrupted or truncated
+        int Read(NetCapture::RecordHead *pHead, std::vector<uint8_t> *pData)
+        {
+            if(!(m_File && pHead && pData)){
+                return -1;
+            }
+
+            NetCapture::RecordHead stHead;
+            switch(std::fread(&stHead, 1, sizeof(stHead), m_File)){
+                case 0                  : return std::feof(m_File) ? 0 : -1;
+                case sizeof(stHead)     : break;
+                default                 : return -1;
+            }
+
+            auto nMaskLen = ((size_t)(stHead.DataLen) + 7) / 8;
+            if(stHead.CompLen > stHead.DataLen){
+                return -1;
+            }
+
+            pData->resize(stHead.DataLen);
+            if(stHead.DataLen){
+                m_CompBuf.resize(nMaskLen + stHead.CompLen);
+                if(std::fread(m_CompBuf.data(), m_CompBuf.size(), 1, m_File) != 1){
+                    return -1;
+                }
+
+                if(false
+                        || Compress::CountMask(m_CompBuf.data(), nMaskLen) != (int)(stHead.CompLen)
+                        || Compress::Decode(pData->data(), stHead.DataLen, m_CompBuf.data(), m_CompBuf.data() + nMaskLen) != (int)(stHead.CompLen)){
+                    return -1;
+                }
+            }
+
+            *pHead = stHead;
+            return 1;
+        }
+};
@@ -0,0 +1,262 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: netframeparser.hpp
+ *        Created: 10/18/2026 17:25:03
+ *  Last Modified: 10/18/2026 17:25:03
+ *
+ *    Description: split received byte stream into messages
+ *
+ *                 socket reads into the parser buffer by big chunks, then Parse() takes
+ *                 all complete messages in the buffer, one read completion can get many
+ *                 messages instead of reading HC / length / body by 3 ~ 4 async_read()
+ *
+ *                 message format on the wire, checked by MSGParam:
+ *
+ *                      type 0: [HC]
+ *                      type 1: [HC][CompLen: 1 or 2 bytes][Mask][CompData]
+ *                      type 2: [HC][Data]
+ *                      type 3: [HC][DataLen: 4 bytes][Data]
+ *
+ *                 MSGParam is CMSGParam for server and SMSGParam for client
+ *
+ *                 usage:
+ *
+ *                      socket.async_read_some(asio::buffer(parser.WriteBuf(), parser.WriteLen()), ...);
+ *                      ...
+ *                      parser.Commit(nReadBytes);
+ *                      if(parser.Parse(fnOnMessage) < 0){
+ *                          // corrupted stream, check parser.ErrorInfo()
+ *                      }
+ *
+ *                 data passed to fnOnMessage(HC, Data, DataLen) is decoded and only valid
+ *                 inside the callback, copy it if needed
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "sysconst.hpp"
+#include "compress.hpp"
+
+template<typename MSGParam> class NetFrameParser final
+{
+    private:
+        // minimal free space for one read
+        // buffer grows when a message is longer than this
+        const size_t m_ReadChunk;
+
+    private:
+        // valid data is in [m_Begin, m_End)
+        // always move it to the head before reading if no enough space at the tail
+        std::vector<uint8_t> m_Buf;
+        size_t               m_Begin;
+        size_t               m_End;
+
+    private:
+        std::vector<uint8_t> m_DecodeBuf;
+
+    private:
+        std::string m_ErrorInfo;
+
+    public:
+        NetFrameParser(size_t nReadChunk = 4096)
+            : m_ReadChunk(nReadChunk ? nReadChunk : 4096)
+            , m_Buf(m_ReadChunk * 2)
+            , m_Begin(0)
+            , m_End(0)
+            , m_DecodeBuf()
+            , m_ErrorInfo()
+        {}
+
+    public:
+        uint8_t *WriteBuf()
+        {
+            Reserve(m_ReadChunk);
+            return m_Buf.data() + m_End;
+        }
+
+        size_t WriteLen()
+        {
+            Reserve(m_ReadChunk);
+            return m_Buf.size() - m_End;
+        }
+
+        void Commit(size_t nLen)
+        {
+            m_End += std::min<size_t>(nLen, m_Buf.size() - m_End);
+        }
+
+    public:
+        // bytes received but not parsed yet
+        size_t PendingLen() const
+        {
+            return m_End - m_Begin;
+        }
+
+        const std::string &ErrorInfo() const
+        {
+            return m_ErrorInfo;
+        }
+
+    public:
+        // call fnOnMessage(uint8_t, const uint8_t *, size_t) for each complete message
+        // return the count of messages parsed, or -1 if the stream is corrupted
+        //
+        // after a corrupted message there is no way to find where the next message starts
+        // the caller should close the connection
+        template<typename F> int Parse(F &&fnOnMessage)
+        {
+            int nCount = 0;
+            while(m_Begin < m_End){
+                auto pHead = m_Buf.data() + m_Begin;
+                auto nLen  = m_End - m_Begin;
+
+                MSGParam stMSG(pHead[0]);
+                switch(stMSG.Type()){
+                    case 0:
+                        {
+                            m_Begin += 1;
+                            fnOnMessage(pHead[0], nullptr, 0);
+                            break;
+                        }
+                    case 1:
+                        {
+                            // not empty, fixed size, compressed
+                            // length encoding: [0 ~ 254] or [255][0 ~ 255]
+                            if(nLen < 2){
+                                return nCount;
+                            }
+
+                            size_t nSizeLen = 1;
+                            size_t nCompLen = pHead[1];
+
+                            if(nCompLen == 255){
+                                if(nLen < 3){
+                                    return nCount;
+                                }
+
+                                nSizeLen = 2;
+                                nCompLen = 255 + (size_t)(pHead[2]);
+                            }
+
+                            if(nCompLen > stMSG.DataLen()){
+                                return OnError("Invalid package: CompLen = " + std::to_string(nCompLen), pHead[0]);
+                            }
+
+                            auto nFrameLen = 1 + nSizeLen + stMSG.MaskLen() + nCompLen;
+                            if(nLen < nFrameLen){
+                                Reserve(nFrameLen - nLen);
+                                return nCount;
+                            }
+
+                            auto pMask = pHead + 1 + nSizeLen;
+                            auto pComp = pMask + stMSG.MaskLen();
+
+                            auto nMaskCount = Compress::CountMask(pMask, stMSG.MaskLen());
+                            if(nMaskCount != (int)(nCompLen)){
+                                return OnError("Corrupted data: MaskCount = " + std::to_string(nMaskCount) + ", CompLen = " + std::to_string(nCompLen), pHead[0]);
+                            }
+
+                            m_DecodeBuf.resize(stMSG.DataLen());
+                            if(Compress::Decode(m_DecodeBuf.data(), stMSG.DataLen(), pMask, pComp) != (int)(nCompLen)){
+                                return OnError("Decode failed: MaskCount = " + std::to_string(nMaskCount) + ", CompLen = " + std::to_string(nCompLen), pHead[0]);
+                            }
+
+                            m_Begin += nFrameLen;
+                            fnOnMessage(pHead[0], m_DecodeBuf.data(), stMSG.DataLen());
+                            break;
+                        }
+                    case 2:
+                        {
+                            // not empty, fixed size, not compressed
+                            auto nFrameLen = 1 + stMSG.DataLen();
+                            if(nLen < nFrameLen){
+                                Reserve(nFrameLen - nLen);
+                                return nCount;
+                            }
+
+                            m_Begin += nFrameLen;
+                            fnOnMessage(pHead[0], pHead + 1, stMSG.DataLen());
+                            break;
+                        }
+                    case 3:
+                        {
+                            // not empty, not fixed size, not compressed
+                            if(nLen < 5){
+                                return nCount;
+                            }
+
+                            uint32_t nDataLenU32 = 0;
+                            std::memcpy(&nDataLenU32, pHead + 1, 4);
+
+                            // length is from the peer, reject it before reserving the buffer
+                            // otherwise one 5-byte header can make us allocate 4GB
+                            if(nDataLenU32 > (uint32_t)(SYS_MAXMSGLEN)){
+                                return OnError("Invalid package: DataLen = " + std::to_string(nDataLenU32), pHead[0]);
+                            }
+
+                            auto nFrameLen = 5 + (size_t)(nDataLenU32);
+                            if(nLen < nFrameLen){
+                                Reserve(nFrameLen - nLen);
+                                return nCount;
+                            }
+
+                            m_Begin += nFrameLen;
+                            fnOnMessage(pHead[0], nDataLenU32 ? (pHead + 5) : nullptr, (size_t)(nDataLenU32));
+                            break;
+                        }
+                    default:
+                        {
+                            return OnError("Invalid message type: " + std::to_string(stMSG.Type()), pHead[0]);
+                        }
+                }
+                nCount++;
+            }
+
+            // all consumed
+            // reset to buffer head without copy
+            m_Begin = 0;
+            m_End   = 0;
+            return nCount;
+        }
+
+    private:
+        int OnError(const std::string &szError, uint8_t nHC)
+        {
+            m_ErrorInfo = szError + ", HC = " + MSGParam(nHC).Name();
+            return -1;
+        }
+
+        // make sure there is at least nSize free bytes after m_End
+        // move pending data to the head first, grow the buffer only if still no enough space
+        void Reserve(size_t nSize)
+        {
+            if(m_Buf.size() - m_End >= nSize){
+                return;
+            }
+
+            if(m_Begin){
+                std::memmove(m_Buf.data(), m_Buf.data() + m_Begin, m_End - m_Begin);
+                m_End  -= m_Begin;
+                m_Begin = 0;
+            }
+
+            if(m_Buf.size() - m_End < nSize){
+                m_Buf.resize(m_End + nSize);
+            }
+        }
+};
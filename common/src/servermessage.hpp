@@ -39,7 +39,8 @@ enum: uint8_t
     SM_SPACEMOVE,
     SM_OFFLINE,
     SM_REMOVEGROUNDITEM,
-    SM_PICKUPOK
+    SM_PICKUPOK,
+    SM_BUNDLE,
 };
 
 #pragma pack(push, 1)
@@ -231,6 +232,9 @@ class SMSGParam: public MessageBase
                 {SM_OFFLINE,          {1, sizeof(SMOffline),               "SM_OFFLINE"         }},
                 {SM_PICKUPOK,         {1, sizeof(SMPickUpOK),              "SM_PICKUPOK"        }},
                 {SM_REMOVEGROUNDITEM, {1, sizeof(SMRemoveGroundItem),      "SM_REMOVEGROUNDITEM"}},
+
+                // messages sent to one session in one tick, see netbundle.hpp
+                {SM_BUNDLE,           {3, 0,                               "SM_BUNDLE"          }},
             };
 
             return s_AttributeTable.at((s_AttributeTable.find(nHC) == s_AttributeTable.end()) ? (uint8_t)(SM_NONE) : nHC);
@@ -46,9 +46,38 @@ const int SYS_MAPVISIBLECD = 100;
 
 const int SYS_MAXPLAYERNUM = 8192;
 
+// max messages gathered in one socket write
+// each takes two iovec entries, keep it below IOV_MAX
+const int SYS_MAXSENDBATCH = 128;
+
+// send the bundle without waiting for the tick if it has more raw bytes than this
+const int SYS_MAXBUNDLELEN = 4096;
+
+// max body length of a not fixed size message on the wire
+// length of such a message comes from the peer, a bigger one is taken as a corrupted stream
+const int SYS_MAXMSGLEN = 65536;
+
 const int SYS_MAXDROPITEM     = 10;
 const int SYS_MAXDROPITEMGRID = 100;
 
+const int SYS_AOIBUCKETSIZE = 16;
+
+// max nodes expanded by one path finding, the search fails after that
+// unreachable target otherwise floods the whole map
+const int SYS_MAXPATHEXPAND = 2048;
+
+// CO's within this range of the requestor are taken into the path finding snapshot
+const int SYS_PATHCORANGE = 16;
+
+// flow field covers cells within this range of the target
+// one field is dropped if nobody queries it for SYS_FLOWFIELDLIFE ms
+const int SYS_FLOWFIELDRANGE = 24;
+const int SYS_FLOWFIELDLIFE  = 5000;
+
+// cluster size of the abstract graph for route planning
+// changing it invalidates all route cache files
+const int SYS_ROUTECLUSTERSIZE = 32;
+
 const int SYS_MINSPEED =  20;
 const int SYS_DEFSPEED = 100;
 const int SYS_MAXSPEED = 500;
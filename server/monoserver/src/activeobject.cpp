@@ -83,6 +83,7 @@ ActiveObject::ActiveObject()
 
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<ActiveObject>();
 }
 
 ActiveObject::~ActiveObject()
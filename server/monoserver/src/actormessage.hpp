@@ -72,6 +72,10 @@ enum MessagePackType: int
     MPK_PICKUP,
     MPK_PICKUPOK,
     MPK_REMOVEGROUNDITEM,
+
+    // keep it as the last one
+    // not a valid type, used as count of message types
+    MPK_MAX,
 };
 
 struct AMBadActorPod
@@ -313,6 +317,13 @@ struct AMPathFind
     int MaxStep;
     bool CheckCO;
 
+    // max nodes expanded, 0 means SYS_MAXPATHEXPAND
+    int MaxExpand;
+
+    // UID of the CO at (EndX, EndY) if we're chasing it, otherwise 0
+    // requestors chasing the same target share one flow field in the map
+    uint32_t TargetUID;
+
     int X;
     int Y;
     int EndX;
@@ -0,0 +1,206 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: actormetrics.cpp
+ *        Created: 10/18/2026 15:41:26
+ *  Last Modified: 10/18/2026 15:41:26
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cinttypes>
+#include "serverenv.hpp"
+#include "messagepack.hpp"
+#include "actormetrics.hpp"
+
+std::mutex ActorMetrics::s_ThreadRecordLock;
+std::vector<ActorMetrics::ThreadRecord *> ActorMetrics::s_ThreadRecordV;
+
+ActorMetrics::ThreadRecord::ThreadRecord()
+{
+    for(auto &rstCounter: CounterV){
+        rstCounter.ForwardCount.store(0);
+        rstCounter.HandleCount .store(0);
+        rstCounter.TimeoutCount.store(0);
+
+        rstCounter.HandleTimeSum.store(0);
+        rstCounter.QueueDelaySum.store(0);
+
+        for(auto &rstBucket: rstCounter.HandleTimeHist){
+            rstBucket.store(0);
+        }
+
+        for(auto &rstBucket: rstCounter.QueueDelayHist){
+            rstBucket.store(0);
+        }
+    }
+}
+
+bool ActorMetrics::Enabled()
+{
+    extern ServerEnv *g_ServerEnv;
+    return g_ServerEnv->TraceActorMessageCount;
+}
+
+uint64_t ActorMetrics::Now()
+{
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+ActorMetrics::ThreadRecord *ActorMetrics::CurrThreadRecord()
+{
+    thread_local ThreadRecord *t_ThreadRecord = nullptr;
+    if(!t_ThreadRecord){
+        t_ThreadRecord = new ThreadRecord();
+        {
+            std::lock_guard<std::mutex> stLockGuard(s_ThreadRecordLock);
+            s_ThreadRecordV.push_back(t_ThreadRecord);
+        }
+    }
+    return t_ThreadRecord;
+}
+
+void ActorMetrics::Increase(std::atomic<uint64_t> &rstCounter, uint64_t nValue)
+{
+    // only owner thread writes, no RMW needed
+    rstCounter.store(rstCounter.load(std::memory_order_relaxed) + nValue, std::memory_order_relaxed);
+}
+
+int ActorMetrics::HistogramIndex(uint64_t nTimeNS)
+{
+    auto nTimeUS = nTimeNS / 1000;
+
+    int nIndex = 0;
+    while(nTimeUS && (nIndex + 1 < HISTOGRAM_SIZE)){
+        nTimeUS >>= 1;
+        nIndex++;
+    }
+    return nIndex;
+}
+
+static int MetricsTypeIndex(int nType)
+{
+    return (nType >= 0 && nType < MPK_MAX) ? nType : MPK_MAX;
+}
+
+void ActorMetrics::OnForward(int nType)
+{
+    Increase(CurrThreadRecord()->CounterV[MetricsTypeIndex(nType)].ForwardCount, 1);
+}
+
+void ActorMetrics::OnTimeout(int nType)
+{
+    Increase(CurrThreadRecord()->CounterV[MetricsTypeIndex(nType)].TimeoutCount, 1);
+}
+
+void ActorMetrics::OnHandle(int nType, uint64_t nQueueDelay, uint64_t nHandleTime)
+{
+    auto &rstCounter = CurrThreadRecord()->CounterV[MetricsTypeIndex(nType)];
+
+    Increase(rstCounter.HandleCount, 1);
+    Increase(rstCounter.HandleTimeSum, nHandleTime);
+    Increase(rstCounter.QueueDelaySum, nQueueDelay);
+
+    Increase(rstCounter.HandleTimeHist[HistogramIndex(nHandleTime)], 1);
+    Increase(rstCounter.QueueDelayHist[HistogramIndex(nQueueDelay)], 1);
+}
+
+std::vector<ActorMetrics::TypeRecord> ActorMetrics::Merge()
+{
+    std::vector<TypeRecord> stRecordV(MPK_MAX + 1);
+    std::lock_guard<std::mutex> stLockGuard(s_ThreadRecordLock);
+
+    for(auto pThreadRecord: s_ThreadRecordV){
+        for(size_t nType = 0; nType < stRecordV.size(); ++nType){
+            auto &rstCounter = pThreadRecord->CounterV[nType];
+            auto &rstRecord  = stRecordV[nType];
+
+            rstRecord.ForwardCount += rstCounter.ForwardCount.load(std::memory_order_relaxed);
+            rstRecord.HandleCount  += rstCounter.HandleCount .load(std::memory_order_relaxed);
+            rstRecord.TimeoutCount += rstCounter.TimeoutCount.load(std::memory_order_relaxed);
+
+            rstRecord.HandleTimeSum += rstCounter.HandleTimeSum.load(std::memory_order_relaxed);
+            rstRecord.QueueDelaySum += rstCounter.QueueDelaySum.load(std::memory_order_relaxed);
+
+            for(int nIndex = 0; nIndex < HISTOGRAM_SIZE; ++nIndex){
+                rstRecord.HandleTimeHist[nIndex] += rstCounter.HandleTimeHist[nIndex].load(std::memory_order_relaxed);
+                rstRecord.QueueDelayHist[nIndex] += rstCounter.QueueDelayHist[nIndex].load(std::memory_order_relaxed);
+            }
+        }
+    }
+    return stRecordV;
+}
+
+std::vector<std::string> ActorMetrics::Dump()
+{
+    // upper bound of the bucket where the percentile falls in, in us
+    auto fnPercentile = [](const std::array<uint64_t, HISTOGRAM_SIZE> &rstHist, uint64_t nCount, double fRatio) -> uint64_t
+    {
+        uint64_t nSum = 0;
+        for(int nIndex = 0; nIndex < HISTOGRAM_SIZE; ++nIndex){
+            nSum += rstHist[nIndex];
+            if(nSum >= fRatio * nCount){
+                return (uint64_t)(1) << nIndex;
+            }
+        }
+        return (uint64_t)(1) << (HISTOGRAM_SIZE - 1);
+    };
+
+    std::vector<std::string> stLineV;
+    stLineV.push_back("Type                      Forward     Handle    Timeout  AvgHandle(us) P99Handle(us)  AvgQueue(us)  P99Queue(us)");
+
+    auto stRecordV = Merge();
+    for(size_t nType = 0; nType < stRecordV.size(); ++nType){
+        const auto &rstRecord = stRecordV[nType];
+        if(true
+                && rstRecord.ForwardCount == 0
+                && rstRecord.HandleCount  == 0
+                && rstRecord.TimeoutCount == 0){
+            continue;
+        }
+
+        auto nHandleCount = rstRecord.HandleCount;
+        auto fAvgHandle   = nHandleCount ? (rstRecord.HandleTimeSum / 1000.0 / nHandleCount) : 0.0;
+        auto fAvgQueue    = nHandleCount ? (rstRecord.QueueDelaySum / 1000.0 / nHandleCount) : 0.0;
+
+        char szLine[256];
+        std::snprintf(szLine, sizeof(szLine), "%-22s %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %14.2f %13" PRIu64 " %13.2f %13" PRIu64,
+                MessagePack((int)(nType)).Name(),
+                rstRecord.ForwardCount,
+                rstRecord.HandleCount,
+                rstRecord.TimeoutCount,
+                fAvgHandle,
+                nHandleCount ? fnPercentile(rstRecord.HandleTimeHist, nHandleCount, 0.99) : (uint64_t)(0),
+                fAvgQueue,
+                nHandleCount ? fnPercentile(rstRecord.QueueDelayHist, nHandleCount, 0.99) : (uint64_t)(0));
+        stLineV.push_back(szLine);
+    }
+    return stLineV;
+}
+
+bool ActorMetrics::DumpFile(const char *szFileName)
+{
+    if(szFileName && std::strlen(szFileName)){
+        if(auto fp = std::fopen(szFileName, "w")){
+            for(auto &rstLine: Dump()){
+                std::fprintf(fp, "%s\n", rstLine.c_str());
+            }
+            std::fclose(fp);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,131 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: actormetrics.hpp
+ *        Created: 10/18/2026 15:10:08
+ *  Last Modified: 10/18/2026 15:10:08
+ *
+ *    Description: per message type statistics for actor messaging
+ *
+ *                 enabled by MIR2X_DEBUG_ARGS="--trace-actor-message-count", ActorPod
+ *                 reports to this class when it forwards / handles a message:
+ *
+ *                      1. count of forwarded / handled messages
+ *                      2. handler time histogram
+ *                      3. mailbox queueing delay histogram, from Forward() to InnHandler()
+ *                      4. count of response handler timeout, by the request type
+ *
+ *                 each thread writes its own counters without any lock, reader merges
+ *                 counters of all threads when dumping, so the numbers are a snapshot
+ *                 and can be slightly inconsistent with each other
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "actormessage.hpp"
+
+class ActorMetrics final
+{
+    public:
+        // histogram in microseconds by power of 2
+        // bucket 0 : [0, 1us), bucket n : [2^(n-1), 2^n)us, last bucket holds all larger ones
+        constexpr static int HISTOGRAM_SIZE = 24;
+
+    public:
+        // merged result of one message type
+        struct TypeRecord
+        {
+            uint64_t ForwardCount;
+            uint64_t HandleCount;
+            uint64_t TimeoutCount;
+
+            uint64_t HandleTimeSum;     // ns
+            uint64_t QueueDelaySum;     // ns
+
+            std::array<uint64_t, HISTOGRAM_SIZE> HandleTimeHist;
+            std::array<uint64_t, HISTOGRAM_SIZE> QueueDelayHist;
+
+            TypeRecord()
+                : ForwardCount(0)
+                , HandleCount(0)
+                , TimeoutCount(0)
+                , HandleTimeSum(0)
+                , QueueDelaySum(0)
+            {
+                HandleTimeHist.fill(0);
+                QueueDelayHist.fill(0);
+            }
+        };
+
+    private:
+        // counters of one thread
+        // only the owner thread writes, use relaxed atomic then reader sees no torn values
+        struct ThreadRecord
+        {
+            struct Counter
+            {
+                std::atomic<uint64_t> ForwardCount;
+                std::atomic<uint64_t> HandleCount;
+                std::atomic<uint64_t> TimeoutCount;
+
+                std::atomic<uint64_t> HandleTimeSum;
+                std::atomic<uint64_t> QueueDelaySum;
+
+                std::array<std::atomic<uint64_t>, HISTOGRAM_SIZE> HandleTimeHist;
+                std::array<std::atomic<uint64_t>, HISTOGRAM_SIZE> QueueDelayHist;
+            };
+
+            // message type may be out of range
+            // put all invalid types to the last one
+            std::array<Counter, MPK_MAX + 1> CounterV;
+
+            ThreadRecord();
+        };
+
+    public:
+        static bool Enabled();
+
+    public:
+        // monotonic time in ns, used as message time stamp
+        static uint64_t Now();
+
+    public:
+        static void OnForward(int);
+        static void OnTimeout(int);
+        static void OnHandle(int, uint64_t, uint64_t);
+
+    public:
+        // merge counters of all threads
+        // result is indexed by message type
+        static std::vector<TypeRecord> Merge();
+
+        // format the merged counters as text table, one line per message type
+        // types never forwarded / handled are skipped
+        static std::vector<std::string> Dump();
+        static bool DumpFile(const char *);
+
+    private:
+        // all thread records created, never released since actor threads live till exit
+        static std::mutex s_ThreadRecordLock;
+        static std::vector<ThreadRecord *> s_ThreadRecordV;
+
+    private:
+        static ThreadRecord *CurrThreadRecord();
+        static void Increase(std::atomic<uint64_t> &, uint64_t);
+        static int HistogramIndex(uint64_t);
+};
@@ -24,9 +24,14 @@
 #include "actorpod.hpp"
 #include "serverenv.hpp"
 #include "monoserver.hpp"
+#include "actormetrics.hpp"
 
 void ActorPod::InnHandler(const MessagePack &rstMPK, const Theron::Address stFromAddr)
 {
+    // zero if actor metrics disabled
+    // take it before any logging so the handler time includes everything
+    auto nHandleStart = ActorMetrics::Enabled() ? ActorMetrics::Now() : (uint64_t)(0);
+
     extern ServerEnv *g_ServerEnv;
     if(g_ServerEnv->TraceActorMessage){
         extern MonoServer *g_MonoServer;
@@ -37,40 +42,16 @@ void ActorPod::InnHandler(const MessagePack &rstMPK, const Theron::Address stFro
     // everytime when message comes check the expire time
     // remove all expired message handler before any handling
     if(m_ExpireTime){
-        while(!m_RespondMessageRecord.empty()){
-            extern MonoServer *g_MonoServer;
-            if(m_RespondMessageRecord.begin()->second.ExpireTime < g_MonoServer->GetTimeTick()){
-                // expired, erase current message handler
-                // send MPK_TIMEOUT to registered message handler to indicate erasion
-                try{
-                    m_RespondMessageRecord.begin()->second.RespondOperation(MPK_TIMEOUT, GetAddress());
-                }catch(...){
-                    extern MonoServer *g_MonoServer;
-                    g_MonoServer->AddLog(LOGTYPE_WARNING,
-                            "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) <- (Type: MPK_TIMEOUT, ID: 0, Resp: %u) : Caught exception from current message handler",
-                            (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), m_RespondMessageRecord.begin()->first);
-                }
-                m_RespondMessageRecord.erase(m_RespondMessageRecord.begin());
-                continue;
-            }
-
-            // std::map<ID, Handler> keeps order in ID number
-            // ID number is the Resp() of the responding messages
-            //
-            // and we guarantee ID1 < ID2 ==> ExpireTime1 <= ExpireTime2
-            // so if we get first non-expired handler, means the rest are all not expired
-            // good feature for std::map, reason why use it instead of std::unordered_map here
-            break;
-        }
+        ExpireRespondSlot();
     }
 
     if(rstMPK.Respond()){
-        auto pRecord = m_RespondMessageRecord.find(rstMPK.Respond());
+        auto pSlot = FindRespondSlot(rstMPK.Respond());
         // try to find the response handler for current responding message
         // 1.     find it, good
         // 2. not find it: 1. didn't register for it
         //                 2. repsonse is too late ooops
-        if(pRecord == m_RespondMessageRecord.end()){
+        if(!pSlot){
             extern MonoServer *g_MonoServer;
             g_MonoServer->AddLog(LOGTYPE_WARNING,
                     "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) <- (Type: %s, ID: %u, Resp: %u) : No valid handler for current message",
@@ -80,9 +61,16 @@ void ActorPod::InnHandler(const MessagePack &rstMPK, const Theron::Address stFro
         }else{
             // we do have an record for this message
             // if we still can find it means it's not expired
-            if(pRecord->second.RespondOperation){
+            //
+            // release the slot before calling the handler
+            // since the handler may call Forward() and register new handlers
+            auto stHandler = std::move(pSlot->Handler);
+            pSlot->ID = 0;
+            m_RespondCount--;
+
+            if(stHandler){
                 try{
-                    pRecord->second.RespondOperation(rstMPK, stFromAddr);
+                    stHandler(rstMPK, stFromAddr);
                 }catch(...){
                     extern MonoServer *g_MonoServer;
                     g_MonoServer->AddLog(LOGTYPE_WARNING,
@@ -95,7 +83,6 @@ void ActorPod::InnHandler(const MessagePack &rstMPK, const Theron::Address stFro
                         "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) <- (Type: %s, ID: %u, Resp: %u) : Current message handler not executable",
                         (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), rstMPK.Name(), rstMPK.ID(), rstMPK.Respond());
             }
-            m_RespondMessageRecord.erase(pRecord);
         }
     }else{
         // informing type message
@@ -134,33 +121,123 @@ void ActorPod::InnHandler(const MessagePack &rstMPK, const Theron::Address stFro
         // TODO
         // it's ok to work without trigger for an actorpod
     }
+
+    if(nHandleStart){
+        auto nQueueDelay = (rstMPK.Timestamp() && rstMPK.Timestamp() < nHandleStart) ? (nHandleStart - rstMPK.Timestamp()) : (uint64_t)(0);
+        ActorMetrics::OnHandle(rstMPK.Type(), nQueueDelay, ActorMetrics::Now() - nHandleStart);
+    }
 }
 
 uint32_t ActorPod::ValidID()
 {
+    // keep the table at most half full
+    // then we can always find a free slot in a few steps
+    if(2 * (m_RespondCount + 1) > m_RespondSlotV.size()){
+        GrowRespondSlot();
+    }
+
     extern ServerEnv *g_ServerEnv;
     if(g_ServerEnv->TraceActorMessage){
         // for debug only
         // when debug all messages get unique ID
         // make it convienent to get all records for one message in the log file
         static std::atomic<uint32_t> s_ValidID(1);
-        return s_ValidID.fetch_add(1);
+        while(true){
+            auto nID = s_ValidID.fetch_add(1);
+            if(nID && !m_RespondSlotV[nID & (m_RespondSlotV.size() - 1)].ID){
+                return nID;
+            }
+        }
     }
 
     // won't reset the current valid ID if there is handler in record
     // check the requirement for ValidID() in header file
-    m_ValidID = (m_RespondMessageRecord.empty() ? 1 : (m_ValidID + 1));
+    //
+    // skip those IDs whose slot is taken, IDs don't need to be continuous
+    m_ValidID = (m_RespondCount ? (m_ValidID + 1) : 1);
+    while(!m_ValidID || m_RespondSlotV[m_ValidID & (m_RespondSlotV.size() - 1)].ID){
+        m_ValidID++;
+    }
+    return m_ValidID;
+}
 
-    // before return the ID generated
-    // we search the map to make sure no (ID, Operation) registered
-    auto pRecord = m_RespondMessageRecord.find(m_ValidID);
-    if(pRecord == m_RespondMessageRecord.end()){
-        return m_ValidID;
-    }else{
-        extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_WARNING, "Response requested message overflows");
-        g_MonoServer->Restart();
-        return 0;
+ActorPod::RespondSlot *ActorPod::FindRespondSlot(uint32_t nID)
+{
+    if(nID){
+        auto &rstSlot = m_RespondSlotV[nID & (m_RespondSlotV.size() - 1)];
+        if(rstSlot.ID == nID){
+            return &rstSlot;
+        }
+    }
+    return nullptr;
+}
+
+void ActorPod::GrowRespondSlot()
+{
+    // any two pending IDs with the same index in the new table
+    // also share the same index in the old table, so no collision after re-index
+    std::vector<RespondSlot> stNewSlotV(m_RespondSlotV.size() * 2);
+    for(auto &rstSlot: m_RespondSlotV){
+        if(rstSlot.ID){
+            auto &rstNewSlot = stNewSlotV[rstSlot.ID & (stNewSlotV.size() - 1)];
+            rstNewSlot.ID         = rstSlot.ID;
+            rstNewSlot.ExpireTime = rstSlot.ExpireTime;
+            rstNewSlot.Type       = rstSlot.Type;
+            rstNewSlot.Handler    = std::move(rstSlot.Handler);
+        }
+    }
+    m_RespondSlotV.swap(stNewSlotV);
+}
+
+void ActorPod::ExpireRespondSlot()
+{
+    extern MonoServer *g_MonoServer;
+    auto nCurrTick = g_MonoServer->GetTimeTick();
+
+    while(m_RespondExpireHead < m_RespondExpireQ.size()){
+        auto stRecord = m_RespondExpireQ[m_RespondExpireHead];
+        if(stRecord.ExpireTime >= nCurrTick){
+            // handlers are registered in time order
+            // if we get first non-expired handler, means the rest are all not expired
+            break;
+        }
+
+        m_RespondExpireHead++;
+
+        // handler could have been responded already
+        // or the ID is re-used by a newer handler with different expire time
+        auto pSlot = FindRespondSlot(stRecord.ID);
+        if(!pSlot || pSlot->ExpireTime != stRecord.ExpireTime){
+            continue;
+        }
+
+        // expired, erase current message handler
+        // send MPK_TIMEOUT to registered message handler to indicate erasion
+        auto stHandler = std::move(pSlot->Handler);
+        pSlot->ID = 0;
+        m_RespondCount--;
+
+        if(ActorMetrics::Enabled()){
+            ActorMetrics::OnTimeout(pSlot->Type);
+        }
+
+        try{
+            stHandler(MPK_TIMEOUT, GetAddress());
+        }catch(...){
+            g_MonoServer->AddLog(LOGTYPE_WARNING,
+                    "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) <- (Type: MPK_TIMEOUT, ID: 0, Resp: %u) : Caught exception from current message handler",
+                    (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), stRecord.ID);
+        }
+    }
+
+    // reclaim the consumed part of the queue
+    // keep the capacity so no allocation in steady state
+    if(m_RespondExpireHead == m_RespondExpireQ.size()){
+        m_RespondExpireQ.clear();
+        m_RespondExpireHead = 0;
+    }else if(m_RespondExpireHead > 1024 && 2 * m_RespondExpireHead > m_RespondExpireQ.size()){
+        m_RespondExpireQ.erase(m_RespondExpireQ.begin(), m_RespondExpireQ.begin() + m_RespondExpireHead);
+        m_RespondExpireHead = 0;
     }
 }
 
@@ -187,7 +264,13 @@ bool ActorPod::Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr,
         return false;
     }
 
-    if(!Theron::Actor::Send<MessagePack>({rstMB, 0, nRespond}, rstAddr)){
+    MessagePack stMPK(rstMB, 0, nRespond);
+    if(ActorMetrics::Enabled()){
+        stMPK.Timestamp(ActorMetrics::Now());
+        ActorMetrics::OnForward(rstMB.Type());
+    }
+
+    if(!Theron::Actor::Send<MessagePack>(stMPK, rstAddr)){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u) : Faile to send message to given address",
                 (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), 0, nRespond);
@@ -198,9 +281,7 @@ bool ActorPod::Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr,
 }
 
 // send a responding message and exptecting a reply
-bool ActorPod::Forward(const MessageBuf &rstMB,
-        const Theron::Address &rstAddr, uint32_t nRespond,
-        const std::function<void(const MessagePack&, const Theron::Address &)> &fnOPR)
+bool ActorPod::Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr, uint32_t nRespond, RespondHandler stHandler)
 {
     uint32_t nID = ValidID();
 
@@ -225,7 +306,13 @@ bool ActorPod::Forward(const MessageBuf &rstMB,
         return false;
     }
 
-    if(!Theron::Actor::Send<MessagePack>({rstMB, nID, nRespond}, rstAddr)){
+    MessagePack stMPK(rstMB, nID, nRespond);
+    if(ActorMetrics::Enabled()){
+        stMPK.Timestamp(ActorMetrics::Now());
+        ActorMetrics::OnForward(rstMB.Type());
+    }
+
+    if(!Theron::Actor::Send<MessagePack>(stMPK, rstAddr)){
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u) : Failed to send message to given address",
                 (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), nID, nRespond);
@@ -233,5 +320,58 @@ bool ActorPod::Forward(const MessageBuf &rstMB,
     }
 
     extern MonoServer *g_MonoServer;
-    return m_RespondMessageRecord.emplace(nID, RespondMessageRecord((g_MonoServer->GetTimeTick() + m_ExpireTime), fnOPR)).second;
+    auto nExpireTime = g_MonoServer->GetTimeTick() + m_ExpireTime;
+
+    auto &rstSlot = m_RespondSlotV[nID & (m_RespondSlotV.size() - 1)];
+    rstSlot.ID         = nID;
+    rstSlot.ExpireTime = nExpireTime;
+    rstSlot.Type       = rstMB.Type();
+    rstSlot.Handler    = std::move(stHandler);
+    m_RespondCount++;
+
+    if(m_ExpireTime){
+        m_RespondExpireQ.push_back({nID, nExpireTime});
+    }
+    return true;
+}
+
+size_t ActorPod::Forward(const MessageBuf &rstMB, const std::vector<Theron::Address> &rstAddrV)
+{
+    if(rstAddrV.empty()){
+        return 0;
+    }
+
+    extern ServerEnv *g_ServerEnv;
+    if(g_ServerEnv->TraceActorMessage){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_DEBUG, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u, Count: %zu)",
+                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), MessagePack(rstMB.Type()).Name(), 0, 0, rstAddrV.size());
+    }
+
+    // build the message pack only once
+    // Theron copies it for each delivery but the copy shares the payload
+    MessagePack stMPK(rstMB, 0, 0);
+    if(ActorMetrics::Enabled()){
+        stMPK.Timestamp(ActorMetrics::Now());
+    }
+
+    size_t nFailed = 0;
+    for(auto &rstAddr: rstAddrV){
+        if(false
+                || !rstAddr
+                ||  rstAddr == GetAddress()
+                || !Theron::Actor::Send<MessagePack>(stMPK, rstAddr)){
+            nFailed++;
+        }else if(stMPK.Timestamp()){
+            ActorMetrics::OnForward(rstMB.Type());
+        }
+    }
+
+    if(nFailed){
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "(ActorPod: 0X%0*" PRIXPTR ", Name: %s, UID: %u) -> (Type: %s, ID: %u, Resp: %u) : Failed to multicast message to %zu of %zu addresses",
+                (int)(sizeof(this) * 2), (uintptr_t)(this), Name(), UID(), stMPK.Name(), 0, 0, nFailed, rstAddrV.size());
+    }
+
+    return nFailed;
 }
@@ -60,33 +60,50 @@
  */
 #pragma once
 
-#include <map>
+#include <vector>
 #include <functional>
 #include <Theron/Theron.h>
 
 #include "messagebuf.hpp"
 #include "messagepack.hpp"
+#include "respondhandler.hpp"
 
 class ActorPod final: public Theron::Actor
 {
     private:
         using MessagePackOperation = std::function<void(const MessagePack&, const Theron::Address &)>;
+
         // no need to keep the message pack itself
         // since when registering response operation, we always have the message pack avaliable
         // so we can put the pack copy in the lambda function capture list instead of here
-        struct RespondMessageRecord
+        struct RespondSlot
         {
+            // zero ID means the slot is free
+            uint32_t ID;
+
             // we put an expire time here
             // to support automatically remove the registered response handler
             uint32_t ExpireTime;
-            MessagePackOperation RespondOperation;
 
-            RespondMessageRecord(uint32_t nExpireTime, const MessagePackOperation &rstOperation)
-                : ExpireTime(nExpireTime)
-                , RespondOperation(rstOperation)
+            // type of the request message
+            // for actor metrics to count timeout by message type
+            int Type;
+            RespondHandler Handler;
+
+            RespondSlot()
+                : ID(0)
+                , ExpireTime(0)
+                , Type(MPK_NONE)
+                , Handler()
             {}
         };
 
+        struct RespondExpireRecord
+        {
+            uint32_t ID;
+            uint32_t ExpireTime;
+        };
+
     private:
         // trigger is only for state update, so it won't accept any parameters w.r.t
         // message or time or xxx
@@ -116,17 +133,17 @@ class ActorPod final: public Theron::Actor
         // we can put argument to specify the expire time of each handler but not necessary
         const uint32_t m_ExpireTime;
 
-        // use std::map instead of std::unordered_map
-        //
-        // 1. we have to scan the map every time when new message comes to remove expired ones
-        //    std::unordered_map is slow for scan the entire map
-        //    I can maintain another std::priority_queue based on expire time
-        //    but it's hard to remove those entry which executed before expire from the queue
-        //
-        // 2. std::map keeps entries in order by Resp number
-        //    Resp number gives strict order of expire time, excellent freature by std::map
-        //    then when checking expired ones, we start from std::map::begin() and stop at the fist non-expired one
-        std::map<uint32_t, RespondMessageRecord> m_RespondMessageRecord;
+        // response handler table, indexed by (ID & (size - 1))
+        // ValidID() only hands out an ID whose slot is free, and grows the table when it's
+        // half full, so no allocation for each request / response round trip
+        size_t m_RespondCount;
+        std::vector<RespondSlot> m_RespondSlotV;
+
+        // all handlers in one pod share the same m_ExpireTime
+        // then expire order is just the registration order, keep a FIFO queue instead of a heap
+        // entries of handlers already responded are left here and skipped when popped
+        size_t m_RespondExpireHead;
+        std::vector<RespondExpireRecord> m_RespondExpireQ;
 
     private:
         // actor information provided by BindPod()
@@ -143,7 +160,10 @@ class ActorPod final: public Theron::Actor
             , m_Operation(fnOperate)
             , m_ValidID(0)
             , m_ExpireTime(nExpireTime)
-            , m_RespondMessageRecord()
+            , m_RespondCount(0)
+            , m_RespondSlotV(16)
+            , m_RespondExpireHead(0)
+            , m_RespondExpireQ()
             , m_UID(0)
             , m_Name("ActorPod")
         {
@@ -163,12 +183,21 @@ class ActorPod final: public Theron::Actor
         // when the responding message comes we use the Resp to find its responding handler
         // requirement for the ID:
         // 1. non-zero, zero ID means no response expected
-        // 2. unique for registered handler in m_RespondMessageRecord at one time
+        // 2. unique for registered handler in m_RespondSlotV at one time
         //    a number can be re-used, but we should make sure no mistake happen for ID -> Hanlder mapping
         uint32_t ValidID();
 
+    private:
+        RespondSlot *FindRespondSlot(uint32_t);
+
+        // double the table size and re-index all pending handlers
+        void GrowRespondSlot();
+
+        // call all expired handlers with MPK_TIMEOUT and release them
+        void ExpireRespondSlot();
+
         // to register to Theron::Actor
-        // works as a wrapper for (m_Operation, m_Trigger, m_RespondMessageRecord)
+        // works as a wrapper for (m_Operation, m_Trigger, m_RespondSlotV)
         // Theron::Actor accept Theron::Actor::InnHandler only instead of std::function<void(...)>
         void InnHandler(const MessagePack &, const Theron::Address);
 
@@ -183,15 +212,20 @@ class ActorPod final: public Theron::Actor
         bool Forward(const MessageBuf &, const Theron::Address &, uint32_t);
 
         // send a non-responding message and exptecting a reply
-        bool Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr,
-                const std::function<void(const MessagePack&, const Theron::Address &)> &fnOPR)
+        // lambda is stored in RespondHandler directly without converting to std::function
+        bool Forward(const MessageBuf &rstMB, const Theron::Address &rstAddr, RespondHandler stHandler)
         {
-            return Forward(rstMB, rstAddr, 0, fnOPR);
+            return Forward(rstMB, rstAddr, 0, std::move(stHandler));
         }
 
         // send a responding message and exptecting a reply
-        bool Forward(const MessageBuf &, const Theron::Address &, uint32_t,
-                const std::function<void(const MessagePack&, const Theron::Address &)> &);
+        bool Forward(const MessageBuf &, const Theron::Address &, uint32_t, RespondHandler);
+
+    public:
+        // multicast a message to a list of addresses, won't exptect a reply
+        // message pack is built only once and all deliveries share its payload
+        // return number of failed deliveries, zero means all done
+        size_t Forward(const MessageBuf &, const std::vector<Theron::Address> &);
 
     public:
         const char *Name() const
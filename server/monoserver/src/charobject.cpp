@@ -69,6 +69,7 @@ CharObject::CharObject(ServiceCore *pServiceCore,
     };
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<CharObject>();
 }
 
 bool CharObject::NextLocation(int *pX, int *pY, int nDirection, int nDistance)
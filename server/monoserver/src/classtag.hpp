@@ -0,0 +1,104 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: classtag.hpp
+ *        Created: 10/18/2026 11:20:47
+ *  Last Modified: 10/18/2026 11:20:47
+ *
+ *    Description: compile-time class tag for ServerObject and its sub-classes
+ *
+ *                 each class gets one bit as Tag, and Mask is the OR of its own tag and
+ *                 all its parents' tags, then class check is only one AND:
+ *
+ *                      (m_ClassMask & ClassTag<CharObject>::Tag) == ClassTag<CharObject>::Tag
+ *
+ *                 the class hierarchy is duplicated here from the class definitions, when
+ *                 adding a new class derived from ServerObject, we need to:
+ *
+ *                      1. assign a new bit in enum ClassTagType
+ *                      2. specialize ClassTag<T> with its direct parent
+ *                      3. call SetClassMask<T>() in its constructor
+ *
+ *                 the mask is computed at compile time and stored in the object when it's
+ *                 constructed, no typeid() or table lookup when checking
+ *
+ *                 ClassTag<T> is not defined for unregistered class, so ClassFrom<T>()
+ *                 with such a class won't compile
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <cstdint>
+
+enum ClassTagType: uint32_t
+{
+    CLASSTAG_NONE         = 0,
+    CLASSTAG_SERVEROBJECT = (1 << 0),
+    CLASSTAG_ACTIVEOBJECT = (1 << 1),
+    CLASSTAG_SERVICECORE  = (1 << 2),
+    CLASSTAG_SERVERMAP    = (1 << 3),
+    CLASSTAG_CHAROBJECT   = (1 << 4),
+    CLASSTAG_PLAYER       = (1 << 5),
+    CLASSTAG_MONSTER      = (1 << 6),
+};
+
+class ServerObject;
+class ActiveObject;
+class ServiceCore;
+class ServerMap;
+class CharObject;
+class Player;
+class Monster;
+
+template<typename T> struct ClassTag;
+
+template<> struct ClassTag<ServerObject>
+{
+    constexpr static uint32_t Tag  = CLASSTAG_SERVEROBJECT;
+    constexpr static uint32_t Mask = Tag;
+};
+
+template<> struct ClassTag<ActiveObject>
+{
+    constexpr static uint32_t Tag  = CLASSTAG_ACTIVEOBJECT;
+    constexpr static uint32_t Mask = Tag | ClassTag<ServerObject>::Mask;
+};
+
+template<> struct ClassTag<ServiceCore>
+{
+    constexpr static uint32_t Tag  = CLASSTAG_SERVICECORE;
+    constexpr static uint32_t Mask = Tag | ClassTag<ActiveObject>::Mask;
+};
+
+template<> struct ClassTag<ServerMap>
+{
+    constexpr static uint32_t Tag  = CLASSTAG_SERVERMAP;
+    constexpr static uint32_t Mask = Tag | ClassTag<ActiveObject>::Mask;
+};
+
+template<> struct ClassTag<CharObject>
+{
+    constexpr static uint32_t Tag  = CLASSTAG_CHAROBJECT;
+    constexpr static uint32_t Mask = Tag | ClassTag<ActiveObject>::Mask;
+};
+
+template<> struct ClassTag<Player>
+{
+    constexpr static uint32_t Tag  = CLASSTAG_PLAYER;
+    constexpr static uint32_t Mask = Tag | ClassTag<CharObject>::Mask;
+};
+
+template<> struct ClassTag<Monster>
+{
+    constexpr static uint32_t Tag  = CLASSTAG_MONSTER;
+    constexpr static uint32_t Mask = Tag | ClassTag<CharObject>::Mask;
+};
@@ -0,0 +1,83 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: flowfield.cpp
+ *        Created: 10/19/2026 01:32:08
+ *  Last Modified: 10/19/2026 01:32:08
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <algorithm>
+#include "flowfield.hpp"
+
+bool FlowField::Build(const GroundMask &rstGround, int nX, int nY, int nRange)
+{
+    m_X = nX;
+    m_Y = nY;
+
+    m_DistV.clear();
+    m_QueueV.clear();
+
+    if(!rstGround.Valid(nX, nY)){
+        return false;
+    }
+
+    m_BoxX = std::max<int>(0, nX - nRange);
+    m_BoxY = std::max<int>(0, nY - nRange);
+    m_BoxW = std::min<int>(rstGround.W(), nX + nRange + 1) - m_BoxX;
+    m_BoxH = std::min<int>(rstGround.H(), nY + nRange + 1) - m_BoxY;
+
+    // capacity of both buffers are kept
+    // then rebuilding after the target moves doesn't allocate
+    int nStride = m_BoxW + 2;
+    m_DistV.resize(nStride * (m_BoxH + 2), DIST_BLOCK);
+    m_QueueV.reserve(m_BoxW * m_BoxH);
+
+    // mark the ground first, then BFS only reads m_DistV
+    // the border stays DIST_BLOCK, no bound check for neighbors
+    for(int nCurrY = 0; nCurrY < m_BoxH; ++nCurrY){
+        auto pDist = m_DistV.data() + (nCurrY + 1) * nStride + 1;
+        for(int nCurrX = 0; nCurrX < m_BoxW; ++nCurrX){
+            if(rstGround.Valid(m_BoxX + nCurrX, m_BoxY + nCurrY)){
+                pDist[nCurrX] = DIST_NONE;
+            }
+        }
+    }
+
+    const int nNeighborV[]
+    {
+        -nStride - 1, -nStride, -nStride + 1,
+                  -1,                       1,
+         nStride - 1,  nStride,  nStride + 1,
+    };
+
+    int nStartIndex = (nY - m_BoxY + 1) * nStride + (nX - m_BoxX + 1);
+    m_DistV[nStartIndex] = 0;
+    m_QueueV.push_back(nStartIndex);
+
+    // plain BFS, every step costs 1
+    // each cell is pushed only once, then the queue is a flat array
+    for(size_t nHead = 0; nHead < m_QueueV.size(); ++nHead){
+        int  nIndex    = m_QueueV[nHead];
+        auto nNextDist = (uint16_t)(m_DistV[nIndex] + 1);
+
+        for(auto nNeighbor: nNeighborV){
+            if(m_DistV[nIndex + nNeighbor] == DIST_NONE){
+                m_DistV[nIndex + nNeighbor] = nNextDist;
+                m_QueueV.push_back(nIndex + nNeighbor);
+            }
+        }
+    }
+    return true;
+}
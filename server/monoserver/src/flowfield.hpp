@@ -0,0 +1,147 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: flowfield.hpp
+ *        Created: 10/19/2026 01:32:08
+ *  Last Modified: 10/19/2026 01:32:08
+ *
+ *    Description: step distance to one target cell, for all cells in a box around it
+ *
+ *                 built by BFS on the GroundMask, 8 directions and each step costs 1,
+ *                 same as the monster moves, then for any cell inside the box the next
+ *                 step to the target is one of its neighbors with distance - 1
+ *
+ *                 many monsters chasing the same target share one field instead of each
+ *                 running its own search, CO's are not in the field since they move too
+ *                 often, the map checks CO's when picking the next step
+ *
+ *                 the field is only valid for the target location it's built for, when
+ *                 the target moves it's rebuilt and the buffers are reused
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "groundmask.hpp"
+
+class FlowField final
+{
+    private:
+        // target location the field is built for
+        int m_X;
+        int m_Y;
+
+    private:
+        int m_BoxX;
+        int m_BoxY;
+        int m_BoxW;
+        int m_BoxH;
+
+    private:
+        // box with one cell border, indexed by (y - m_BoxY + 1) * (m_BoxW + 2) + (x - m_BoxX + 1)
+        // DIST_BLOCK for invalid ground and the border, DIST_NONE for cells not reached
+        enum: uint16_t
+        {
+            DIST_NONE  = 0XFFFF,
+            DIST_BLOCK = 0XFFFE,
+        };
+
+        std::vector<uint16_t> m_DistV;
+        std::vector<int>      m_QueueV;
+
+    public:
+        FlowField()
+            : m_X(-1)
+            , m_Y(-1)
+            , m_BoxX(0)
+            , m_BoxY(0)
+            , m_BoxW(0)
+            , m_BoxH(0)
+            , m_DistV()
+            , m_QueueV()
+        {}
+
+    public:
+        // build the field for target (nX, nY) and cells within nRange of it
+        // return false if the target is not on valid ground
+        bool Build(const GroundMask &, int, int, int);
+
+    public:
+        bool Valid() const
+        {
+            return !m_DistV.empty();
+        }
+
+        int X() const { return m_X; }
+        int Y() const { return m_Y; }
+
+    public:
+        // step count from (nX, nY) to the target
+        // -1 if it's out of the box or unreachable inside the box
+        int Distance(int nX, int nY) const
+        {
+            if(true
+                    && nX >= m_BoxX
+                    && nY >= m_BoxY
+                    && nX <  m_BoxX + m_BoxW
+                    && nY <  m_BoxY + m_BoxH){
+                auto nDist = m_DistV[(nY - m_BoxY + 1) * (m_BoxW + 2) + (nX - m_BoxX + 1)];
+                return (nDist >= DIST_BLOCK) ? -1 : (int)(nDist);
+            }
+            return -1;
+        }
+
+    public:
+        // next step from (nX, nY) toward the target, skip cells that fnBlocked(x, y) returns true
+        // neighbor closer to the straight line is preferred, then monsters won't walk in zigzag
+        template<typename F> bool NextStep(int nX, int nY, int *pX, int *pY, const F &fnBlocked) const
+        {
+            auto nDist = Distance(nX, nY);
+            if(nDist <= 0){
+                return false;
+            }
+
+            int nBestX = -1;
+            int nBestY = -1;
+            int nBestD = -1;
+
+            for(int nDY = -1; nDY <= 1; ++nDY){
+                for(int nDX = -1; nDX <= 1; ++nDX){
+                    int nNextX = nX + nDX;
+                    int nNextY = nY + nDY;
+
+                    if(false
+                            || (nDX == 0 && nDY == 0)
+                            || Distance(nNextX, nNextY) != nDist - 1
+                            || fnBlocked(nNextX, nNextY)){
+                        continue;
+                    }
+
+                    int nCurrD = (nNextX - m_X) * (nNextX - m_X) + (nNextY - m_Y) * (nNextY - m_Y);
+                    if(nBestD < 0 || nCurrD < nBestD){
+                        nBestX = nNextX;
+                        nBestY = nNextY;
+                        nBestD = nCurrD;
+                    }
+                }
+            }
+
+            if(nBestD < 0){
+                return false;
+            }
+
+            if(pX){ *pX = nBestX; }
+            if(pY){ *pY = nBestY; }
+            return true;
+        }
+};
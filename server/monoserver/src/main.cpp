@@ -18,6 +18,7 @@
  * =====================================================================================
  */
 #include <ctime>
+#include <cstdio>
 #include <asio.hpp>
 
 #include "log.hpp"
@@ -25,11 +26,15 @@
 #include "netdriver.hpp"
 #include "taskhub.hpp"
 #include "memorypn.hpp"
+#include "netcapture.hpp"
 #include "threadpn.hpp"
+#include "pathservice.hpp"
 #include "mapbindbn.hpp"
 #include "metronome.hpp"
+#include "routeplanner.hpp"
 #include "serverenv.hpp"
 #include "mainwindow.hpp"
+#include "serverconfig.hpp"
 #include "eventtaskhub.hpp"
 #include "scriptwindow.hpp"
 #include "serverconfigurewindow.hpp"
@@ -37,13 +42,17 @@
 
 Log                      *g_Log;
 ServerEnv                *g_ServerEnv;
+ServerConfig             *g_ServerConfig;
 TaskHub                  *g_TaskHub;
 MemoryPN                 *g_MemoryPN;
 EventTaskHub             *g_EventTaskHub;
 Theron::EndPoint         *g_EndPoint;
 Theron::Framework        *g_Framework;
 ThreadPN                 *g_ThreadPN;
+PathService              *g_PathService;
+RoutePlanner             *g_RoutePlanner;
 NetDriver                  *g_NetDriver;
+NetCaptureWriter         *g_NetCapture;
 DBPodN                   *g_DBPodN;
 
 MapBinDBN                *g_MapBinDBN;
@@ -54,29 +63,57 @@ ServerConfigureWindow    *g_ServerConfigureWindow;
 DatabaseConfigureWindow  *g_DatabaseConfigureWindow;
 
 
-int main()
+int main(int argc, char *argv[])
 {
     std::srand(std::time(nullptr));
 
+    g_ServerConfig = new ServerConfig();
+    {
+        auto szError = g_ServerConfig->ParseArgs(argc, argv);
+        if(!szError.empty()){
+            std::fprintf(stderr, "%s\n", szError.c_str());
+            std::fprintf(stderr, "Usage: monoserver [--headless] [--config=file] [--key=value ...]\n");
+            return 1;
+        }
+    }
+
     // start FLTK multithreading support
-    Fl::lock();
+    // in headless mode never touch FLTK, then no display required
+    if(!g_ServerConfig->Headless){
+        Fl::lock();
+    }
 
     g_Log                     = new Log("mir2x-monoserver-v0.1");
     g_ServerEnv               = new ServerEnv();
     g_TaskHub                 = new TaskHub();
-    g_ScriptWindow            = new ScriptWindow();
-    g_MainWindow              = new MainWindow();
     g_MonoServer              = new MonoServer();
     g_MemoryPN                = new MemoryPN();
     g_MapBinDBN               = new MapBinDBN();
-    g_ServerConfigureWindow   = new ServerConfigureWindow();
-    g_DatabaseConfigureWindow = new DatabaseConfigureWindow();
     g_EventTaskHub            = new EventTaskHub();
     g_EndPoint                = new Theron::EndPoint("monoserver", "tcp://127.0.0.1:5556");
     g_Framework               = new Theron::Framework(*g_EndPoint);
     g_ThreadPN                = new ThreadPN(4);
+    g_PathService             = new PathService();
+    g_RoutePlanner            = new RoutePlanner();
     g_DBPodN                  = new DBPodN();
     g_NetDriver                 = new NetDriver();
+    g_NetCapture              = new NetCaptureWriter();
+
+    if(g_ServerConfig->Headless){
+        // no windows and no FLTK event loop
+        // launch immediately, main thread only handles exit / restart requests
+        g_MonoServer->Launch();
+        while(true){
+            g_MonoServer->WaitNotifyGUIQ();
+            g_MonoServer->ParseNotifyGUIQ();
+        }
+        return 0;
+    }
+
+    g_ScriptWindow            = new ScriptWindow();
+    g_MainWindow              = new MainWindow();
+    g_ServerConfigureWindow   = new ServerConfigureWindow();
+    g_DatabaseConfigureWindow = new DatabaseConfigureWindow();
 
     g_MainWindow->ShowAll();
 
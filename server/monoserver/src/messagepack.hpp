@@ -95,6 +95,7 @@
 #include <utility>
 #include <type_traits>
 
+#include "sharedbuf.hpp"
 #include "messagebuf.hpp"
 #include "actormessage.hpp"
 
@@ -108,13 +109,22 @@ class InnMessagePack final
         uint32_t m_ID;
         uint32_t m_Respond;
 
+    private:
+        // time when the message is forwarded, in ns, check ActorMetrics::Now()
+        // only set when actor metrics is enabled, used to measure mailbox delay
+        uint64_t m_Timestamp;
+
     private:
         uint8_t  m_SBuf[SBufSize];
         size_t   m_SBufUsedLen;
 
     private:
-        uint8_t *m_DBuf;
-        size_t   m_DBufLen;
+        // dynamic buffer is immutable after creation
+        // so copies of one message pack share it by reference count, this makes
+        // multicast of a big message only allocate and copy the payload once
+        //
+        // buffer is allocated from the global memory pool, check sharedbuf.hpp
+        SharedBuf m_DBuf;
 
     public:
         // since we make sender to accept only MessageBuf
@@ -127,26 +137,17 @@ class InnMessagePack final
             : m_Type(nType)
             , m_ID(nID)
             , m_Respond(nRespond)
+            , m_Timestamp(0)
+            , m_SBufUsedLen(0)
+            , m_DBuf()
         {
             if(pData && nDataLen){
                 if(nDataLen <= SBufSize){
                     m_SBufUsedLen = nDataLen;
                     std::memcpy(m_SBuf, pData, nDataLen);
-
-                    m_DBuf = nullptr;
-                    m_DBufLen = 0;
                 }else{
-                    m_DBuf = new uint8_t[nDataLen];
-                    m_DBufLen = nDataLen;
-                    std::memcpy(m_DBuf, pData, nDataLen);
-
-                    m_SBufUsedLen = 0;
+                    m_DBuf = SharedBuf(pData, nDataLen);
                 }
-            }else{
-                m_DBuf = nullptr;
-                m_DBufLen = 0;
-
-                m_SBufUsedLen = 0;
             }
         }
 
@@ -154,57 +155,43 @@ class InnMessagePack final
             : InnMessagePack(rstMB.Type(), rstMB.Data(), rstMB.DataLen(), nID, nRespond)
         {}
 
-        InnMessagePack(InnMessagePack &&rstMPK)
-            : m_Type(rstMPK.Type())
-            , m_ID(rstMPK.ID())
-            , m_Respond(rstMPK.Respond())
+        // copy the header but share the payload of rstMPK
+        // used to send one payload with different ID / Respond
+        InnMessagePack(const InnMessagePack &rstMPK, uint32_t nID, uint32_t nRespond)
+            : m_Type(rstMPK.m_Type)
+            , m_ID(nID)
+            , m_Respond(nRespond)
+            , m_Timestamp(rstMPK.m_Timestamp)
+            , m_SBufUsedLen(rstMPK.m_SBufUsedLen)
+            , m_DBuf(rstMPK.m_DBuf)
         {
-            // case-1: use dynamic buffer, steal the buffer
-            //         after this call rstMPK will be invalid
-            if(rstMPK.m_DBuf && rstMPK.m_DBufLen){
-                m_DBuf = rstMPK.m_DBuf;
-                m_DBufLen = rstMPK.m_DBufLen;
-
-                m_SBufUsedLen = 0;
-
-                rstMPK.m_DBuf = nullptr;
-                rstMPK.m_DBufLen = 0;
-                return;
+            if(m_SBufUsedLen){
+                std::memcpy(m_SBuf, rstMPK.m_SBuf, m_SBufUsedLen);
             }
+        }
 
-            // case-1: use static buffer, copy only
-            //         but after this call I make rstMPK invalid
-            if(rstMPK.m_SBufUsedLen){
-                m_SBufUsedLen = rstMPK.m_SBufUsedLen;
+        InnMessagePack(InnMessagePack &&rstMPK)
+            : m_Type(rstMPK.m_Type)
+            , m_ID(rstMPK.m_ID)
+            , m_Respond(rstMPK.m_Respond)
+            , m_Timestamp(rstMPK.m_Timestamp)
+            , m_SBufUsedLen(rstMPK.m_SBufUsedLen)
+            , m_DBuf(std::move(rstMPK.m_DBuf))
+        {
+            // after this call I make rstMPK invalid
+            if(m_SBufUsedLen){
                 std::memcpy(m_SBuf, rstMPK.m_SBuf, m_SBufUsedLen);
-
-                m_DBuf = nullptr;
-                m_DBufLen = 0;
-
-                rstMPK.m_SBufUsedLen = 0;
-                return;
             }
 
-            // case-3: empty message
-            //         shouldn't happen here
-            {
-                m_SBufUsedLen = 0;
-
-                m_DBuf = nullptr;
-                m_DBufLen = 0;
-                return;
-            }
+            rstMPK.m_SBufUsedLen = 0;
         }
 
         InnMessagePack(const InnMessagePack &rstMPK)
-            : InnMessagePack(rstMPK.Type(), rstMPK.Data(), rstMPK.DataLen(), rstMPK.ID(), rstMPK.Respond())
+            : InnMessagePack(rstMPK, rstMPK.m_ID, rstMPK.m_Respond)
         {}
 
     public:
-       ~InnMessagePack()
-        {
-            delete [] m_DBuf;
-        }
+       ~InnMessagePack() = default;
 
     public:
        InnMessagePack &operator = (InnMessagePack stMPK)
@@ -212,10 +199,10 @@ class InnMessagePack final
            std::swap(m_Type         , stMPK.m_Type       );
            std::swap(m_ID           , stMPK.m_ID         );
            std::swap(m_Respond      , stMPK.m_Respond    );
+           std::swap(m_Timestamp    , stMPK.m_Timestamp  );
 
            std::swap(m_SBufUsedLen  , stMPK.m_SBufUsedLen);
            std::swap(m_DBuf         , stMPK.m_DBuf       );
-           std::swap(m_DBufLen      , stMPK.m_DBufLen    );
 
            if(m_SBufUsedLen){
                std::memcpy(m_SBuf, stMPK.m_SBuf, m_SBufUsedLen);
@@ -232,12 +219,12 @@ class InnMessagePack final
 
         const uint8_t *Data() const
         {
-            return m_SBufUsedLen ? m_SBuf : m_DBuf;
+            return m_SBufUsedLen ? m_SBuf : m_DBuf.Data();
         }
 
         size_t DataLen() const
         {
-            return m_SBufUsedLen ? m_SBufUsedLen : m_DBufLen;
+            return m_SBufUsedLen ? m_SBufUsedLen : m_DBuf.DataLen();
         }
 
         size_t Size() const
@@ -255,6 +242,16 @@ class InnMessagePack final
             return m_ID;
         }
 
+        uint64_t Timestamp() const
+        {
+            return m_Timestamp;
+        }
+
+        void Timestamp(uint64_t nTimestamp)
+        {
+            m_Timestamp = nTimestamp;
+        }
+
         const char *Name() const
         {
             switch(m_Type){
@@ -270,6 +267,7 @@ class InnMessagePack final
                 case MPK_METRONOME           : return "MPK_METRONOME";
                 case MPK_TRYMOVE             : return "MPK_TRYMOVE";
                 case MPK_MOVEOK              : return "MPK_MOVEOK";
+                case MPK_SPACEMOVEOK         : return "MPK_SPACEMOVEOK";
                 case MPK_TRYLEAVE            : return "MPK_TRYLEAVE";
                 case MPK_TRYSPACEMOVE        : return "MPK_TRYSPACEMOVE";
                 case MPK_LOGINOK             : return "MPK_LOGINOK";
@@ -304,6 +302,9 @@ class InnMessagePack final
                 case MPK_SHOWDROPITEM        : return "MPK_SHOWDROPITEM";
                 case MPK_NOTIFYDEAD          : return "MPK_NOTIFYDEAD";
                 case MPK_OFFLINE             : return "MPK_OFFLINE";
+                case MPK_PICKUP              : return "MPK_PICKUP";
+                case MPK_PICKUPOK            : return "MPK_PICKUPOK";
+                case MPK_REMOVEGROUNDITEM    : return "MPK_REMOVEGROUNDITEM";
                 default                      : return "MPK_UNKNOWN";
             }
         }
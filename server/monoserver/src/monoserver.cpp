@@ -25,30 +25,38 @@
 #include <cstdarg>
 #include <cstdlib>
 #include <cinttypes>
+#include <algorithm>
 #include <FL/fl_ask.H>
 
 #include "log.hpp"
 #include "dbpod.hpp"
 #include "taskhub.hpp"
 #include "message.hpp"
+#include "compress.hpp"
 #include "monster.hpp"
+#include "netcapture.hpp"
 #include "database.hpp"
 #include "threadpn.hpp"
+#include "pathservice.hpp"
+#include "routeplanner.hpp"
 #include "mapbindbn.hpp"
 #include "uidrecord.hpp"
 #include "mainwindow.hpp"
 #include "monoserver.hpp"
+#include "dbcomrecord.hpp"
+#include "serverconfig.hpp"
+#include "actormetrics.hpp"
+#include "serverenv.hpp"
 #include "servicecore.hpp"
 #include "eventtaskhub.hpp"
 #include "commandwindow.hpp"
-#include "databaseconfigurewindow.hpp"
 
 MonoServer::MonoServer()
     : m_LogLock()
     , m_LogBuf()
     , m_ServiceCore(nullptr)
     , m_GlobalUID {1}
-    , m_UIDArray()
+    , m_UIDRegistry()
     , m_StartTime(std::chrono::system_clock::now())
 {}
 
@@ -69,6 +77,14 @@ void MonoServer::AddLog(const std::array<std::string, 4> &stLogDesc, const char
             default:
                 {
                     g_Log->AddLog(stLogDesc, szLogInfo);
+
+                    // no log browser in headless mode
+                    // g3log is the only destination, don't wake up the main thread
+                    extern ServerConfig *g_ServerConfig;
+                    if(g_ServerConfig->Headless){
+                        break;
+                    }
+
                     {
                         std::lock_guard<std::mutex> stLockGuard(m_LogLock);
                         m_LogBuf.push_back((char)(nLogType));
@@ -131,6 +147,12 @@ void MonoServer::AddLog(const std::array<std::string, 4> &stLogDesc, const char
 void MonoServer::AddCWLog(uint32_t nCWID, int nLogType, const char *szPrompt, const char *szLogFormat, ...)
 {
     auto fnCWRecordLog = [this](uint32_t nCWID, int nLogType, const char *szPrompt, const char *szLogMsg){
+        // no command window in headless mode
+        extern ServerConfig *g_ServerConfig;
+        if(g_ServerConfig->Headless){
+            return;
+        }
+
         if(true
                 && (nCWID)
                 && (nLogType == 0 || nLogType == 1 || nLogType == 2)){
@@ -205,23 +227,23 @@ void MonoServer::AddCWLog(uint32_t nCWID, int nLogType, const char *szPrompt, co
 void MonoServer::CreateDBConnection()
 {
     extern DBPodN *g_DBPodN;
-    extern DatabaseConfigureWindow *g_DatabaseConfigureWindow;
+    extern ServerConfig *g_ServerConfig;
 
     if(g_DBPodN->Launch(
-            g_DatabaseConfigureWindow->DatabaseIP(),
-            g_DatabaseConfigureWindow->UserName(),
-            g_DatabaseConfigureWindow->Password(),
-            g_DatabaseConfigureWindow->DatabaseName(),
-            g_DatabaseConfigureWindow->DatabasePort())){
+            g_ServerConfig->DatabaseIP.c_str(),
+            g_ServerConfig->UserName.c_str(),
+            g_ServerConfig->Password.c_str(),
+            g_ServerConfig->DatabaseName.c_str(),
+            g_ServerConfig->DatabasePort)){
         AddLog(LOGTYPE_WARNING, "DBPod can't connect to Database (%s:%d)", 
-                g_DatabaseConfigureWindow->DatabaseIP(),
-                g_DatabaseConfigureWindow->DatabasePort());
+                g_ServerConfig->DatabaseIP.c_str(),
+                g_ServerConfig->DatabasePort);
         // no database we just restart the monoserver
         Restart();
     }else{
         AddLog(LOGTYPE_INFO, "Connect to Database (%s:%d) successfully", 
-                g_DatabaseConfigureWindow->DatabaseIP(),
-                g_DatabaseConfigureWindow->DatabasePort());
+                g_ServerConfig->DatabaseIP.c_str(),
+                g_ServerConfig->DatabasePort);
     }
 }
 
@@ -254,8 +276,8 @@ void MonoServer::RegisterAMFallbackHandler()
 
 void MonoServer::LoadMapBinDBN()
 {
-    extern ServerConfigureWindow *g_ServerConfigureWindow;
-    std::string szMapPath = g_ServerConfigureWindow->GetMapPath();
+    extern ServerConfig *g_ServerConfig;
+    std::string szMapPath = g_ServerConfig->MapPath;
 
     extern MapBinDBN *g_MapBinDBN;
     if(!g_MapBinDBN->Load(szMapPath.c_str())){
@@ -273,17 +295,36 @@ void MonoServer::StartServiceCore()
 void MonoServer::StartNetwork()
 {
     extern NetDriver *g_NetDriver;
-    extern ServerConfigureWindow *g_ServerConfigureWindow;
+    extern ServerConfig *g_ServerConfig;
+
+    // open it before accepting any session
+    // otherwise the replay misses the login of the first sessions
+    if(!g_ServerConfig->CapturePath.empty()){
+        extern NetCaptureWriter *g_NetCapture;
+        if(g_NetCapture->Open(g_ServerConfig->CapturePath.c_str())){
+            AddLog(LOGTYPE_INFO, "Capture messages to %s", g_ServerConfig->CapturePath.c_str());
+        }else{
+            AddLog(LOGTYPE_WARNING, "Can't open capture file %s, capture disabled", g_ServerConfig->CapturePath.c_str());
+        }
+    }
 
-    uint32_t nPort = g_ServerConfigureWindow->Port();
-    if(g_NetDriver->Launch(nPort, m_ServiceCore->GetAddress())){
+    uint32_t nPort = g_ServerConfig->Port;
+    if(g_NetDriver->Launch(nPort, m_ServiceCore->GetAddress(), (size_t)((std::max)(0, g_ServerConfig->NetThreadCount)))){
         AddLog(LOGTYPE_FATAL, "Failed to launch the network");
         Restart();
     }
+    AddLog(LOGTYPE_INFO, "Message compression uses %s kernel", Compress::KernelName());
 }
 
 void MonoServer::Launch()
 {
+    // with GUI take a snapshot of the configure windows
+    // in headless mode config has been parsed in main()
+    extern ServerConfig *g_ServerConfig;
+    if(!g_ServerConfig->Headless){
+        g_ServerConfig->LoadGUI();
+    }
+
     CreateDBConnection();
     LoadMonsterRecord();
     RegisterAMFallbackHandler();
@@ -528,10 +569,27 @@ void MonoServer::NotifyGUI(std::string szNotification)
             std::lock_guard<std::mutex> stLockGuard(m_NotifyGUILock);
             m_NotifyGUIQ.push(szNotification);
         }
-        Fl::awake((void *)(uintptr_t)(1));
+
+        // headless main thread waits on the condition variable
+        // never touch FLTK since there is no display
+        extern ServerConfig *g_ServerConfig;
+        if(g_ServerConfig->Headless){
+            m_NotifyGUICV.notify_one();
+        }else{
+            Fl::awake((void *)(uintptr_t)(1));
+        }
     }
 }
 
+void MonoServer::WaitNotifyGUIQ()
+{
+    std::unique_lock<std::mutex> stLock(m_NotifyGUILock);
+    m_NotifyGUICV.wait(stLock, [this]() -> bool
+    {
+        return !m_NotifyGUIQ.empty();
+    });
+}
+
 void MonoServer::ParseNotifyGUIQ()
 {
     static auto fnGetTokenList = [](const std::string &szCommand) -> std::deque<std::string>
@@ -598,7 +656,13 @@ void MonoServer::ParseNotifyGUIQ()
                 || stTokenList.front() == "restart"
                 || stTokenList.front() == "Restart"
                 || stTokenList.front() == "RESTART"){
-            fl_alert("%s", "System request for restart");
+            extern ServerConfig *g_ServerConfig;
+            if(g_ServerConfig->Headless){
+                extern Log *g_Log;
+                g_Log->AddLog(LOGTYPE_FATAL, "%s", "System request for restart");
+            }else{
+                fl_alert("%s", "System request for restart");
+            }
             std::exit(0);
             return;
         }
@@ -633,8 +697,8 @@ void MonoServer::ParseNotifyGUIQ()
                 nCWID = 0;
             }
 
-            if(nCWID > 0){
-                extern MainWindow *g_MainWindow;
+            extern MainWindow *g_MainWindow;
+            if(nCWID > 0 && g_MainWindow){
                 g_MainWindow->DeleteCommandWindow(nCWID);
             }
             continue;
@@ -703,18 +767,12 @@ uint32_t MonoServer::GetUID()
 bool MonoServer::LinkUID(uint32_t nUID, ServerObject *pObject)
 {
     if(nUID && pObject){
-        auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
-        {
-            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
-            auto stFind = rstRecord.Record.find(nUID);
-            if(stFind == rstRecord.Record.end()){
-                rstRecord.Record[nUID] = pObject;
-                return true;
-            }else{
-                AddLog(LOGTYPE_WARNING, "UIDArray duplicated UID: (%" PRIu32 ", %p, %p)", nUID, stFind->second, pObject);
-                return false;
-            }
+        if(m_UIDRegistry.Link(nUID, pObject)){
+            return true;
         }
+
+        AddLog(LOGTYPE_WARNING, "UIDRegistry duplicated UID: (%" PRIu32 ", %p)", nUID, pObject);
+        return false;
     }
 
     AddLog(LOGTYPE_WARNING, "Invalid argument LinkUID(UID = %" PRIu32 ", ServerObject = %p)", nUID, pObject);
@@ -723,72 +781,59 @@ bool MonoServer::LinkUID(uint32_t nUID, ServerObject *pObject)
 
 void MonoServer::EraseUID(uint32_t nUID)
 {
-    if(nUID){
-        auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
-        {
-            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
-            auto stFind = rstRecord.Record.find(nUID);
-            if(stFind != rstRecord.Record.end()){
-                if(stFind->second){
-                    if(stFind->second->UID() != nUID){
-                        AddLog(LOGTYPE_WARNING, "UIDArray mismatch: UID = (%" PRIu32 ", %" PRIu32 ")", nUID, stFind->second->UID());
-                    }
-                    delete stFind->second;
-                }
-                rstRecord.Record.erase(stFind);
-            }
+    // Unlink() waits till no reader holds the pointer
+    // then it's safe to delete the object here
+    if(auto pObject = m_UIDRegistry.Unlink(nUID)){
+        if(pObject->UID() != nUID){
+            AddLog(LOGTYPE_WARNING, "UIDRegistry mismatch: UID = (%" PRIu32 ", %" PRIu32 ")", nUID, pObject->UID());
         }
+        delete pObject;
     }
 }
 
 UIDRecord MonoServer::GetUIDRecord(uint32_t nUID)
 {
     if(nUID){
-        auto &rstUIDArrayEntry = m_UIDArray[nUID % m_UIDArray.size()];
-        {
-            std::lock_guard<std::mutex> stLockGuard(rstUIDArrayEntry.Lock);
-            auto pRecord = rstUIDArrayEntry.Record.find(nUID);
-            if(pRecord != rstUIDArrayEntry.Record.end()){
-                if(pRecord->second){
-                    if(pRecord->second->UID() == nUID){
-                        // two solutions
-                        // 1. for server object, define a virtual UIDRecord GetUIDRecord()
-                        //    then here directly forward the result
-                        //
-                        // 2. maintain UID() for server object
-                        //    maintain UID() and GetAddress() for classes from ActiveObject
-                        //    then construct a temporary UIDRecord and return
-                        //
-                        // solution-1 : simpler but it introduces concept of address to server object
-                        // solution-2 : means I should make both UID() and GetAddress() atomically accessable
-                        //
-                        // UID()        : OK by default
-                        // GetAddress() : which calls m_ActorPod->GetAddress()
-                        //                m_ActorPod could change when other threads accessing it
-                        //
-                        // solution:
-                        // 1. we constrains that we can only access an UID if the object actively given it
-                        //    means if we try to access object through GetUIDRecord(nUID), then the nUID is reported
-                        //    by the object itself. rather than we do randomly draw an UID and access it
-                        //
-                        //    an UID can be deleted then we get an invalid UIDRecord
-                        //    this behaves like malloc() / free(), any pointer try to free() should be from malloc()
-                        //
-                        //    this means if we trying to access ActiveObject::GetAddress(), its m_ActorPod has
-                        //    already be initialized otherwise we can't get its UID
-                        //
-                        // 2. before deletion of active object we should call Deactivate() which calls m_ActorPod->Detach()
-                        //    this helps to detach *this* from the actor thread of m_ActorPod, then deletion in other thread is OK
-                        //
-                        //    then deletion of m_ActorPod will wait if m_ActorPod is scheduled in actor threads
-                        //
-                        auto bActive = pRecord->second->ClassFrom<ActiveObject>();
-                        auto stAddress = bActive ? ((ActiveObject *)(pRecord->second))->GetAddress() : Theron::Address::Null();
-                        return {nUID, pRecord->second->GetInvarData(), stAddress, pRecord->second->ClassEntry()};
-                    }else{
-                        AddLog(LOGTYPE_WARNING, "UIDArray mismatch: UID = (%" PRIu32 ", %" PRIu32 ")", nUID, pRecord->second->UID());
-                    }
-                }
+        // readers never block, the object won't be deleted before stReadGuard exits
+        UIDRegistry::ReadGuard stReadGuard(&m_UIDRegistry);
+        if(auto pObject = m_UIDRegistry.Get(nUID)){
+            if(pObject->UID() == nUID){
+                // two solutions
+                // 1. for server object, define a virtual UIDRecord GetUIDRecord()
+                //    then here directly forward the result
+                //
+                // 2. maintain UID() for server object
+                //    maintain UID() and GetAddress() for classes from ActiveObject
+                //    then construct a temporary UIDRecord and return
+                //
+                // solution-1 : simpler but it introduces concept of address to server object
+                // solution-2 : means I should make both UID() and GetAddress() atomically accessable
+                //
+                // UID()        : OK by default
+                // GetAddress() : which calls m_ActorPod->GetAddress()
+                //                m_ActorPod could change when other threads accessing it
+                //
+                // solution:
+                // 1. we constrains that we can only access an UID if the object actively given it
+                //    means if we try to access object through GetUIDRecord(nUID), then the nUID is reported
+                //    by the object itself. rather than we do randomly draw an UID and access it
+                //
+                //    an UID can be deleted then we get an invalid UIDRecord
+                //    this behaves like malloc() / free(), any pointer try to free() should be from malloc()
+                //
+                //    this means if we trying to access ActiveObject::GetAddress(), its m_ActorPod has
+                //    already be initialized otherwise we can't get its UID
+                //
+                // 2. before deletion of active object we should call Deactivate() which calls m_ActorPod->Detach()
+                //    this helps to detach *this* from the actor thread of m_ActorPod, then deletion in other thread is OK
+                //
+                //    then deletion of m_ActorPod will wait if m_ActorPod is scheduled in actor threads
+                //
+                auto nClassMask = pObject->ClassMask();
+                auto stAddress  = (nClassMask & ClassTag<ActiveObject>::Tag) ? ((ActiveObject *)(pObject))->GetAddress() : Theron::Address::Null();
+                return {nUID, pObject->GetInvarData(), stAddress, pObject->ClassEntry(), nClassMask};
+            }else{
+                AddLog(LOGTYPE_WARNING, "UIDRegistry mismatch: UID = (%" PRIu32 ", %" PRIu32 ")", nUID, pObject->UID());
             }
         }
     }
@@ -799,7 +844,7 @@ UIDRecord MonoServer::GetUIDRecord(uint32_t nUID)
     // 3. record contains an empty pointer
     // 4. record mismatch
     static const std::vector<ServerObject::ClassCodeName> stNullEntry {};
-    return UIDRecord(0, {}, Theron::Address::Null(), stNullEntry);
+    return UIDRecord(0, {}, Theron::Address::Null(), stNullEntry, CLASSTAG_NONE);
 }
 
 bool MonoServer::RegisterLuaExport(CommandLuaModule *pModule, uint32_t nCWID)
@@ -911,6 +956,72 @@ bool MonoServer::RegisterLuaExport(CommandLuaModule *pModule, uint32_t nCWID)
             }
         });
 
+        // register command dumpActorMetrics
+        // print per message type counters to current window, need --trace-actor-message-count
+        pModule->GetLuaState().set_function("dumpActorMetrics", [this, nCWID]()
+        {
+            extern ServerEnv *g_ServerEnv;
+            if(!g_ServerEnv->TraceActorMessageCount){
+                AddCWLog(nCWID, 2, ">>> ", "Actor metrics disabled, enable it by MIR2X_DEBUG_ARGS=\"--trace-actor-message-count\"");
+                return;
+            }
+
+            for(auto &rstLine: ActorMetrics::Dump()){
+                AddCWLog(nCWID, 0, "> ", "%s", rstLine.c_str());
+            }
+        });
+
+        // register command dumpActorMetricsFile(fileName)
+        // same as dumpActorMetrics but write to given file
+        pModule->GetLuaState().set_function("dumpActorMetricsFile", [this, nCWID](std::string szFileName) -> bool
+        {
+            extern ServerEnv *g_ServerEnv;
+            if(!g_ServerEnv->TraceActorMessageCount){
+                AddCWLog(nCWID, 2, ">>> ", "Actor metrics disabled, enable it by MIR2X_DEBUG_ARGS=\"--trace-actor-message-count\"");
+                return false;
+            }
+
+            if(!ActorMetrics::DumpFile(szFileName.c_str())){
+                AddCWLog(nCWID, 2, ">>> ", "Failed to dump actor metrics to file: %s", szFileName.c_str());
+                return false;
+            }
+            return true;
+        });
+
+        // register command dumpPathMetrics
+        // print queue depth and search cost of the path finding service
+        pModule->GetLuaState().set_function("dumpPathMetrics", [this, nCWID]()
+        {
+            extern PathService *g_PathService;
+            for(auto &rstLine: g_PathService->Dump()){
+                AddCWLog(nCWID, 0, "> ", "%s", rstLine.c_str());
+            }
+        });
+
+        // register command planRoute
+        // plan a route on loaded maps and print the waypoints
+        pModule->GetLuaState().set_function("planRoute", [this, nCWID](int nMapID, int nX, int nY, int nEndMapID, int nEndX, int nEndY) -> bool
+        {
+            extern RoutePlanner *g_RoutePlanner;
+            std::vector<RoutePlanner::RouteNode> stRouteV;
+
+            int  nCost  = -1;
+            auto stTime = std::chrono::steady_clock::now();
+            if(!g_RoutePlanner->Plan((uint32_t)(nMapID), nX, nY, (uint32_t)(nEndMapID), nEndX, nEndY, &stRouteV, &nCost)){
+                AddCWLog(nCWID, 2, ">>> ", "planRoute(MapID: int, X: int, Y: int, EndMapID: int, EndX: int, EndY: int)");
+                AddCWLog(nCWID, 2, ">>> ", "no route, or the maps are not loaded yet");
+                return false;
+            }
+
+            auto nCostUS = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - stTime).count();
+            AddCWLog(nCWID, 0, "> ", "Waypoint %d, Step %d, %lldus", (int)(stRouteV.size()), nCost, (long long)(nCostUS));
+
+            for(auto &rstNode: stRouteV){
+                AddCWLog(nCWID, 0, "> ", "%s (%d, %d)", DBCOM_MAPRECORD(rstNode.MapID).Name, rstNode.X, rstNode.Y);
+            }
+            return true;
+        });
+
         // register command mapList
         // return a table (userData) to lua for ipairs() check
         pModule->GetLuaState().set_function("getMapIDList", [this](sol::this_state stThisLua)
@@ -934,7 +1045,11 @@ bool MonoServer::RegisterLuaExport(CommandLuaModule *pModule, uint32_t nCWID)
 
         pModule->GetLuaState().script(
             R"###( g_HelpTable = {}                                                        )###""\n"
-            R"###( g_HelpTable["listMap"] = "print all map indices to current window"      )###""\n");
+            R"###( g_HelpTable["listMap"] = "print all map indices to current window"      )###""\n"
+            R"###( g_HelpTable["dumpActorMetrics"] = "print actor message counters"        )###""\n"
+            R"###( g_HelpTable["dumpActorMetricsFile"] = "write actor message counters"    )###""\n"
+            R"###( g_HelpTable["dumpPathMetrics"] = "print path finding queue and cost"    )###""\n"
+            R"###( g_HelpTable["planRoute"] = "planRoute(MapID: int, X: int, Y: int, EndMapID: int, EndX: int, EndY: int)" )###""\n");
 
         // part-2: make up the function to print the table entry
         pModule->GetLuaState().script(
@@ -25,6 +25,7 @@
 #include <vector>
 #include <chrono>
 #include <cstdint>
+#include <condition_variable>
 #include <sol/sol.hpp>
 #include <type_traits>
 #include <unordered_map>
@@ -34,6 +35,7 @@
 #include "taskhub.hpp"
 #include "database.hpp"
 #include "uidrecord.hpp"
+#include "uidregistry.hpp"
 #include "eventtaskhub.hpp"
 #include "commandluamodule.hpp"
 
@@ -41,12 +43,6 @@ class ServiceCore;
 class ServerObject;
 class MonoServer final
 {
-    struct UIDLockRecord
-    {
-        std::mutex Lock;
-        std::unordered_map<uint32_t, const ServerObject *> Record;
-    };
-
     private:
         std::mutex m_LogLock;
         std::vector<char> m_LogBuf;
@@ -57,6 +53,7 @@ class MonoServer final
 
     private:
         std::mutex m_NotifyGUILock;
+        std::condition_variable m_NotifyGUICV;
         std::queue<std::string> m_NotifyGUIQ;
 
     private:
@@ -66,7 +63,7 @@ class MonoServer final
         std::atomic<uint32_t> m_GlobalUID;
 
     private:
-        std::array<UIDLockRecord, 17> m_UIDArray;
+        UIDRegistry m_UIDRegistry;
 
     private:
         std::chrono::time_point<std::chrono::system_clock> m_StartTime;
@@ -75,6 +72,10 @@ class MonoServer final
         void NotifyGUI(std::string);
         void ParseNotifyGUIQ();
 
+        // headless mode only
+        // main thread blocks here till any notification comes
+        void WaitNotifyGUIQ();
+
     public:
         void FlushBrowser();
         void FlushCWBrowser();
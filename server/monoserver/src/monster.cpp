@@ -125,6 +125,7 @@ Monster::Monster(uint32_t   nMonsterID,
     };
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<Monster>();
 
     SetState(STATE_DEAD    , 0);
     SetState(STATE_NEVERDIE, 0);
@@ -275,7 +276,7 @@ bool Monster::AttackUID(uint32_t nUID, int nDC)
 bool Monster::TrackUID(uint32_t nUID)
 {
     if(CanMove()){
-        return RetrieveLocation(nUID, [this](const COLocation &rstCOLocation) -> bool
+        return RetrieveLocation(nUID, [this, nUID](const COLocation &rstCOLocation) -> bool
         {
             auto nX     = rstCOLocation.X;
             auto nY     = rstCOLocation.Y;
@@ -291,7 +292,7 @@ bool Monster::TrackUID(uint32_t nUID)
                         }
                     default:
                         {
-                            return MoveOneStep(nX, nY);
+                            return MoveOneStep(nX, nY, nUID);
                         }
                 }
             }
@@ -377,7 +378,7 @@ bool Monster::FollowMaster()
                                 }
                             default:
                                 {
-                                    return MoveOneStep(nBackX, nBackY);
+                                    return MoveOneStep(nBackX, nBackY, 0);
                                 }
                         }
                     }
@@ -802,12 +803,12 @@ bool Monster::StruckDamage(const DamageNode &rstDamage)
     return false;
 }
 
-bool Monster::MoveOneStep(int nX, int nY)
+bool Monster::MoveOneStep(int nX, int nY, uint32_t nTargetUID)
 {
     switch(FindPathMethod()){
-        case FPMETHOD_ASTAR   : return MoveOneStepAStar  (nX, nY);
+        case FPMETHOD_ASTAR   : return MoveOneStepAStar  (nX, nY, nTargetUID);
         case FPMETHOD_GREEDY  : return MoveOneStepGreedy (nX, nY);
-        case FPMETHOD_COMBINE : return MoveOneStepCombine(nX, nY);
+        case FPMETHOD_COMBINE : return MoveOneStepCombine(nX, nY, nTargetUID);
         default               : return false;
     }
 }
@@ -847,7 +848,7 @@ bool Monster::MoveOneStepGreedy(int nX, int nY)
     return false;
 }
 
-bool Monster::MoveOneStepCombine(int nX, int nY)
+bool Monster::MoveOneStepCombine(int nX, int nY, uint32_t nTargetUID)
 {
     int nX0 = X();
     int nY0 = Y();
@@ -879,13 +880,13 @@ bool Monster::MoveOneStepCombine(int nX, int nY)
     // and the a-star cache can't help
 
     auto stvPathNode = GetChaseGrid(nX, nY);
-    auto fnOnErrorRound0 = [this, stvPathNode, nX, nY]()
+    auto fnOnErrorRound0 = [this, stvPathNode, nX, nY, nTargetUID]()
     {
-        auto fnOnErrorRound1 = [this, stvPathNode, nX, nY]()
+        auto fnOnErrorRound1 = [this, stvPathNode, nX, nY, nTargetUID]()
         {
-            auto fnOnErrorRound2 = [this, nX, nY]()
+            auto fnOnErrorRound2 = [this, nX, nY, nTargetUID]()
             {
-                return MoveOneStepAStar(nX, nY);
+                return MoveOneStepAStar(nX, nY, nTargetUID);
             };
             return RequestMove(stvPathNode[2].X, stvPathNode[2].Y, MoveSpeed(), false, [](){}, fnOnErrorRound2);
         };
@@ -894,7 +895,7 @@ bool Monster::MoveOneStepCombine(int nX, int nY)
     return RequestMove(stvPathNode[0].X, stvPathNode[0].Y, MoveSpeed(), false, [](){}, fnOnErrorRound0);
 }
 
-bool Monster::MoveOneStepAStar(int nX, int nY)
+bool Monster::MoveOneStepAStar(int nX, int nY, uint32_t nTargetUID)
 {
     switch(LDistance2(X(), Y(), nX, nY)){
         case 0:
@@ -926,14 +927,16 @@ bool Monster::MoveOneStepAStar(int nX, int nY)
     // need firstly do path finding by server map
 
     AMPathFind stAMPF;
-    stAMPF.UID     = UID();
-    stAMPF.MapID   = MapID();
-    stAMPF.MaxStep = 1;
-    stAMPF.CheckCO = true;
-    stAMPF.X       = X();
-    stAMPF.Y       = Y();
-    stAMPF.EndX    = nX;
-    stAMPF.EndY    = nY;
+    stAMPF.UID       = UID();
+    stAMPF.MapID     = MapID();
+    stAMPF.MaxStep   = 1;
+    stAMPF.CheckCO   = true;
+    stAMPF.MaxExpand = 0;
+    stAMPF.TargetUID = nTargetUID;
+    stAMPF.X         = X();
+    stAMPF.Y         = Y();
+    stAMPF.EndX      = nX;
+    stAMPF.EndY      = nY;
 
     auto fnOnResp = [this, nX, nY](const MessagePack &rstRMPK, const Theron::Address &)
     {
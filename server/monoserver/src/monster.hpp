@@ -194,7 +194,7 @@ class Monster: public CharObject
         void ReportCORecord(uint32_t);
 
     protected:
-        bool MoveOneStep(int, int);
+        bool MoveOneStep(int, int, uint32_t);
 
     protected:
         void CheckTarget();
@@ -212,9 +212,9 @@ class Monster: public CharObject
         void CheckFriend(uint32_t, std::function<void(int)>);
 
     protected:
-        bool MoveOneStepAStar  (int, int);
+        bool MoveOneStepAStar  (int, int, uint32_t);
         bool MoveOneStepGreedy (int, int);
-        bool MoveOneStepCombine(int, int);
+        bool MoveOneStepCombine(int, int, uint32_t);
 
     protected:
         bool CanMove();
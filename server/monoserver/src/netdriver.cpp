@@ -18,30 +18,41 @@
  * =====================================================================================
  */
 
+#include <algorithm>
 #include "netdriver.hpp"
 #include "sysconst.hpp"
+#include "netcapture.hpp"
 #include "monoserver.hpp"
 
 NetDriver::NetDriver()
     : SyncDriver()
     , m_Port(0)
-    , m_IO(nullptr)
     , m_EndPoint(nullptr)
     , m_Acceptor(nullptr)
     , m_Socket(nullptr)
-    , m_Thread()
+    , m_IOV()
+    , m_IOWorkV()
+    , m_ThreadV()
+    , m_NextIO(0)
     , m_SCAddress(Theron::Address::Null())
     , m_ValidQ()
+    , m_LiveLock()
+    , m_LiveV()
+    , m_LiveIndexV(SYS_MAXPLAYERNUM, -1)
 {}
 
 NetDriver::~NetDriver()
 {
     Shutdown(0);
 
+    // sessions are released by Shutdown(0)
+    // then the io_service has no pending handlers when deleted
     delete m_Socket;
     delete m_Acceptor;
     delete m_EndPoint;
-    delete m_IO;
+
+    m_IOWorkV.clear();
+    m_IOV.clear();
 }
 
 bool NetDriver::CheckPort(uint32_t nPort)
@@ -60,7 +71,7 @@ bool NetDriver::CheckPort(uint32_t nPort)
 }
 
 // TODO stop io before we restart it
-bool NetDriver::InitASIO(uint32_t nPort)
+bool NetDriver::InitASIO(uint32_t nPort, size_t nIOCount)
 {
     // 1. set server listen port
 
@@ -73,15 +84,27 @@ bool NetDriver::InitASIO(uint32_t nPort)
     m_Port = nPort;
 
     try{
-        m_IO       = new asio::io_service();
+        m_IOWorkV.clear();
+        m_IOV.clear();
+        for(size_t nIndex = 0; nIndex < nIOCount; ++nIndex){
+            m_IOV.emplace_back(new asio::io_service(1));
+            m_IOWorkV.emplace_back(new asio::io_service::work(*(m_IOV.back())));
+        }
+
         m_EndPoint = new asio::ip::tcp::endpoint(asio::ip::tcp::v4(), m_Port);
-        m_Acceptor = new asio::ip::tcp::acceptor(*m_IO, *m_EndPoint);
-        m_Socket   = new asio::ip::tcp::socket(*m_IO);
+        m_Acceptor = new asio::ip::tcp::acceptor(*(m_IOV[0]), *m_EndPoint);
+        m_Socket   = new asio::ip::tcp::socket(*(m_IOV[0]));
     }catch(...){
         delete m_Socket;
         delete m_Acceptor;
         delete m_EndPoint;
-        delete m_IO;
+
+        m_Socket   = nullptr;
+        m_Acceptor = nullptr;
+        m_EndPoint = nullptr;
+
+        m_IOWorkV.clear();
+        m_IOV.clear();
 
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "Initialization of ASIO failed");
@@ -91,7 +114,7 @@ bool NetDriver::InitASIO(uint32_t nPort)
     return true;
 }
 
-int NetDriver::Launch(uint32_t nPort, const Theron::Address &rstSCAddr)
+int NetDriver::Launch(uint32_t nPort, const Theron::Address &rstSCAddr, size_t nIOCount)
 {
     // 1. check parameter
     if(!CheckPort(nPort) || rstSCAddr == Theron::Address::Null()){ return 1; }
@@ -99,9 +122,16 @@ int NetDriver::Launch(uint32_t nPort, const Theron::Address &rstSCAddr)
     // 2. assign the target address
     m_SCAddress = rstSCAddr;
 
-    // 3. make sure the internal thread has ended
-    if(m_Thread.joinable()){
-        m_Thread.join();
+    // 3. make sure the internal threads have ended
+    for(auto &rstThread: m_ThreadV){
+        if(rstThread.joinable()){
+            rstThread.join();
+        }
+    }
+    m_ThreadV.clear();
+
+    if(!nIOCount){
+        nIOCount = (std::max<size_t>)(1, std::thread::hardware_concurrency());
     }
 
     // 4. prepare valid session ID
@@ -111,14 +141,20 @@ int NetDriver::Launch(uint32_t nPort, const Theron::Address &rstSCAddr)
     }
 
     // 5. init ASIO
-    if(!InitASIO(nPort)){ return 2; }
+    if(!InitASIO(nPort, nIOCount)){ return 2; }
 
     // 6. put one accept handler inside the event loop
-    //    but the asio main loop is not driven by m_Thread yet here
+    //    but the asio main loop is not driven by m_ThreadV yet here
     Accept();
 
-    // 7. start the internal thread to driven the loop
-    m_Thread = std::thread([this](){ m_IO->run(); });
+    // 7. start the internal threads to driven the loops
+    //    one thread per io_service, then handlers of one session never run concurrently
+    for(auto &pIO: m_IOV){
+        m_ThreadV.emplace_back([pIO = pIO.get()](){ pIO->run(); });
+    }
+
+    extern MonoServer *g_MonoServer;
+    g_MonoServer->AddLog(LOGTYPE_INFO, "Network started with %d io threads", (int)(m_IOV.size()));
 
     // 8. all Launch() function will return 0 when succceeds
     return 0;
@@ -128,7 +164,11 @@ bool NetDriver::Activate(uint32_t nSessionID, const Theron::Address &rstTargetAd
 {
     if(nSessionID && nSessionID < (uint32_t)(std::extent<decltype(m_ChannelList)>::value)){
         if(rstTargetAddress == m_SCAddress){
-            return m_ChannelList[nSessionID].Launch(rstTargetAddress);
+            if(m_ChannelList[nSessionID].Launch(rstTargetAddress)){
+                AddLive(nSessionID);
+                return true;
+            }
+            return false;
         }else{
             extern MonoServer *g_MonoServer;
             g_MonoServer->AddLog(LOGTYPE_WARNING, "Channel %d is not activated by service core");
@@ -138,6 +178,54 @@ bool NetDriver::Activate(uint32_t nSessionID, const Theron::Address &rstTargetAd
     return false;
 }
 
+void NetDriver::AddLive(uint32_t nSessionID)
+{
+    std::lock_guard<std::mutex> stLockGuard(m_LiveLock);
+    if(m_LiveIndexV[nSessionID] < 0){
+        m_LiveIndexV[nSessionID] = (int)(m_LiveV.size());
+        m_LiveV.push_back(nSessionID);
+    }
+}
+
+void NetDriver::RemoveLive(uint32_t nSessionID)
+{
+    std::lock_guard<std::mutex> stLockGuard(m_LiveLock);
+    auto nIndex = m_LiveIndexV[nSessionID];
+    if(nIndex >= 0){
+        // swap with the last one then pop
+        // order of sessions in m_LiveV doesn't matter
+        auto nLastID = m_LiveV.back();
+        m_LiveV[nIndex]       = nLastID;
+        m_LiveIndexV[nLastID] = nIndex;
+
+        m_LiveV.pop_back();
+        m_LiveIndexV[nSessionID] = -1;
+    }
+}
+
+bool NetDriver::Broadcast(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+{
+    // compression and copy is done once here
+    // then each session only enqueues a reference of the shared buffer
+    SharedBuf stBuf;
+    if(!Session::BuildSharedBuf(nHC, pData, nDataLen, &stBuf)){
+        return false;
+    }
+
+    extern NetCaptureWriter *g_NetCapture;
+    if(g_NetCapture->Valid()){
+        g_NetCapture->Write(NetCapture::BROADCAST_SESSIONID, NetCapture::DIR_SM, nHC, pData, nDataLen);
+    }
+
+    bool bSendDone = true;
+    std::lock_guard<std::mutex> stLockGuard(m_LiveLock);
+
+    for(auto nSessionID: m_LiveV){
+        bSendDone = m_ChannelList[nSessionID].Send(nHC, stBuf) && bSendDone;
+    }
+    return bSendDone;
+}
+
 void NetDriver::Accept()
 {
     auto fnAccept = [this](std::error_code stEC)
@@ -178,6 +266,9 @@ void NetDriver::Accept()
 
         // use channel nValidID to host the accept
         // if not use std::move() we'll get ``already open" error
+        //
+        // the moved socket keeps the io_service it's created with
+        // which was picked by round-robin when posting this accept
         m_ChannelList[nValidID].ChannBuild(nValidID, std::move(*m_Socket));
 
         // forward a message by SyncDriver::Forward()
@@ -199,5 +290,11 @@ void NetDriver::Accept()
         Accept();
     };
 
+    // pick the io_service for the next session
+    // acceptor runs in m_IOV[0] but the peer socket can belong to any io_service in the pool
+    m_NextIO = (m_NextIO + 1) % m_IOV.size();
+    delete m_Socket;
+    m_Socket = new asio::ip::tcp::socket(*(m_IOV[m_NextIO]));
+
     m_Acceptor->async_accept(*m_Socket, fnAccept);
 }
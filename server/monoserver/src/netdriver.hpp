@@ -9,7 +9,12 @@
  *                 with general info. and nothing will be done till Launch()
  *
  *                 when Launch(Theron::Address) with the actor address of service core
- *                 this pod will start a new thread and run asio::run() inside
+ *                 this pod will start a pool of asio::io_service, each runs in its own
+ *                 thread, the first one also accepts new connections
+ *
+ *                 accepted sessions are assigned to the pool by round-robin, all handlers
+ *                 of one session run in the thread of its io_service, so session code is
+ *                 still single-threaded as before, only different sessions run in parallel
  *
  *                 when a new connection request received, if net driver decide to accept
  *                 it, the pod will:
@@ -56,8 +61,11 @@
 
 #pragma once
 
+#include <mutex>
 #include <atomic>
+#include <memory>
 #include <thread>
+#include <vector>
 #include <cstdint>
 #include <asio.hpp>
 #include <Theron/Theron.h>
@@ -73,13 +81,21 @@ class NetDriver: public SyncDriver
 {
     private:
         unsigned int                m_Port;
-        asio::io_service           *m_IO;
         asio::ip::tcp::endpoint    *m_EndPoint;
         asio::ip::tcp::acceptor    *m_Acceptor;
         asio::ip::tcp::socket      *m_Socket;
 
     private:
-        std::thread m_Thread;
+        // io pool, m_IOV[0] also runs the acceptor
+        // work objects keep io_service::run() from returning when there is no session
+        std::vector<std::unique_ptr<asio::io_service>>       m_IOV;
+        std::vector<std::unique_ptr<asio::io_service::work>> m_IOWorkV;
+        std::vector<std::thread>                             m_ThreadV;
+
+    private:
+        // io_service for next accepted session
+        // only accessed in the accept handler
+        size_t m_NextIO;
 
     private:
         Theron::Address m_SCAddress;
@@ -90,6 +106,14 @@ class NetDriver: public SyncDriver
     private:
         CacheQueue<uint32_t, SYS_MAXPLAYERNUM> m_ValidQ;
 
+    private:
+        // dense list of activated sessions, broadcast only iterates it
+        // m_LiveIndexV[nSessionID] is the index in m_LiveV, or -1 if not in it
+        // accessed by actor threads, protected by m_LiveLock
+        std::mutex            m_LiveLock;
+        std::vector<uint32_t> m_LiveV;
+        std::vector<int>      m_LiveIndexV;
+
     public:
         NetDriver();
 
@@ -98,18 +122,20 @@ class NetDriver: public SyncDriver
 
     protected:
         bool CheckPort(uint32_t);
-        bool InitASIO(uint32_t);
+        bool InitASIO(uint32_t, size_t);
 
     public:
         // launch the net driver with (port, service_core_address)
         // before call this function, the service core should be ready
         // then connection request will be accepted and forward to the service core
         //
+        // the 3rd argument is the count of io threads, 0 means the count of CPU cores
+        //
         // return value:
         //      0: OK
         //      1: invalid argument
         //      2: asio initialization failed
-        int Launch(uint32_t, const Theron::Address &);
+        int Launch(uint32_t, const Theron::Address &, size_t = 0);
 
     public:
         // start the specified session with specified actor address
@@ -130,21 +156,36 @@ class NetDriver: public SyncDriver
             switch(nSessionID){
                 case 0:
                     {
+                        {
+                            std::lock_guard<std::mutex> stLockGuard(m_LiveLock);
+                            for(auto nID: m_LiveV){
+                                m_LiveIndexV[nID] = -1;
+                            }
+                            m_LiveV.clear();
+                        }
+
                         for(int nIndex = 1; nIndex < (int)(std::extent<decltype(m_ChannelList)>::value); ++nIndex){
                             m_ChannelList[nIndex].ChannRelease();
                             m_ValidQ.PushHead((uint32_t)(nIndex));
                         }
 
-                        m_IO->stop();
-                        if(m_Thread.joinable()){
-                            m_Thread.join();
+                        for(auto &pIO: m_IOV){
+                            pIO->stop();
+                        }
+
+                        for(auto &rstThread: m_ThreadV){
+                            if(rstThread.joinable()){
+                                rstThread.join();
+                            }
                         }
+                        m_ThreadV.clear();
 
                         break;
                     }
                 default:
                     {
                         if(nSessionID < (uint32_t)(std::extent<decltype(m_ChannelList)>::value)){
+                            RemoveLive(nSessionID);
                             m_ChannelList[nSessionID].ChannRelease();
                             m_ValidQ.PushHead(nSessionID);
                         }
@@ -174,37 +215,49 @@ class NetDriver: public SyncDriver
 
             // when some session failed
             // should we send cancel message or leave it as it is?
+            if(nSessionID == 0){
+                return Broadcast(nHC, std::forward<Args>(args)...);
+            }
 
-            int nIndex0 = -1;
-            int nIndex1 = -1;
-
-            switch(nSessionID){
-                case 0:
-                    {
-                        nIndex0 = (int)(1);
-                        nIndex1 = (int)(std::extent<decltype(m_ChannelList)>::value);
-                        break;
-                    }
-                default:
-                    {
-                        if(nSessionID < (uint32_t)(std::extent<decltype(m_ChannelList)>::value)){
-                            nIndex0 = (int)(nSessionID + 0);
-                            nIndex1 = (int)(nSessionID + 1);
-                        }else{
-                            return false;
-                        }
-                        break;
-                    }
+            if(nSessionID < (uint32_t)(std::extent<decltype(m_ChannelList)>::value)){
+                return m_ChannelList[nSessionID].Send(nHC, std::forward<Args>(args)...);
             }
+            return false;
+        }
+
+    public:
+        // send to all activated sessions
+        // message is encoded once to a shared buffer and every session refers to it
+        // return false if the message is invalid or any session failed, failed session won't stop the rest
+        bool Broadcast(uint8_t, const uint8_t *, size_t);
+
+        bool Broadcast(uint8_t nHC)
+        {
+            return Broadcast(nHC, (const uint8_t *)(nullptr), (size_t)(0));
+        }
+
+        template<typename T> bool Broadcast(uint8_t nHC, const T &stMsgT)
+        {
+            return Broadcast(nHC, (const uint8_t *)(&stMsgT), sizeof(stMsgT));
+        }
 
-            for(int nIndex = nIndex0; nIndex < nIndex1; ++nIndex){
-                if(!m_ChannelList[nIndex].Send(nHC, std::forward<Args>(args)...)){
-                    return false;
-                }
+        // send with callbacks, each session needs its own task to invoke the callback
+        // can't share the buffer, send one by one
+        template<typename T, typename... Args> bool Broadcast(uint8_t nHC, const T &stArg, const Args &... stArgs)
+        {
+            bool bSendDone = true;
+            std::lock_guard<std::mutex> stLockGuard(m_LiveLock);
+
+            for(auto nSessionID: m_LiveV){
+                bSendDone = m_ChannelList[nSessionID].Send(nHC, stArg, stArgs...) && bSendDone;
             }
-            return true;
+            return bSendDone;
         }
 
+    private:
+        void AddLive(uint32_t);
+        void RemoveLive(uint32_t);
+
     private:
         void Accept();
 };
@@ -0,0 +1,258 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: pathservice.cpp
+ *        Created: 10/18/2026 23:52:16
+ *  Last Modified: 10/18/2026 23:52:16
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cinttypes>
+#include <algorithm>
+#include <type_traits>
+
+#include "threadpn.hpp"
+#include "mathfunc.hpp"
+#include "sysconst.hpp"
+#include "syncdriver.hpp"
+#include "monoserver.hpp"
+#include "pathservice.hpp"
+#include "actormessage.hpp"
+#include "gridpathfinder.hpp"
+
+PathService::PathService()
+    : m_SeqLock()
+    , m_Seq(0)
+    , m_SeqTable()
+    , m_PendingCount(0)
+    , m_MaxPendingCount(0)
+    , m_SubmitCount(0)
+    , m_DoneCount(0)
+    , m_FailCount(0)
+    , m_BudgetCount(0)
+    , m_CancelCount(0)
+    , m_ExpandCount(0)
+    , m_CostUS(0)
+    , m_MaxCostUS(0)
+    , m_FlowBuildCount(0)
+    , m_FlowHitCount(0)
+{}
+
+bool PathService::Submit(PathQuery stQuery)
+{
+    uint32_t nSeq = 0;
+    if(stQuery.UID){
+        std::lock_guard<std::mutex> stLockGuard(m_SeqLock);
+        if(!(nSeq = ++m_Seq)){
+            nSeq = ++m_Seq;
+        }
+        m_SeqTable[stQuery.UID] = nSeq;
+    }
+
+    m_SubmitCount++;
+    auto nPendingCount = ++m_PendingCount;
+
+    auto nMaxPendingCount = m_MaxPendingCount.load();
+    while(nPendingCount > nMaxPendingCount && !m_MaxPendingCount.compare_exchange_weak(nMaxPendingCount, nPendingCount)){
+        continue;
+    }
+
+    // ThreadPool2 takes copyable task only
+    // put the query in shared_ptr, the box state can be a few KB
+    auto pQuery = std::make_shared<PathQuery>(std::move(stQuery));
+
+    extern ThreadPN *g_ThreadPN;
+    if(g_ThreadPN->Add([this, pQuery, nSeq](){ Run(*pQuery, nSeq); })){
+        return true;
+    }
+
+    m_PendingCount--;
+    m_FailCount++;
+
+    CheckSeq(pQuery->UID, nSeq, true);
+    SyncDriver().Forward(MPK_ERROR, pQuery->From, pQuery->RespondID);
+    return false;
+}
+
+bool PathService::CheckSeq(uint32_t nUID, uint32_t nSeq, bool bRemove)
+{
+    // return true if nSeq is the latest query of nUID
+    // remove the record if needed, then the table only keeps queries in flight
+    if(!nUID){
+        return true;
+    }
+
+    std::lock_guard<std::mutex> stLockGuard(m_SeqLock);
+    auto pRecord = m_SeqTable.find(nUID);
+    if(pRecord == m_SeqTable.end() || pRecord->second != nSeq){
+        return false;
+    }
+
+    if(bRemove){
+        m_SeqTable.erase(pRecord);
+    }
+    return true;
+}
+
+void PathService::Run(const PathQuery &rstQuery, uint32_t nSeq)
+{
+    m_PendingCount--;
+
+    // 1. cancel the query if it's not needed anymore
+    //    reply anyway, the requestor can be still waiting for it
+    {
+        bool bCancel = !CheckSeq(rstQuery.UID, nSeq, false);
+        if(!bCancel && rstQuery.UID){
+            extern MonoServer *g_MonoServer;
+            bCancel = !g_MonoServer->GetUIDRecord(rstQuery.UID);
+        }
+
+        if(bCancel){
+            m_CancelCount++;
+            CheckSeq(rstQuery.UID, nSeq, true);
+            SyncDriver().Forward(MPK_ERROR, rstQuery.From, rstQuery.RespondID);
+            return;
+        }
+    }
+
+    // 2. search on the snapshot
+    //    nodes are pooled in the finder, one finder per worker thread
+    thread_local GridPathFinder t_PathFinder;
+
+    const auto &rstGround = *(rstQuery.Ground);
+    auto fnCellState = [&rstQuery, &rstGround](int nX, int nY) -> uint8_t
+    {
+        if(!rstGround.Valid(nX, nY)){
+            return GridPathFinder::CELL_BLOCK;
+        }
+
+        uint8_t nState = GridPathFinder::CELL_FREE;
+        if(true
+                && nX >= rstQuery.BoxX
+                && nY >= rstQuery.BoxY
+                && nX <  rstQuery.BoxX + rstQuery.BoxW
+                && nY <  rstQuery.BoxY + rstQuery.BoxH){
+            nState |= rstQuery.BoxState[(nY - rstQuery.BoxY) * rstQuery.BoxW + (nX - rstQuery.BoxX)];
+        }
+        return nState;
+    };
+
+    auto stStartTime = std::chrono::steady_clock::now();
+    auto nSearchResult = t_PathFinder.Search(rstGround.W(), rstGround.H(), rstQuery.X, rstQuery.Y, rstQuery.EndX, rstQuery.EndY, rstQuery.MaxStep, rstQuery.CheckCO, rstQuery.MaxExpand, fnCellState);
+    auto nCostUS = (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - stStartTime).count());
+
+    m_CostUS      += nCostUS;
+    m_ExpandCount += t_PathFinder.ExpandCount();
+
+    auto nMaxCostUS = m_MaxCostUS.load();
+    while(nCostUS > nMaxCostUS && !m_MaxCostUS.compare_exchange_weak(nMaxCostUS, nCostUS)){
+        continue;
+    }
+
+    CheckSeq(rstQuery.UID, nSeq, true);
+    switch(nSearchResult){
+        case GridPathFinder::SEARCH_SUCCEEDED:
+            {
+                m_DoneCount++;
+                break;
+            }
+        case GridPathFinder::SEARCH_BUDGET:
+            {
+                m_BudgetCount++;
+                SyncDriver().Forward(MPK_ERROR, rstQuery.From, rstQuery.RespondID);
+                return;
+            }
+        default:
+            {
+                m_FailCount++;
+                SyncDriver().Forward(MPK_ERROR, rstQuery.From, rstQuery.RespondID);
+                return;
+            }
+    }
+
+    // 3. fill the path to the message
+    //    we fill all slots with -1 for initialization
+    //    won't keep a record of ``how many path nodes are valid"
+    AMPathFindOK stAMPFOK;
+    stAMPFOK.UID   = rstQuery.UID;
+    stAMPFOK.MapID = rstQuery.MapID;
+
+    constexpr auto nPathCount = std::extent<decltype(stAMPFOK.Point)>::value;
+    for(int nIndex = 0; nIndex < (int)(nPathCount); ++nIndex){
+        stAMPFOK.Point[nIndex].X = -1;
+        stAMPFOK.Point[nIndex].Y = -1;
+    }
+
+    const auto &rstPath = t_PathFinder.Path();
+
+    int nCurrN = 0;
+    int nCurrX = rstQuery.X;
+    int nCurrY = rstQuery.Y;
+
+    for(size_t nIndex = 1; nIndex < rstPath.size(); ++nIndex){
+        if(nCurrN >= (int)(nPathCount)){ break; }
+        int nEndX = rstPath[nIndex].X;
+        int nEndY = rstPath[nIndex].Y;
+        switch(LDistance2(nCurrX, nCurrY, nEndX, nEndY)){
+            case 1:
+            case 2:
+                {
+                    stAMPFOK.Point[nCurrN].X = nCurrX;
+                    stAMPFOK.Point[nCurrN].Y = nCurrY;
+
+                    nCurrN++;
+
+                    nCurrX = nEndX;
+                    nCurrY = nEndY;
+                    break;
+                }
+            case 0:
+            default:
+                {
+                    extern MonoServer *g_MonoServer;
+                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid path node");
+                    break;
+                }
+        }
+    }
+
+    SyncDriver().Forward({MPK_PATHFINDOK, stAMPFOK}, rstQuery.From, rstQuery.RespondID);
+}
+
+std::vector<std::string> PathService::Dump() const
+{
+    auto nSearchCount = m_DoneCount.load() + m_FailCount.load() + m_BudgetCount.load();
+
+    char szLine[256];
+    std::vector<std::string> stLineV;
+
+    std::snprintf(szLine, sizeof(szLine), "Submit %" PRIu64 ", Pending %" PRIu64 ", MaxPending %" PRIu64, m_SubmitCount.load(), m_PendingCount.load(), m_MaxPendingCount.load());
+    stLineV.push_back(szLine);
+
+    std::snprintf(szLine, sizeof(szLine), "Done %" PRIu64 ", Fail %" PRIu64 ", Budget %" PRIu64 ", Cancel %" PRIu64, m_DoneCount.load(), m_FailCount.load(), m_BudgetCount.load(), m_CancelCount.load());
+    stLineV.push_back(szLine);
+
+    std::snprintf(szLine, sizeof(szLine), "AvgExpand %.1f, AvgCost %.1f us, MaxCost %" PRIu64 " us",
+            nSearchCount ? (1.0 * m_ExpandCount.load() / nSearchCount) : 0.0,
+            nSearchCount ? (1.0 * m_CostUS.load() / nSearchCount) : 0.0,
+            m_MaxCostUS.load());
+    stLineV.push_back(szLine);
+
+    // each hit is one search saved, each build is one BFS in the map actor
+    std::snprintf(szLine, sizeof(szLine), "FlowBuild %" PRIu64 ", FlowHit %" PRIu64 " (searches saved)", m_FlowBuildCount.load(), m_FlowHitCount.load());
+    stLineV.push_back(szLine);
+    return stLineV;
+}
@@ -0,0 +1,147 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: pathservice.hpp
+ *        Created: 10/18/2026 23:52:16
+ *  Last Modified: 10/18/2026 23:52:16
+ *
+ *    Description: path finding off the map actor
+ *
+ *                 map actor only takes a snapshot of the query and submits it, search
+ *                 runs in ThreadPN and the reply MPK_PATHFINDOK / MPK_ERROR is sent to the
+ *                 requestor by SyncDriver with the respond ID of the MPK_PATHFIND
+ *
+ *                 snapshot of a query:
+ *
+ *                      1. GroundMask of the map, built once and shared by all queries
+ *                      2. CO and lock state of cells around the requestor, CO's outside
+ *                         are ignored since they move anyway before we get there, the
+ *                         requestor searches again every step
+ *
+ *                 query is cancelled before searching if the requestor is dead, or it has
+ *                 submitted a newer query, a running search is bounded by its node budget
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <Theron/Theron.h>
+#include "groundmask.hpp"
+
+class PathService final
+{
+    public:
+        struct PathQuery
+        {
+            uint32_t UID;
+            uint32_t MapID;
+
+            int X;
+            int Y;
+            int EndX;
+            int EndY;
+
+            int    MaxStep;
+            bool   CheckCO;
+            size_t MaxExpand;
+
+            // queries in flight keep a reference, then the map can go away
+            std::shared_ptr<const GroundMask> Ground;
+
+            // GridPathFinder::CELL_CO / CELL_LOCK of cells inside the box
+            // empty if CheckCO is not set
+            int BoxX;
+            int BoxY;
+            int BoxW;
+            int BoxH;
+
+            std::vector<uint8_t> BoxState;
+
+            Theron::Address From;
+            uint32_t        RespondID;
+        };
+
+    private:
+        // latest query of each requestor
+        // older ones still in the queue are cancelled
+        std::mutex m_SeqLock;
+        uint32_t   m_Seq;
+
+        std::unordered_map<uint32_t, uint32_t> m_SeqTable;
+
+    private:
+        std::atomic<uint64_t> m_PendingCount;
+        std::atomic<uint64_t> m_MaxPendingCount;
+
+    private:
+        std::atomic<uint64_t> m_SubmitCount;
+        std::atomic<uint64_t> m_DoneCount;
+        std::atomic<uint64_t> m_FailCount;
+        std::atomic<uint64_t> m_BudgetCount;
+        std::atomic<uint64_t> m_CancelCount;
+
+    private:
+        std::atomic<uint64_t> m_ExpandCount;
+        std::atomic<uint64_t> m_CostUS;
+        std::atomic<uint64_t> m_MaxCostUS;
+
+    private:
+        // queries answered by the flow field in map actors, never submitted here
+        std::atomic<uint64_t> m_FlowBuildCount;
+        std::atomic<uint64_t> m_FlowHitCount;
+
+    public:
+        PathService();
+
+    public:
+        // called by map actors, always replies even if fails
+        bool Submit(PathQuery);
+
+    public:
+        // queries waiting in ThreadPN
+        uint64_t PendingCount() const
+        {
+            return m_PendingCount.load();
+        }
+
+        uint64_t MaxPendingCount() const
+        {
+            return m_MaxPendingCount.load();
+        }
+
+    public:
+        // reported by map actors, only for Dump()
+        void AddFlowBuild()
+        {
+            m_FlowBuildCount++;
+        }
+
+        void AddFlowHit()
+        {
+            m_FlowHitCount++;
+        }
+
+    public:
+        std::vector<std::string> Dump() const;
+
+    private:
+        void Run(const PathQuery &, uint32_t);
+
+    private:
+        bool CheckSeq(uint32_t, uint32_t, bool);
+};
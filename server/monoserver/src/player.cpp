@@ -57,6 +57,7 @@ Player::Player(uint32_t nDBID,
     };
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<Player>();
 
     m_HP    = 10;
     m_HPMax = 10;
@@ -169,6 +170,7 @@ void Player::OperateAM(const MessagePack &rstMPK, const Theron::Address &rstFrom
 void Player::OperateNet(uint8_t nType, const uint8_t *pData, size_t nDataLen)
 {
     switch(nType){
+        case CM_PING            : Net_CM_PING            (nType, pData, nDataLen); break;
         case CM_QUERYCORECORD   : Net_CM_QUERYCORECORD   (nType, pData, nDataLen); break;
         case CM_REQUESTSPACEMOVE: Net_CM_REQUESTSPACEMOVE(nType, pData, nDataLen); break;
         case CM_ACTION          : Net_CM_ACTION          (nType, pData, nDataLen); break;
@@ -130,6 +130,7 @@ class Player: public CharObject
         void On_MPK_REMOVEGROUNDITEM(const MessagePack &, const Theron::Address &);
 
     private:
+        void Net_CM_PING            (uint8_t, const uint8_t *, size_t);
         void Net_CM_REQUESTSPACEMOVE(uint8_t, const uint8_t *, size_t);
         void Net_CM_QUERYCORECORD   (uint8_t, const uint8_t *, size_t);
         void Net_CM_ACTION          (uint8_t, const uint8_t *, size_t);
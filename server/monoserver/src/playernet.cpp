@@ -21,9 +21,24 @@
 #include <cinttypes>
 #include "player.hpp"
 #include "message.hpp"
+#include "netdriver.hpp"
 #include "actorpod.hpp"
 #include "monoserver.hpp"
 
+void Player::Net_CM_PING(uint8_t, const uint8_t *pBuf, size_t)
+{
+    // echo the tick back without touching it
+    // client uses it to measure the round trip through the whole server
+    CMPing stCMP;
+    std::memcpy(&stCMP, pBuf, sizeof(stCMP));
+
+    SMPing stSMP;
+    stSMP.Tick = stCMP.Tick;
+
+    extern NetDriver *g_NetDriver;
+    g_NetDriver->Send(SessionID(), SM_PING, stSMP);
+}
+
 void Player::Net_CM_ACTION(uint8_t, const uint8_t *pBuf, size_t)
 {
     CMAction stCMA;
@@ -0,0 +1,187 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: respondhandler.hpp
+ *        Created: 10/18/2026 14:02:51
+ *  Last Modified: 10/18/2026 14:02:51
+ *
+ *    Description: callback for ActorPod response, works like
+ *
+ *                      std::function<void(const MessagePack &, const Theron::Address &)>
+ *
+ *                 but keeps the callable in an inline buffer, most lambdas registered
+ *                 by ActorPod::Forward() only capture this and few PODs, so it never
+ *                 touches the allocator, callable larger than the buffer falls back to
+ *                 heap allocation
+ *
+ *                 move-only, ActorPod owns the handler in its response table
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <type_traits>
+#include <Theron/Address.h>
+#include "messagepack.hpp"
+
+class RespondHandler final
+{
+    private:
+        constexpr static size_t SBUF_SIZE = 64;
+
+    private:
+        // type-erased operations of the stored callable
+        // Move(pSrc, pDst) move-constructs callable at pDst and destroys the one at pSrc
+        struct HandlerOps
+        {
+            void (*Invoke )(void *, const MessagePack &, const Theron::Address &);
+            void (*Move   )(void *, void *);
+            void (*Destroy)(void *);
+        };
+
+        template<typename F> struct InlineOps
+        {
+            static void Invoke(void *pBuf, const MessagePack &rstMPK, const Theron::Address &rstAddr)
+            {
+                (*(F *)(pBuf))(rstMPK, rstAddr);
+            }
+
+            static void Move(void *pSrc, void *pDst)
+            {
+                new (pDst) F(std::move(*(F *)(pSrc)));
+                ((F *)(pSrc))->~F();
+            }
+
+            static void Destroy(void *pBuf)
+            {
+                ((F *)(pBuf))->~F();
+            }
+        };
+
+        // too large to fit, buffer only keeps the pointer
+        template<typename F> struct HeapOps
+        {
+            static void Invoke(void *pBuf, const MessagePack &rstMPK, const Theron::Address &rstAddr)
+            {
+                (**(F **)(pBuf))(rstMPK, rstAddr);
+            }
+
+            static void Move(void *pSrc, void *pDst)
+            {
+                *(F **)(pDst) = *(F **)(pSrc);
+            }
+
+            static void Destroy(void *pBuf)
+            {
+                delete *(F **)(pBuf);
+            }
+        };
+
+        template<typename F> constexpr static bool FitInline()
+        {
+            return true
+                && sizeof(F) <= SBUF_SIZE
+                && alignof(std::max_align_t) % alignof(F) == 0
+                && std::is_nothrow_move_constructible<F>::value;
+        }
+
+    private:
+        alignas(std::max_align_t) uint8_t m_Buf[SBUF_SIZE];
+        const HandlerOps *m_Ops;
+
+    public:
+        RespondHandler()
+            : m_Ops(nullptr)
+        {}
+
+        template<typename F, typename = typename std::enable_if<true
+            && !std::is_same<typename std::decay<F>::type, RespondHandler>::value
+            && !std::is_arithmetic<typename std::decay<F>::type>::value>::type>
+        RespondHandler(F &&fnOp)
+            : m_Ops(nullptr)
+        {
+            Assign<typename std::decay<F>::type>(std::forward<F>(fnOp), std::integral_constant<bool, FitInline<typename std::decay<F>::type>()>());
+        }
+
+        RespondHandler(RespondHandler &&rstHandler)
+            : m_Ops(rstHandler.m_Ops)
+        {
+            if(m_Ops){
+                m_Ops->Move(rstHandler.m_Buf, m_Buf);
+                rstHandler.m_Ops = nullptr;
+            }
+        }
+
+        RespondHandler(const RespondHandler &) = delete;
+
+    public:
+       ~RespondHandler()
+        {
+            Clear();
+        }
+
+    public:
+        RespondHandler &operator = (RespondHandler &&rstHandler)
+        {
+            if(this != &rstHandler){
+                Clear();
+                if(rstHandler.m_Ops){
+                    m_Ops = rstHandler.m_Ops;
+                    m_Ops->Move(rstHandler.m_Buf, m_Buf);
+                    rstHandler.m_Ops = nullptr;
+                }
+            }
+            return *this;
+        }
+
+        RespondHandler &operator = (const RespondHandler &) = delete;
+
+    public:
+        operator bool () const
+        {
+            return m_Ops != nullptr;
+        }
+
+        void operator () (const MessagePack &rstMPK, const Theron::Address &rstAddr)
+        {
+            if(m_Ops){
+                m_Ops->Invoke(m_Buf, rstMPK, rstAddr);
+            }
+        }
+
+    public:
+        void Clear()
+        {
+            if(m_Ops){
+                m_Ops->Destroy(m_Buf);
+                m_Ops = nullptr;
+            }
+        }
+
+    private:
+        template<typename F, typename G> void Assign(G &&fnOp, std::true_type)
+        {
+            static const HandlerOps stOps {&InlineOps<F>::Invoke, &InlineOps<F>::Move, &InlineOps<F>::Destroy};
+            new (m_Buf) F(std::forward<G>(fnOp));
+            m_Ops = &stOps;
+        }
+
+        template<typename F, typename G> void Assign(G &&fnOp, std::false_type)
+        {
+            static const HandlerOps stOps {&HeapOps<F>::Invoke, &HeapOps<F>::Move, &HeapOps<F>::Destroy};
+            *(F **)(m_Buf) = new F(std::forward<G>(fnOp));
+            m_Ops = &stOps;
+        }
+};
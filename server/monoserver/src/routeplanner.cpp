@@ -0,0 +1,493 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: routeplanner.cpp
+ *        Created: 10/19/2026 02:58:30
+ *  Last Modified: 10/19/2026 02:58:30
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+#include <algorithm>
+#include "dbcomid.hpp"
+#include "sysconst.hpp"
+#include "monoserver.hpp"
+#include "dbcomrecord.hpp"
+#include "threadpn.hpp"
+#include "routeplanner.hpp"
+#include "serverconfig.hpp"
+
+RoutePlanner::RoutePlanner()
+    : m_Lock()
+    , m_MapRouteList()
+    , m_BuildingList()
+{}
+
+std::string RoutePlanner::CacheFileName(uint32_t nMapID)
+{
+    // next to the map database
+    // Res/Map/MapBinDBN.ZIP -> Res/Map/MapBinDBN.ZIP.00000001.HPA
+    extern ServerConfig *g_ServerConfig;
+
+    char szSuffix[64];
+    std::snprintf(szSuffix, sizeof(szSuffix), ".%08" PRIX32 ".HPA", nMapID);
+    return g_ServerConfig->MapPath + szSuffix;
+}
+
+bool RoutePlanner::Register(uint32_t nMapID, std::shared_ptr<const GroundMask> pGround)
+{
+    if(false
+            || !nMapID
+            || !pGround
+            || !pGround->W()
+            || !pGround->H()){
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_Lock);
+        if(false
+                || m_MapRouteList.count(nMapID)
+                || m_BuildingList.count(nMapID)){
+            return true;
+        }
+        m_BuildingList.insert(nMapID);
+    }
+
+    extern ThreadPN *g_ThreadPN;
+    if(!g_ThreadPN->Add([this, nMapID, pGround](){ BuildMapRoute(nMapID, pGround); })){
+        {
+            std::lock_guard<std::mutex> stLockGuard(m_Lock);
+            m_BuildingList.erase(nMapID);
+        }
+
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "Failed to post route graph job: MapID = %" PRIu32, nMapID);
+        return false;
+    }
+    return true;
+}
+
+void RoutePlanner::BuildMapRoute(uint32_t nMapID, std::shared_ptr<const GroundMask> pGround)
+{
+    auto pRoute = std::make_shared<MapRoute>();
+    pRoute->MapID  = nMapID;
+    pRoute->Ground = pGround;
+
+    // 1. switch points of this map
+    //    any cell of the area switches the map, take the first valid one as the key cell
+    std::vector<PathFind::PathNode> stKeyV;
+    std::vector<SwitchRecord>       stSwitchV;
+
+    for(auto &rstLinkEntry: DBCOM_MAPRECORD(nMapID).LinkArray){
+        // W / H <= 0 ends the array, a bad entry only skips itself
+        if(rstLinkEntry.W <= 0 || rstLinkEntry.H <= 0){
+            break;
+        }
+
+        if(!pGround->ValidC(rstLinkEntry.X, rstLinkEntry.Y)){
+            continue;
+        }
+
+        bool bFound = false;
+        for(int nDX = 0; !bFound && nDX < rstLinkEntry.W; ++nDX){
+            for(int nDY = 0; !bFound && nDY < rstLinkEntry.H; ++nDY){
+                if(pGround->Valid(rstLinkEntry.X + nDX, rstLinkEntry.Y + nDY)){
+                    stKeyV.emplace_back(rstLinkEntry.X + nDX, rstLinkEntry.Y + nDY);
+                    stSwitchV.push_back({-1, DBCOM_MAPID(rstLinkEntry.EndName), rstLinkEntry.EndX, rstLinkEntry.EndY});
+                    bFound = true;
+                }
+            }
+        }
+    }
+
+    // 2. cells switch points of other maps lead to
+    //    DBCOM_MAPRECORD() returns the record of ID 0 for an invalid ID, use it as the end
+    auto nLinkCount = stKeyV.size();
+    for(uint32_t nID = 1; &DBCOM_MAPRECORD(nID) != &DBCOM_MAPRECORD((uint32_t)(0)); ++nID){
+        for(auto &rstLinkEntry: DBCOM_MAPRECORD(nID).LinkArray){
+            if(rstLinkEntry.W <= 0 || rstLinkEntry.H <= 0){
+                break;
+            }
+
+            if(true
+                    && DBCOM_MAPID(rstLinkEntry.EndName) == nMapID
+                    && pGround->Valid(rstLinkEntry.EndX, rstLinkEntry.EndY)
+                    && std::find(stKeyV.begin() + nLinkCount, stKeyV.end(), PathFind::PathNode(rstLinkEntry.EndX, rstLinkEntry.EndY)) == stKeyV.end()){
+                stKeyV.emplace_back(rstLinkEntry.EndX, rstLinkEntry.EndY);
+            }
+        }
+    }
+
+    // 3. load the graph from the cache, it's rebuilt if the map or the links changed
+    extern MonoServer *g_MonoServer;
+    auto szCacheFileName = CacheFileName(nMapID);
+
+    if(!pRoute->Graph.Load(szCacheFileName.c_str(), *pGround, SYS_ROUTECLUSTERSIZE, stKeyV)){
+        pRoute->Graph.Build(*pGround, SYS_ROUTECLUSTERSIZE, stKeyV);
+        if(!pRoute->Graph.Save(szCacheFileName.c_str())){
+            g_MonoServer->AddLog(LOGTYPE_WARNING, "Failed to save route cache: %s", szCacheFileName.c_str());
+        }
+    }
+
+    for(size_t nIndex = 0; nIndex < stKeyV.size(); ++nIndex){
+        auto nNode = pRoute->Graph.KeyNode((int)(nIndex));
+        if(nNode < 0){
+            continue;
+        }
+
+        if(nIndex < nLinkCount){
+            pRoute->SwitchV.push_back(stSwitchV[nIndex]);
+            pRoute->SwitchV.back().Node = nNode;
+        }else{
+            pRoute->ArriveList[stKeyV[nIndex].Y * pGround->W() + stKeyV[nIndex].X] = nNode;
+        }
+    }
+
+    // 4. label connected components, edges are symmetric since motions are
+    pRoute->ComponentV.assign(pRoute->Graph.NodeCount(), -1);
+    {
+        int nComponent = 0;
+        std::vector<int> stStackV;
+
+        for(int nNode = 0; nNode < pRoute->Graph.NodeCount(); ++nNode){
+            if(pRoute->ComponentV[nNode] >= 0){
+                continue;
+            }
+
+            pRoute->ComponentV[nNode] = nComponent;
+            stStackV.push_back(nNode);
+
+            while(!stStackV.empty()){
+                auto nCurrNode = stStackV.back();
+                stStackV.pop_back();
+
+                for(auto pEdge = pRoute->Graph.EdgeBegin(nCurrNode); pEdge != pRoute->Graph.EdgeEnd(nCurrNode); ++pEdge){
+                    if(pRoute->ComponentV[pEdge->To] < 0){
+                        pRoute->ComponentV[pEdge->To] = nComponent;
+                        stStackV.push_back(pEdge->To);
+                    }
+                }
+            }
+            nComponent++;
+        }
+    }
+
+    g_MonoServer->AddLog(LOGTYPE_INFO, "Route graph ready: MapID = %" PRIu32 ", Node = %d, Edge = %d", nMapID, pRoute->Graph.NodeCount(), pRoute->Graph.EdgeCount());
+
+    std::lock_guard<std::mutex> stLockGuard(m_Lock);
+    m_MapRouteList.emplace(nMapID, pRoute);
+    m_BuildingList.erase(nMapID);
+}
+
+
+bool RoutePlanner::Plan(uint32_t nMapID, int nX, int nY, uint32_t nEndMapID, int nEndX, int nEndY, std::vector<RouteNode> *pRouteV, int *pCost)
+{
+    // take a snapshot, maps registered during the search are not used
+    std::unordered_map<uint32_t, std::shared_ptr<const MapRoute>> stRouteList;
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_Lock);
+        stRouteList = m_MapRouteList;
+    }
+
+    auto pStartRoute = stRouteList.find(nMapID);
+    auto pEndRoute   = stRouteList.find(nEndMapID);
+
+    if(false
+            || pStartRoute == stRouteList.end()
+            || pEndRoute   == stRouteList.end()
+            || !pStartRoute->second->Ground->Valid(nX, nY)
+            || !pEndRoute  ->second->Ground->Valid(nEndX, nEndY)){
+        return false;
+    }
+
+    // search node is (MapID, node index) packed in uint64_t
+    // start and goal are not graph nodes, they use the two reserved indices
+    const uint32_t NODE_START = 0XFFFFFFFF;
+    const uint32_t NODE_GOAL  = 0XFFFFFFFE;
+
+    // no path to the goal, big enough but can't overflow when added
+    const int COST_INF = 0X3FFFFFFF;
+
+    auto fnKey = [](uint32_t nKeyMapID, uint32_t nNode) -> uint64_t
+    {
+        return ((uint64_t)(nKeyMapID) << 32) | nNode;
+    };
+
+    auto fnChebyshev = [](int nX0, int nY0, int nX1, int nY1) -> int
+    {
+        return std::max<int>(std::abs(nX0 - nX1), std::abs(nY0 - nY1));
+    };
+
+    struct MapState
+    {
+        std::shared_ptr<const MapRoute> Route;
+
+        // lower bound of the step count from each switch point to the goal
+        std::vector<int> SwitchH;
+
+        // allocated when the search first reaches the map
+        // H caches the heuristic of nodes, -1 if not computed yet
+        std::vector<int>      G;
+        std::vector<int>      H;
+        std::vector<uint64_t> Parent;
+    };
+
+    std::unordered_map<uint32_t, MapState> stStateList;
+    for(auto &rstRoute: stRouteList){
+        stStateList[rstRoute.first].Route = rstRoute.second;
+    }
+
+    // edges of the goal are symmetric, node -> goal costs the same as goal -> node
+    int nGoalComponent = -1;
+    std::unordered_map<int, int> stGoalEdgeList;
+    {
+        auto &rstEndRoute = *(pEndRoute->second);
+        std::vector<ClusterGraph::Edge> stEdgeV;
+
+        rstEndRoute.Graph.Connect(*(rstEndRoute.Ground), nEndX, nEndY, -1, -1, &stEdgeV);
+        for(auto &rstEdge: stEdgeV){
+            stGoalEdgeList[rstEdge.To] = rstEdge.Cost;
+            nGoalComponent = rstEndRoute.ComponentV[rstEdge.To];
+        }
+    }
+
+    // heuristic is the lower bound of (nX, nY) -> goal, either:
+    //   1. walk to the goal directly, on the goal map
+    //   2. walk to a switch point of the map, then the lower bound of the switch point
+    // it's admissible even a shortcut through other maps exists, and it's COST_INF if the goal can't be reached
+    auto fnGoalBound = [&](uint32_t nBoundMapID, int nComponent, int nBoundX, int nBoundY) -> int
+    {
+        if(true
+                && nBoundMapID == nEndMapID
+                && nComponent  >= 0
+                && nComponent  == nGoalComponent){
+            return fnChebyshev(nBoundX, nBoundY, nEndX, nEndY);
+        }
+        return COST_INF;
+    };
+
+    auto fnHeuristic = [&](const MapState &rstState, int nComponent, int nHX, int nHY) -> int
+    {
+        auto nH = fnGoalBound(rstState.Route->MapID, nComponent, nHX, nHY);
+        for(size_t nIndex = 0; nIndex < rstState.Route->SwitchV.size(); ++nIndex){
+            auto nSwitchNode = rstState.Route->SwitchV[nIndex].Node;
+            if(true
+                    && rstState.SwitchH[nIndex] < COST_INF
+                    && rstState.Route->ComponentV[nSwitchNode] == nComponent){
+                auto &rstNode = rstState.Route->Graph.GetNode(nSwitchNode);
+                nH = std::min<int>(nH, fnChebyshev(nHX, nHY, rstNode.X, rstNode.Y) + rstState.SwitchH[nIndex]);
+            }
+        }
+        return nH;
+    };
+
+    // the node a switch point leads to, nullptr if the map is not loaded
+    auto fnArrive = [&stStateList](const SwitchRecord &rstSwitch, int *pNode) -> MapState *
+    {
+        auto pState = stStateList.find(rstSwitch.EndMapID);
+        if(true
+                && pState != stStateList.end()
+                && pState->second.Route->Ground->ValidC(rstSwitch.EndX, rstSwitch.EndY)){
+            // EndX / EndY are from the map database, check them before making the cell index
+            // an out-of-range EndX can alias another cell
+            auto &rstArriveList = pState->second.Route->ArriveList;
+            auto  pArrive       = rstArriveList.find(rstSwitch.EndY * pState->second.Route->Ground->W() + rstSwitch.EndX);
+
+            if(pArrive != rstArriveList.end()){
+                *pNode = pArrive->second;
+                return &(pState->second);
+            }
+        }
+        return nullptr;
+    };
+
+    // bound of switch points by Bellman-Ford, only a few of them per map
+    for(auto &rstStatePair: stStateList){
+        auto &rstState = rstStatePair.second;
+        for(auto &rstSwitch: rstState.Route->SwitchV){
+            auto &rstNode = rstState.Route->Graph.GetNode(rstSwitch.Node);
+            rstState.SwitchH.push_back(fnGoalBound(rstState.Route->MapID, rstState.Route->ComponentV[rstSwitch.Node], rstNode.X, rstNode.Y));
+        }
+    }
+
+    for(bool bUpdated = true; bUpdated;){
+        bUpdated = false;
+        for(auto &rstStatePair: stStateList){
+            auto &rstState = rstStatePair.second;
+            for(size_t nIndex = 0; nIndex < rstState.Route->SwitchV.size(); ++nIndex){
+                int  nArriveNode = -1;
+                auto pArriveState = fnArrive(rstState.Route->SwitchV[nIndex], &nArriveNode);
+
+                if(pArriveState){
+                    auto nH = fnHeuristic(*pArriveState, pArriveState->Route->ComponentV[nArriveNode], rstState.Route->SwitchV[nIndex].EndX, rstState.Route->SwitchV[nIndex].EndY);
+                    if(nH < COST_INF && nH + 1 < rstState.SwitchH[nIndex]){
+                        rstState.SwitchH[nIndex] = nH + 1;
+                        bUpdated = true;
+                    }
+                }
+            }
+        }
+    }
+
+    struct OpenNode
+    {
+        int      F;
+        int      G;
+        uint64_t Key;
+    };
+
+    auto fnOpenLess = [](const OpenNode &rstLHS, const OpenNode &rstRHS) -> bool
+    {
+        // std::push_heap makes a max-heap
+        return (rstLHS.F != rstRHS.F) ? (rstLHS.F > rstRHS.F) : (rstLHS.G < rstRHS.G);
+    };
+
+    std::vector<OpenNode> stOpenV;
+    int      nGoalG      = -1;
+    uint64_t nGoalParent = 0;
+
+    auto fnRelaxGoal = [&](int nG, uint64_t nParent)
+    {
+        if(nGoalG < 0 || nG < nGoalG){
+            nGoalG      = nG;
+            nGoalParent = nParent;
+
+            stOpenV.push_back({nG, nG, fnKey(nEndMapID, NODE_GOAL)});
+            std::push_heap(stOpenV.begin(), stOpenV.end(), fnOpenLess);
+        }
+    };
+
+    auto fnRelax = [&](MapState *pState, int nNode, int nG, uint64_t nParent)
+    {
+        if(pState->G.empty()){
+            pState->G.assign(pState->Route->Graph.NodeCount(), -1);
+            pState->H.assign(pState->Route->Graph.NodeCount(), -1);
+            pState->Parent.assign(pState->Route->Graph.NodeCount(), 0);
+        }
+
+        if(pState->G[nNode] < 0 || nG < pState->G[nNode]){
+            if(pState->H[nNode] < 0){
+                auto &rstNode = pState->Route->Graph.GetNode(nNode);
+                pState->H[nNode] = fnHeuristic(*pState, pState->Route->ComponentV[nNode], rstNode.X, rstNode.Y);
+            }
+
+            // dead end, goal is not reachable from it
+            auto nH = pState->H[nNode];
+            if(nH >= COST_INF){
+                return;
+            }
+
+            pState->G[nNode]      = nG;
+            pState->Parent[nNode] = nParent;
+
+            stOpenV.push_back({nG + nH, nG, fnKey(pState->Route->MapID, nNode)});
+            std::push_heap(stOpenV.begin(), stOpenV.end(), fnOpenLess);
+        }
+    };
+
+    {
+        auto &rstStartRoute = *(pStartRoute->second);
+        std::vector<ClusterGraph::Edge> stEdgeV;
+
+        auto nDirect = rstStartRoute.Graph.Connect(*(rstStartRoute.Ground), nX, nY, (nMapID == nEndMapID) ? nEndX : -1, (nMapID == nEndMapID) ? nEndY : -1, &stEdgeV);
+        if(nDirect >= 0){
+            fnRelaxGoal(nDirect, fnKey(nMapID, NODE_START));
+        }
+
+        auto pStartState = &(stStateList[nMapID]);
+        for(auto &rstEdge: stEdgeV){
+            fnRelax(pStartState, rstEdge.To, rstEdge.Cost, fnKey(nMapID, NODE_START));
+        }
+    }
+
+    while(!stOpenV.empty()){
+        std::pop_heap(stOpenV.begin(), stOpenV.end(), fnOpenLess);
+        auto stCurr = stOpenV.back();
+        stOpenV.pop_back();
+
+        auto nCurrMapID = (uint32_t)(stCurr.Key >> 32);
+        auto nCurrNode  = (uint32_t)(stCurr.Key & 0XFFFFFFFF);
+
+        if(nCurrNode == NODE_GOAL){
+            break;
+        }
+
+        // outdated entry, the node has been reached by a cheaper path
+        auto &rstState = stStateList[nCurrMapID];
+        if(rstState.G[nCurrNode] < stCurr.G){
+            continue;
+        }
+
+        // won't find a cheaper goal
+        if(nGoalG >= 0 && stCurr.F >= nGoalG){
+            break;
+        }
+
+        auto &rstGraph = rstState.Route->Graph;
+        for(auto pEdge = rstGraph.EdgeBegin(nCurrNode); pEdge != rstGraph.EdgeEnd(nCurrNode); ++pEdge){
+            fnRelax(&rstState, pEdge->To, stCurr.G + pEdge->Cost, stCurr.Key);
+        }
+
+        if(nCurrMapID == nEndMapID){
+            auto pGoalEdge = stGoalEdgeList.find((int)(nCurrNode));
+            if(pGoalEdge != stGoalEdgeList.end()){
+                fnRelaxGoal(stCurr.G + pGoalEdge->second, stCurr.Key);
+            }
+        }
+
+        // map switch costs one step
+        for(auto &rstSwitch: rstState.Route->SwitchV){
+            if(rstSwitch.Node == (int)(nCurrNode)){
+                int nArriveNode = -1;
+                if(auto pArriveState = fnArrive(rstSwitch, &nArriveNode)){
+                    fnRelax(pArriveState, nArriveNode, stCurr.G + 1, stCurr.Key);
+                }
+            }
+        }
+    }
+
+    if(nGoalG < 0){
+        return false;
+    }
+
+    if(pRouteV){
+        pRouteV->clear();
+        pRouteV->push_back({nEndMapID, nEndX, nEndY});
+
+        for(auto nKey = nGoalParent; ;){
+            auto nKeyMapID = (uint32_t)(nKey >> 32);
+            auto nKeyNode  = (uint32_t)(nKey & 0XFFFFFFFF);
+
+            if(nKeyNode == NODE_START){
+                pRouteV->push_back({nMapID, nX, nY});
+                break;
+            }
+
+            auto &rstState = stStateList[nKeyMapID];
+            auto &rstNode  = rstState.Route->Graph.GetNode(nKeyNode);
+
+            pRouteV->push_back({nKeyMapID, rstNode.X, rstNode.Y});
+            nKey = rstState.Parent[nKeyNode];
+        }
+        std::reverse(pRouteV->begin(), pRouteV->end());
+    }
+
+    if(pCost){
+        *pCost = nGoalG;
+    }
+    return true;
+}
@@ -0,0 +1,116 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: routeplanner.hpp
+ *        Created: 10/19/2026 02:58:30
+ *  Last Modified: 10/19/2026 02:58:30
+ *
+ *    Description: long range route planning inside one map and across maps
+ *
+ *                 each map registers its GroundMask when it's loaded, the planner builds
+ *                 a ClusterGraph for it in ThreadPN, or loads it from the cache file next
+ *                 to the map database, key cells of the graph are the switch points in
+ *                 LinkArray of the map, and the cells other maps' switch points lead to
+ *
+ *                 building takes hundreds of ms for a big map, so Register() only posts
+ *                 the job and returns, the map joins route planning when the job is done
+ *
+ *                 maps are connected by their switch points, a route search runs on all
+ *                 registered graphs as one graph, maps not loaded yet are not used, the
+ *                 heuristic is the lower bound through switch points, so the search goes
+ *                 to the right switch point directly and fails fast if the goal is not
+ *                 reachable
+ *
+ *                 route is a list of waypoints, two consecutive waypoints on the same map
+ *                 are inside one cluster or neighbors across a cluster border, and on
+ *                 different maps means a map switch, a grid search between waypoints only
+ *                 covers a cluster then
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include "groundmask.hpp"
+#include "clustergraph.hpp"
+
+class RoutePlanner final
+{
+    public:
+        struct RouteNode
+        {
+            uint32_t MapID;
+            int      X;
+            int      Y;
+        };
+
+    private:
+        struct SwitchRecord
+        {
+            int Node;
+
+            uint32_t EndMapID;
+            int      EndX;
+            int      EndY;
+        };
+
+        struct MapRoute
+        {
+            uint32_t MapID;
+            std::shared_ptr<const GroundMask> Ground;
+
+            ClusterGraph Graph;
+
+            // connected component of each node
+            // nodes of different components can't reach each other inside this map
+            std::vector<int> ComponentV;
+
+            // switch points of this map, one node for each LinkEntry
+            std::vector<SwitchRecord> SwitchV;
+
+            // cell index (y * w + x) -> node, for cells other maps' switch points lead to
+            std::unordered_map<int, int> ArriveList;
+        };
+
+    private:
+        std::mutex m_Lock;
+        std::unordered_map<uint32_t, std::shared_ptr<const MapRoute>> m_MapRouteList;
+
+        // maps with a build job posted but not done yet
+        // prevents two jobs building one map and writing the same cache file
+        std::unordered_set<uint32_t> m_BuildingList;
+
+    public:
+        RoutePlanner();
+
+    public:
+        // post a job to build the graph of one map or load it from the cache
+        // called when the map is loaded, won't replace a registered or building one
+        bool Register(uint32_t, std::shared_ptr<const GroundMask>);
+
+    public:
+        // plan (nMapID, nX, nY) -> (nEndMapID, nEndX, nEndY)
+        // waypoints include start and goal, pCost gets the total step count, map switch counts 1
+        bool Plan(uint32_t, int, int, uint32_t, int, int, std::vector<RouteNode> *, int *);
+
+    private:
+        // build job running in ThreadPN
+        void BuildMapRoute(uint32_t, std::shared_ptr<const GroundMask>);
+
+    private:
+        static std::string CacheFileName(uint32_t);
+};
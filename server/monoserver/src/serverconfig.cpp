@@ -0,0 +1,189 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: serverconfig.cpp
+ *        Created: 10/18/2026 16:34:50
+ *  Last Modified: 10/18/2026 16:34:50
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstring>
+#include <fstream>
+#include "session.hpp"
+#include "serverconfig.hpp"
+#include "serverconfigurewindow.hpp"
+#include "databaseconfigurewindow.hpp"
+
+static std::string TrimString(const std::string &szString)
+{
+    auto nLoc0 = szString.find_first_not_of(" \t\r\n");
+    auto nLoc1 = szString.find_last_not_of (" \t\r\n");
+
+    if(nLoc0 == std::string::npos){
+        return "";
+    }
+    return szString.substr(nLoc0, nLoc1 - nLoc0 + 1);
+}
+
+std::string ServerConfig::Set(const std::string &szKey, const std::string &szValue)
+{
+    auto fnInt = [&szKey, &szValue](int *pValue) -> std::string
+    {
+        try{
+            size_t nParsed = 0;
+            *pValue = std::stoi(szValue, &nParsed);
+            if(nParsed == szValue.size()){
+                return "";
+            }
+        }catch(...){}
+        return "invalid integer for " + szKey + ": " + szValue;
+    };
+
+    auto fnDouble = [&szKey, &szValue](double *pValue) -> std::string
+    {
+        try{
+            size_t nParsed = 0;
+            auto fValue = std::stod(szValue, &nParsed);
+            if(nParsed == szValue.size() && fValue >= 0.00){
+                *pValue = fValue;
+                return "";
+            }
+        }catch(...){}
+        return "invalid rate for " + szKey + ": " + szValue;
+    };
+
+    if(szKey == "map-path"   ){ MapPath      = szValue; return ""; }
+    if(szKey == "script-path"){ ScriptPath   = szValue; return ""; }
+    if(szKey == "db-ip"      ){ DatabaseIP   = szValue; return ""; }
+    if(szKey == "db-name"    ){ DatabaseName = szValue; return ""; }
+    if(szKey == "db-user"    ){ UserName     = szValue; return ""; }
+    if(szKey == "db-password"){ Password     = szValue; return ""; }
+    if(szKey == "capture"    ){ CapturePath  = szValue; return ""; }
+
+    if(szKey == "sendq-policy"){
+        if((SendQPolicy = Session::SendQPolicy(szValue)) < 0){
+            return "invalid policy for " + szKey + ": " + szValue + ", expect coalesce, drop or disconnect";
+        }
+        return "";
+    }
+
+    if(szKey == "port"       ){ return fnInt(&Port           ); }
+    if(szKey == "net-thread" ){ return fnInt(&NetThreadCount ); }
+    if(szKey == "bundle-tick"){ return fnInt(&BundleTick     ); }
+    if(szKey == "db-port"    ){ return fnInt(&DatabasePort   ); }
+    if(szKey == "max-player" ){ return fnInt(&MaxPlayerCount ); }
+    if(szKey == "max-monster"){ return fnInt(&MaxMonsterCount); }
+
+    if(szKey == "sendq-high-msg" ){ return fnInt(&SendQHighMsg ); }
+    if(szKey == "sendq-high-byte"){ return fnInt(&SendQHighByte); }
+    if(szKey == "sendq-low-msg"  ){ return fnInt(&SendQLowMsg  ); }
+    if(szKey == "sendq-low-byte" ){ return fnInt(&SendQLowByte ); }
+
+    if(szKey == "exp-rate"   ){ return fnDouble(&ExpRate  ); }
+    if(szKey == "equip-rate" ){ return fnDouble(&EquipRate); }
+    if(szKey == "gold-rate"  ){ return fnDouble(&GoldRate ); }
+
+    return "unknown config key: " + szKey;
+}
+
+std::string ServerConfig::Load(const char *szFileName)
+{
+    std::ifstream stFile(szFileName ? szFileName : "");
+    if(!stFile){
+        return std::string("can't open config file: ") + (szFileName ? szFileName : "");
+    }
+
+    int nLine = 0;
+    std::string szLine;
+    while(std::getline(stFile, szLine)){
+        nLine++;
+        auto nCommentLoc = szLine.find('#');
+        if(nCommentLoc != std::string::npos){
+            szLine.resize(nCommentLoc);
+        }
+
+        szLine = TrimString(szLine);
+        if(szLine.empty()){
+            continue;
+        }
+
+        auto nLoc = szLine.find('=');
+        if(nLoc == std::string::npos){
+            return std::string(szFileName) + ":" + std::to_string(nLine) + ": expect \"key = value\"";
+        }
+
+        auto szError = Set(TrimString(szLine.substr(0, nLoc)), TrimString(szLine.substr(nLoc + 1)));
+        if(!szError.empty()){
+            return std::string(szFileName) + ":" + std::to_string(nLine) + ": " + szError;
+        }
+    }
+    return "";
+}
+
+std::string ServerConfig::ParseArgs(int nArgc, char *szArgv[])
+{
+    // load config file first
+    // then the rest options override it no matter where it appears
+    for(int nIndex = 1; nIndex < nArgc; ++nIndex){
+        if(std::strncmp(szArgv[nIndex], "--config=", 9) == 0){
+            auto szError = Load(szArgv[nIndex] + 9);
+            if(!szError.empty()){
+                return szError;
+            }
+        }
+    }
+
+    for(int nIndex = 1; nIndex < nArgc; ++nIndex){
+        std::string szArg = szArgv[nIndex];
+        if(szArg == "--headless"){
+            Headless = true;
+            continue;
+        }
+
+        if(szArg.compare(0, 9, "--config=") == 0){
+            continue;
+        }
+
+        auto nLoc = szArg.find('=');
+        if(szArg.compare(0, 2, "--") || nLoc == std::string::npos){
+            return "invalid option: " + szArg + ", expect --key=value";
+        }
+
+        auto szError = Set(szArg.substr(2, nLoc - 2), szArg.substr(nLoc + 1));
+        if(!szError.empty()){
+            return szError;
+        }
+    }
+    return "";
+}
+
+void ServerConfig::LoadGUI()
+{
+    extern ServerConfigureWindow *g_ServerConfigureWindow;
+    MapPath         = g_ServerConfigureWindow->GetMapPath();
+    ScriptPath      = g_ServerConfigureWindow->GetScriptPath();
+    Port            = g_ServerConfigureWindow->Port();
+    MaxPlayerCount  = g_ServerConfigureWindow->MaxPlayerCount();
+    MaxMonsterCount = g_ServerConfigureWindow->MaxMonsterCount();
+    ExpRate         = g_ServerConfigureWindow->ExpRate();
+    EquipRate       = g_ServerConfigureWindow->EquipRate();
+    GoldRate        = g_ServerConfigureWindow->GoldRate();
+
+    extern DatabaseConfigureWindow *g_DatabaseConfigureWindow;
+    DatabaseIP      = g_DatabaseConfigureWindow->DatabaseIP();
+    DatabasePort    = g_DatabaseConfigureWindow->DatabasePort();
+    DatabaseName    = g_DatabaseConfigureWindow->DatabaseName();
+    UserName        = g_DatabaseConfigureWindow->UserName();
+    Password        = g_DatabaseConfigureWindow->Password();
+}
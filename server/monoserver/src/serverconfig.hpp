@@ -0,0 +1,120 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: serverconfig.hpp
+ *        Created: 10/18/2026 16:20:12
+ *  Last Modified: 10/18/2026 16:20:12
+ *
+ *    Description: runtime configuration of monoserver
+ *
+ *                 with GUI it's copied from ServerConfigureWindow and
+ *                 DatabaseConfigureWindow when launching, in headless mode it comes
+ *                 from a config file and command line:
+ *
+ *                      monoserver --headless --config=monoserver.cfg --port=5000
+ *
+ *                 config file contains lines of "key = value", '#' starts comment,
+ *                 keys are the same as the command line options without "--":
+ *
+ *                      map-path, script-path, port, net-thread, bundle-tick, max-player, max-monster,
+ *                      exp-rate, equip-rate, gold-rate,
+ *                      db-ip, db-port, db-name, db-user, db-password, capture,
+ *                      sendq-high-msg, sendq-high-byte, sendq-low-msg, sendq-low-byte, sendq-policy
+ *
+ *                 command line options override the config file, they also work with GUI
+ *                 for options not in the configure windows, i.e. --net-thread, --bundle-tick
+ *
+ *                 --capture=file writes all messages of all sessions to the file, see
+ *                 netcapture.hpp, it's for replay and costs io, don't use it by default
+ *
+ *                 --sendq-policy=coalesce|drop|disconnect decides what to do with a session
+ *                 whose send queue is above the high watermark, see session.hpp
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <string>
+#include <cstdint>
+
+struct ServerConfig
+{
+    // no FLTK window created in headless mode
+    // logs only go to g3log and NotifyGUI() never wakes up FLTK
+    bool Headless;
+
+    std::string MapPath;
+    std::string ScriptPath;
+
+    int Port;
+    int NetThreadCount;     // io threads of NetDriver, 0 means count of CPU cores
+    int BundleTick;         // ms to gather small messages to one session as SM_BUNDLE, 0 disables it
+    int MaxPlayerCount;
+    int MaxMonsterCount;
+
+    double ExpRate;
+    double EquipRate;
+    double GoldRate;
+
+    std::string DatabaseIP;
+    int         DatabasePort;
+    std::string DatabaseName;
+    std::string UserName;
+    std::string Password;
+
+    // file to capture messages, empty disables it
+    std::string CapturePath;
+
+    // watermarks of the send queue of one session, 0 disables the limit
+    // policy takes effect above the high watermark and stops below the low one
+    int SendQHighMsg;
+    int SendQHighByte;
+    int SendQLowMsg;
+    int SendQLowByte;
+    int SendQPolicy;        // Session::SENDQ_XXXX
+
+    // defaults are the same as the configure windows
+    ServerConfig()
+        : Headless(false)
+        , MapPath("Res/Map/MapBinDBN.ZIP")
+        , ScriptPath("")
+        , Port(5000)
+        , NetThreadCount(0)
+        , BundleTick(20)
+        , MaxPlayerCount(5000)
+        , MaxMonsterCount(5000)
+        , ExpRate(1.5)
+        , EquipRate(1.5)
+        , GoldRate(1.5)
+        , DatabaseIP("127.0.0.1")
+        , DatabasePort(3306)
+        , DatabaseName("mir2x")
+        , UserName("root")
+        , Password("123456")
+        , CapturePath("")
+        , SendQHighMsg(4096)
+        , SendQHighByte(1024 * 1024)
+        , SendQLowMsg(1024)
+        , SendQLowByte(256 * 1024)
+        , SendQPolicy(0)
+    {}
+
+    // return empty string if succeeds, otherwise the error message
+    // error makes monoserver exit before creating anything
+    std::string Load(const char *);
+    std::string ParseArgs(int, char *[]);
+
+    // copy configuration from configure windows
+    // only valid when running with GUI
+    void LoadGUI();
+
+    std::string Set(const std::string &, const std::string &);
+};
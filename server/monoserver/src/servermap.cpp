@@ -20,6 +20,8 @@
 
 #include <sstream>
 #include <fstream>
+#include <cstdlib>
+#include <cinttypes>
 #include <algorithm>
 #include "player.hpp"
 #include "dbcomid.hpp"
@@ -34,218 +36,13 @@
 #include "monoserver.hpp"
 #include "dbcomrecord.hpp"
 #include "rotatecoord.hpp"
-#include "serverconfigurewindow.hpp"
+#include "routeplanner.hpp"
+#include "serverconfig.hpp"
 
 ServerMap::ServerMapLuaModule::ServerMapLuaModule()
     : BatchLuaModule()
 {}
 
-ServerMap::ServerPathFinder::ServerPathFinder(ServerMap *pMap, int nMaxStep, bool bCheckCO)
-    : AStarPathFinder(
-            // 1. step check function
-            //    validate pMap in constructor body
-            [pMap, nMaxStep](int nSrcX, int nSrcY, int nDstX, int nDstY) -> bool
-            {
-                // for server we always check ground
-                // there shouldn't be any motion through invalid grids while client could be
-
-                // skip some parameter checking
-                // but put the code here for completion
-
-                if(0){
-                    if(true
-                            && nMaxStep != 1
-                            && nMaxStep != 2
-                            && nMaxStep != 3){
-
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid MaxStep provided: %d, should be (1, 2, 3)", nMaxStep);
-                        return false;
-                    }
-
-                    int nDistance2 = LDistance2(nSrcX, nSrcY, nDstX, nDstY);
-                    if(true
-                            && nDistance2 != 1
-                            && nDistance2 != 2
-                            && nDistance2 != nMaxStep * nMaxStep
-                            && nDistance2 != nMaxStep * nMaxStep * 2){
-
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid step checked: (%d, %d) -> (%d, %d)", nSrcX, nSrcY, nDstX, nDstY);
-                        return false;
-                    }
-                }
-
-                // now we are sure:
-                // 1. nMaxStep is 1, 2, 3
-                // 2. distance of given src -> dst is 1, 2, 3
-
-                // no matter bCheckCO set or not
-                // we allow all grids if the ground is valid, ignoring the creature and lock
-
-                return pMap->CanMove(false, false, false, nSrcX, nSrcY, nDstX, nDstY);
-            },
-
-            // 2. move cost function, for directions as following
-            //    
-            //                  0
-            //               7     1
-            //             6    x    2
-            //               5     3
-            //                  4
-            //    we put directions 1, 3, 5, 7 as higher cost because for following grids:
-            //
-            //              A B C D E
-            //              F G H I J
-            //              K L M N O
-            //              P Q R S T
-            //
-            //    if we make all directions equally cost, then G->I: G -> C -> I
-            //    we want the result as G -> H -> I
-            //    
-            //    also read comments in mir2x/client/src/clientpathfinder.cpp
-            //    there are more additional issues and solutions for the cost assignment
-
-            [pMap, nMaxStep, bCheckCO](int nSrcX, int nSrcY, int nDstX, int nDstY) -> double
-            {
-                // checking parameter here
-                // skipped since it's done in AStarPathFinder
-
-                if(0){
-                    if(true
-                            && nMaxStep != 1
-                            && nMaxStep != 2
-                            && nMaxStep != 3){
-
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid MaxStep provided: %d, should be (1, 2, 3)", nMaxStep);
-                        return 10000.00;
-                    }
-
-                    int nDistance2 = LDistance2(nSrcX, nSrcY, nDstX, nDstY);
-                    if(true
-                            && nDistance2 != 1
-                            && nDistance2 != 2
-                            && nDistance2 != nMaxStep * nMaxStep
-                            && nDistance2 != nMaxStep * nMaxStep * 2){
-
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid step checked: (%d, %d) -> (%d, %d)", nSrcX, nSrcY, nDstX, nDstY);
-                        return 10000.00;
-                    }
-                }
-
-                double fExtraPen = 0.00;
-                switch(LDistance2(nSrcX, nSrcY, nDstX, nDstY)){
-                    case  1: fExtraPen = 0.00 + 0.01; break;
-                    case  2: fExtraPen = 0.10 + 0.01; break;
-                    case  4: fExtraPen = 0.00 + 0.02; break;
-                    case  8: fExtraPen = 0.10 + 0.02; break;
-                    case  9: fExtraPen = 0.00 + 0.03; break;
-                    case 18: fExtraPen = 0.10 + 0.03; break;
-                    default:
-                        {
-                            extern MonoServer *g_MonoServer;
-                            g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid step checked: (%d, %d) -> (%d, %d)", nSrcX, nSrcY, nDstX, nDstY);
-                            return 10000.00;
-                        }
-                }
-
-                // for server any hops provided to this function has passed the ground checking
-                // this is done in the above lambda through ServerMap::CanMove(false, srcLoc, dstLoc)
-
-                // here we need to assign different value for provided hops
-                // since the hops provided to this function doesn't do creature check
-                // we assign higher cost if bCheckCO is set and ServerMap::CanMove(true, true, srcLoc, dstLoc) fails
-
-                if(bCheckCO){
-
-                    // if there is no co on the way we take it
-                    // however if there is, we can still take it but with very high cost
-                    // for example: now A is targeting at C
-                    //    +---+---+---+---+---+
-                    //    |   |   |   | C |   |
-                    //    +---+---+---+---+---+
-                    //    |   |   | B |   |   |
-                    //    +---+---+---+---+---+
-                    //    |   | A |   |   |   |
-                    //    +---+---+---+---+---+
-                    //    |   |   |   |   |   |
-                    //    +---+---+---+---+---+
-                    // then we try to find a path Loc(A) -> Loc(C)
-                    // if 1. we always allow if CanMove(0, 0, LOC) is true : co ignored
-                    //    2. we always allow if CanMove(1, 1, LOC) is true : co affects
-                    //
-                    // for solution-1: A will stop at current position since A try to move to LOC(B) but it's occupied
-                    //     solution-2: LOC(A) -> LOC(C) is invalid since start and end point has been taken by themselves
-                    //
-                    // so my solution: 1. always allow if CanMove(0, 0, LOC) is true
-                    //                 2. if currently there is CO in the cell we give a higher cost
-                    // then A will bypass B to go to C and stop as close as possible to C
-                    //
-                    // this also saves if C is surrendered by a lot of CO's
-                    // in which case solution-1 will make A stop at a far distance between C
-                    //               solution-2 will make C un-reachable
-                    //            my solution   will make A stop at a place as close as possible to C
-
-                    // new issue found for current cost strategy
-                    //
-                    //             O O D O O
-                    //             O O X O O
-                    //             B O A O C
-                    //             O O O O O
-                    //
-                    // if now we want A->D with step size = 2, we can do (A->B->D) or (A->C->D), the
-                    // step (A->B) and (A->C) are expensive since A is occupied by the path-finding
-                    // requestor. But now if between A and C the grid is occupied by another CO, our
-                    // current algorithm can't prefer (A->B->D) instead of (A->C->D) !!!
-
-                    // reason is we only get yes/no anwser for (A->B) and (A->D) but no detailed
-                    // information to estimate a cost. solution: assign cost inside map rather than
-                    // in the path finder, which need me to introduce new function
-                    //
-                    //   doulbe ServerMap::MoveCost(bool, bool, bool, int, int, int, int)
-                    //   
-                    // this function gives cost of single hop
-                    // in future's version fExtraPen should be penalty for turn
-                    // and this function can enable we put dynamical cost for some busy hops
-
-                    return pMap->MoveCost(true, true, true, nSrcX, nSrcY, nDstX, nDstY) + fExtraPen;
-                }else{
-                    // won't check creature
-                    // then all walk-able step get cost 1.0 + delta
-                    return 1.00 + fExtraPen;
-                }
-            },
-
-            // max step length for each hop, valid step size : 1, 2, 3
-            // check value in AStarPathFinder::AStarPathFinder() and ServerPathFinder::ServerPathFinder()
-            nMaxStep
-      )
-{
-    // we do it here to complete the logic
-    // this also will be checked in AStarPathFinder::AStarPathFinder()
-    switch(nMaxStep){
-        case 1:
-        case 2:
-        case 3:
-            {
-                break;
-            }
-        default:
-            {
-                extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid MaxStep provided: %d, should be (1, 2, 3)", nMaxStep);
-                break;
-            }
-    }
-
-    if(!pMap){
-        extern MonoServer *g_MonoServer;
-        g_MonoServer->AddLog(LOGTYPE_FATAL, "Invalid argument: ServerMap = %p, CheckCreature = %d", pMap, (int)(bCheckCO));
-    }
-}
-
 ServerMap::ServerMap(ServiceCore *pServiceCore, uint32_t nMapID)
     : ActiveObject()
     , m_ID(nMapID)
@@ -265,6 +62,20 @@ ServerMap::ServerMap(ServiceCore *pServiceCore, uint32_t nMapID)
     , m_Metronome(nullptr)
     , m_ServiceCore(pServiceCore)
     , m_CellRecordV2D()
+    , m_GridUIDV()
+    , m_GridUIDOffset()
+    , m_AOIW(0)
+    , m_AOIH(0)
+    , m_AOIBucketV()
+    , m_AOIUIDV()
+    , m_TickCount(0)
+    , m_TickVisit(0)
+    , m_TickCostUS(0)
+    , m_TickMaxCostUS(0)
+    , m_GroundMask(std::make_shared<GroundMask>(m_Mir2xMapData))
+    , m_COCountV()
+    , m_LockV()
+    , m_FlowFieldList()
     , m_LuaModule(nullptr)
 {
     m_CellRecordV2D.clear();
@@ -273,6 +84,17 @@ ServerMap::ServerMap(ServiceCore *pServiceCore, uint32_t nMapID)
         for(auto &rstStateLine: m_CellRecordV2D){
             rstStateLine.resize(H());
         }
+
+        m_AOIW = (W() + SYS_AOIBUCKETSIZE - 1) / SYS_AOIBUCKETSIZE;
+        m_AOIH = (H() + SYS_AOIBUCKETSIZE - 1) / SYS_AOIBUCKETSIZE;
+        m_AOIBucketV.resize(m_AOIW * m_AOIH);
+
+        m_COCountV.resize(W() * H(), 0);
+        m_LockV   .resize(W() * H(), 0);
+
+        // only posts a job to ThreadPN, never blocks the ServiceCore
+        extern RoutePlanner *g_RoutePlanner;
+        g_RoutePlanner->Register(nMapID, m_GroundMask);
     }else{
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "Load map failed: ID = %d, Name = %s", nMapID, DBCOM_MAPRECORD(nMapID).Name);
@@ -309,6 +131,7 @@ ServerMap::ServerMap(ServiceCore *pServiceCore, uint32_t nMapID)
     };
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<ServerMap>();
 }
 
 void ServerMap::OperateAM(const MessagePack &rstMPK, const Theron::Address &rstFromAddr)
@@ -415,36 +238,44 @@ void ServerMap::OperateAM(const MessagePack &rstMPK, const Theron::Address &rstF
 
 bool ServerMap::GroundValid(int nX, int nY) const
 {
-    return true
-        && m_Mir2xMapData.Valid()
-        && m_Mir2xMapData.ValidC(nX, nY)
-        && m_Mir2xMapData.Cell(nX, nY).CanThrough();
+    return m_GroundMask->Valid(nX, nY);
 }
 
-bool ServerMap::CanMove(bool bCheckCO, bool bCheckLock, int nX, int nY)
+bool ServerMap::CellHasCO(int nX, int nY) const
 {
-    if(GroundValid(nX, nY)){
-        if(bCheckCO){
-            for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                extern MonoServer *g_MonoServer;
-                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                    if(stUIDRecord.ClassFrom<CharObject>()){
-                        return false;
-                    }
-                }
-            }
-        }
+    // most cells are empty, then it's only one byte load
+    // for cells with CO's still check the UID record since the CO can be dead but not removed yet
+    if(!m_COCountV[CellIndex(nX, nY)]){
+        return false;
+    }
 
-        if(bCheckLock){
-            if(m_CellRecordV2D[nX][nY].Lock){
-                return false;
+    for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
+        extern MonoServer *g_MonoServer;
+        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
+            if(stUIDRecord.ClassFrom<CharObject>()){
+                return true;
             }
         }
-        return true;
     }
     return false;
 }
 
+bool ServerMap::CanMove(bool bCheckCO, bool bCheckLock, int nX, int nY)
+{
+    if(!GroundValid(nX, nY)){
+        return false;
+    }
+
+    if(bCheckCO && CellHasCO(nX, nY)){
+        return false;
+    }
+
+    if(bCheckLock && CellLocked(nX, nY)){
+        return false;
+    }
+    return true;
+}
+
 bool ServerMap::CanMove(bool bCheckCO, bool bCheckLock, bool bSkipMiddleLock, int nX0, int nY0, int nX1, int nY1)
 {
     int nMaxIndex = -1;
@@ -478,10 +309,22 @@ bool ServerMap::CanMove(bool bCheckCO, bool bCheckLock, bool bSkipMiddleLock, in
             }
     }
 
+    // check the ground of the whole line first
+    // horizontal and vertical lines take one word per 64 cells
+    if(!m_GroundMask->LineValid(nX0, nY0, nX1, nY1)){
+        return false;
+    }
+
+    if(!(bCheckCO || bCheckLock)){
+        return true;
+    }
+
     int nDX = (nX1 > nX0) - (nX1 < nX0);
     int nDY = (nY1 > nY0) - (nY1 < nY0);
 
     for(int nIndex = 0; nIndex <= nMaxIndex; ++nIndex){
+        auto nCurrX = nX0 + nDX * nIndex;
+        auto nCurrY = nY0 + nDY * nIndex;
 
         bool bCheckCurrLock = false;
         if(bCheckLock){
@@ -496,7 +339,9 @@ bool ServerMap::CanMove(bool bCheckCO, bool bCheckLock, bool bSkipMiddleLock, in
             }
         }
 
-        if(!CanMove(bCheckCO, bCheckCurrLock, nX0 + nDX * nIndex, nY0 + nDY * nIndex)){
+        if(false
+                || (bCheckCO       && CellHasCO (nCurrX, nCurrY))
+                || (bCheckCurrLock && CellLocked(nCurrX, nCurrY))){
             return false;
         }
     }
@@ -536,6 +381,12 @@ double ServerMap::MoveCost(bool bCheckCO, bool bCheckLock, bool bSkipMiddleLock,
             }
     }
 
+    // validate the whole line first
+    // for server's side any motion needs to be inside valid grids
+    if(!m_GroundMask->LineValid(nX0, nY0, nX1, nY1)){
+        return 10000.00;
+    }
+
     int nDX = (nX1 > nX0) - (nX1 < nX0);
     int nDY = (nY1 > nY0) - (nY1 < nY0);
 
@@ -544,34 +395,25 @@ double ServerMap::MoveCost(bool bCheckCO, bool bCheckLock, bool bSkipMiddleLock,
         auto nCurrX = nX0 + nDX * nIndex;
         auto nCurrY = nY0 + nDY * nIndex;
 
-        // validate current grid first
-        // for server's side any motion needs to be inside valid grids
-
-        if(GroundValid(nCurrX, nCurrY)){
-
-            // OK current grid is capable to contain co's
-            // check the co's and locks
-
-            bool bCheckCurrLock = false;
-            if(bCheckLock){
-                if(bSkipMiddleLock){
-                    if((nIndex != 0) && (nIndex != nMaxIndex)){
-                        bCheckCurrLock = false;
-                    }else{
-                        bCheckCurrLock = true;
-                    }
+        bool bCheckCurrLock = false;
+        if(bCheckLock){
+            if(bSkipMiddleLock){
+                if((nIndex != 0) && (nIndex != nMaxIndex)){
+                    bCheckCurrLock = false;
                 }else{
                     bCheckCurrLock = true;
                 }
+            }else{
+                bCheckCurrLock = true;
             }
+        }
 
-            fMoveCost += (CanMove(bCheckCO, bCheckCurrLock, nCurrX, nCurrY) ? 1.00 : 100.00);
-
+        if(false
+                || (bCheckCO       && CellHasCO (nCurrX, nCurrY))
+                || (bCheckCurrLock && CellLocked(nCurrX, nCurrY))){
+            fMoveCost += 100.00;
         }else{
-
-            // current grid is not valid
-            // ignore alculated cost and immediately return infinite
-            return 10000.00;
+            fMoveCost += 1.00;
         }
     }
 
@@ -689,6 +531,29 @@ void ServerMap::AddGridUID(uint32_t nUID, int nX, int nY)
         auto &rstUIDList = m_CellRecordV2D[nX][nY].UIDList;
         if(std::find(rstUIDList.begin(), rstUIDList.end(), nUID) == rstUIDList.end()){
             rstUIDList.push_back(nUID);
+            AddAOIRecord(nUID, nX, nY);
+
+            // update the dense index
+            // we only count it when it's newly added into one cell
+            auto pOffset = m_GridUIDOffset.find(nUID);
+            if(pOffset == m_GridUIDOffset.end()){
+                extern MonoServer *g_MonoServer;
+                auto bCO = g_MonoServer->GetUIDRecord(nUID).ClassFrom<CharObject>();
+
+                pOffset = m_GridUIDOffset.emplace(nUID, m_GridUIDV.size()).first;
+                m_GridUIDV.emplace_back(nUID, nX, nY, bCO);
+            }else{
+                auto &rstRecord = m_GridUIDV[pOffset->second];
+                rstRecord.X = nX;
+                rstRecord.Y = nY;
+                rstRecord.Count++;
+            }
+
+            // sticky once saturated, CellHasCO() then always scans the cell
+            auto &rstCOCount = m_COCountV[CellIndex(nX, nY)];
+            if(m_GridUIDV[pOffset->second].CO && rstCOCount < 255){
+                rstCOCount++;
+            }
         }
     }
 }
@@ -705,10 +570,272 @@ void ServerMap::RemoveGridUID(uint32_t nUID, int nX, int nY)
         if(pUIDRecord != rstUIDList.end()){
             std::swap(rstUIDList.back(), *pUIDRecord);
             rstUIDList.pop_back();
+            RemoveAOIRecord(nUID, nX, nY);
+
+            auto pOffset = m_GridUIDOffset.find(nUID);
+            if(pOffset == m_GridUIDOffset.end()){
+                extern MonoServer *g_MonoServer;
+                g_MonoServer->AddLog(LOGTYPE_WARNING, "UID is in grid but not indexed: UID = %" PRIu32, nUID);
+                return;
+            }
+
+            auto nOffset = pOffset->second;
+            auto &rstCOCount = m_COCountV[CellIndex(nX, nY)];
+            if(m_GridUIDV[nOffset].CO && rstCOCount > 0 && rstCOCount < 255){
+                rstCOCount--;
+            }
+
+            if(--m_GridUIDV[nOffset].Count > 0){
+                return;
+            }
+
+            // no cell contains this UID now
+            // swap it with the last one and update the moved record's offset
+            m_GridUIDOffset.erase(pOffset);
+            if(nOffset + 1 != m_GridUIDV.size()){
+                m_GridUIDV[nOffset] = m_GridUIDV.back();
+                m_GridUIDOffset[m_GridUIDV[nOffset].UID] = nOffset;
+            }
+            m_GridUIDV.pop_back();
+        }
+    }
+}
+
+void ServerMap::PurgeGridUID(uint32_t nUID)
+{
+    auto pOffset = m_GridUIDOffset.find(nUID);
+    if(pOffset == m_GridUIDOffset.end()){
+        return;
+    }
+
+    // most likely the UID only stays in the last cell it's added to
+    // then we don't need to scan the whole grid
+    auto nLastX = m_GridUIDV[pOffset->second].X;
+    auto nLastY = m_GridUIDV[pOffset->second].Y;
+    RemoveGridUID(nUID, nLastX, nLastY);
+
+    if(m_GridUIDOffset.find(nUID) == m_GridUIDOffset.end()){
+        return;
+    }
+
+    // every (UID, cell) pair has an AOI record, so the rest cells can be found from buckets
+    // check the bucket of the last cell and its neighbours first, an object taking more than
+    // one cell is always close to where it was added last time
+    auto fnPurgeBucket = [this, nUID](int nBX, int nBY) -> bool
+    {
+        if(true
+                && nBX >= 0 && nBX < m_AOIW
+                && nBY >= 0 && nBY < m_AOIH){
+
+            // collect first, RemoveGridUID() reorders the bucket
+            std::vector<std::pair<int, int>> stCellV;
+            for(auto &rstRecord: m_AOIBucketV[nBX * m_AOIH + nBY]){
+                if(rstRecord.UID == nUID){
+                    stCellV.emplace_back(rstRecord.X, rstRecord.Y);
+                }
+            }
+
+            for(auto &rstCell: stCellV){
+                RemoveGridUID(nUID, rstCell.first, rstCell.second);
+            }
+        }
+        return m_GridUIDOffset.find(nUID) == m_GridUIDOffset.end();
+    };
+
+    auto nLastBX = nLastX / SYS_AOIBUCKETSIZE;
+    auto nLastBY = nLastY / SYS_AOIBUCKETSIZE;
+    for(int nDX = -1; nDX <= 1; ++nDX){
+        for(int nDY = -1; nDY <= 1; ++nDY){
+            if(fnPurgeBucket(nLastBX + nDX, nLastBY + nDY)){
+                return;
+            }
+        }
+    }
+
+    // still indexed, shouldn't happen but don't leave a dead UID in the map
+    // walk the AOI records of the rest buckets, still cheaper than scanning all cells
+    for(int nBX = 0; nBX < m_AOIW; ++nBX){
+        for(int nBY = 0; nBY < m_AOIH; ++nBY){
+            if(true
+                    && std::abs(nBX - nLastBX) <= 1
+                    && std::abs(nBY - nLastBY) <= 1){
+                continue;
+            }
+
+            if(fnPurgeBucket(nBX, nBY)){
+                return;
+            }
+        }
+    }
+}
+
+bool ServerMap::FlowPathFind(const AMPathFind &rstAMPF, const Theron::Address &rstFromAddr, uint32_t nRespondID)
+{
+    // only for monsters chasing a CO step by step
+    // other requests need the max step or the cost of CO's in the search
+    if(false
+            || !rstAMPF.TargetUID
+            || !rstAMPF.CheckCO
+            || rstAMPF.MaxStep != 1){
+        return false;
+    }
+
+    // location of the target is what the map has
+    // it can be newer than (EndX, EndY) in the request
+    auto pOffset = m_GridUIDOffset.find(rstAMPF.TargetUID);
+    if(pOffset == m_GridUIDOffset.end()){
+        m_FlowFieldList.erase(rstAMPF.TargetUID);
+        return false;
+    }
+
+    auto nTargetX = m_GridUIDV[pOffset->second].X;
+    auto nTargetY = m_GridUIDV[pOffset->second].Y;
+
+    if(false
+            || std::abs(rstAMPF.X - nTargetX) > SYS_FLOWFIELDRANGE
+            || std::abs(rstAMPF.Y - nTargetY) > SYS_FLOWFIELDRANGE){
+        return false;
+    }
+
+    extern MonoServer  *g_MonoServer;
+    extern PathService *g_PathService;
+
+    auto &rstRecord = m_FlowFieldList[rstAMPF.TargetUID];
+    rstRecord.Time = g_MonoServer->GetTimeTick();
+
+    // rebuild only when the target moves
+    // all requestors in between share the same field
+    auto &rstField = rstRecord.Field;
+    if(false
+            || !rstField.Valid()
+            || rstField.X() != nTargetX
+            || rstField.Y() != nTargetY){
+        g_PathService->AddFlowBuild();
+        if(!rstField.Build(*m_GroundMask, nTargetX, nTargetY, SYS_FLOWFIELDRANGE)){
+            return false;
+        }
+    }
+
+    // CO's and locks are checked when walking down the field
+    // if all closer neighbors are blocked, let the search find a way around
+    auto fnBlocked = [this](int nX, int nY) -> bool
+    {
+        return CellHasCO(nX, nY) || CellLocked(nX, nY);
+    };
+
+    AMPathFindOK stAMPFOK;
+    stAMPFOK.UID   = rstAMPF.UID;
+    stAMPFOK.MapID = ID();
+
+    constexpr auto nPathCount = std::extent<decltype(stAMPFOK.Point)>::value;
+    for(int nIndex = 0; nIndex < (int)(nPathCount); ++nIndex){
+        stAMPFOK.Point[nIndex].X = -1;
+        stAMPFOK.Point[nIndex].Y = -1;
+    }
+
+    // same as the search result, start is the first node and the target is excluded
+    int nCurrN = 0;
+    int nCurrX = rstAMPF.X;
+    int nCurrY = rstAMPF.Y;
+
+    stAMPFOK.Point[nCurrN].X = nCurrX;
+    stAMPFOK.Point[nCurrN].Y = nCurrY;
+    nCurrN++;
+
+    while(nCurrN < (int)(nPathCount)){
+        int nNextX = -1;
+        int nNextY = -1;
+
+        if(false
+                || !rstField.NextStep(nCurrX, nCurrY, &nNextX, &nNextY, fnBlocked)
+                || !rstField.Distance(nNextX, nNextY)){
+            break;
         }
+
+        stAMPFOK.Point[nCurrN].X = nNextX;
+        stAMPFOK.Point[nCurrN].Y = nNextY;
+        nCurrN++;
+
+        nCurrX = nNextX;
+        nCurrY = nNextY;
+    }
+
+    // requestor always moves to the second node
+    if(nCurrN < 2){
+        return false;
+    }
+
+    g_PathService->AddFlowHit();
+    m_ActorPod->Forward({MPK_PATHFINDOK, stAMPFOK}, rstFromAddr, nRespondID);
+    return true;
+}
+
+void ServerMap::AddAOIRecord(uint32_t nUID, int nX, int nY)
+{
+    if(ValidC(nX, nY)){
+        auto nBX = nX / SYS_AOIBUCKETSIZE;
+        auto nBY = nY / SYS_AOIBUCKETSIZE;
+        m_AOIBucketV[nBX * m_AOIH + nBY].emplace_back(nUID, nX, nY);
     }
 }
 
+void ServerMap::RemoveAOIRecord(uint32_t nUID, int nX, int nY)
+{
+    if(ValidC(nX, nY)){
+        auto nBX = nX / SYS_AOIBUCKETSIZE;
+        auto nBY = nY / SYS_AOIBUCKETSIZE;
+
+        auto &rstBucket = m_AOIBucketV[nBX * m_AOIH + nBY];
+        for(size_t nIndex = 0; nIndex < rstBucket.size(); ++nIndex){
+            if(true
+                    && rstBucket[nIndex].UID == nUID
+                    && rstBucket[nIndex].X   == nX
+                    && rstBucket[nIndex].Y   == nY){
+                std::swap(rstBucket[nIndex], rstBucket.back());
+                rstBucket.pop_back();
+                return;
+            }
+        }
+
+        extern MonoServer *g_MonoServer;
+        g_MonoServer->AddLog(LOGTYPE_WARNING, "UID is in grid but not in AOI bucket: UID = %" PRIu32 ", X = %d, Y = %d", nUID, nX, nY);
+    }
+}
+
+const std::vector<uint32_t> &ServerMap::GetAOIUIDList(int nCX0, int nCY0, int nCR)
+{
+    m_AOIUIDV.clear();
+    if(true
+            && nCR > 0
+            && m_AOIW > 0
+            && m_AOIH > 0){
+
+        // bounding box in buckets, clipped by the map
+        // use same region as DoCircle(): LDistance2() <= (nCR - 1)^2
+
+        auto nBX0 = (std::max<int>)(0, (nCX0 - nCR + 1) / SYS_AOIBUCKETSIZE);
+        auto nBY0 = (std::max<int>)(0, (nCY0 - nCR + 1) / SYS_AOIBUCKETSIZE);
+        auto nBX1 = (std::min<int>)(m_AOIW - 1, (nCX0 + nCR - 1) / SYS_AOIBUCKETSIZE);
+        auto nBY1 = (std::min<int>)(m_AOIH - 1, (nCY0 + nCR - 1) / SYS_AOIBUCKETSIZE);
+
+        for(int nBX = nBX0; nBX <= nBX1; ++nBX){
+            for(int nBY = nBY0; nBY <= nBY1; ++nBY){
+                for(auto &rstRecord: m_AOIBucketV[nBX * m_AOIH + nBY]){
+                    if(LDistance2(rstRecord.X, rstRecord.Y, nCX0, nCY0) <= (nCR - 1) * (nCR - 1)){
+                        m_AOIUIDV.push_back(rstRecord.UID);
+                    }
+                }
+            }
+        }
+
+        // one UID can stay in more than one cell
+        // make the list unique then each one only get notified once
+        std::sort(m_AOIUIDV.begin(), m_AOIUIDV.end());
+        m_AOIUIDV.erase(std::unique(m_AOIUIDV.begin(), m_AOIUIDV.end()), m_AOIUIDV.end());
+    }
+    return m_AOIUIDV;
+}
+
 void ServerMap::DoCircle(int nCX0, int nCY0, int nCR, const std::function<bool(int, int)> &fnOP)
 {
     int nW = 2 * nCR - 1;
@@ -917,22 +1044,16 @@ bool ServerMap::AddGroundItem(int nX, int nY, const CommonItem &rstItem)
                 }
             }
 
-            auto fnNotifyDropItem = [this, stAMSDI](int nX, int nY) -> bool
-            {
-                if(true || ValidC(nX, nY)){
-                    for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                        extern MonoServer *g_MonoServer;
-                        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                            if(stUIDRecord.ClassFrom<Player>()){
-                                m_ActorPod->Forward({MPK_SHOWDROPITEM, stAMSDI}, stUIDRecord.Address);
-                            }
-                        }
+            std::vector<Theron::Address> stAddressV;
+            for(auto nUID: GetAOIUIDList(nX, nY, 10)){
+                extern MonoServer *g_MonoServer;
+                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
+                    if(stUIDRecord.ClassFrom<Player>()){
+                        stAddressV.push_back(stUIDRecord.Address);
                     }
                 }
-                return false;
-            };
-
-            DoCircle(nX, nY, 10, fnNotifyDropItem);
+            }
+            m_ActorPod->Forward({MPK_SHOWDROPITEM, stAMSDI}, stAddressV);
             return true;
         }
     }
@@ -942,18 +1063,14 @@ bool ServerMap::AddGroundItem(int nX, int nY, const CommonItem &rstItem)
 int ServerMap::GetMonsterCount(uint32_t nMonsterID)
 {
     int nCount = 0;
-    for(auto &rstLine: m_CellRecordV2D){
-        for(auto &rstRecord: rstLine){
-            for(auto nUID: rstRecord.UIDList){
-                extern MonoServer *g_MonoServer;
-                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                    if(stUIDRecord.ClassFrom<Monster>()){
-                        if(nMonsterID){
-                            nCount += ((stUIDRecord.Desp.Monster.MonsterID == nMonsterID) ? 1 : 0);
-                        }else{
-                            nCount++;
-                        }
-                    }
+    for(auto &rstRecord: m_GridUIDV){
+        extern MonoServer *g_MonoServer;
+        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(rstRecord.UID)){
+            if(stUIDRecord.ClassFrom<Monster>()){
+                if(nMonsterID){
+                    nCount += ((stUIDRecord.Desp.Monster.MonsterID == nMonsterID) ? 1 : 0);
+                }else{
+                    nCount++;
                 }
             }
         }
@@ -1010,8 +1127,8 @@ bool ServerMap::RegisterLuaExport(ServerMap::ServerMapLuaModule *pModule)
 
         // load lua script to the module
         {
-            extern ServerConfigureWindow *g_ServerConfigureWindow;
-            auto szScriptPath = g_ServerConfigureWindow->GetScriptPath();
+            extern ServerConfig *g_ServerConfig;
+            auto szScriptPath = g_ServerConfig->ScriptPath;
             if(szScriptPath.empty()){
                 szScriptPath  = "/home/anhong/mir2x/server/monoserver/script/map";
             }
@@ -1037,6 +1154,18 @@ bool ServerMap::RegisterLuaExport(ServerMap::ServerMapLuaModule *pModule)
             return std::string(DBCOM_MAPRECORD(ID()).Name);
         });
 
+        pModule->GetLuaState().set_function("getTickCost", [this]() -> int
+        {
+            // average metronome cost in microseconds
+            auto nTickCount = TickCount();
+            return nTickCount ? (int)(TickCostUS() / nTickCount) : 0;
+        });
+
+        pModule->GetLuaState().set_function("getTickMaxCost", [this]() -> int
+        {
+            return (int)(TickMaxCostUS());
+        });
+
         pModule->GetLuaState().set_function("getMonsterCount", [this](sol::variadic_args stVariadicArgs) -> int
         {
             std::vector<sol::object> stArgList(stVariadicArgs.begin(), stVariadicArgs.end());
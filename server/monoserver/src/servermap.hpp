@@ -20,15 +20,21 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <cstdint>
+#include <unordered_map>
 
 #include "sysconst.hpp"
 #include "querytype.hpp"
 #include "uidrecord.hpp"
 #include "metronome.hpp"
+#include "flowfield.hpp"
+#include "groundmask.hpp"
+#include "pathservice.hpp"
 #include "commonitem.hpp"
-#include "pathfinder.hpp"
+#include "gridpathfinder.hpp"
 #include "mir2xmapdata.hpp"
 #include "activeobject.hpp"
 #include "batchluamodule.hpp"
@@ -48,24 +54,9 @@ class ServerMap: public ActiveObject
                ~ServerMapLuaModule() = default;
         };
 
-    private:
-        // bind to servermap
-        // only for server map internal usage
-        class ServerPathFinder: public AStarPathFinder
-        {
-            public:
-                ServerPathFinder(ServerMap*, int, bool);
-               ~ServerPathFinder() = default;
-        };
-
-        // the server pathfinder will call CanMove() etc
-        // which I refuse to set as public since it's dynamically updated
-        friend class ServerPathFinder;
-
     private:
         struct CellRecord
         {
-            bool Lock;
             std::vector<uint32_t> UIDList;
 
             uint32_t UID;
@@ -82,8 +73,7 @@ class ServerMap: public ActiveObject
             std::array<CommonItem, SYS_MAXDROPITEM> GroundItemList;
 
             CellRecord()
-                : Lock(false)
-                , UIDList()
+                : UIDList()
                 , UID(0)
                 , MapID(0)
                 , SwitchX(-1)
@@ -93,6 +83,48 @@ class ServerMap: public ActiveObject
             {}
         };
 
+    private:
+        // dense index of all UIDs recorded in m_CellRecordV2D
+        // maintained by AddGridUID() / RemoveGridUID(), then metronome and other map-wide loops
+        // only visit live objects rather than scanning all cells
+        //
+        // an UID can be recorded in more than one cell, use Count as reference
+        // (X, Y) is the last cell it's added to, used to purge it without a full-grid scan
+        // CO is checked once when it's first added, then RemoveGridUID() knows which layer to update
+        struct GridUIDRecord
+        {
+            uint32_t UID;
+            int      X;
+            int      Y;
+            int      Count;
+            bool     CO;
+
+            GridUIDRecord(uint32_t nUID, int nX, int nY, bool bCO)
+                : UID(nUID)
+                , X(nX)
+                , Y(nY)
+                , Count(1)
+                , CO(bCO)
+            {}
+        };
+
+    private:
+        // area-of-interest record, one per (UID, cell) in m_CellRecordV2D
+        // map is split into SYS_AOIBUCKETSIZE x SYS_AOIBUCKETSIZE buckets and each bucket keeps
+        // all UIDs inside it, then broadcast only checks a few buckets instead of walking cells
+        struct AOIRecord
+        {
+            uint32_t UID;
+            int      X;
+            int      Y;
+
+            AOIRecord(uint32_t nUID, int nX, int nY)
+                : UID(nUID)
+                , X(nX)
+                , Y(nY)
+            {}
+        };
+
     private:
         template<typename T> using Vec2D = std::vector<std::vector<T>>;
 
@@ -107,6 +139,56 @@ class ServerMap: public ActiveObject
     private:
         Vec2D<CellRecord> m_CellRecordV2D;
 
+    private:
+        std::vector<GridUIDRecord>           m_GridUIDV;
+        std::unordered_map<uint32_t, size_t> m_GridUIDOffset;
+
+    private:
+        int m_AOIW;
+        int m_AOIH;
+
+        std::vector<std::vector<AOIRecord>> m_AOIBucketV;
+
+        // recipient buffer reused by GetAOIUIDList()
+        // map actor is single-threaded so it's safe to share
+        std::vector<uint32_t> m_AOIUIDV;
+
+    private:
+        // metronome cost statistics
+        // only updated in the map actor thread, atomic since can be read by other threads
+        std::atomic<uint64_t> m_TickCount;
+        std::atomic<uint64_t> m_TickVisit;
+        std::atomic<uint64_t> m_TickCostUS;
+        std::atomic<uint64_t> m_TickMaxCostUS;
+
+    private:
+        // packed bitmap of the ground, built in the constructor and never changed
+        // shared with PathService as the snapshot of the ground
+        std::shared_ptr<const GroundMask> m_GroundMask;
+
+    private:
+        // per-cell layers indexed by (y * w + x), then CanMove() doesn't touch m_CellRecordV2D
+        // m_COCountV counts CO's in the cell, maintained by AddGridUID() / RemoveGridUID()
+        // m_LockV is set when a cell is reserved for a pending move / map switch
+        std::vector<uint8_t> m_COCountV;
+        std::vector<uint8_t> m_LockV;
+
+    private:
+        // flow fields keyed by target UID, shared by all requestors chasing the target
+        // Time is the last tick it's used, dropped in metronome if idle for SYS_FLOWFIELDLIFE
+        struct FlowFieldRecord
+        {
+            FlowField Field;
+            uint32_t  Time;
+
+            FlowFieldRecord()
+                : Field()
+                , Time(0)
+            {}
+        };
+
+        std::unordered_map<uint32_t, FlowFieldRecord> m_FlowFieldList;
+
     private:
         ServerMapLuaModule *m_LuaModule;
 
@@ -129,6 +211,46 @@ class ServerMap: public ActiveObject
     public:
         bool GroundValid(int, int) const;
 
+    public:
+        uint64_t TickCount() const
+        {
+            return m_TickCount.load();
+        }
+
+        uint64_t TickVisit() const
+        {
+            return m_TickVisit.load();
+        }
+
+        uint64_t TickCostUS() const
+        {
+            return m_TickCostUS.load();
+        }
+
+        uint64_t TickMaxCostUS() const
+        {
+            return m_TickMaxCostUS.load();
+        }
+
+    private:
+        int CellIndex(int nX, int nY) const
+        {
+            return nY * W() + nX;
+        }
+
+        bool CellLocked(int nX, int nY) const
+        {
+            return m_LockV[CellIndex(nX, nY)];
+        }
+
+        void SetCellLock(int nX, int nY, bool bLock)
+        {
+            m_LockV[CellIndex(nX, nY)] = (bLock ? 1 : 0);
+        }
+
+    private:
+        bool CellHasCO(int, int) const;
+
     protected:
         bool CanMove(bool, bool, int, int);
         bool CanMove(bool, bool, bool, int, int, int, int);
@@ -153,6 +275,24 @@ class ServerMap: public ActiveObject
         void AddGridUID(uint32_t, int, int);
         void RemoveGridUID(uint32_t, int, int);
 
+    private:
+        // remove all records of one UID from the grid and the dense index
+        void PurgeGridUID(uint32_t);
+
+    private:
+        // answer MPK_PATHFIND by the flow field of the target
+        // return false if it can't help, then a search is needed
+        bool FlowPathFind(const AMPathFind &, const Theron::Address &, uint32_t);
+
+    private:
+        void AddAOIRecord(uint32_t, int, int);
+        void RemoveAOIRecord(uint32_t, int, int);
+
+    private:
+        // get UIDs in a circle, same region as DoCircle() but only checks AOI buckets
+        // result is unique and valid till next call
+        const std::vector<uint32_t> &GetAOIUIDList(int, int, int);
+
     private:
         bool Empty();
         bool RandomLocation(int *, int *);
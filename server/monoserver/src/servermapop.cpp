@@ -17,6 +17,8 @@
  *
  * =====================================================================================
  */
+#include <chrono>
+#include <algorithm>
 #include <cinttypes>
 #include "dbcomid.hpp"
 #include "player.hpp"
@@ -42,36 +44,64 @@ void ServerMap::On_MPK_METRONOME(const MessagePack &, const Theron::Address &)
         m_LuaModule->LoopOne();
     }
 
-    for(auto &rstRecordLine: m_CellRecordV2D){
-        for(auto &rstRecordV: rstRecordLine){
+    // only visit UIDs in the dense index
+    // cost of each tick scales with live objects on the map instead of map area
+    auto stTickStart = std::chrono::steady_clock::now();
 
-            // this part check all recorded UID and remove those invalid ones
-            // do it periodically in 1s, then for all rest logic we can skip the clean job
+    size_t nVisit = 0;
+    for(size_t nIndex = 0; nIndex < m_GridUIDV.size();){
 
-            for(size_t nIndex = 0; nIndex < rstRecordV.UIDList.size();){
-                extern MonoServer *g_MonoServer;
-                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(rstRecordV.UIDList[nIndex])){
-                    if(stUIDRecord.ClassFrom<ActiveObject>()){
-                        if(m_ActorPod->Forward(MPK_METRONOME, stUIDRecord.Address)){
-                            nIndex++;
-                            continue;
-                        }else{
-                            std::swap(rstRecordV.UIDList[nIndex], rstRecordV.UIDList.back());
-                            rstRecordV.UIDList.pop_back();
-                            continue;
-                        }
-                    }else{
-                        nIndex++;
-                        continue;
-                    }
+        // this part check all recorded UID and remove those invalid ones
+        // do it periodically in 1s, then for all rest logic we can skip the clean job
+
+        nVisit++;
+        auto nUID = m_GridUIDV[nIndex].UID;
+
+        extern MonoServer *g_MonoServer;
+        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
+            if(stUIDRecord.ClassFrom<ActiveObject>()){
+                if(m_ActorPod->Forward(MPK_METRONOME, stUIDRecord.Address)){
+                    nIndex++;
+                    continue;
                 }else{
-                    std::swap(rstRecordV.UIDList[nIndex], rstRecordV.UIDList.back());
-                    rstRecordV.UIDList.pop_back();
+                    // purge swaps the last record into nIndex
+                    // so don't increase the index
+                    PurgeGridUID(nUID);
                     continue;
                 }
+            }else{
+                nIndex++;
+                continue;
+            }
+        }else{
+            PurgeGridUID(nUID);
+            continue;
+        }
+    }
+
+    auto nCostUS = (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - stTickStart).count());
+
+    // drop flow fields nobody chases anymore
+    {
+        extern MonoServer *g_MonoServer;
+        auto nCurrTick = g_MonoServer->GetTimeTick();
+
+        for(auto pRecord = m_FlowFieldList.begin(); pRecord != m_FlowFieldList.end();){
+            if(nCurrTick - pRecord->second.Time > (uint32_t)(SYS_FLOWFIELDLIFE)){
+                pRecord = m_FlowFieldList.erase(pRecord);
+            }else{
+                ++pRecord;
             }
         }
     }
+
+    m_TickCount++;
+    m_TickVisit  += nVisit;
+    m_TickCostUS += nCostUS;
+
+    if(nCostUS > m_TickMaxCostUS.load()){
+        m_TickMaxCostUS.store(nCostUS);
+    }
 }
 
 void ServerMap::On_MPK_BADACTORPOD(const MessagePack &, const Theron::Address &)
@@ -84,23 +114,18 @@ void ServerMap::On_MPK_ACTION(const MessagePack &rstMPK, const Theron::Address &
     std::memcpy(&stAMA, rstMPK.Data(), sizeof(stAMA));
 
     if(ValidC(stAMA.X, stAMA.Y)){
-        auto fnNotifyAction = [this, stAMA](int nX, int nY) -> bool
-        {
-            if(true || ValidC(nX, nY)){
-                for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                    if(nUID != stAMA.UID){
-                        extern MonoServer *g_MonoServer;
-                        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                            if(stUIDRecord.ClassFrom<CharObject>()){
-                                m_ActorPod->Forward({MPK_ACTION, stAMA}, stUIDRecord.Address);
-                            }
-                        }
+        std::vector<Theron::Address> stAddressV;
+        for(auto nUID: GetAOIUIDList(stAMA.X, stAMA.Y, 10)){
+            if(nUID != stAMA.UID){
+                extern MonoServer *g_MonoServer;
+                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
+                    if(stUIDRecord.ClassFrom<CharObject>()){
+                        stAddressV.push_back(stUIDRecord.Address);
                     }
                 }
             }
-            return false;
-        };
-        DoCircle(stAMA.X, stAMA.Y, 10, fnNotifyAction);
+        }
+        m_ActorPod->Forward({MPK_ACTION, stAMA}, stAddressV);
     }
 }
 
@@ -349,27 +374,15 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
 
                     // 1. leave last cell
                     {
-                        bool bFind = false;
                         auto &rstRecordV = m_CellRecordV2D[stAMTM.X][stAMTM.Y].UIDList;
-
-                        for(auto &nUID: rstRecordV){
-                            if(nUID == stAMTM.UID){
-                                // 1. mark as find
-                                bFind = true;
-
-                                // 2. remove from the object list
-                                std::swap(nUID, rstRecordV.back());
-                                rstRecordV.pop_back();
-
-                                break;
-                            }
-                        }
-
-                        if(!bFind){
+                        if(std::find(rstRecordV.begin(), rstRecordV.end(), stAMTM.UID) == rstRecordV.end()){
                             extern MonoServer *g_MonoServer;
                             g_MonoServer->AddLog(LOGTYPE_FATAL, "CO is not at current location: UID = %" PRIu32 , stAMTM.UID);
                             g_MonoServer->Restart();
                         }
+
+                        // use RemoveGridUID() to keep the dense index consistent
+                        RemoveGridUID(stAMTM.UID, stAMTM.X, stAMTM.Y);
                     }
 
                     // 2. push it to the new cell
@@ -445,7 +458,7 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
                     break;
                 }
         }
-        m_CellRecordV2D[nMostX][nMostY].Lock = false;
+        SetCellLock(nMostX, nMostY, false);
     };
 
     AMMoveOK stAMMOK;
@@ -456,7 +469,7 @@ void ServerMap::On_MPK_TRYMOVE(const MessagePack &rstMPK, const Theron::Address
     stAMMOK.EndX  = nMostX;
     stAMMOK.EndY  = nMostY;
 
-    m_CellRecordV2D[nMostX][nMostY].Lock = true;
+    SetCellLock(nMostX, nMostY, true);
     m_ActorPod->Forward({MPK_MOVEOK, stAMMOK}, rstFromAddr, rstMPK.ID(), fnOnR);
 }
 
@@ -490,19 +503,12 @@ void ServerMap::On_MPK_PULLCOINFO(const MessagePack &rstMPK, const Theron::Addre
     AMPullCOInfo stAMPCOI;
     std::memcpy(&stAMPCOI, rstMPK.Data(), sizeof(stAMPCOI));
 
-    auto fnPullCOInfo = [this, stAMPCOI](int nX, int nY) -> bool
-    {
-        if(true || ValidC(nX, nY)){
-            for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                extern MonoServer *g_MonoServer;
-                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                    m_ActorPod->Forward({MPK_PULLCOINFO, stAMPCOI}, stUIDRecord.Address);
-                }
-            }
+    for(auto &rstRecord: m_GridUIDV){
+        extern MonoServer *g_MonoServer;
+        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(rstRecord.UID)){
+            m_ActorPod->Forward({MPK_PULLCOINFO, stAMPCOI}, stUIDRecord.Address);
         }
-        return false;
-    };
-    DoSquare(0, 0, W(), H(), fnPullCOInfo);
+    }
 }
 
 void ServerMap::On_MPK_TRYMAPSWITCH(const MessagePack &rstMPK, const Theron::Address &rstFromAddr)
@@ -535,9 +541,9 @@ void ServerMap::On_MPK_TRYMAPSWITCH(const MessagePack &rstMPK, const Theron::Add
                         break;
                     }
             }
-            m_CellRecordV2D[stAMMSOK.X][stAMMSOK.Y].Lock = false;
+            SetCellLock(stAMMSOK.X, stAMMSOK.Y, false);
         };
-        m_CellRecordV2D[nX][nY].Lock = true;
+        SetCellLock(nX, nY, true);
         m_ActorPod->Forward({MPK_MAPSWITCHOK, stAMMSOK}, rstFromAddr, rstMPK.ID(), fnOnResp);
     }else{
         extern MonoServer *g_MonoServer;
@@ -551,23 +557,6 @@ void ServerMap::On_MPK_PATHFIND(const MessagePack &rstMPK, const Theron::Address
     AMPathFind stAMPF;
     std::memcpy(&stAMPF, rstMPK.Data(), sizeof(stAMPF));
 
-    int nX0 = stAMPF.X;
-    int nY0 = stAMPF.Y;
-    int nX1 = stAMPF.EndX;
-    int nY1 = stAMPF.EndY;
-
-    AMPathFindOK stAMPFOK;
-    stAMPFOK.UID   = stAMPF.UID;
-    stAMPFOK.MapID = ID();
-
-    // we fill all slots with -1 for initialization
-    // won't keep a record of ``how many path nodes are valid"
-    constexpr auto nPathCount = std::extent<decltype(stAMPFOK.Point)>::value;
-    for(int nIndex = 0; nIndex < (int)(nPathCount); ++nIndex){
-        stAMPFOK.Point[nIndex].X = -1;
-        stAMPFOK.Point[nIndex].Y = -1;
-    }
-
     // should make sure MaxStep is OK
     if(true
             && stAMPF.MaxStep != 1
@@ -576,55 +565,72 @@ void ServerMap::On_MPK_PATHFIND(const MessagePack &rstMPK, const Theron::Address
 
         // we get a dangerous parameter from actormessage
         // correct here and put an warning in the log system
-        stAMPF.MaxStep = 1;
-
         extern MonoServer *g_MonoServer;
         g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid MaxStep: %d, should be (1, 2, 3)", stAMPF.MaxStep);
+
+        stAMPF.MaxStep = 1;
     }
 
-    ServerPathFinder stPathFinder(this, stAMPF.MaxStep, stAMPF.CheckCO);
-    if(true
-            && stPathFinder.Search(nX0, nY0, nX1, nY1)
-            && stPathFinder.GetSolutionStart()){
-
-        int nCurrN = 0;
-        int nCurrX = nX0;
-        int nCurrY = nY0;
-
-        while(auto pNode1 = stPathFinder.GetSolutionNext()){
-            if(nCurrN >= (int)(nPathCount)){ break; }
-            int nEndX = pNode1->X();
-            int nEndY = pNode1->Y();
-            switch(LDistance2(nCurrX, nCurrY, nEndX, nEndY)){
-                case 1:
-                case 2:
-                    {
-                        stAMPFOK.Point[nCurrN].X = nCurrX;
-                        stAMPFOK.Point[nCurrN].Y = nCurrY;
+    if(false
+            || !m_GroundMask
+            || !ValidC(stAMPF.X, stAMPF.Y)
+            || !ValidC(stAMPF.EndX, stAMPF.EndY)){
+        m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
+        return;
+    }
 
-                        nCurrN++;
+    // requestors chasing the same target read the shared flow field
+    // next step is found in O(1) without a search
+    if(FlowPathFind(stAMPF, rstFromAddr, rstMPK.ID())){
+        return;
+    }
 
-                        nCurrX = nEndX;
-                        nCurrY = nEndY;
-                        break;
-                    }
-                case 0:
-                default:
-                    {
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid path node");
-                        break;
-                    }
+    // search runs in ThreadPN, map actor only takes the snapshot
+    // reply MPK_PATHFINDOK / MPK_ERROR is sent by PathService with the respond ID
+    PathService::PathQuery stQuery;
+    stQuery.UID       = stAMPF.UID;
+    stQuery.MapID     = ID();
+    stQuery.X         = stAMPF.X;
+    stQuery.Y         = stAMPF.Y;
+    stQuery.EndX      = stAMPF.EndX;
+    stQuery.EndY      = stAMPF.EndY;
+    stQuery.MaxStep   = stAMPF.MaxStep;
+    stQuery.CheckCO   = stAMPF.CheckCO;
+    stQuery.MaxExpand = (stAMPF.MaxExpand > 0) ? (size_t)(stAMPF.MaxExpand) : (size_t)(SYS_MAXPATHEXPAND);
+    stQuery.Ground    = m_GroundMask;
+    stQuery.BoxX      = 0;
+    stQuery.BoxY      = 0;
+    stQuery.BoxW      = 0;
+    stQuery.BoxH      = 0;
+    stQuery.From      = rstFromAddr;
+    stQuery.RespondID = rstMPK.ID();
+
+    // cells with CO or lock are still allowed but with very high cost
+    // then the requestor bypasses other CO's and stops as close as possible to the target
+    if(stAMPF.CheckCO){
+        stQuery.BoxX = std::max<int>(0, stAMPF.X - SYS_PATHCORANGE);
+        stQuery.BoxY = std::max<int>(0, stAMPF.Y - SYS_PATHCORANGE);
+        stQuery.BoxW = std::min<int>(W(), stAMPF.X + SYS_PATHCORANGE + 1) - stQuery.BoxX;
+        stQuery.BoxH = std::min<int>(H(), stAMPF.Y + SYS_PATHCORANGE + 1) - stQuery.BoxY;
+
+        stQuery.BoxState.resize(stQuery.BoxW * stQuery.BoxH, 0);
+        for(int nY = stQuery.BoxY; nY < stQuery.BoxY + stQuery.BoxH; ++nY){
+            for(int nX = stQuery.BoxX; nX < stQuery.BoxX + stQuery.BoxW; ++nX){
+                uint8_t nState = 0;
+                if(CellHasCO(nX, nY)){
+                    nState |= GridPathFinder::CELL_CO;
+                }
+
+                if(CellLocked(nX, nY)){
+                    nState |= GridPathFinder::CELL_LOCK;
+                }
+                stQuery.BoxState[(nY - stQuery.BoxY) * stQuery.BoxW + (nX - stQuery.BoxX)] = nState;
             }
         }
-
-        // we filled all possible nodes to the message
-        m_ActorPod->Forward({MPK_PATHFINDOK, stAMPFOK}, rstFromAddr, rstMPK.ID());
-        return;
     }
 
-    // failed to find a path
-    m_ActorPod->Forward(MPK_ERROR, rstFromAddr, rstMPK.ID());
+    extern PathService *g_PathService;
+    g_PathService->Submit(std::move(stQuery));
 }
 
 void ServerMap::On_MPK_UPDATEHP(const MessagePack &rstMPK, const Theron::Address &)
@@ -633,23 +639,18 @@ void ServerMap::On_MPK_UPDATEHP(const MessagePack &rstMPK, const Theron::Address
     std::memcpy(&stAMUHP, rstMPK.Data(), sizeof(stAMUHP));
 
     if(ValidC(stAMUHP.X, stAMUHP.Y)){
-        auto fnUpdateHP = [this, stAMUHP](int nX, int nY) -> bool
-        {
-            if(true || ValidC(nX, nY)){
-                for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                    if(nUID != stAMUHP.UID){
-                        extern MonoServer *g_MonoServer;
-                        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                            if(stUIDRecord.ClassFrom<CharObject>()){
-                                m_ActorPod->Forward({MPK_UPDATEHP, stAMUHP}, stUIDRecord.Address);
-                            }
-                        }
+        std::vector<Theron::Address> stAddressV;
+        for(auto nUID: GetAOIUIDList(stAMUHP.X, stAMUHP.Y, 20)){
+            if(nUID != stAMUHP.UID){
+                extern MonoServer *g_MonoServer;
+                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
+                    if(stUIDRecord.ClassFrom<CharObject>()){
+                        stAddressV.push_back(stUIDRecord.Address);
                     }
                 }
             }
-            return false;
-        };
-        DoCircle(stAMUHP.X, stAMUHP.Y, 20, fnUpdateHP);
+        }
+        m_ActorPod->Forward({MPK_UPDATEHP, stAMUHP}, stAddressV);
     }
 }
 
@@ -659,23 +660,18 @@ void ServerMap::On_MPK_DEADFADEOUT(const MessagePack &rstMPK, const Theron::Addr
     std::memcpy(&stAMDFO, rstMPK.Data(), sizeof(stAMDFO));
 
     if(ValidC(stAMDFO.X, stAMDFO.Y)){
-        auto fnDeadFadeOut = [this, stAMDFO](int nX, int nY) -> bool
-        {
-            if(true || ValidC(nX, nY)){
-                for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                    if(nUID != stAMDFO.UID){
-                        extern MonoServer *g_MonoServer;
-                        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                            if(stUIDRecord.ClassFrom<Player>()){
-                                m_ActorPod->Forward({MPK_DEADFADEOUT, stAMDFO}, stUIDRecord.Address);
-                            }
-                        }
+        std::vector<Theron::Address> stAddressV;
+        for(auto nUID: GetAOIUIDList(stAMDFO.X, stAMDFO.Y, 20)){
+            if(nUID != stAMDFO.UID){
+                extern MonoServer *g_MonoServer;
+                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
+                    if(stUIDRecord.ClassFrom<Player>()){
+                        stAddressV.push_back(stUIDRecord.Address);
                     }
                 }
             }
-            return false;
-        };
-        DoCircle(stAMDFO.X, stAMDFO.Y, 20, fnDeadFadeOut);
+        }
+        m_ActorPod->Forward({MPK_DEADFADEOUT, stAMDFO}, stAddressV);
     }
 }
 
@@ -689,24 +685,17 @@ void ServerMap::On_MPK_QUERYCORECORD(const MessagePack &rstMPK, const Theron::Ad
             && stAMQCOR.MapID == ID()
             && ValidC(stAMQCOR.X, stAMQCOR.Y)){
 
-        auto fnQueryCORecord = [this, stAMQCOR](int nX, int nY) -> bool
-        {
-            if(true || ValidC(nX, nY)){
-                for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                    if(nUID == stAMQCOR.UID){
-                        extern MonoServer *g_MonoServer;
-                        if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                            if(stUIDRecord.ClassFrom<CharObject>()){
-                                m_ActorPod->Forward({MPK_PULLCOINFO, stAMQCOR.SessionID}, stUIDRecord.Address);
-                                return true;
-                            }
-                        }
+        for(auto nUID: GetAOIUIDList(stAMQCOR.X, stAMQCOR.Y, 10)){
+            if(nUID == stAMQCOR.UID){
+                extern MonoServer *g_MonoServer;
+                if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
+                    if(stUIDRecord.ClassFrom<CharObject>()){
+                        m_ActorPod->Forward({MPK_PULLCOINFO, stAMQCOR.SessionID}, stUIDRecord.Address);
+                        return;
                     }
                 }
             }
-            return false;
-        };
-        DoCircle(stAMQCOR.X, stAMQCOR.Y, 10, fnQueryCORecord);
+        }
     }
 }
 
@@ -719,18 +708,14 @@ void ServerMap::On_MPK_QUERYCOCOUNT(const MessagePack &rstMPK, const Theron::Add
             || (stAMQCOC.MapID == 0)
             || (stAMQCOC.MapID == ID())){
         int nCOCount = 0;
-        for(size_t nX = 0; nX < m_CellRecordV2D.size(); ++nX){
-            for(size_t nY = 0; nY < m_CellRecordV2D[0].size(); ++nY){
-                std::for_each(m_CellRecordV2D[nX][nY].UIDList.begin(), m_CellRecordV2D[nX][nY].UIDList.end(), [stAMQCOC, &nCOCount](uint32_t nUID){
-                    extern MonoServer *g_MonoServer;
-                    if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                        if(stUIDRecord.ClassFrom<CharObject>()){
-                            if(stAMQCOC.Check.NPC    ){ nCOCount++; return; }
-                            if(stAMQCOC.Check.Player ){ nCOCount++; return; }
-                            if(stAMQCOC.Check.Monster){ nCOCount++; return; }
-                        }
-                    }
-                });
+        for(auto &rstRecord: m_GridUIDV){
+            extern MonoServer *g_MonoServer;
+            if(auto stUIDRecord = g_MonoServer->GetUIDRecord(rstRecord.UID)){
+                if(stUIDRecord.ClassFrom<CharObject>()){
+                    if(stAMQCOC.Check.NPC    ){ nCOCount++; continue; }
+                    if(stAMQCOC.Check.Player ){ nCOCount++; continue; }
+                    if(stAMQCOC.Check.Monster){ nCOCount++; continue; }
+                }
             }
         }
 
@@ -845,22 +830,16 @@ void ServerMap::On_MPK_OFFLINE(const MessagePack &rstMPK, const Theron::Address
     AMOffline stAMO;
     std::memcpy(&stAMO, rstMPK.Data(), sizeof(stAMO));
        
-    auto fnNotifyOffline = [stAMO, this](int nX, int nY) -> bool
-    {
-        if(true || ValidC(nX, nY)){
-            for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                if(nUID != stAMO.UID){
-                    extern MonoServer *g_MonoServer;
-                    if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                        m_ActorPod->Forward({MPK_OFFLINE, stAMO}, stUIDRecord.Address);
-                    }
-                }
+    std::vector<Theron::Address> stAddressV;
+    for(auto nUID: GetAOIUIDList(stAMO.X, stAMO.Y, 10)){
+        if(nUID != stAMO.UID){
+            extern MonoServer *g_MonoServer;
+            if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
+                stAddressV.push_back(stUIDRecord.Address);
             }
         }
-        return false;
-    };
-
-    DoCircle(stAMO.X, stAMO.Y, 10, fnNotifyOffline);
+    }
+    m_ActorPod->Forward({MPK_OFFLINE, stAMO}, stAddressV);
 }
 
 void ServerMap::On_MPK_PICKUP(const MessagePack &rstMPK, const Theron::Address &)
@@ -874,26 +853,22 @@ void ServerMap::On_MPK_PICKUP(const MessagePack &rstMPK, const Theron::Address &
             auto nIndex = FindGroundItem(stAMPU.X, stAMPU.Y, stAMPU.ItemID);
             if(nIndex >= 0){
                 RemoveGroundItem(stAMPU.X, stAMPU.Y, stAMPU.ItemID);
-                auto fnRemoveGroundItem = [this, stAMPU](int nX, int nY) -> bool
-                {
-                    if(true || ValidC(nX, nY)){
-                        for(auto nUID: m_CellRecordV2D[nX][nY].UIDList){
-                            extern MonoServer *g_MonoServer;
-                            if(auto stUIDRecord = g_MonoServer->GetUIDRecord(nUID)){
-                                if(stUIDRecord.ClassFrom<Player>()){
-                                    AMRemoveGroundItem stAMRGI;
-                                    stAMRGI.X      = nX;
-                                    stAMRGI.Y      = nY;
-                                    stAMRGI.DBID   = stAMPU.DBID;
-                                    stAMRGI.ItemID = stAMPU.ItemID;
-                                    m_ActorPod->Forward({MPK_REMOVEGROUNDITEM, stAMRGI}, stUIDRecord.Address);
-                                }
-                            }
+                AMRemoveGroundItem stAMRGI;
+                stAMRGI.X      = stAMPU.X;
+                stAMRGI.Y      = stAMPU.Y;
+                stAMRGI.DBID   = stAMPU.DBID;
+                stAMRGI.ItemID = stAMPU.ItemID;
+
+                std::vector<Theron::Address> stAddressV;
+                for(auto nUID: GetAOIUIDList(stAMPU.X, stAMPU.Y, 10)){
+                    extern MonoServer *g_MonoServer;
+                    if(auto stPlayerRecord = g_MonoServer->GetUIDRecord(nUID)){
+                        if(stPlayerRecord.ClassFrom<Player>()){
+                            stAddressV.push_back(stPlayerRecord.Address);
                         }
                     }
-                    return false;
-                };
-                DoCircle(stAMPU.X, stAMPU.Y, 10, fnRemoveGroundItem);
+                }
+                m_ActorPod->Forward({MPK_REMOVEGROUNDITEM, stAMRGI}, stAddressV);
 
                 // notify the picker
                 AMPickUpOK stAMPUOK;
@@ -26,6 +26,7 @@
 extern MonoServer *g_MonoServer;
 ServerObject::ServerObject()
     : m_UID(g_MonoServer->GetUID())
+    , m_ClassMask(ClassTag<ServerObject>::Mask)
 {
     // 1. link to the mono object pool
     //    never allocate ServerObject on stack
@@ -52,7 +53,7 @@ static std::array<ServerObject::ClassEntryItem, 997> s_ClassEntryV;
 // always use std::call_once() for class registration
 // registration will exchange current Ready state as 1 then do registration if needed
 // this could cause busy looping for other thread calling ClassFrom() call, so don't make registration too often
-bool ServerObject::RegisterClass(size_t nCode, const char *pName, const std::vector<ClassCodeName> &rstParentEntry)
+bool ServerObject::RegisterClass(size_t nCode, const char *pName, uint32_t nMask, const std::vector<ClassCodeName> &rstParentEntry)
 {
     if(pName){
         auto nEntryCode0 = nCode % s_ClassEntryV.size();
@@ -65,6 +66,7 @@ bool ServerObject::RegisterClass(size_t nCode, const char *pName, const std::vec
                     {
                         rstCurrEntry.Entry = rstParentEntry;
                         rstCurrEntry.Entry.emplace_back(nCode, pName);
+                        rstCurrEntry.Mask = nMask;
 
                         rstCurrEntry.Ready.store(2);
                         return true;
@@ -91,6 +93,7 @@ bool ServerObject::RegisterClass(size_t nCode, const char *pName, const std::vec
 
                             if(true
                                     && bAgree
+                                    && rstCurrEntry.Mask == nMask
                                     && rstCurrEntry.Entry.back().Code == nCode
                                     && rstCurrEntry.Entry.back().Name == pName){
                                 rstCurrEntry.Ready.store(2);
@@ -137,13 +140,9 @@ bool ServerObject::RegisterClass(size_t nCode, const char *pName, const std::vec
 }
 
 // retrieve class registration information
-// for class already registered in the table this return a const ref of it
-const std::vector<ServerObject::ClassCodeName> &ServerObject::ClassEntry(size_t nClassCode)
+// for class already registered in the table this return a pointer to it, otherwise nullptr
+const ServerObject::ClassEntryItem *ServerObject::FindClassEntryItem(size_t nClassCode)
 {
-    // empty parent class for non-valid
-    // remember for ServerObject it self we have the return vector with size 1
-    static std::vector<ClassCodeName> stNullEntry {};
-
     auto nEntryCode0 = nClassCode % s_ClassEntryV.size();
     auto nEntryCode1 = nEntryCode0;
     while(true){
@@ -151,7 +150,7 @@ const std::vector<ServerObject::ClassCodeName> &ServerObject::ClassEntry(size_t
         switch(auto nState = rstCurrEntry.Ready.load()){
             case 0:
                 {
-                    return stNullEntry;
+                    return nullptr;
                 }
             case 1:
                 {
@@ -168,7 +167,7 @@ const std::vector<ServerObject::ClassCodeName> &ServerObject::ClassEntry(size_t
                         // we can do some verification if needed like
                         // 1. entry.Name is not empty
                         // 2. entry.Code should also exist in current table
-                        return rstCurrEntry.Entry;
+                        return &rstCurrEntry;
                     }else{
                         nEntryCode1 = (nEntryCode1 + 1) % s_ClassEntryV.size();
                     }
@@ -178,13 +177,23 @@ const std::vector<ServerObject::ClassCodeName> &ServerObject::ClassEntry(size_t
                 {
                     extern MonoServer *g_MonoServer;
                     g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid slot status: (Slot = %d, State = %d)", (int)(nEntryCode1), nState);
-                    return stNullEntry;
+                    return nullptr;
                 }
         }
 
-        if(nEntryCode1 == nEntryCode0){ return stNullEntry; }
+        if(nEntryCode1 == nEntryCode0){ return nullptr; }
     }
 
     // impossible, make the compiler happy
-    return stNullEntry;
+    return nullptr;
+}
+
+const std::vector<ServerObject::ClassCodeName> &ServerObject::ClassEntry(size_t nClassCode)
+{
+    // empty parent class for non-valid
+    // remember for ServerObject it self we have the return vector with size 1
+    static std::vector<ClassCodeName> stNullEntry {};
+
+    auto pItem = FindClassEntryItem(nClassCode);
+    return pItem ? pItem->Entry : stNullEntry;
 }
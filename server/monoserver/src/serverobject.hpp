@@ -26,6 +26,7 @@
 #include <string>
 #include <cstdint>
 #include <cstddef>
+#include "classtag.hpp"
 #include "invardata.hpp"
 #include "uidrecord.hpp"
 
@@ -48,15 +49,26 @@ class ServerObject
             std::atomic<int> Ready;
             std::vector<ClassCodeName> Entry;
 
+            // compile-time class tag mask
+            // check ClassTag<T> in classtag.hpp
+            uint32_t Mask;
+
             ClassEntryItem()
                 : Ready{0}
                 , Entry()
+                , Mask(CLASSTAG_NONE)
             {}
         };
 
     private:
         const uint32_t m_UID;
 
+    private:
+        // class tag mask of the most derived class, check classtag.hpp
+        // each registered class sets it in its constructor, the last one wins
+        // atomic since the object is visible by GetUIDRecord() before constructed
+        std::atomic<uint32_t> m_ClassMask;
+
     public:
         explicit ServerObject();
         virtual ~ServerObject() = default;
@@ -84,10 +96,18 @@ class ServerObject
             return {};
         }
 
+    private:
+        static const ClassEntryItem *FindClassEntryItem(size_t);
+
     public:
         static const std::vector<ClassCodeName> &ClassEntry(size_t);
 
     public:
+        uint32_t ClassMask() const
+        {
+            return m_ClassMask.load(std::memory_order_relaxed);
+        }
+
         const std::vector<ClassCodeName> &ClassEntry() const
         {
             return ServerObject::ClassEntry(ClassCode());
@@ -96,29 +116,30 @@ class ServerObject
     public:
         template<typename T> bool ClassFrom() const
         {
-            for(const auto &rstCodeName: ClassEntry()){
-                if(true
-                        && rstCodeName.Name == typeid(T).name()
-                        && rstCodeName.Code == typeid(T).hash_code()){ return true; }
-            }
-            return false;
+            return (ClassMask() & ClassTag<typename std::remove_cv<T>::type>::Tag) == ClassTag<typename std::remove_cv<T>::type>::Tag;
+        }
+
+    protected:
+        template<typename T> void SetClassMask()
+        {
+            m_ClassMask.store(ClassTag<typename std::remove_cv<T>::type>::Mask, std::memory_order_relaxed);
         }
 
     protected:
-        bool RegisterClass(size_t, const char *, const std::vector<ClassCodeName> &);
+        bool RegisterClass(size_t, const char *, uint32_t, const std::vector<ClassCodeName> &);
 
         template<typename T> bool RegisterClass(const std::vector<ClassCodeName> &rstParentEntry)
         {
             using RT = typename std::remove_cv<T>::type;
             if(std::is_same<RT, ServerObject>::value){
                 if(rstParentEntry.empty()){
-                    return RegisterClass(typeid(ServerObject).hash_code(), typeid(ServerObject).name(), {});
+                    return RegisterClass(typeid(ServerObject).hash_code(), typeid(ServerObject).name(), ClassTag<ServerObject>::Mask, {});
                 }
             }else{
                 if(true
                         &&  std::is_base_of<ServerObject, RT>::value
                         && !rstParentEntry.empty()){
-                    return RegisterClass(typeid(RT).hash_code(), typeid(RT).name(), rstParentEntry);
+                    return RegisterClass(typeid(RT).hash_code(), typeid(RT).name(), ClassTag<RT>::Mask, rstParentEntry);
                 }
             }
             return false;
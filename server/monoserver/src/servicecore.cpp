@@ -42,6 +42,7 @@ ServiceCore::ServiceCore()
     };
     static std::once_flag stFlag;
     std::call_once(stFlag, fnRegisterClass);
+    SetClassMask<ServiceCore>();
 }
 
 void ServiceCore::OperateAM(const MessagePack &rstMPK, const Theron::Address &rstAddr)
@@ -19,17 +19,63 @@
  * =====================================================================================
  */
 
+#include <chrono>
+#include <cinttypes>
+#include <algorithm>
 #include "session.hpp"
 #include "memorypn.hpp"
 #include "compress.hpp"
+#include "sysconst.hpp"
+#include "netbundle.hpp"
+#include "netcapture.hpp"
 #include "condcheck.hpp"
 #include "monoserver.hpp"
+#include "serverconfig.hpp"
 
-Session::SendTask::SendTask(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::function<void()> &&fnOnDone)
+static uint32_t ConfigBundleTick()
+{
+    extern ServerConfig *g_ServerConfig;
+    return (uint32_t)((std::max)(0, g_ServerConfig->BundleTick));
+}
+
+// watermark of the send queue from config, negative is the same as 0
+// low watermark is not above the high one, otherwise it never leaves congestion
+static size_t ConfigSendQ(int ServerConfig::*pHigh, int ServerConfig::*pLow, bool bLow)
+{
+    extern ServerConfig *g_ServerConfig;
+    auto nHigh = (size_t)((std::max)(0, g_ServerConfig->*pHigh));
+    auto nLow  = (size_t)((std::max)(0, g_ServerConfig->*pLow ));
+    return bLow ? (std::min)(nLow, nHigh) : nHigh;
+}
+
+static int ConfigSendQPolicy()
+{
+    extern ServerConfig *g_ServerConfig;
+    return g_ServerConfig->SendQPolicy;
+}
+
+// statistics of all sessions
+static std::atomic<size_t>   s_TotalSendQMsg(0);
+static std::atomic<size_t>   s_TotalSendQByte(0);
+static std::atomic<uint64_t> s_TotalCoalesceCount(0);
+static std::atomic<uint64_t> s_TotalDropCount(0);
+static std::atomic<uint64_t> s_TotalEvictCount(0);
+
+static void CaptureMessage(uint32_t nSessionID, uint8_t nDir, uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+{
+    extern NetCaptureWriter *g_NetCapture;
+    if(g_NetCapture->Valid()){
+        g_NetCapture->Write(nSessionID, nDir, nHC, pData, nDataLen);
+    }
+}
+
+Session::SendTask::SendTask(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
     : HC(nHC)
+    , DoneToken(0)
+    , Key(0)
     , Data(pData)
     , DataLen(nDataLen)
-    , OnDone(std::move(fnOnDone))
+    , Shared(nullptr)
 {
     auto fnReportAndExit = [this]()
     {
@@ -115,16 +161,46 @@ Session::Session(uint32_t nSessionID, asio::ip::tcp::socket stSocket)
     , m_Socket(std::move(stSocket))
     , m_IP(m_Socket.remote_endpoint().address().to_string())
     , m_Port(m_Socket.remote_endpoint().port())
-    , m_ReadHC(0)
-    , m_ReadLen {0, 0, 0, 0}
     , m_Delay(0)
     , m_BindAddress(Theron::Address::Null())
+    , m_ReadParser()
+    , m_ReadOpCount(0)
+    , m_ReadMsgCount(0)
     , m_FlushFlag(false)
     , m_NextQLock()
     , m_SendQBuf0()
     , m_SendQBuf1()
     , m_CurrSendQ(&(m_SendQBuf0))
     , m_NextSendQ(&(m_SendQBuf1))
+    , m_CurrSendHead(0)
+    , m_DoneTable()
+    , m_DoneCallV()
+    , m_SendBufV()
+    , m_SendTaskCount(0)
+    , m_SendOpCount(0)
+    , m_SendMsgCount(0)
+    , m_SendByteCount(0)
+    , m_BundleTick(ConfigBundleTick())
+    , m_BundleBuf()
+    , m_BundleCount(0)
+    , m_BundleTimerFlag(false)
+    , m_BundleTimer(m_Socket.get_io_service())
+    , m_BundleMsgCount(0)
+    , m_SendQHighMsg (ConfigSendQ(&ServerConfig::SendQHighMsg,  &ServerConfig::SendQLowMsg,  false))
+    , m_SendQHighByte(ConfigSendQ(&ServerConfig::SendQHighByte, &ServerConfig::SendQLowByte, false))
+    , m_SendQLowMsg  (ConfigSendQ(&ServerConfig::SendQHighMsg,  &ServerConfig::SendQLowMsg,  true ))
+    , m_SendQLowByte (ConfigSendQ(&ServerConfig::SendQHighByte, &ServerConfig::SendQLowByte, true ))
+    , m_SendQPolicy(ConfigSendQPolicy())
+    , m_SendQMsg(0)
+    , m_SendQByte(0)
+    , m_SendQPeakMsg(0)
+    , m_SendQPeakByte(0)
+    , m_SendQCongested(false)
+    , m_SendQEvicted(false)
+    , m_CoalesceIndex()
+    , m_CongestCount(0)
+    , m_CoalesceCount(0)
+    , m_DropCount(0)
     , m_MemoryPN()
     , m_State(SESSTYPE_NONE)
 {}
@@ -137,167 +213,55 @@ Session::~Session()
     // don't use shared_from_this() in constructor or destructor
     // so Shutdown(true) should accessing raw this pointer
     Shutdown(true);
+
+    // tasks never sent are released with the session
+    // tasks are trivial, have to release references of shared buffers explicitly
+    for(size_t nIndex = m_CurrSendHead; nIndex < m_CurrSendQ->size(); ++nIndex){
+        ReleaseTask((*m_CurrSendQ)[nIndex]);
+    }
+
+    for(auto &rstTask: *m_NextSendQ){
+        ReleaseTask(rstTask);
+    }
+
+    s_TotalSendQMsg .fetch_sub(SendQMsg (), std::memory_order_relaxed);
+    s_TotalSendQByte.fetch_sub(SendQByte(), std::memory_order_relaxed);
 }
 
-void Session::DoReadHC()
+int Session::SendQPolicy(const std::string &szPolicy)
 {
-    switch(auto nCurrState = m_State.load()){
-        case SESSTYPE_STOPPED:
-            {
-                return;
-            }
-        case SESSTYPE_RUNNING:
-            {
-                auto fnReportCurrentMessage = [pThis = shared_from_this()]()
-                {
-                    extern MonoServer *g_MonoServer;
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Current CMSGParam::HC      = %s", (CMSGParam(pThis->m_ReadHC).Name().c_str()));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::Type    = %d", (int)(CMSGParam(pThis->m_ReadHC).Type()));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::MaskLen = %d", (int)(CMSGParam(pThis->m_ReadHC).MaskLen()));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::DataLen = %d", (int)(CMSGParam(pThis->m_ReadHC).DataLen()));
-                };
+    if(szPolicy == "coalesce"  ){ return SENDQ_COALESCE;   }
+    if(szPolicy == "drop"      ){ return SENDQ_DROP;       }
+    if(szPolicy == "disconnect"){ return SENDQ_DISCONNECT; }
+    return -1;
+}
 
-                auto fnOnNetError = [pThis = shared_from_this(), fnReportCurrentMessage](std::error_code stEC)
-                {
-                    if(stEC){
-                        // 1. close the asio socket
-                        pThis->Shutdown(true);
+size_t Session::TotalSendQMsg()
+{
+    return s_TotalSendQMsg.load(std::memory_order_relaxed);
+}
 
-                        // 2. record the error code to log
-                        extern MonoServer *g_MonoServer;
-                        g_MonoServer->AddLog(LOGTYPE_WARNING, "Network error on session %d: %s", (int)(pThis->ID()), stEC.message().c_str());
-                        fnReportCurrentMessage();
-                    }
-                };
+size_t Session::TotalSendQByte()
+{
+    return s_TotalSendQByte.load(std::memory_order_relaxed);
+}
 
-                auto fnDoneReadHC = [pThis = shared_from_this(), fnOnNetError, fnReportCurrentMessage](std::error_code stEC, size_t)
-                {
-                    if(stEC){
-                        fnOnNetError(stEC);
-                    }else{
-                        CMSGParam stCMSG(pThis->m_ReadHC);
-                        switch(stCMSG.Type()){
-                            case 0:
-                                {
-                                    pThis->ForwardActorMessage(pThis->m_ReadHC, nullptr, 0);
-                                    pThis->DoReadHC();
-                                    return;
-                                }
-                            case 1:
-                                {
-                                    // not empty, fixed size, compressed
-                                    auto fnDoneReadLen0 = [pThis, stCMSG, fnOnNetError, fnReportCurrentMessage](std::error_code stEC, size_t)
-                                    {
-                                        if(stEC){
-                                            fnOnNetError(stEC);
-                                        }else{
-                                            if(pThis->m_ReadLen[0] != 255){
-                                                if((size_t)(pThis->m_ReadLen[0]) > stCMSG.DataLen()){
-                                                    // 1. close the asio socket
-                                                    pThis->Shutdown(true);
-
-                                                    // 2. record the error code but not exit?
-                                                    extern MonoServer *g_MonoServer;
-                                                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid package: CompLen = %d", (int)(pThis->m_ReadLen[0]));
-                                                    fnReportCurrentMessage();
-
-                                                    // 3. we stop here
-                                                    //    should we have some method to save it?
-                                                    return;
-                                                }else{
-                                                    pThis->DoReadBody(stCMSG.MaskLen(), pThis->m_ReadLen[0]);
-                                                }
-                                            }else{
-                                                // oooops, bytes[0] is 255
-                                                // we got a long message and need to read bytes[1]
-                                                auto fnDoneReadLen1 = [pThis, stCMSG, fnReportCurrentMessage, fnOnNetError](std::error_code stEC, size_t)
-                                                {
-                                                    if(stEC){
-                                                        fnOnNetError(stEC);
-                                                    }else{
-                                                        condcheck(pThis->m_ReadLen[0] == 255);
-                                                        auto nCompLen = (size_t)(pThis->m_ReadLen[1]) + 255;
-
-                                                        if(nCompLen > stCMSG.DataLen()){
-                                                            // 1. close the asio socket
-                                                            pThis->Shutdown(true);
-
-                                                            // 2. record the error code but not exit?
-                                                            extern MonoServer *g_MonoServer;
-                                                            g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid package: CompLen = %d", (int)(nCompLen));
-                                                            fnReportCurrentMessage();
-
-                                                            // 3. we stop here
-                                                            //    should we have some method to save it?
-                                                            return;
-                                                        }else{
-                                                            pThis->DoReadBody(stCMSG.MaskLen(), nCompLen);
-                                                        }
-                                                    }
-                                                };
-                                                asio::async_read(pThis->m_Socket, asio::buffer(pThis->m_ReadLen + 1, 1), fnDoneReadLen1);
-                                            }
-                                        }
-                                    };
-                                    asio::async_read(pThis->m_Socket, asio::buffer(pThis->m_ReadLen, 1), fnDoneReadLen0);
-                                    return;
-                                }
-                            case 2:
-                                {
-                                    // not empty, fixed size, not compressed
-
-                                    // it has no overhead, fast
-                                    // this mode should be used for small messages
-                                    pThis->DoReadBody(0, stCMSG.DataLen());
-                                    return;
-                                }
-                            case 3:
-                                {
-                                    // not empty, not fixed size, not compressed
-
-                                    // directly read four bytes as length
-                                    // this mode is designed for transfering big chunk
-                                    // for even bigger chunk we should send more than one time
-
-                                    // and if we want to send big chunk of compressed data
-                                    // we should compress it by other method and send it via this channel
-                                    auto fnDoneReadLen = [pThis, fnOnNetError](std::error_code stEC, size_t)
-                                    {
-                                        if(stEC){
-                                            fnOnNetError(stEC);
-                                        }else{
-                                            uint32_t nDataLenU32 = 0;
-                                            std::memcpy(&nDataLenU32, pThis->m_ReadLen, 4);
-                                            pThis->DoReadBody(0, (size_t)(nDataLenU32));
-                                        }
-                                    };
-                                    asio::async_read(pThis->m_Socket, asio::buffer(pThis->m_ReadLen, 4), fnDoneReadLen);
-                                    return;
-                                }
-                            default:
-                                {
-                                    // impossible type
-                                    // should abort at construction of CMSGParam
-                                    pThis->Shutdown(true);
-                                    fnReportCurrentMessage();
-                                    return;
-                                }
-                        }
-                    }
-                };
-                asio::async_read(m_Socket, asio::buffer(&m_ReadHC, 1), fnDoneReadHC);
-                return;
-            }
-        default:
-            {
-                extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoReadHC() with invalid state: %d", nCurrState);
-                return;
-            }
-    }
+uint64_t Session::TotalCoalesceCount()
+{
+    return s_TotalCoalesceCount.load(std::memory_order_relaxed);
+}
+
+uint64_t Session::TotalDropCount()
+{
+    return s_TotalDropCount.load(std::memory_order_relaxed);
+}
+
+uint64_t Session::TotalEvictCount()
+{
+    return s_TotalEvictCount.load(std::memory_order_relaxed);
 }
 
-void Session::DoReadBody(size_t nMaskLen, size_t nBodyLen)
+void Session::DoRead()
 {
     switch(auto nCurrState = m_State.load()){
         case SESSTYPE_STOPPED:
@@ -306,16 +270,7 @@ void Session::DoReadBody(size_t nMaskLen, size_t nBodyLen)
             }
         case SESSTYPE_RUNNING:
             {
-                auto fnReportCurrentMessage = [pThis = shared_from_this()]()
-                {
-                    extern MonoServer *g_MonoServer;
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Current SMSGParam::HC      = %d", (int)(pThis->m_ReadHC));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::Type    = %d", (int)(CMSGParam(pThis->m_ReadHC).Type()));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::MaskLen = %d", (int)(CMSGParam(pThis->m_ReadHC).MaskLen()));
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "                 ::DataLen = %d", (int)(CMSGParam(pThis->m_ReadHC).DataLen()));
-                };
-
-                auto fnOnNetError = [pThis = shared_from_this(), fnReportCurrentMessage](std::error_code stEC)
+                auto fnDoneRead = [pThis = shared_from_this()](std::error_code stEC, size_t nReadBytes)
                 {
                     if(stEC){
                         // 1. close the asio socket
@@ -324,142 +279,60 @@ void Session::DoReadBody(size_t nMaskLen, size_t nBodyLen)
                         // 2. record the error code to log
                         extern MonoServer *g_MonoServer;
                         g_MonoServer->AddLog(LOGTYPE_WARNING, "Network error on session %d: %s", (int)(pThis->ID()), stEC.message().c_str());
-                        fnReportCurrentMessage();
+                        return;
                     }
-                };
 
-                auto fnReportInvalidArg = [nMaskLen, nBodyLen, fnReportCurrentMessage]()
-                {
-                    extern MonoServer *g_MonoServer;
-                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid argument to DoReadBody(MaskLen = %d, BodyLen = %d)", (int)(nMaskLen), (int)(nBodyLen));
-                    fnReportCurrentMessage();
-                };
-
-                // argument check
-                // check if (nMaskLen, nBodyLen) is proper based on current m_ReadHC
-                CMSGParam stCMSG(m_ReadHC);
-                switch(stCMSG.Type()){
-                    case 0:
-                        {
-                            fnReportInvalidArg();
-                            return;
-                        }
-                    case 1:
-                        {
-                            if(!((nMaskLen == stCMSG.MaskLen()) && (nBodyLen <= stCMSG.DataLen()))){
-                                fnReportInvalidArg();
-                                return;
-                            }
-                            break;
-                        }
-                    case 2:
-                        {
-                            if(nMaskLen || (nBodyLen != stCMSG.DataLen())){
-                                fnReportInvalidArg();
-                                return;
-                            }
-                            break;
-                        }
-                    case 3:
-                        {
-                            if(nMaskLen || (nBodyLen > 0XFFFFFFFF)){
-                                fnReportInvalidArg();
-                                return;
-                            }
-                            break;
-                        }
-                    default:
-                        {
-                            fnReportInvalidArg();
-                            return;
+                    // take all complete messages in the buffer
+                    // one read can contain many messages, or only part of one message
+                    pThis->m_ReadParser.Commit(nReadBytes);
+                    auto nParsed = pThis->m_ReadParser.Parse([pThis](uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+                    {
+                        CaptureMessage(pThis->ID(), NetCapture::DIR_CM, nHC, pData, nDataLen);
+
+                        // we use global memory pool for read
+                        // since the allocated buffer will be passed to actor
+                        // and it's de-allocated by actor message handler, not here
+                        uint8_t *pMem = nullptr;
+                        if(pData && nDataLen){
+                            extern MemoryPN *g_MemoryPN;
+                            pMem = (uint8_t *)(g_MemoryPN->Get(nDataLen));
+                            std::memcpy(pMem, pData, nDataLen);
                         }
-                }
+                        pThis->ForwardActorMessage(nHC, pMem, pMem ? nDataLen : 0);
+                    });
 
-                if(auto nDataLen = nMaskLen + nBodyLen){
-                    // we use global memory pool for read
-                    // since the allocated buffer will be passed to actor
-                    // and it's de-allocated by actor message handler, not here
-                    extern MemoryPN *g_MemoryPN;
-                    auto pMem = (uint8_t *)(g_MemoryPN->Get(nDataLen));
+                    if(nParsed < 0){
+                        // stream is corrupted
+                        // can't find where next message starts, close the session
+                        pThis->Shutdown(true);
 
-                    auto fnDoneReadData = [pThis = shared_from_this(), nMaskLen, nBodyLen, pMem, stCMSG, fnReportCurrentMessage, fnOnNetError](std::error_code stEC, size_t)
-                    {
-                        if(stEC){
-                            fnOnNetError(stEC);
-                        }else{
-                            uint8_t *pDecodeMem = nullptr;
-                            if(nMaskLen){
-                                auto nMaskCount = Compress::CountMask(pMem, nMaskLen);
-                                if(nMaskCount != (int)(nBodyLen)){
-                                    // we get corrupted data
-                                    // should we ignore current package or kill the process?
-
-                                    // 1. keep a log for the corrupted message
-                                    extern MonoServer *g_MonoServer;
-                                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Corrupted data: MaskCount = %d, CompLen = %d", nMaskCount, (int)(nBodyLen));
-
-                                    // 2. we ignore this message
-                                    //    won't shutdown current session, just return?
-                                    return;
-                                }
-
-                                // we need to decode it
-                                // we do have a compressed version of data
-                                if(nBodyLen <= stCMSG.DataLen()){
-                                    extern MemoryPN *g_MemoryPN;
-                                    pDecodeMem = (uint8_t *)(g_MemoryPN->Get(stCMSG.DataLen()));
-                                    if(Compress::Decode(pDecodeMem, stCMSG.DataLen(), pMem, pMem + nMaskLen) != (int)(nBodyLen)){
-                                        // 1. keep a record for this failure
-                                        extern MonoServer *g_MonoServer;
-                                        g_MonoServer->AddLog(LOGTYPE_WARNING, "Decode failed: MaskCount = %d, CompLen = %d", nMaskCount, (int)(nBodyLen));
-                                        fnReportCurrentMessage();
-
-                                        // 2. free memory
-                                        g_MemoryPN->Free(pMem);
-                                        g_MemoryPN->Free(pDecodeMem);
-
-                                        // 3. do nothing but return directly
-                                        return;
-                                    }else{
-                                        // ok decoding succeed, free pMem
-                                        g_MemoryPN->Free(pMem);
-                                    }
-                                }else{
-                                    extern MonoServer *g_MonoServer;
-                                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Corrupted data: DataLen = %d, CompLen = %d", (int)(stCMSG.DataLen()), (int)(nBodyLen));
-                                    fnReportCurrentMessage();
-                                    return;
-                                }
-                            }
+                        extern MonoServer *g_MonoServer;
+                        g_MonoServer->AddLog(LOGTYPE_WARNING, "Invalid message on session %d: %s", (int)(pThis->ID()), pThis->m_ReadParser.ErrorInfo().c_str());
+                        return;
+                    }
 
-                            // decoding and verification done
-                            // we pass the pointer to actor and it's released inside actor
-                            pThis->ForwardActorMessage(pThis->m_ReadHC, pDecodeMem ? pDecodeMem : pMem, nMaskLen ? stCMSG.DataLen() : nBodyLen);
-                            pThis->DoReadHC();
-                        }
-                    };
-                    asio::async_read(m_Socket, asio::buffer(pMem, nDataLen), fnDoneReadData);
-                    return;
-                }
+                    pThis->m_ReadOpCount.fetch_add(1, std::memory_order_relaxed);
+                    pThis->m_ReadMsgCount.fetch_add(nParsed, std::memory_order_relaxed);
+                    pThis->DoRead();
+                };
 
-                // possibilities to reach here
-                // 1. call DoReadBody() with m_ReadHC as empty message type
-                // 2. read a body with empty body in mode 3
-                ForwardActorMessage(m_ReadHC, nullptr, 0);
-                DoReadHC();
+                m_Socket.async_read_some(asio::buffer(m_ReadParser.WriteBuf(), m_ReadParser.WriteLen()), fnDoneRead);
                 return;
             }
         default:
             {
                 extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoReadBody() with invalid state: %d", nCurrState);
+                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoRead() with invalid state: %d", nCurrState);
                 return;
             }
     }
 }
 
-void Session::DoSendNext()
+void Session::DoSendDone(size_t nSentBytes)
 {
+    // 1. only called in asio main loop thread
+    // 2. called when the whole batch built in DoSendQ() is written
+
     switch(auto nCurrState = m_State.load()){
         case SESSTYPE_STOPPED:
             {
@@ -468,78 +341,73 @@ void Session::DoSendNext()
         case SESSTYPE_RUNNING:
             {
                 condcheck(m_FlushFlag);
-                condcheck(!m_CurrSendQ->empty());
+                condcheck(m_CurrSendHead + m_SendTaskCount <= m_CurrSendQ->size());
 
-                if(m_CurrSendQ->front().OnDone){
-                    m_CurrSendQ->front().OnDone();
-                }
+                m_SendOpCount.fetch_add(1, std::memory_order_relaxed);
+                m_SendByteCount.fetch_add(nSentBytes, std::memory_order_relaxed);
+                m_SendMsgCount.fetch_add(m_SendTaskCount, std::memory_order_relaxed);
 
-                if(m_CurrSendQ->front().Data && m_CurrSendQ->front().DataLen){
-                    m_MemoryPN.Free(const_cast<uint8_t *>(m_CurrSendQ->front().Data));
-                }
+                // release all tasks in the batch
+                // most tasks have no callback, only lock the table if there is any
+                bool   bHasDone     = false;
+                size_t nReleaseByte = 0;
 
-                m_CurrSendQ->pop();
-                DoSendHC();
+                auto pBegin = m_CurrSendQ->begin() + m_CurrSendHead;
+                auto pEnd   = pBegin + m_SendTaskCount;
 
-                return;
-            }
-        default:
-            {
-                extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoSendNext() with invalid state: %d", nCurrState);
-                return;
-            }
-    }
-}
+                for(auto pTask = pBegin; pTask != pEnd; ++pTask){
+                    nReleaseByte += (1 + pTask->DataLen);
+                    bHasDone      = bHasDone || (pTask->DoneToken != 0);
+                    ReleaseTask(*pTask);
+                }
 
-void Session::DoSendBuf()
-{
-    switch(auto nCurrState = m_State.load()){
-        case SESSTYPE_STOPPED:
-            {
-                return;
-            }
-        case SESSTYPE_RUNNING:
-            {
-                condcheck(m_FlushFlag);
-                condcheck(!m_CurrSendQ->empty());
+                m_CurrSendHead += m_SendTaskCount;
 
-                if(m_CurrSendQ->front().Data && m_CurrSendQ->front().DataLen){
-                    auto fnDoneSend = [pThis = shared_from_this()](std::error_code stEC, size_t)
+                // callbacks are invoked in the same order as messages sent
+                // invoke them without lock, they may call Send() again
+                if(bHasDone){
                     {
-                        if(stEC){
-                            // 1. shutdown current connection
-                            pThis->Shutdown(true);
-
-                            // 2. report message and abort current process
-                            extern MonoServer *g_MonoServer;
-                            g_MonoServer->AddLog(LOGTYPE_WARNING, "Network error on session %d: %s", (int)(pThis->ID()), stEC.message().c_str());
-                            return;
-                        }else{
-                            // don't do buffer release and callback invocation here
-                            // we put it in DoSendNext()
-                            pThis->DoSendNext();
+                        std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
+                        for(auto pTask = pBegin; pTask != pEnd; ++pTask){
+                            if(pTask->DoneToken){
+                                m_DoneCallV.emplace_back(m_DoneTable.Take(pTask->DoneToken));
+                            }
                         }
-                    };
+                    }
 
-                    // the Data field should contains all needed size info
-                    // when call Session::Send() it should be compressed if necessary and put it there
-                    asio::async_write(m_Socket, asio::buffer(m_CurrSendQ->front().Data, m_CurrSendQ->front().DataLen), fnDoneSend);
-                }else{
-                    DoSendNext();
+                    for(auto &fnDone: m_DoneCallV){
+                        fnDone();
+                    }
+                    m_DoneCallV.clear();
+                }
+
+                m_SendQMsg .fetch_sub(m_SendTaskCount, std::memory_order_relaxed);
+                m_SendQByte.fetch_sub(nReleaseByte,    std::memory_order_relaxed);
+                s_TotalSendQMsg .fetch_sub(m_SendTaskCount, std::memory_order_relaxed);
+                s_TotalSendQByte.fetch_sub(nReleaseByte,    std::memory_order_relaxed);
+
+                // leave the congested state as soon as the queue drains below the low watermark
+                // otherwise SENDQ_DROP keeps dropping state messages till some other message is pushed
+                // queue only shrinks here, eviction is decided by the senders
+                if(m_SendQCongested.load(std::memory_order_relaxed)){
+                    std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
+                    CheckSendQ();
                 }
+
+                m_SendTaskCount = 0;
+                DoSendQ();
                 return;
             }
         default:
             {
                 extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoSendBuf() with invalid state: %d", nCurrState);
+                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoSendDone() with invalid state: %d", nCurrState);
                 return;
             }
     }
 }
 
-void Session::DoSendHC()
+void Session::DoSendQ()
 {
     // 1. only called in asio main loop thread
     // 2. only called in RUNNING / STOPPED state
@@ -554,24 +422,23 @@ void Session::DoSendHC()
             }
         case SESSTYPE_RUNNING:
             {
-                // will send this header code
-                // session state could switch to STOPPED during sending
-
                 // when we are here
                 // we should already have m_FlushFlag set as true
                 condcheck(m_FlushFlag);
+                condcheck(m_SendTaskCount == 0);
 
                 // we check m_CurrSendQ and if it's empty we swap with the pending queue
                 // then for server threads calling Send() we only dealing with m_NextSendQ
 
-                // but in asio main loop thread calling DoSendHC()
+                // but in asio main loop thread calling DoSendQ()
                 // when we finished all tasks in m_CurrSendQ (ro swapped into m_CurrSendQ) we just stopped
                 // all posted tasks after have to wait for next post to call FlushSendQ() to drive then send
 
-                // we may put a self check for each session
-                // for every x ms we automatically call FlushSendQ()
+                if(m_CurrSendHead == m_CurrSendQ->size()){
+                    // all sent, keep the capacity for next swap
+                    m_CurrSendQ->clear();
+                    m_CurrSendHead = 0;
 
-                if(m_CurrSendQ->empty()){
                     std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
                     if(m_NextSendQ->empty()){
                         // neither queue contains pending packages
@@ -580,18 +447,40 @@ void Session::DoSendHC()
                         return;
                     }else{
                         // else we still need to access m_CurrSendQ 
-                        // keep m_FlushFlag to pervent other thread to call DoSendHC()
+                        // keep m_FlushFlag to pervent other thread to call DoSendQ()
                         std::swap(m_CurrSendQ, m_NextSendQ);
+
+                        // tasks in writing can't be coalesced
+                        // indices refer to the new empty m_NextSendQ from now
+                        m_CoalesceIndex.clear();
                     }
                 }
 
-                condcheck(!m_CurrSendQ->empty());
-                auto fnDoSendBuf = [pThis = shared_from_this()](std::error_code stEC, size_t)
-                {
-                    // we always use pThis here
-                    // but actually we know since DoSendHC() is invoked by pThis always
-                    // then here using this or pThis should be both OK
+                condcheck(m_CurrSendHead < m_CurrSendQ->size());
+
+                // gather HC and body of as many messages as possible into one buffer sequence
+                // then asio issues one writev() for the whole batch instead of two writes per message
+                //
+                // m_CurrSendQ is not changed by Send() and only cleared when all sent
+                // so buffers keep valid till the write is done
+                m_SendBufV.clear();
+                for(auto pTask = m_CurrSendQ->begin() + m_CurrSendHead; pTask != m_CurrSendQ->end(); ++pTask){
+                    if(m_SendTaskCount >= (size_t)(SYS_MAXSENDBATCH)){
+                        break;
+                    }
 
+                    auto &rstTask = *pTask;
+                    m_SendBufV.emplace_back(&(rstTask.HC), 1);
+                    if(rstTask.Data && rstTask.DataLen){
+                        // the Data field should contains all needed size info
+                        // when call Session::Send() it should be compressed if necessary and put it there
+                        m_SendBufV.emplace_back(rstTask.Data, rstTask.DataLen);
+                    }
+                    m_SendTaskCount++;
+                }
+
+                auto fnDoneSend = [pThis = shared_from_this()](std::error_code stEC, size_t nSentBytes)
+                {
                     if(stEC){
                         // 1. shutdown current connection
                         pThis->Shutdown(true);
@@ -601,17 +490,19 @@ void Session::DoSendHC()
                         g_MonoServer->AddLog(LOGTYPE_WARNING, "Network error on session %d: %s", (int)(pThis->ID()), stEC.message().c_str());
                         return;
                     }else{
-                        pThis->DoSendBuf();
+                        // don't do buffer release and callback invocation here
+                        // we put it in DoSendDone()
+                        pThis->DoSendDone(nSentBytes);
                     }
                 };
 
-                asio::async_write(m_Socket, asio::buffer(&(m_CurrSendQ->front().HC), 1), fnDoSendBuf);
+                asio::async_write(m_Socket, m_SendBufV, fnDoneSend);
                 return;
             }
         default:
             {
                 extern MonoServer *g_MonoServer;
-                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoSendHC() with invalid state: %d", nCurrState);
+                g_MonoServer->AddLog(LOGTYPE_WARNING, "Calling DoSendQ() with invalid state: %d", nCurrState);
                 return;
             }
     }
@@ -628,8 +519,8 @@ bool Session::FlushSendQ()
         // but we need lock for m_NextSendQ, in child threads, in asio main loop
 
         // but we need to make sure there is only one procedure in asio main loop accessing m_CurrSendQ
-        // because packages in m_CurrSendQ are divided into two parts: HC / Data 
-        // one package only get erased after Data is sent
+        // because packages in m_CurrSendQ are sent by batches
+        // one package only get erased after the whole batch is sent
         // then multiple procesdure in asio main loop may send HC / Data more than one time
 
         // use shared_ptr<Session>() instead of raw this
@@ -639,7 +530,7 @@ bool Session::FlushSendQ()
             //  mark as current some one is accessing it
             //  we don't even need to make m_FlushFlag atomic since it's in one thread
             pThis->m_FlushFlag = true;
-            pThis->DoSendHC();
+            pThis->DoSendQ();
         }
     };
 
@@ -651,14 +542,93 @@ bool Session::FlushSendQ()
 
 bool Session::Send(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::function<void()> &&fnDone)
 {
+    // capture the body before encoding and bundling
+    // messages by Send(HC, SharedBuf) are captured once by NetDriver::Broadcast()
+    CaptureMessage(ID(), NetCapture::DIR_SM, nHC, pData, nDataLen);
+
+    // evicted session is waiting for shutdown
+    // don't let anything grow the queue again
+    if(m_SendQEvicted.load(std::memory_order_relaxed)){
+        return false;
+    }
+
+    // state message when the client can't catch up
+    // it's dropped, or it skips the bundle to replace the pending one
+    auto nKey = fnDone ? 0 : CoalesceKey(nHC, pData, nDataLen);
+    auto bCongestedKey = nKey && m_SendQCongested.load(std::memory_order_relaxed);
+
+    if(bCongestedKey && (m_SendQPolicy == SENDQ_DROP)){
+        m_DropCount.fetch_add(1, std::memory_order_relaxed);
+        s_TotalDropCount.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // small message without callback goes to the bundle
+    // it's not encoded here, the whole bundle is compressed once when packing
+    if(m_BundleTick && !fnDone && !bCongestedKey){
+        bool bAppend = false;
+        bool bPacked = false;
+        bool bArming = false;
+        bool bEvict  = false;
+        {
+            std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
+            if(NetBundle::Append<SMSGParam>(&m_BundleBuf, nHC, pData, nDataLen)){
+                bAppend = true;
+                m_BundleCount++;
+
+                if(m_BundleBuf.size() >= (size_t)(SYS_MAXBUNDLELEN)){
+                    // don't wait for the timer if the bundle is big enough
+                    // the armed timer only finds an empty bundle
+                    PackBundle();
+                    bPacked = true;
+                    bEvict  = !CheckSendQ();
+                }else if(!m_BundleTimerFlag){
+                    m_BundleTimerFlag = true;
+                    bArming = true;
+                }
+            }
+        }
+
+        if(bEvict){
+            EvictSendQ();
+            return false;
+        }
+
+        if(bAppend){
+            if(bArming){
+                m_Socket.get_io_service().post([pThis = shared_from_this()](){ pThis->DoBundleTimer(); });
+            }
+            return bPacked ? FlushSendQ() : true;
+        }
+
+        // can't bundle
+        // send it by a normal task, BuildTask() reports the error if it's invalid
+    }
+
     // BuildTask should be thread-safe
     // it's using the internal memory pool to build the task block
 
-    if(auto stTask = BuildTask(nHC, pData, nDataLen, std::move(fnDone))){
+    if(auto stTask = BuildTask(nHC, pData, nDataLen)){
         // ready to send
+        // pending bundle first to keep the order
+        bool bEvict = false;
         {
+            stTask.Key = nKey;
             std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
-            m_NextSendQ->emplace(std::move(stTask));
+
+            PackBundle();
+            if(!CoalesceTask(stTask)){
+                // callback is only moved to the table, no copy
+                // it's empty for most messages then the table is not touched
+                stTask.DoneToken = m_DoneTable.Add(std::move(fnDone));
+                PushTask(stTask);
+            }
+            bEvict = !CheckSendQ();
+        }
+
+        if(bEvict){
+            EvictSendQ();
+            return false;
         }
 
         // 3. notify asio main loop
@@ -667,7 +637,236 @@ bool Session::Send(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::func
     return false;
 }
 
-Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::function<void()> &&fnDone)
+bool Session::Send(uint8_t nHC, const SharedBuf &stBuf)
+{
+    if(m_SendQEvicted.load(std::memory_order_relaxed)){
+        return false;
+    }
+
+    bool bEvict = false;
+    {
+        std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
+        PackBundle();
+        PushTask(SendTask(nHC, stBuf));
+        bEvict = !CheckSendQ();
+    }
+
+    if(bEvict){
+        EvictSendQ();
+        return false;
+    }
+    return FlushSendQ();
+}
+
+uint64_t Session::CoalesceKey(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+{
+    // only messages carrying a full state can be coalesced
+    // i.e. SM_ACTION is not since the client plays every action as animation, SM_EXP is an increment
+    switch(nHC){
+        case SM_UPDATEHP:
+            {
+                if(pData && (nDataLen == sizeof(SMUpdateHP))){
+                    SMUpdateHP stSMUHP;
+                    std::memcpy(&stSMUHP, pData, sizeof(stSMUHP));
+                    return ((uint64_t)(nHC) << 32) | stSMUHP.UID;
+                }
+                return 0;
+            }
+        default:
+            {
+                return 0;
+            }
+    }
+}
+
+void Session::PushTask(const SendTask &rstTask)
+{
+    auto nTaskByte  = 1 + rstTask.DataLen;
+    auto nSendQMsg  = m_SendQMsg .fetch_add(1,         std::memory_order_relaxed) + 1;
+    auto nSendQByte = m_SendQByte.fetch_add(nTaskByte, std::memory_order_relaxed) + nTaskByte;
+
+    s_TotalSendQMsg .fetch_add(1,         std::memory_order_relaxed);
+    s_TotalSendQByte.fetch_add(nTaskByte, std::memory_order_relaxed);
+
+    // peaks are only written here with m_NextQLock
+    if(nSendQMsg > m_SendQPeakMsg.load(std::memory_order_relaxed)){
+        m_SendQPeakMsg.store(nSendQMsg, std::memory_order_relaxed);
+    }
+
+    if(nSendQByte > m_SendQPeakByte.load(std::memory_order_relaxed)){
+        m_SendQPeakByte.store(nSendQByte, std::memory_order_relaxed);
+    }
+
+    if(true
+            && rstTask.Key
+            && m_SendQPolicy == SENDQ_COALESCE
+            && m_SendQCongested.load(std::memory_order_relaxed)){
+        m_CoalesceIndex[rstTask.Key] = m_NextSendQ->size();
+    }
+    m_NextSendQ->push_back(rstTask);
+}
+
+bool Session::CoalesceTask(SendTask &rstTask)
+{
+    if(!rstTask.Key){
+        return false;
+    }
+
+    auto pIndex = m_CoalesceIndex.find(rstTask.Key);
+    if(pIndex == m_CoalesceIndex.end()){
+        return false;
+    }
+
+    // take the position of the pending one
+    // the newer state arrives a bit earlier than other messages sent before it, which is fine for a state
+    auto &rstPending = (*m_NextSendQ)[pIndex->second];
+    condcheck(rstPending.Key == rstTask.Key);
+    condcheck(!rstPending.DoneToken && !rstPending.Shared);
+
+    if(rstTask.DataLen >= rstPending.DataLen){
+        m_SendQByte.fetch_add(rstTask.DataLen - rstPending.DataLen, std::memory_order_relaxed);
+        s_TotalSendQByte.fetch_add(rstTask.DataLen - rstPending.DataLen, std::memory_order_relaxed);
+    }else{
+        m_SendQByte.fetch_sub(rstPending.DataLen - rstTask.DataLen, std::memory_order_relaxed);
+        s_TotalSendQByte.fetch_sub(rstPending.DataLen - rstTask.DataLen, std::memory_order_relaxed);
+    }
+
+    ReleaseTask(rstPending);
+    rstPending.Data    = rstTask.Data;
+    rstPending.DataLen = rstTask.DataLen;
+
+    rstTask.Data    = nullptr;
+    rstTask.DataLen = 0;
+
+    m_CoalesceCount.fetch_add(1, std::memory_order_relaxed);
+    s_TotalCoalesceCount.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+bool Session::CheckSendQ()
+{
+    auto nSendQMsg  = SendQMsg();
+    auto nSendQByte = SendQByte();
+
+    auto fnAbove = [nSendQMsg, nSendQByte](size_t nMarkMsg, size_t nMarkByte) -> bool
+    {
+        return false
+            || (nMarkMsg  && (nSendQMsg  > nMarkMsg ))
+            || (nMarkByte && (nSendQByte > nMarkByte));
+    };
+
+    if(m_SendQCongested.load(std::memory_order_relaxed)){
+        if(!fnAbove(m_SendQLowMsg, m_SendQLowByte)){
+            m_SendQCongested.store(false, std::memory_order_relaxed);
+            m_CoalesceIndex.clear();
+            return true;
+        }
+    }else{
+        if(!fnAbove(m_SendQHighMsg, m_SendQHighByte)){
+            return true;
+        }
+
+        m_SendQCongested.store(true, std::memory_order_relaxed);
+        m_CongestCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // congested now
+    // coalescing and dropping only slow down the growth, evict if it still grows too much
+    return (m_SendQPolicy != SENDQ_DISCONNECT) && !fnAbove(2 * m_SendQHighMsg, 2 * m_SendQHighByte);
+}
+
+void Session::EvictSendQ()
+{
+    if(m_SendQEvicted.exchange(true)){
+        return;
+    }
+
+    s_TotalEvictCount.fetch_add(1, std::memory_order_relaxed);
+
+    extern MonoServer *g_MonoServer;
+    g_MonoServer->AddLog(LOGTYPE_WARNING, "Session %d evicted, client can't catch up: %zu messages, %zu bytes pending", (int)(ID()), SendQMsg(), SendQByte());
+
+    // called by server threads
+    // post the shutdown to asio main loop
+    Shutdown(false);
+}
+
+void Session::PackBundle()
+{
+    switch(m_BundleCount){
+        case 0:
+            {
+                return;
+            }
+        case 1:
+            {
+                // only one message, send it as itself
+                // bundle adds 5 bytes overhead for one message
+                auto nHC      = m_BundleBuf[0];
+                auto nDataLen = m_BundleBuf.size() - 1;
+
+                if(auto stTask = BuildTask(nHC, nDataLen ? (m_BundleBuf.data() + 1) : nullptr, nDataLen)){
+                    PushTask(stTask);
+                }
+                break;
+            }
+        default:
+            {
+                // SM_BUNDLE is type 3: [DataLen: 4 bytes][Data]
+                // Data is [RawLen: 4 bytes][Mask][CompData]
+                auto nCountData = Compress::CountData(m_BundleBuf.data(), m_BundleBuf.size());
+                auto nBundleLen = NetBundle::EncodeLen(m_BundleBuf.size(), nCountData);
+                auto pEncodeData = (uint8_t *)(m_MemoryPN.Get(4 + nBundleLen));
+
+                auto nBundleLenU32 = (uint32_t)(nBundleLen);
+                std::memcpy(pEncodeData, &nBundleLenU32, 4);
+
+                if(!NetBundle::Encode(pEncodeData + 4, m_BundleBuf.data(), m_BundleBuf.size())){
+                    m_MemoryPN.Free(pEncodeData);
+
+                    extern MonoServer *g_MonoServer;
+                    g_MonoServer->AddLog(LOGTYPE_WARNING, "Session %d failed to encode bundle: %d messages, %d bytes", (int)(ID()), (int)(m_BundleCount), (int)(m_BundleBuf.size()));
+                    break;
+                }
+
+                PushTask(SendTask(SM_BUNDLE, pEncodeData, 4 + nBundleLen));
+                m_BundleMsgCount.fetch_add(m_BundleCount, std::memory_order_relaxed);
+                break;
+            }
+    }
+
+    m_BundleBuf.clear();
+    m_BundleCount = 0;
+}
+
+void Session::DoBundleTimer()
+{
+    m_BundleTimer.expires_from_now(std::chrono::milliseconds(m_BundleTick));
+    m_BundleTimer.async_wait([pThis = shared_from_this()](std::error_code stEC)
+    {
+        if(stEC){
+            return;
+        }
+
+        bool bEvict = false;
+        {
+            std::lock_guard<std::mutex> stLockGuard(pThis->m_NextQLock);
+            pThis->PackBundle();
+            pThis->m_BundleTimerFlag = false;
+
+            // packed bundle is pushed to the send queue as any other task
+            bEvict = !pThis->CheckSendQ();
+        }
+
+        if(bEvict){
+            pThis->EvictSendQ();
+            return;
+        }
+        pThis->FlushSendQ();
+    });
+}
+
+template<typename F> bool Session::EncodeMessage(uint8_t nHC, const uint8_t *pData, size_t nDataLen, F &&fnGetBuf, size_t *pEncodeSize)
 {
     size_t   nEncodeSize = 0;
     uint8_t *pEncodeData = nullptr;
@@ -684,7 +883,7 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
             {
                 if(pData || nDataLen){
                     fnReportError("Invalid argument");
-                    return Session::SendTask::Null();
+                    return false;
                 }
                 break;
             }
@@ -693,7 +892,7 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
                 // not empty, fixed size, comperssed
                 if(!(pData && (nDataLen == stSMSG.DataLen()))){
                     fnReportError("Invalid argument");
-                    return Session::SendTask::Null();
+                    return false;
                 }
 
                 // do compression, two solutions
@@ -712,31 +911,27 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
                 auto nCountData = Compress::CountData(pData, nDataLen);
                 if(nCountData < 0){
                     fnReportError("Count data failed");
-                    return Session::SendTask::Null();
+                    return false;
                 }else if(nCountData <= 254){
                     // we need only one byte for length info
-                    pEncodeData = (uint8_t *)(m_MemoryPN.Get(stSMSG.MaskLen() + (size_t)(nCountData) + 1));
+                    pEncodeData = fnGetBuf(stSMSG.MaskLen() + (size_t)(nCountData) + 1);
                     if(Compress::Encode(pEncodeData + 1, pData, nDataLen) != nCountData){
-                        // 1. keep a record for the failure
+                        // keep a record for the failure
+                        // memory allocated is released by caller
                         fnReportError("Compression failed");
-
-                        // 2. free memory allocated and return immediately
-                        m_MemoryPN.Free(pEncodeData);
-                        return Session::SendTask::Null();
+                        return false;
                     }
 
                     pEncodeData[0] = (uint8_t)(nCountData);
                     nEncodeSize    = 1 + stSMSG.MaskLen() + (size_t)(nCountData);
                 }else if(nCountData <= (255 + 255)){
                     // we need two byte for length info
-                    pEncodeData = (uint8_t *)(m_MemoryPN.Get(stSMSG.MaskLen() + (size_t)(nCountData) + 2));
-                    if(!Compress::Encode(pEncodeData + 2, pData, nDataLen)){
-                        // 1. keep a record for the failure
+                    pEncodeData = fnGetBuf(stSMSG.MaskLen() + (size_t)(nCountData) + 2);
+                    if(Compress::Encode(pEncodeData + 2, pData, nDataLen) != nCountData){
+                        // keep a record for the failure
+                        // memory allocated is released by caller
                         fnReportError("Compression failed");
-
-                        // 2. free memory allocated and return immediately
-                        m_MemoryPN.Free(pEncodeData);
-                        return Session::SendTask::Null();
+                        return false;
                     }
 
                     pEncodeData[0] = 255;
@@ -746,12 +941,9 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
                     // compressed message is toooooo long
                     // should use another mode to send this message type
 
-                    // 1. keep a record for the failure
+                    // keep a record for the failure
                     fnReportError("Compressed data too long");
-
-                    // 2. free memory allocated and return immediately
-                    m_MemoryPN.Free(pEncodeData);
-                    return Session::SendTask::Null();
+                    return false;
                 }
                 break;
             }
@@ -760,10 +952,10 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
                 // not empty, fixed size, not compressed
                 if(!(pData && (nDataLen == stSMSG.DataLen()))){
                     fnReportError("Invalid argument");
-                    return Session::SendTask::Null();
+                    return false;
                 }
 
-                pEncodeData = (uint8_t *)(m_MemoryPN.Get(nDataLen));
+                pEncodeData = fnGetBuf(nDataLen);
                 nEncodeSize = stSMSG.DataLen();
 
                 // for fixed size and uncompressed message
@@ -777,16 +969,16 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
                 if(pData){
                     if((nDataLen == 0) || (nDataLen > 0XFFFFFFFF)){
                         fnReportError("Invalid argument");
-                        return Session::SendTask::Null();
+                        return false;
                     }
                 }else{
                     if(nDataLen){
                         fnReportError("Invalid argument");
-                        return Session::SendTask::Null();
+                        return false;
                     }
                 }
 
-                pEncodeData = (uint8_t *)(m_MemoryPN.Get(nDataLen + 4));
+                pEncodeData = fnGetBuf(nDataLen + 4);
                 nEncodeSize = nDataLen + 4;
 
                 // 1. setup the message length encoding
@@ -802,11 +994,65 @@ Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t n
         default:
             {
                 fnReportError("Invalid argument");
-                return Session::SendTask::Null();
+                return false;
             }
     }
 
-    return {nHC, pEncodeData, nEncodeSize, std::move(fnDone)};
+    *pEncodeSize = nEncodeSize;
+    return true;
+}
+
+Session::SendTask Session::BuildTask(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+{
+    size_t   nEncodeSize = 0;
+    uint8_t *pEncodeData = nullptr;
+
+    auto fnGetBuf = [this, &pEncodeData](size_t nBufLen) -> uint8_t *
+    {
+        pEncodeData = (uint8_t *)(m_MemoryPN.Get(nBufLen));
+        return pEncodeData;
+    };
+
+    if(!EncodeMessage(nHC, pData, nDataLen, fnGetBuf, &nEncodeSize)){
+        if(pEncodeData){
+            m_MemoryPN.Free(pEncodeData);
+        }
+        return Session::SendTask::Null();
+    }
+    return {nHC, pEncodeData, nEncodeSize};
+}
+
+void Session::ReleaseTask(const SendTask &rstTask)
+{
+    if(rstTask.Shared){
+        SharedBuf::ReleaseHandle(rstTask.Shared);
+        return;
+    }
+
+    if(rstTask.Data && rstTask.DataLen){
+        m_MemoryPN.Free(const_cast<uint8_t *>(rstTask.Data));
+    }
+}
+
+bool Session::BuildSharedBuf(uint8_t nHC, const uint8_t *pData, size_t nDataLen, SharedBuf *pBuf)
+{
+    // encode to a thread local buffer then copy to the shared buffer
+    // the copy is done once for all sessions, compression is the expensive part
+    thread_local std::vector<uint8_t> t_EncodeBuf;
+
+    auto fnGetBuf = [](size_t nBufLen) -> uint8_t *
+    {
+        t_EncodeBuf.resize(nBufLen);
+        return t_EncodeBuf.data();
+    };
+
+    size_t nEncodeSize = 0;
+    if(!(pBuf && EncodeMessage(nHC, pData, nDataLen, fnGetBuf, &nEncodeSize))){
+        return false;
+    }
+
+    *pBuf = SharedBuf(nEncodeSize ? t_EncodeBuf.data() : nullptr, nEncodeSize);
+    return true;
 }
 
 bool Session::ForwardActorMessage(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
@@ -890,6 +1136,17 @@ void Session::Shutdown(bool bForce)
                     pThis->m_SyncDriver.Forward({MPK_BADSESSION, stAMBS}, pThis->m_BindAddress);
                     pThis->m_BindAddress = Theron::Address::Null();
 
+                    // the session ID may be reused by next connection
+                    // replay starts a new connection for messages after this
+                    CaptureMessage(pThis->ID(), NetCapture::DIR_CLOSE, 0, nullptr, 0);
+
+                    extern MonoServer *g_MonoServer;
+                    g_MonoServer->AddLog(LOGTYPE_DEBUG, "Session %d closed, sent %" PRIu64 " messages (%" PRIu64 " in bundles), %" PRIu64 " bytes by %" PRIu64 " writes, received %" PRIu64 " messages by %" PRIu64 " reads",
+                            (int)(pThis->ID()), pThis->SendMsgCount(), pThis->BundleMsgCount(), pThis->SendByteCount(), pThis->SendOpCount(), pThis->ReadMsgCount(), pThis->ReadOpCount());
+
+                    g_MonoServer->AddLog(LOGTYPE_DEBUG, "Session %d send queue peak %zu messages, %zu bytes, congested %" PRIu64 " times, coalesced %" PRIu64 ", dropped %" PRIu64,
+                            (int)(pThis->ID()), pThis->SendQPeakMsg(), pThis->SendQPeakByte(), pThis->CongestCount(), pThis->CoalesceCount(), pThis->DropCount());
+
                     // if we call shutdown() here
                     // we need to use try-catch since if connection has already
                     // been broken, it throws exception
@@ -940,7 +1197,7 @@ bool Session::Launch(const Theron::Address &rstAddr)
                     // make state RUNNING first
                     // otherwise all DoXXXXFunc() will exit directly
 
-                    m_Socket.get_io_service().post([pThis = shared_from_this()](){ pThis->DoReadHC(); });
+                    m_Socket.get_io_service().post([pThis = shared_from_this()](){ pThis->DoRead(); });
                     break;
                 }
             default:
@@ -21,7 +21,8 @@
  *                 1. who is going to access this class?
  *                    the server threads and asio main loop thread will access it. For access from
  *                    server threads, need to make it thread safe. For access from the asio thread
- *                    since currently I only use one thread for asio, it's simpler
+ *                    each session belongs to one io_service of NetDriver and every io_service is
+ *                    driven by exactly one thread, so all DoXXX() of one session are serialized
  *
  *                 2. Session::Send(server_message) use internal memory pool to copy server_message
  *                    and post it to the asio main loop
@@ -94,16 +95,24 @@
  */
 
 #pragma once
-#include <queue>
 #include <mutex>
+#include <string>
+#include <atomic>
+#include <vector>
 #include <memory>
 #include <cstdint>
 #include <asio.hpp>
 #include <functional>
+#include <type_traits>
+#include <unordered_map>
 #include <Theron/Theron.h>
 
+#include "message.hpp"
+#include "donetable.hpp"
+#include "sharedbuf.hpp"
 #include "syncdriver.hpp"
 #include "memorychunkpn.hpp"
+#include "netframeparser.hpp"
 
 class Session: public std::enable_shared_from_this<Session>
 {
@@ -115,21 +124,63 @@ class Session: public std::enable_shared_from_this<Session>
             SESSTYPE_STOPPED = 2,
         };
 
+    public:
+        // what to do when the send queue is above the high watermark, i.e. the client can't catch up
+        // in all policies a session is evicted if its queue still grows to twice the high watermark
+        //
+        //      SENDQ_COALESCE   : state message replaces the pending one with the same key
+        //      SENDQ_DROP       : state message is dropped, client gets the state by next update
+        //      SENDQ_DISCONNECT : evict the session directly
+        //
+        // state messages are those CoalesceKey() returns non-zero, messages with callback are never touched
+        enum SendQPolicyType: int
+        {
+            SENDQ_COALESCE   = 0,
+            SENDQ_DROP       = 1,
+            SENDQ_DISCONNECT = 2,
+        };
+
+        // return -1 if the name is invalid
+        static int SendQPolicy(const std::string &);
+
     private:
         // used by server threads, when server trying to post an send
         // it build a SendTask package by BuildTask() and post to the asio main loop thread
+        //
+        // SendTask is trivial, queues of it are plain arrays and never call constructors / destructors
+        // buffer and callback are referred by handles and released explicitly by ReleaseTask()
         struct SendTask
         {
             uint8_t HC;
 
+            // callback in m_DoneTable, 0 if no callback
+            uint32_t DoneToken;
+
+            // key of state message, 0 if it can't be coalesced or dropped
+            uint64_t Key;
+
             const uint8_t *Data;
             size_t         DataLen;
 
-            std::function<void()> OnDone;
+            // handle by SharedBuf::Detach() if Data refers to a buffer shared by many sessions, i.e. broadcast
+            // then Data is not allocated from m_MemoryPN and the task holds one reference of the buffer
+            const void *Shared;
+
+            SendTask() = default;
 
             // there are argument check when constructing SendTask
             // so put the implementation of the constructor in session.cpp
-            SendTask(uint8_t, const uint8_t *, size_t, std::function<void()> &&);
+            SendTask(uint8_t, const uint8_t *, size_t);
+
+            // no argument check, the shared buffer is built by BuildSharedBuf()
+            SendTask(uint8_t nHC, SharedBuf stBuf)
+                : HC(nHC)
+                , DoneToken(0)
+                , Key(0)
+                , Data(stBuf.Data())
+                , DataLen(stBuf.DataLen())
+                , Shared(stBuf.Detach())
+            {}
 
             operator bool () const
             {
@@ -138,11 +189,13 @@ class Session: public std::enable_shared_from_this<Session>
 
             static const SendTask &Null()
             {
-                static SendTask stNullTask(0, nullptr, 0, [](){});
+                static SendTask stNullTask(0, nullptr, 0);
                 return stNullTask;
             }
         };
 
+        static_assert(std::is_pod<SendTask>::value, "SendTask should be trivial to keep sending free of heap allocation");
+
     private:
         const uint32_t m_ID;
 
@@ -155,12 +208,19 @@ class Session: public std::enable_shared_from_this<Session>
         const uint32_t        m_Port;
 
     private:
-        uint8_t         m_ReadHC;
-        uint8_t         m_ReadLen[4];
-        uint32_t        m_BodyLen;
         uint32_t        m_Delay;
         Theron::Address m_BindAddress;
 
+    private:
+        // received bytes are read into the parser by chunks
+        // one read completion forwards all complete messages in it
+        NetFrameParser<CMSGParam> m_ReadParser;
+
+    private:
+        // statistics of the receive path
+        std::atomic<uint64_t> m_ReadOpCount;
+        std::atomic<uint64_t> m_ReadMsgCount;
+
     private:
         // 1. m_FlushFlag indicates there is procedure accessing m_CurrSendQ in asio main loop
         //    m_FlushFlag prevents more than one procedure from accessing m_CurrSendQ
@@ -171,10 +231,83 @@ class Session: public std::enable_shared_from_this<Session>
         std::mutex m_NextQLock;
 
     private:
-        std::queue<SendTask>  m_SendQBuf0;
-        std::queue<SendTask>  m_SendQBuf1;
-        std::queue<SendTask> *m_CurrSendQ;
-        std::queue<SendTask> *m_NextSendQ;
+        // queues only grow at the end and are cleared when empty, then the capacity is reused
+        // m_CurrSendQ is consumed from m_CurrSendHead, it's swapped with m_NextSendQ only after all sent
+        std::vector<SendTask>  m_SendQBuf0;
+        std::vector<SendTask>  m_SendQBuf1;
+        std::vector<SendTask> *m_CurrSendQ;
+        std::vector<SendTask> *m_NextSendQ;
+        size_t                 m_CurrSendHead;
+
+    private:
+        // callbacks of tasks in both queues, protected by m_NextQLock
+        // m_DoneCallV gathers callbacks of one batch to invoke them without lock, only used in asio main loop thread
+        DoneTable                          m_DoneTable;
+        std::vector<std::function<void()>> m_DoneCallV;
+
+    private:
+        // buffer sequence of the batch in writing, refers to m_SendTaskCount tasks from m_CurrSendHead
+        // keep it as member to reuse the capacity, only accessed in asio main loop thread
+        std::vector<asio::const_buffer> m_SendBufV;
+        size_t                          m_SendTaskCount;
+
+    private:
+        // statistics of the send path
+        // one op is one async_write() of a batch, then m_SendByteCount / m_SendOpCount is the average bytes per write
+        std::atomic<uint64_t> m_SendOpCount;
+        std::atomic<uint64_t> m_SendMsgCount;
+        std::atomic<uint64_t> m_SendByteCount;
+
+    private:
+        // small messages to the client are gathered as [HC][Data]... in m_BundleBuf
+        // then sent as one SM_BUNDLE when m_BundleTimer expires, see netbundle.hpp
+        //
+        // 1. only messages of type 0 / 1 / 2 without callback are bundled, m_BundleTick = 0 disables it
+        // 2. other messages pack the pending bundle before them, so the order of all messages keeps
+        // 3. m_BundleBuf, m_BundleCount and m_BundleTimerFlag are protected by m_NextQLock
+        //    m_BundleTimer is only accessed in asio main loop thread
+        const uint32_t       m_BundleTick;
+        std::vector<uint8_t> m_BundleBuf;
+        size_t               m_BundleCount;
+        bool                 m_BundleTimerFlag;
+        asio::steady_timer   m_BundleTimer;
+
+    private:
+        // statistics of bundle, messages in bundles are counted once as the bundle in m_SendMsgCount
+        std::atomic<uint64_t> m_BundleMsgCount;
+
+    private:
+        // watermarks of the send queue, 0 disables the limit, see SendQPolicyType
+        const size_t m_SendQHighMsg;
+        const size_t m_SendQHighByte;
+        const size_t m_SendQLowMsg;
+        const size_t m_SendQLowByte;
+        const int    m_SendQPolicy;
+
+    private:
+        // depth of the send queue: tasks in m_CurrSendQ and m_NextSendQ, bytes count the HC
+        // the bundle is not counted since it's packed when longer than SYS_MAXBUNDLELEN
+        //
+        // 1. increased when pushing to m_NextSendQ by PushTask(), decreased by DoSendDone()
+        // 2. m_SendQCongested is set above the high watermark and reset below the low watermark
+        //    checked after each push by Send() / DoBundleTimer() and after each release by DoSendDone()
+        //    written with m_NextQLock, read without lock by Send() for the fast path
+        // 3. m_CoalesceIndex maps key to index of task in m_NextSendQ, only filled when congested
+        //    protected by m_NextQLock, cleared when m_NextSendQ is swapped
+        std::atomic<size_t> m_SendQMsg;
+        std::atomic<size_t> m_SendQByte;
+        std::atomic<size_t> m_SendQPeakMsg;
+        std::atomic<size_t> m_SendQPeakByte;
+        std::atomic<bool>   m_SendQCongested;
+        std::atomic<bool>   m_SendQEvicted;
+
+        std::unordered_map<uint64_t, size_t> m_CoalesceIndex;
+
+    private:
+        // statistics of backpressure
+        std::atomic<uint64_t> m_CongestCount;
+        std::atomic<uint64_t> m_CoalesceCount;
+        std::atomic<uint64_t> m_DropCount;
 
     private:
         // used for internal pending message storage
@@ -216,6 +349,81 @@ class Session: public std::enable_shared_from_this<Session>
             return m_IP.c_str();
         }
 
+    public:
+        uint64_t SendOpCount() const
+        {
+            return m_SendOpCount.load(std::memory_order_relaxed);
+        }
+
+        uint64_t SendMsgCount() const
+        {
+            return m_SendMsgCount.load(std::memory_order_relaxed);
+        }
+
+        uint64_t SendByteCount() const
+        {
+            return m_SendByteCount.load(std::memory_order_relaxed);
+        }
+
+        uint64_t BundleMsgCount() const
+        {
+            return m_BundleMsgCount.load(std::memory_order_relaxed);
+        }
+
+        uint64_t ReadOpCount() const
+        {
+            return m_ReadOpCount.load(std::memory_order_relaxed);
+        }
+
+        uint64_t ReadMsgCount() const
+        {
+            return m_ReadMsgCount.load(std::memory_order_relaxed);
+        }
+
+    public:
+        size_t SendQMsg() const
+        {
+            return m_SendQMsg.load(std::memory_order_relaxed);
+        }
+
+        size_t SendQByte() const
+        {
+            return m_SendQByte.load(std::memory_order_relaxed);
+        }
+
+        size_t SendQPeakMsg() const
+        {
+            return m_SendQPeakMsg.load(std::memory_order_relaxed);
+        }
+
+        size_t SendQPeakByte() const
+        {
+            return m_SendQPeakByte.load(std::memory_order_relaxed);
+        }
+
+        uint64_t CongestCount() const
+        {
+            return m_CongestCount.load(std::memory_order_relaxed);
+        }
+
+        uint64_t CoalesceCount() const
+        {
+            return m_CoalesceCount.load(std::memory_order_relaxed);
+        }
+
+        uint64_t DropCount() const
+        {
+            return m_DropCount.load(std::memory_order_relaxed);
+        }
+
+    public:
+        // send queue depth of all sessions and backpressure statistics since the server starts
+        static size_t   TotalSendQMsg();
+        static size_t   TotalSendQByte();
+        static uint64_t TotalCoalesceCount();
+        static uint64_t TotalDropCount();
+        static uint64_t TotalEvictCount();
+
     public:
         // family of send facilities, called by server threads
         // Session class accepts buffer and make a copy as SendTask internally
@@ -276,20 +484,70 @@ class Session: public std::enable_shared_from_this<Session>
             return Send(nHC, (const uint8_t *)(&stMsgT), sizeof(stMsgT));
         }
 
+        // send an encoded message built by BuildSharedBuf()
+        // no copy and compression, the session only holds a reference of the buffer
+        bool Send(uint8_t, const SharedBuf &);
+
+    public:
+        // encode a message once for all sessions, the result is used by Send(HC, SharedBuf)
+        // empty buffer is valid for messages without body
+        // return false if the message is invalid
+        static bool BuildSharedBuf(uint8_t, const uint8_t *, size_t, SharedBuf *);
+
     private:
         // called by server threads
         // use internal memory pool to create the task
-        SendTask BuildTask(uint8_t, const uint8_t *, size_t, std::function<void()> &&);
+        SendTask BuildTask(uint8_t, const uint8_t *, size_t);
+
+        // release the buffer of a task which is sent or dropped
+        // the callback is not touched, caller takes it from m_DoneTable
+        void ReleaseTask(const SendTask &);
+
+        // encode message body after HC into the buffer returned by fnGetBuf(size)
+        // shared by BuildTask() and BuildSharedBuf(), caller releases the buffer if fails
+        template<typename F> static bool EncodeMessage(uint8_t, const uint8_t *, size_t, F &&, size_t *);
+
+    private:
+        // key of state message which is superseded by the next one of the same key
+        // i.e. SM_UPDATEHP of the same UID, return 0 if the message is not a state message
+        static uint64_t CoalesceKey(uint8_t, const uint8_t *, size_t);
+
+    private:
+        // following functions are called by server threads and caller should hold m_NextQLock
+        // push the task to m_NextSendQ and account it in the send queue depth
+        void PushTask(const SendTask &);
+
+        // replace the pending task of the same key by the new one, return true if replaced
+        // the new task is consumed then, otherwise it's untouched
+        bool CoalesceTask(SendTask &);
+
+        // update the congestion state by watermarks
+        // return false if the session should be evicted
+        bool CheckSendQ();
+
+    private:
+        // called by server threads
+        // shutdown a session whose client can't catch up, only the first call takes effect
+        void EvictSendQ();
+
+    private:
+        // move all messages in m_BundleBuf to m_NextSendQ as one task
+        // caller should hold m_NextQLock
+        void PackBundle();
+
+        // called in asio main loop thread
+        // pack the bundle and send it when timer expires
+        void DoBundleTimer();
 
     private:
         // interal functions isolated from server threads
         // following DoXXXFunc should only be invoked in asio main loop thread
-        void DoReadHC();
-        void DoReadBody(size_t, size_t);
+        void DoRead();
 
-        void DoSendHC();
-        void DoSendBuf();
-        void DoSendNext();
+        // send all pending messages in m_CurrSendQ by batches
+        // one batch is written by one async_write() with a scatter / gather buffer sequence
+        void DoSendQ();
+        void DoSendDone(size_t);
 
     private:
         // called by server threads
@@ -0,0 +1,59 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: sharedbuf.cpp
+ *        Created: 10/18/2026 12:21:40
+ *  Last Modified: 10/18/2026 12:21:40
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <new>
+#include <cstring>
+#include "memorypn.hpp"
+#include "sharedbuf.hpp"
+
+SharedBuf::SharedBuf(const uint8_t *pData, size_t nDataLen)
+    : m_Head(nullptr)
+{
+    if(pData && nDataLen){
+        extern MemoryPN *g_MemoryPN;
+        auto nMemSize = sizeof(SharedBufHead) + nDataLen;
+        auto pMem     = g_MemoryPN ? (uint8_t *)(g_MemoryPN->Get(nMemSize)) : new uint8_t[nMemSize];
+
+        m_Head = new (pMem) SharedBufHead();
+        m_Head->RefCount.store(1, std::memory_order_relaxed);
+        m_Head->DataLen = nDataLen;
+        m_Head->Pooled  = (g_MemoryPN != nullptr);
+
+        std::memcpy((uint8_t *)(m_Head + 1), pData, nDataLen);
+    }
+}
+
+void SharedBuf::Release()
+{
+    if(m_Head){
+        if(m_Head->RefCount.fetch_sub(1, std::memory_order_acq_rel) == 1){
+            auto bPooled = m_Head->Pooled;
+            m_Head->~SharedBufHead();
+
+            if(bPooled){
+                extern MemoryPN *g_MemoryPN;
+                g_MemoryPN->Free(m_Head);
+            }else{
+                delete [] (uint8_t *)(m_Head);
+            }
+        }
+        m_Head = nullptr;
+    }
+}
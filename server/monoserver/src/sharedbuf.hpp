@@ -0,0 +1,124 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: sharedbuf.hpp
+ *        Created: 10/18/2026 12:05:19
+ *  Last Modified: 10/18/2026 12:05:19
+ *
+ *    Description: immutable buffer with intrusive reference count
+ *
+ *                 memory is allocated from g_MemoryPN as
+ *
+ *                      +-------------+---------------------+
+ *                      | SharedBufHead | data ...          |
+ *                      +-------------+---------------------+
+ *
+ *                 then one allocation for both the count and the data, copy of the
+ *                 buffer only increases the count, never allocate or memcpy the body
+ *
+ *                 content can't be changed after creation, so it's safe to share it
+ *                 between actor threads without lock
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+class SharedBuf final
+{
+    private:
+        struct SharedBufHead
+        {
+            std::atomic<int> RefCount;
+            size_t           DataLen;
+
+            // allocated from g_MemoryPN or by new []
+            // when g_MemoryPN is not created yet
+            bool Pooled;
+        };
+
+    private:
+        SharedBufHead *m_Head;
+
+    public:
+        SharedBuf()
+            : m_Head(nullptr)
+        {}
+
+        SharedBuf(const uint8_t *, size_t);
+
+        SharedBuf(const SharedBuf &rstBuf)
+            : m_Head(rstBuf.m_Head)
+        {
+            if(m_Head){
+                m_Head->RefCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        SharedBuf(SharedBuf &&rstBuf)
+            : m_Head(rstBuf.m_Head)
+        {
+            rstBuf.m_Head = nullptr;
+        }
+
+    public:
+       ~SharedBuf()
+        {
+            Release();
+        }
+
+    public:
+        SharedBuf &operator = (SharedBuf stBuf)
+        {
+            std::swap(m_Head, stBuf.m_Head);
+            return *this;
+        }
+
+    public:
+        const uint8_t *Data() const
+        {
+            return m_Head ? (const uint8_t *)(m_Head + 1) : nullptr;
+        }
+
+        size_t DataLen() const
+        {
+            return m_Head ? m_Head->DataLen : 0;
+        }
+
+        int RefCount() const
+        {
+            return m_Head ? m_Head->RefCount.load(std::memory_order_relaxed) : 0;
+        }
+
+    public:
+        // give the reference to a raw handle and make this buffer empty
+        // for trivial records which can't hold a SharedBuf, i.e. Session::SendTask
+        // the handle should be released by ReleaseHandle() exactly once
+        const void *Detach()
+        {
+            auto pHead = m_Head;
+            m_Head = nullptr;
+            return pHead;
+        }
+
+        static void ReleaseHandle(const void *pHandle)
+        {
+            SharedBuf stBuf;
+            stBuf.m_Head = (SharedBufHead *)(const_cast<void *>(pHandle));
+        }
+
+    private:
+        void Release();
+};
@@ -25,11 +25,13 @@
 UIDRecord::UIDRecord(uint32_t nUID,
         const InvarData &rstDesp,
         const Theron::Address &rstAddress,
-        const std::vector<ServerObject::ClassCodeName> &rstClassEntry)
+        const std::vector<ServerObject::ClassCodeName> &rstClassEntry,
+        uint32_t nClassMask)
     : UID(nUID)
     , Desp(rstDesp)
     , Address(rstAddress)
     , ClassEntry(rstClassEntry)
+    , ClassMask(nClassMask)
 {
     if(false
             || UID == 0
@@ -43,6 +45,7 @@ void UIDRecord::Print() const
 {
     extern MonoServer *g_MonoServer;
     g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::UID                  = %" PRIu32, UID);
+    g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::ClassMask            = 0X%08" PRIX32, ClassMask);
     for(size_t nIndex= 0; nIndex < ClassEntry.size(); ++nIndex){
         g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::ClassEntry[%d]::Code = %llu", (int)(nIndex), (unsigned long long)(ClassEntry[nIndex].Code));
         g_MonoServer->AddLog(LOGTYPE_INFO, "UIDRecord::ClassEntry[%d]::Name = %s",   (int)(nIndex), ClassEntry[nIndex].Name.c_str());
@@ -22,8 +22,10 @@
 #pragma once
 #include <vector>
 #include <cstdint>
+#include <type_traits>
 #include <Theron/Address.h>
 
+#include "classtag.hpp"
 #include "invardata.hpp"
 #include "serverobject.hpp"
 
@@ -35,10 +37,15 @@ struct UIDRecord
     Theron::Address Address;
     const std::vector<ServerObject::ClassCodeName> &ClassEntry;
 
+    // class tag mask to check type in ClassFrom<T>()
+    // copied from ServerObject::ClassMask(), check classtag.hpp
+    uint32_t ClassMask;
+
     UIDRecord(uint32_t,
             const InvarData &,
             const Theron::Address &,
-            const std::vector<ServerObject::ClassCodeName> &);
+            const std::vector<ServerObject::ClassCodeName> &,
+            uint32_t);
 
     bool Valid() const
     {
@@ -52,15 +59,8 @@ struct UIDRecord
 
     void Print() const;
 
-    template<typename T> bool ClassFrom()
+    template<typename T> bool ClassFrom() const
     {
-        if(Valid()){
-            for(const auto &rstCodeName: ClassEntry){
-                if(true
-                        && rstCodeName.Name == typeid(T).name()
-                        && rstCodeName.Code == typeid(T).hash_code()){ return true; }
-            }
-        }
-        return false;
+        return Valid() && ((ClassMask & ClassTag<typename std::remove_cv<T>::type>::Tag) == ClassTag<typename std::remove_cv<T>::type>::Tag);
     }
 };
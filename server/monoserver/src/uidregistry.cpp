@@ -0,0 +1,121 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: uidregistry.cpp
+ *        Created: 10/18/2026 10:40:11
+ *  Last Modified: 10/18/2026 10:40:11
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <thread>
+#include "uidregistry.hpp"
+
+UIDRegistry::UIDRegistry()
+    : m_WriteLock()
+    , m_Epoch(0)
+    , m_ReaderSlotV()
+{
+    for(auto &rstSegment: m_SegmentV){
+        rstSegment.store(nullptr);
+    }
+}
+
+UIDRegistry::~UIDRegistry()
+{
+    for(auto &rstSegment: m_SegmentV){
+        delete rstSegment.load();
+    }
+}
+
+UIDRegistry::ReaderSlot *UIDRegistry::CurrReaderSlot()
+{
+    // assign slot to threads in round-robin
+    // threads sharing one slot is OK since it's a counter
+    static std::atomic<uint32_t> s_SlotCount(0);
+    thread_local uint32_t t_SlotIndex = s_SlotCount.fetch_add(1) % READER_SLOTS;
+
+    return &(m_ReaderSlotV[t_SlotIndex]);
+}
+
+bool UIDRegistry::Link(uint32_t nUID, const ServerObject *pObject)
+{
+    if(nUID && pObject){
+        std::lock_guard<std::mutex> stLockGuard(m_WriteLock);
+
+        auto &rstSegment = m_SegmentV[nUID >> SEGMENT_BITS];
+        if(!rstSegment.load()){
+            auto pSegment = new Segment();
+            pSegment->Count = 0;
+            for(auto &rstSlot: pSegment->SlotV){
+                rstSlot.store(nullptr);
+            }
+            rstSegment.store(pSegment);
+        }
+
+        auto pSegment = rstSegment.load();
+        auto &rstSlot = pSegment->SlotV[nUID & ((1 << SEGMENT_BITS) - 1)];
+        if(!rstSlot.load()){
+            rstSlot.store(pObject);
+            pSegment->Count++;
+            return true;
+        }
+    }
+    return false;
+}
+
+const ServerObject *UIDRegistry::Unlink(uint32_t nUID)
+{
+    if(!nUID){
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> stLockGuard(m_WriteLock);
+
+    auto &rstSegment = m_SegmentV[nUID >> SEGMENT_BITS];
+    auto  pSegment   = rstSegment.load();
+    if(!pSegment){
+        return nullptr;
+    }
+
+    auto pObject = pSegment->SlotV[nUID & ((1 << SEGMENT_BITS) - 1)].exchange(nullptr);
+    if(!pObject){
+        return nullptr;
+    }
+
+    // UID is allocated monotonically, a segment gets empty when all its objects are gone
+    // detach it before the grace period, then nobody can hold it afterwards
+    if(--(pSegment->Count)){
+        pSegment = nullptr;
+    }else{
+        rstSegment.store(nullptr);
+    }
+
+    // new readers always see the slot / segment as removed
+    Synchronize();
+
+    delete pSegment;
+    return pObject;
+}
+
+void UIDRegistry::Synchronize()
+{
+    // readers registered in the old epoch must leave
+    // readers registered in the new epoch entered after the flip, they can't see removed records
+    auto nOldParity = m_Epoch.fetch_add(1) & 1;
+    for(auto &rstReaderSlot: m_ReaderSlotV){
+        while(rstReaderSlot.Count[nOldParity].load()){
+            std::this_thread::yield();
+        }
+    }
+}
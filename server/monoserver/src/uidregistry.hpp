@@ -0,0 +1,161 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: uidregistry.hpp
+ *        Created: 10/18/2026 10:12:35
+ *  Last Modified: 10/18/2026 10:12:35
+ *
+ *    Description: read-mostly UID -> ServerObject * table
+ *
+ *                 UID is allocated monotonically from 1 by MonoServer::GetUID(), so we
+ *                 use it as an array index directly, table is split into segments,
+ *                 segments are allocated on demand and released when they get empty
+ *
+ *                 reading is wait-free, writer takes a mutex:
+ *
+ *                      {
+ *                          UIDRegistry::ReadGuard stGuard(&stRegistry);
+ *                          if(auto pObject = stRegistry.Get(nUID)){
+ *                              // pObject is valid inside this scope
+ *                          }
+ *                      }
+ *
+ *                 reader increases a counter slot of the current epoch parity, then checks
+ *                 the epoch again and retries if it changed, Unlink() removes the pointer
+ *                 from the table, flips the epoch and waits all readers entered in the old
+ *                 epoch to leave, after that nobody can hold the pointer and it's safe to
+ *                 delete the object, or the segment if it's detached as well
+ *
+ *                 so never call Unlink() inside a ReadGuard scope
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+class ServerObject;
+class UIDRegistry final
+{
+    private:
+        // 2^16 segments with 2^16 slots in each
+        // covers the whole uint32_t UID space
+        constexpr static int SEGMENT_BITS = 16;
+        constexpr static int READER_SLOTS = 64;
+
+    private:
+        struct Segment
+        {
+            // linked slots, guarded by m_WriteLock
+            uint32_t Count;
+            std::array<std::atomic<const ServerObject *>, (1 << SEGMENT_BITS)> SlotV;
+        };
+
+    private:
+        // reader counter slot
+        // a thread always uses the same slot, but a slot can be shared by threads
+        // put each slot into its own cache line to avoid false sharing
+        struct alignas(64) ReaderSlot
+        {
+            std::atomic<uint32_t> Count[2];
+
+            ReaderSlot()
+            {
+                Count[0].store(0);
+                Count[1].store(0);
+            }
+        };
+
+    public:
+        class ReadGuard final
+        {
+            private:
+                ReaderSlot *m_Slot;
+                uint32_t    m_Parity;
+
+            public:
+                explicit ReadGuard(UIDRegistry *pRegistry)
+                    : m_Slot(pRegistry->CurrReaderSlot())
+                    , m_Parity(0)
+                {
+                    // a reader may be preempted between loading the epoch and increasing the
+                    // counter, then the epoch can be flipped before it gets registered and the
+                    // writer won't wait for it, so check the epoch again and retry if changed
+                    while(true){
+                        auto nEpoch = pRegistry->m_Epoch.load();
+                        m_Parity = nEpoch & 1;
+
+                        m_Slot->Count[m_Parity].fetch_add(1);
+                        if(pRegistry->m_Epoch.load() == nEpoch){
+                            break;
+                        }
+                        m_Slot->Count[m_Parity].fetch_sub(1);
+                    }
+                }
+
+               ~ReadGuard()
+                {
+                    m_Slot->Count[m_Parity].fetch_sub(1);
+                }
+
+            public:
+                ReadGuard(const ReadGuard &) = delete;
+                ReadGuard &operator = (const ReadGuard &) = delete;
+        };
+
+    private:
+        std::mutex m_WriteLock;
+
+    private:
+        std::atomic<uint32_t> m_Epoch;
+        std::array<ReaderSlot, READER_SLOTS> m_ReaderSlotV;
+
+    private:
+        std::atomic<Segment *> m_SegmentV[1 << (32 - SEGMENT_BITS)];
+
+    public:
+        UIDRegistry();
+       ~UIDRegistry();
+
+    public:
+        UIDRegistry(const UIDRegistry &) = delete;
+        UIDRegistry &operator = (const UIDRegistry &) = delete;
+
+    public:
+        // should be called inside a ReadGuard scope
+        // returned pointer is valid till the scope ends
+        const ServerObject *Get(uint32_t nUID) const
+        {
+            if(auto pSegment = m_SegmentV[nUID >> SEGMENT_BITS].load()){
+                return pSegment->SlotV[nUID & ((1 << SEGMENT_BITS) - 1)].load();
+            }
+            return nullptr;
+        }
+
+    public:
+        // return false if UID is zero or already linked
+        bool Link(uint32_t, const ServerObject *);
+
+        // remove the record and wait all current readers done
+        // return the unlinked object, caller can delete it safely
+        const ServerObject *Unlink(uint32_t);
+
+    private:
+        ReaderSlot *CurrReaderSlot();
+
+    private:
+        // flip the epoch and wait all readers entered before it to leave
+        // should be called with m_WriteLock held
+        void Synchronize();
+};
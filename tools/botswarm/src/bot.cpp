@@ -0,0 +1,562 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: bot.cpp
+ *        Created: 10/18/2026 20:05:12
+ *  Last Modified: 10/18/2026 20:05:12
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <algorithm>
+#include <type_traits>
+
+#include "bot.hpp"
+#include "log.hpp"
+#include "message.hpp"
+#include "sysconst.hpp"
+#include "mathfunc.hpp"
+#include "netbundle.hpp"
+#include "protocoldef.hpp"
+
+Bot::Bot(const BotConfig &rstConfig, const std::string &szID, BotStat *pStat)
+    : m_Config(rstConfig)
+    , m_ID(szID)
+    , m_NetIO()
+    , m_State(BOTSTATE_NONE)
+    , m_StateTick(0)
+    , m_UID(0)
+    , m_MapID(0)
+    , m_X(-1)
+    , m_Y(-1)
+    , m_Direction(DIR_DOWN)
+    , m_Map(nullptr)
+    , m_Now(0)
+    , m_NextAction(0)
+    , m_NextPing(0)
+    , m_PingList()
+    , m_Path()
+    , m_COList()
+    , m_ItemList()
+    , m_BundleBuf()
+    , m_Stat(pStat)
+{}
+
+bool Bot::Launch(uint64_t nNow)
+{
+    m_State     = BOTSTATE_CONNECT;
+    m_StateTick = nNow;
+
+    return m_NetIO.InitIO(m_Config.IP.c_str(), m_Config.Port.c_str(), [this](uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+    {
+        OnServerMessage(nHC, pData, nDataLen);
+    });
+}
+
+void Bot::Update(uint64_t nNow)
+{
+    // messages are handled inside PollIO()
+    // they need current time to get the round trip time
+    m_Now = nNow;
+    m_NetIO.PollIO();
+
+    auto fnFail = [this, nNow](const char *szReason)
+    {
+        extern Log *g_Log;
+        g_Log->AddLog(LOGTYPE_WARNING, "Bot %s stops: %s", m_ID.c_str(), szReason);
+
+        m_NetIO.StopIO();
+        m_NetIO.PollIO();
+
+        m_State     = BOTSTATE_DONE;
+        m_StateTick = nNow;
+    };
+
+    switch(m_State){
+        case BOTSTATE_CONNECT:
+            {
+                if(m_NetIO.Connected()){
+                    CMLogin stCML;
+                    std::memset(&stCML, 0, sizeof(stCML));
+                    std::strncpy(stCML.ID, m_ID.c_str(), sizeof(stCML.ID) - 1);
+                    std::strncpy(stCML.Password, m_Config.Password.c_str(), sizeof(stCML.Password) - 1);
+
+                    Send(CM_LOGIN, stCML);
+                    m_State     = BOTSTATE_LOGIN;
+                    m_StateTick = nNow;
+                }else if(nNow - m_StateTick > (uint64_t)(m_Config.ConnectTime) * 1000){
+                    fnFail("connect timeout");
+                }
+                return;
+            }
+        case BOTSTATE_LOGIN:
+            {
+                // SM_LOGINOK switches state to BOTSTATE_RUN
+                if(!m_NetIO.Connected()){
+                    fnFail("disconnected before login");
+                }else if(nNow - m_StateTick > (uint64_t)(m_Config.ConnectTime) * 1000){
+                    fnFail("login timeout");
+                }
+                return;
+            }
+        case BOTSTATE_RUN:
+            {
+                if(!m_NetIO.Connected()){
+                    fnFail("disconnected");
+                    return;
+                }
+
+                // tick is only used by the bot itself
+                // lower 32 bits of us is enough for round trip in ~70 minutes
+                if(nNow >= m_NextPing){
+                    CMPing stCMP;
+                    stCMP.Tick = (uint32_t)(nNow);
+
+                    Send(CM_PING, stCMP);
+                    m_PingList.push_back(stCMP.Tick);
+
+                    // server may drop messages under congestion, don't keep lost pings forever
+                    if(m_PingList.size() > 64){
+                        m_PingList.pop_front();
+                    }
+                    m_NextPing = nNow + (uint64_t)(m_Config.PingTime) * 1000;
+                }
+
+                if(nNow >= m_NextAction){
+                    DoAction();
+                    m_NextAction = nNow + (uint64_t)(m_Config.StepTime) * 1000;
+                }
+                return;
+            }
+        default:
+            {
+                return;
+            }
+    }
+}
+
+void Bot::OnServerMessage(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+{
+    if(nHC != SM_BUNDLE){
+        m_Stat->RecvCount++;
+    }
+
+    switch(nHC){
+        case SM_BUNDLE:
+            {
+                // same as Game::OnServerMessage()
+                // messages inside never contain another bundle
+                auto nCount = NetBundle::Unpack<SMSGParam>(pData, nDataLen, &m_BundleBuf, [this](uint8_t nBundleHC, const uint8_t *pBundleData, size_t nBundleDataLen)
+                {
+                    OnServerMessage(nBundleHC, pBundleData, nBundleDataLen);
+                });
+
+                if(nCount < 0){
+                    extern Log *g_Log;
+                    g_Log->AddLog(LOGTYPE_WARNING, "Bot %s gets corrupted bundle", m_ID.c_str());
+                }
+                break;
+            }
+        case SM_PING            : Net_PING            (pData, nDataLen); break;
+        case SM_LOGINOK         : Net_LOGINOK         (pData, nDataLen); break;
+        case SM_ACTION          : Net_ACTION          (pData, nDataLen); break;
+        case SM_CORECORD        : Net_CORECORD        (pData, nDataLen); break;
+        case SM_SHOWDROPITEM    : Net_SHOWDROPITEM    (pData, nDataLen); break;
+        case SM_REMOVEGROUNDITEM: Net_REMOVEGROUNDITEM(pData, nDataLen); break;
+        case SM_LOGINFAIL:
+            {
+                extern Log *g_Log;
+                g_Log->AddLog(LOGTYPE_WARNING, "Bot %s login failed", m_ID.c_str());
+
+                m_NetIO.StopIO();
+                m_State = BOTSTATE_DONE;
+                break;
+            }
+        case SM_PICKUPOK:
+            {
+                m_Stat->PickUpOKCount++;
+                break;
+            }
+        case SM_DEADFADEOUT:
+            {
+                SMDeadFadeOut stSMDFO;
+                std::memcpy(&stSMDFO, pData, sizeof(stSMDFO));
+                m_COList.erase(stSMDFO.UID);
+                break;
+            }
+        case SM_OFFLINE:
+            {
+                SMOffline stSMO;
+                std::memcpy(&stSMO, pData, sizeof(stSMO));
+                m_COList.erase(stSMO.UID);
+                break;
+            }
+        default:
+            {
+                break;
+            }
+    }
+}
+
+void Bot::Net_PING(const uint8_t *pBuf, size_t)
+{
+    SMPing stSMP;
+    std::memcpy(&stSMP, pBuf, sizeof(stSMP));
+
+    // unsolicited ping from the server metronome carries the server tick, skip it
+    auto pPing = std::find(m_PingList.begin(), m_PingList.end(), stSMP.Tick);
+    if(pPing == m_PingList.end()){
+        return;
+    }
+
+    // echoes come in sending order, earlier ones without echo are lost
+    m_PingList.erase(m_PingList.begin(), pPing + 1);
+
+    // unsigned subtraction handles wrap-around of the tick
+    m_Stat->RTTList.push_back((uint32_t)(m_Now) - stSMP.Tick);
+}
+
+void Bot::Net_LOGINOK(const uint8_t *pBuf, size_t nLen)
+{
+    if(!(pBuf && (nLen == sizeof(SMLoginOK)))){
+        return;
+    }
+
+    SMLoginOK stSMLOK;
+    std::memcpy(&stSMLOK, pBuf, nLen);
+
+    m_UID       = stSMLOK.UID;
+    m_MapID     = stSMLOK.MapID;
+    m_X         = stSMLOK.X;
+    m_Y         = stSMLOK.Y;
+    m_Direction = stSMLOK.Direction;
+    m_Map       = m_Config.RetrieveMap(m_MapID);
+
+    if(!m_Map){
+        extern Log *g_Log;
+        g_Log->AddLog(LOGTYPE_WARNING, "Bot %s can't load map: %" PRIu32, m_ID.c_str(), m_MapID);
+
+        m_NetIO.StopIO();
+        m_State = BOTSTATE_DONE;
+        return;
+    }
+
+    m_State = BOTSTATE_RUN;
+}
+
+void Bot::Net_ACTION(const uint8_t *pBuf, size_t)
+{
+    SMAction stSMA;
+    std::memcpy(&stSMA, pBuf, sizeof(stSMA));
+
+    if(stSMA.UID == m_UID){
+        // server only reports my action when it refuses my move or when I'm moved by it
+        // then my location is not what I thought, drop the path and start from there
+        if(stSMA.MapID != m_MapID){
+            m_MapID = stSMA.MapID;
+            m_Map   = m_Config.RetrieveMap(m_MapID);
+
+            m_COList.clear();
+            m_ItemList.clear();
+        }
+
+        m_X = stSMA.X;
+        m_Y = stSMA.Y;
+        m_Path.clear();
+        m_Stat->ResyncCount++;
+        return;
+    }
+
+    if(stSMA.MapID != m_MapID){
+        m_COList.erase(stSMA.UID);
+        return;
+    }
+
+    // for ACTION_MOVE the creature ends at (AimX, AimY)
+    int nX = (stSMA.Action == ACTION_MOVE) ? stSMA.AimX : stSMA.X;
+    int nY = (stSMA.Action == ACTION_MOVE) ? stSMA.AimY : stSMA.Y;
+
+    auto pRecord = m_COList.find(stSMA.UID);
+    if(pRecord == m_COList.end()){
+        // don't know what it is yet, ask the server
+        // CREATURE_NONE before SM_CORECORD comes, never attacked
+        m_COList[stSMA.UID] = {CREATURE_NONE, nX, nY};
+
+        CMQueryCORecord stCMQCOR;
+        std::memset(&stCMQCOR, 0, sizeof(stCMQCOR));
+
+        stCMQCOR.UID   = stSMA.UID;
+        stCMQCOR.MapID = stSMA.MapID;
+        stCMQCOR.X     = stSMA.X;
+        stCMQCOR.Y     = stSMA.Y;
+        Send(CM_QUERYCORECORD, stCMQCOR);
+    }else if(stSMA.Action == ACTION_DIE){
+        m_COList.erase(pRecord);
+    }else{
+        pRecord->second.X = nX;
+        pRecord->second.Y = nY;
+    }
+}
+
+void Bot::Net_CORECORD(const uint8_t *pBuf, size_t)
+{
+    SMCORecord stSMCOR;
+    std::memcpy(&stSMCOR, pBuf, sizeof(stSMCOR));
+
+    if(true
+            && stSMCOR.Common.UID != m_UID
+            && stSMCOR.Common.MapID == m_MapID){
+        m_COList[stSMCOR.Common.UID] = {stSMCOR.Type, stSMCOR.Common.X, stSMCOR.Common.Y};
+    }
+}
+
+void Bot::Net_SHOWDROPITEM(const uint8_t *pBuf, size_t)
+{
+    SMShowDropItem stSMSDI;
+    std::memcpy(&stSMSDI, pBuf, sizeof(stSMSDI));
+
+    for(size_t nIndex = 0; nIndex < std::extent<decltype(stSMSDI.IDList)>::value; ++nIndex){
+        if(stSMSDI.IDList[nIndex]){
+            m_ItemList.push_back({stSMSDI.IDList[nIndex], stSMSDI.X, stSMSDI.Y});
+        }else{
+            break;
+        }
+    }
+}
+
+void Bot::Net_REMOVEGROUNDITEM(const uint8_t *pBuf, size_t)
+{
+    SMRemoveGroundItem stSMRGI;
+    std::memcpy(&stSMRGI, pBuf, sizeof(stSMRGI));
+
+    m_ItemList.erase(std::remove_if(m_ItemList.begin(), m_ItemList.end(), [&stSMRGI](const ItemInfo &rstItem) -> bool
+    {
+        return true
+            && rstItem.ItemID == stSMRGI.ItemID
+            && rstItem.X == stSMRGI.X
+            && rstItem.Y == stSMRGI.Y;
+    }), m_ItemList.end());
+}
+
+void Bot::DoAction()
+{
+    if(DoPickUp()){ return; }
+    if(DoAttack()){ return; }
+    if(DoWander()){ return; }
+}
+
+bool Bot::DoPickUp()
+{
+    // only go for items not too far away
+    // others are left for bots around
+    int nBest = -1;
+    int nBestD2 = 20 * 20 * 2 + 1;
+    for(int nIndex = 0; nIndex < (int)(m_ItemList.size()); ++nIndex){
+        auto nD2 = LDistance2(m_X, m_Y, m_ItemList[nIndex].X, m_ItemList[nIndex].Y);
+        if(nD2 < nBestD2){
+            nBest   = nIndex;
+            nBestD2 = nD2;
+        }
+    }
+
+    if(nBest < 0){
+        return false;
+    }
+
+    auto stItem = m_ItemList[nBest];
+    if(nBestD2 == 0){
+        CMPickUp stCMPU;
+        std::memset(&stCMPU, 0, sizeof(stCMPU));
+
+        stCMPU.X      = stItem.X;
+        stCMPU.Y      = stItem.Y;
+        stCMPU.UID    = m_UID;
+        stCMPU.MapID  = m_MapID;
+        stCMPU.ItemID = stItem.ItemID;
+
+        Send(CM_PICKUP, stCMPU);
+        m_Stat->PickUpCount++;
+
+        // won't try it again even it fails
+        // SM_REMOVEGROUNDITEM may never come if other bot picked it first
+        m_ItemList.erase(m_ItemList.begin() + nBest);
+        return true;
+    }
+
+    if(MoveTo(stItem.X, stItem.Y)){
+        return true;
+    }
+
+    m_ItemList.erase(m_ItemList.begin() + nBest);
+    return false;
+}
+
+bool Bot::DoAttack()
+{
+    uint32_t nBestUID = 0;
+    int nBestD2 = 10 * 10 * 2 + 1;
+    for(auto &rstRecord: m_COList){
+        if(rstRecord.second.Type == CREATURE_MONSTER){
+            auto nD2 = LDistance2(m_X, m_Y, rstRecord.second.X, rstRecord.second.Y);
+            if(nD2 < nBestD2){
+                nBestUID = rstRecord.first;
+                nBestD2  = nD2;
+            }
+        }
+    }
+
+    if(!nBestUID){
+        return false;
+    }
+
+    auto &rstMonster = m_COList[nBestUID];
+    switch(nBestD2){
+        case 1:
+        case 2:
+            {
+                m_Direction = PathFind::GetDirection(m_X, m_Y, rstMonster.X, rstMonster.Y);
+                SendAction(ActionAttack(m_X, m_Y, DC_PHY_PLAIN, SYS_DEFSPEED, nBestUID));
+
+                m_Stat->AttackCount++;
+                return true;
+            }
+        default:
+            {
+                // monster moves, path to it is always outdated
+                // search again for every step, it's short
+                m_Path.clear();
+                return MoveTo(rstMonster.X, rstMonster.Y);
+            }
+    }
+}
+
+bool Bot::DoWander()
+{
+    if(m_Path.size() > 1){
+        return MoveTo(m_Path.back().X, m_Path.back().Y);
+    }
+
+    for(int nTry = 0; nTry < 8; ++nTry){
+        int nX = m_X + std::rand() % 33 - 16;
+        int nY = m_Y + std::rand() % 33 - 16;
+
+        if(true
+                && (nX != m_X || nY != m_Y)
+                && CanMove(nX, nY)
+                && MoveTo(nX, nY)){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Bot::CanMove(int nX, int nY) const
+{
+    return true
+        && m_Map
+        && m_Map->Valid()
+        && m_Map->ValidC(nX, nY)
+        && m_Map->Cell(nX, nY).CanThrough();
+}
+
+bool Bot::FindPath(int nX, int nY)
+{
+    m_Path.clear();
+
+    // limit the search inside the bounding box with margin
+    // otherwise an unreachable target makes A* flood the whole map
+    int nMinX = std::min<int>(m_X, nX) - 16;
+    int nMinY = std::min<int>(m_Y, nY) - 16;
+    int nMaxX = std::max<int>(m_X, nX) + 16;
+    int nMaxY = std::max<int>(m_Y, nY) + 16;
+
+    // no creature checked, server refuses the move if the grid is occupied
+    // then cost is uniform and JPS is used, path is in single steps
+    //
+    // search in the coordinates of the box, pooled nodes only take the box size
+    // all bots are polled in one thread, share one finder
+    thread_local GridPathFinder t_PathFinder;
+
+    auto nSearchResult = t_PathFinder.Search(nMaxX - nMinX + 1, nMaxY - nMinY + 1, m_X - nMinX, m_Y - nMinY, nX - nMinX, nY - nMinY, 1, false, 0, [this, nMinX, nMinY](int nBoxX, int nBoxY) -> uint8_t
+    {
+        return CanMove(nBoxX + nMinX, nBoxY + nMinY) ? GridPathFinder::CELL_FREE : GridPathFinder::CELL_BLOCK;
+    });
+
+    if(nSearchResult == GridPathFinder::SEARCH_SUCCEEDED){
+        for(auto &rstNode: t_PathFinder.Path()){
+            m_Path.emplace_back(rstNode.X + nMinX, rstNode.Y + nMinY);
+        }
+        return m_Path.size() > 1;
+    }
+    return false;
+}
+
+bool Bot::MoveTo(int nX, int nY)
+{
+    // m_Path[0] is always current location
+    if(false
+            || m_Path.size() < 2
+            || m_Path.front().X != m_X
+            || m_Path.front().Y != m_Y
+            || m_Path.back().X != nX
+            || m_Path.back().Y != nY){
+
+        if(!FindPath(nX, nY)){
+            return false;
+        }
+    }
+
+    auto stNext = m_Path[1];
+    m_Path.erase(m_Path.begin());
+
+    // only one grid per step
+    // and the target grid of attack is occupied by the monster
+    if(!CanMove(stNext.X, stNext.Y)){
+        m_Path.clear();
+        return false;
+    }
+
+    SendAction(ActionMove(m_X, m_Y, stNext.X, stNext.Y, SYS_DEFSPEED, 0));
+    m_Stat->MoveCount++;
+
+    m_Direction = PathFind::GetDirection(m_X, m_Y, stNext.X, stNext.Y);
+    m_X = stNext.X;
+    m_Y = stNext.Y;
+    return true;
+}
+
+void Bot::SendAction(const ActionNode &rstAction)
+{
+    CMAction stCMA;
+    std::memset(&stCMA, 0, sizeof(stCMA));
+
+    stCMA.UID   = m_UID;
+    stCMA.MapID = m_MapID;
+
+    stCMA.Action    = rstAction.Action;
+    stCMA.Speed     = rstAction.Speed;
+    stCMA.Direction = (rstAction.Direction > DIR_NONE && rstAction.Direction < DIR_MAX) ? rstAction.Direction : m_Direction;
+
+    stCMA.X    = rstAction.X;
+    stCMA.Y    = rstAction.Y;
+    stCMA.AimX = rstAction.AimX;
+    stCMA.AimY = rstAction.AimY;
+
+    stCMA.AimUID      = rstAction.AimUID;
+    stCMA.ActionParam = rstAction.ActionParam;
+
+    Send(CM_ACTION, stCMA);
+}
@@ -0,0 +1,211 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: bot.hpp
+ *        Created: 10/18/2026 20:05:12
+ *  Last Modified: 10/18/2026 20:05:12
+ *
+ *    Description: headless client for load test
+ *
+ *                 bot logs in with its own account and keeps doing:
+ *
+ *                      1. pick up the nearest drop item it has seen
+ *                      2. attack monster next to it
+ *                      3. walk to monster nearby, or to a random grid
+ *
+ *                 one action per step time, the server only accepts one-hop movement
+ *                 so path is searched by GridPathFinder and sent hop by hop
+ *
+ *                 bot sends CM_PING periodically, server echoes the tick by SM_PING
+ *                 then round trip time includes the actor dispatch and the send queue
+ *
+ *                 server also sends SM_PING with its own tick on every metronome, only
+ *                 replies matching an outstanding CM_PING tick are counted
+ *
+ *                 no thread inside, caller polls all bots in one thread
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include "netio.hpp"
+#include "gridpathfinder.hpp"
+#include "actionnode.hpp"
+#include "mir2xmapdata.hpp"
+
+struct BotConfig
+{
+    std::string IP;
+    std::string Port;
+    std::string Password;
+
+    int StepTime;       // ms between two actions
+    int PingTime;       // ms between two pings
+    int ConnectTime;    // ms to wait for connection and login
+
+    // map data shared by all bots
+    // return nullptr if the map can't be loaded
+    std::function<const Mir2xMapData *(uint32_t)> RetrieveMap;
+};
+
+struct BotStat
+{
+    uint64_t SendCount;
+    uint64_t RecvCount;
+
+    uint64_t MoveCount;
+    uint64_t AttackCount;
+    uint64_t PickUpCount;
+    uint64_t PickUpOKCount;
+    uint64_t ResyncCount;
+
+    // round trip time of CM_PING -> SM_PING, in us
+    std::vector<uint32_t> RTTList;
+
+    BotStat()
+        : SendCount(0)
+        , RecvCount(0)
+        , MoveCount(0)
+        , AttackCount(0)
+        , PickUpCount(0)
+        , PickUpOKCount(0)
+        , ResyncCount(0)
+        , RTTList()
+    {}
+};
+
+class Bot final
+{
+    public:
+        enum: int
+        {
+            BOTSTATE_NONE = 0,
+            BOTSTATE_CONNECT,
+            BOTSTATE_LOGIN,
+            BOTSTATE_RUN,
+            BOTSTATE_DONE,
+        };
+
+    private:
+        struct COInfo
+        {
+            int Type;
+            int X;
+            int Y;
+        };
+
+        struct ItemInfo
+        {
+            uint32_t ItemID;
+            int X;
+            int Y;
+        };
+
+    private:
+        const BotConfig &m_Config;
+        const std::string m_ID;
+
+    private:
+        NetIO m_NetIO;
+
+    private:
+        int      m_State;
+        uint64_t m_StateTick;
+
+    private:
+        uint32_t m_UID;
+        uint32_t m_MapID;
+        int      m_X;
+        int      m_Y;
+        int      m_Direction;
+
+    private:
+        const Mir2xMapData *m_Map;
+
+    private:
+        uint64_t m_Now;
+        uint64_t m_NextAction;
+        uint64_t m_NextPing;
+
+    private:
+        // ticks of CM_PING sent but not echoed yet, in sending order
+        std::deque<uint32_t> m_PingList;
+
+    private:
+        std::vector<PathFind::PathNode> m_Path;
+
+    private:
+        std::unordered_map<uint32_t, COInfo> m_COList;
+        std::vector<ItemInfo> m_ItemList;
+
+    private:
+        std::vector<uint8_t> m_BundleBuf;
+
+    private:
+        BotStat *m_Stat;
+
+    public:
+        Bot(const BotConfig &, const std::string &, BotStat *);
+
+    public:
+        bool Launch(uint64_t);
+        void Update(uint64_t);
+
+    public:
+        int State() const
+        {
+            return m_State;
+        }
+
+        const std::string &ID() const
+        {
+            return m_ID;
+        }
+
+    private:
+        void OnServerMessage(uint8_t, const uint8_t *, size_t);
+
+    private:
+        void Net_LOGINOK(const uint8_t *, size_t);
+        void Net_ACTION(const uint8_t *, size_t);
+        void Net_CORECORD(const uint8_t *, size_t);
+        void Net_PING(const uint8_t *, size_t);
+        void Net_SHOWDROPITEM(const uint8_t *, size_t);
+        void Net_REMOVEGROUNDITEM(const uint8_t *, size_t);
+
+    private:
+        void DoAction();
+        bool DoPickUp();
+        bool DoAttack();
+        bool DoWander();
+
+    private:
+        bool CanMove(int, int) const;
+        bool FindPath(int, int);
+        bool MoveTo(int, int);
+
+    private:
+        void SendAction(const ActionNode &);
+
+        template<typename T> void Send(uint8_t nHC, const T &stMsg)
+        {
+            if(m_NetIO.Send(nHC, stMsg)){
+                m_Stat->SendCount++;
+            }
+        }
+};
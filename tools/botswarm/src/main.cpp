@@ -0,0 +1,258 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 10/18/2026 20:05:12
+ *  Last Modified: 10/18/2026 20:05:12
+ *
+ *    Description: run many headless bots against a monoserver for load test
+ *
+ *                      botswarm --bots=500 --id=bot --password=123456 --duration=60
+ *
+ *                 accounts are <id>0, <id>1, ..., they should exist in the database
+ *                 all bots run in one thread, each bot has its own connection
+ *
+ *                 prints online bots and message rate every second, at exit prints the
+ *                 throughput and percentiles of round trip time of CM_PING -> SM_PING
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <algorithm>
+#include <unordered_map>
+
+#include "bot.hpp"
+#include "log.hpp"
+#include "mapbindbn.hpp"
+
+Log       *g_Log       = nullptr;
+MapBinDBN *g_MapBinDBN = nullptr;
+
+static uint64_t GetTimeUS()
+{
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void PrintUsage()
+{
+    std::printf("Usage: botswarm [--key=value] ...\n");
+    std::printf("    --ip=127.0.0.1                      server address\n");
+    std::printf("    --port=5000                         server port\n");
+    std::printf("    --bots=100                          count of bots\n");
+    std::printf("    --id=bot                            account prefix, accounts are bot0, bot1, ...\n");
+    std::printf("    --password=123456                   password of all accounts\n");
+    std::printf("    --map-path=Res/Map/MapBinDBN.ZIP    map database for path finding\n");
+    std::printf("    --duration=60                       seconds to run\n");
+    std::printf("    --step=600                          ms between two actions of one bot\n");
+    std::printf("    --ping=1000                         ms between two pings of one bot\n");
+    std::printf("    --ramp=10                           ms between launching two bots\n");
+}
+
+static uint32_t Percentile(const std::vector<uint32_t> &rstSortedList, double fPercent)
+{
+    if(rstSortedList.empty()){
+        return 0;
+    }
+
+    auto nIndex = (size_t)(fPercent / 100.0 * (rstSortedList.size() - 1) + 0.5);
+    return rstSortedList[std::min<size_t>(nIndex, rstSortedList.size() - 1)];
+}
+
+int main(int argc, char *argv[])
+{
+    BotConfig stConfig;
+    stConfig.IP          = "127.0.0.1";
+    stConfig.Port        = "5000";
+    stConfig.Password    = "123456";
+    stConfig.StepTime    = 600;
+    stConfig.PingTime    = 1000;
+    stConfig.ConnectTime = 10000;
+
+    int nBotCount = 100;
+    int nDuration = 60;
+    int nRampTime = 10;
+
+    std::string szIDPrefix = "bot";
+    std::string szMapPath  = "Res/Map/MapBinDBN.ZIP";
+
+    for(int nIndex = 1; nIndex < argc; ++nIndex){
+        std::string szArg = argv[nIndex];
+        if(szArg == "--help"){
+            PrintUsage();
+            return 0;
+        }
+
+        auto nLoc = szArg.find('=');
+        if(szArg.compare(0, 2, "--") || nLoc == std::string::npos){
+            std::printf("invalid option: %s, expect --key=value\n", szArg.c_str());
+            PrintUsage();
+            return 1;
+        }
+
+        auto szKey   = szArg.substr(2, nLoc - 2);
+        auto szValue = szArg.substr(nLoc + 1);
+
+        if(szKey == "ip"      ){ stConfig.IP       = szValue; continue; }
+        if(szKey == "port"    ){ stConfig.Port     = szValue; continue; }
+        if(szKey == "password"){ stConfig.Password = szValue; continue; }
+        if(szKey == "id"      ){ szIDPrefix        = szValue; continue; }
+        if(szKey == "map-path"){ szMapPath         = szValue; continue; }
+
+        if(szKey == "bots"    ){ nBotCount         = std::atoi(szValue.c_str()); continue; }
+        if(szKey == "duration"){ nDuration         = std::atoi(szValue.c_str()); continue; }
+        if(szKey == "ramp"    ){ nRampTime         = std::atoi(szValue.c_str()); continue; }
+        if(szKey == "step"    ){ stConfig.StepTime = std::atoi(szValue.c_str()); continue; }
+        if(szKey == "ping"    ){ stConfig.PingTime = std::atoi(szValue.c_str()); continue; }
+
+        std::printf("unknown option: %s\n", szArg.c_str());
+        PrintUsage();
+        return 1;
+    }
+
+    if(false
+            || nBotCount <= 0
+            || nDuration <= 0
+            || nRampTime <  0
+            || stConfig.StepTime <= 0
+            || stConfig.PingTime <= 0){
+        std::printf("invalid option value\n");
+        return 1;
+    }
+
+    g_Log       = new Log("botswarm");
+    g_MapBinDBN = new MapBinDBN();
+
+    if(!g_MapBinDBN->Load(szMapPath.c_str())){
+        std::printf("can't load map database: %s\n", szMapPath.c_str());
+        return 1;
+    }
+
+    // MapBinDBN only caches a few maps and releases others
+    // keep one copy for each map since bots may keep pointers to it
+    std::unordered_map<uint32_t, std::unique_ptr<Mir2xMapData>> stMapCache;
+    stConfig.RetrieveMap = [&stMapCache](uint32_t nMapID) -> const Mir2xMapData *
+    {
+        auto pRecord = stMapCache.find(nMapID);
+        if(pRecord != stMapCache.end()){
+            return pRecord->second.get();
+        }
+
+        if(auto pMapBin = g_MapBinDBN->Retrieve(nMapID)){
+            stMapCache[nMapID] = std::make_unique<Mir2xMapData>(*pMapBin);
+            return stMapCache[nMapID].get();
+        }
+        return nullptr;
+    };
+
+    BotStat stStat;
+    std::vector<std::unique_ptr<Bot>> stBotList;
+    for(int nIndex = 0; nIndex < nBotCount; ++nIndex){
+        stBotList.emplace_back(std::make_unique<Bot>(stConfig, szIDPrefix + std::to_string(nIndex), &stStat));
+    }
+
+    auto nStartTime  = GetTimeUS();
+    auto nEndTime    = nStartTime + (uint64_t)(nDuration) * 1000000;
+    auto nReportTime = nStartTime + 1000000;
+
+    // stats before the report time
+    // to print the rate of last second
+    uint64_t nLastSend = 0;
+    uint64_t nLastRecv = 0;
+
+    // round trip time is counted only after all bots launched
+    // ramp-up spikes won't distort the percentiles
+    uint64_t nSteadyTime = 0;
+    size_t   nSteadyRTT  = 0;
+    uint64_t nSteadySend = 0;
+    uint64_t nSteadyRecv = 0;
+
+    int nLaunched = 0;
+    while(true){
+        auto nNow = GetTimeUS();
+        if(nNow >= nEndTime){
+            break;
+        }
+
+        while(true
+                && nLaunched < nBotCount
+                && nNow >= nStartTime + (uint64_t)(nLaunched) * (uint64_t)(nRampTime) * 1000){
+            stBotList[nLaunched++]->Launch(nNow);
+            if(nLaunched == nBotCount){
+                nSteadyTime = nNow;
+                nSteadyRTT  = stStat.RTTList.size();
+                nSteadySend = stStat.SendCount;
+                nSteadyRecv = stStat.RecvCount;
+            }
+        }
+
+        int nOnline = 0;
+        for(int nIndex = 0; nIndex < nLaunched; ++nIndex){
+            stBotList[nIndex]->Update(nNow);
+            if(stBotList[nIndex]->State() == Bot::BOTSTATE_RUN){
+                nOnline++;
+            }
+        }
+
+        if(nNow >= nReportTime){
+            std::printf("[%4d s] online %d/%d, send %" PRIu64 "/s, recv %" PRIu64 "/s\n",
+                    (int)((nNow - nStartTime) / 1000000), nOnline, nLaunched, stStat.SendCount - nLastSend, stStat.RecvCount - nLastRecv);
+
+            nLastSend    = stStat.SendCount;
+            nLastRecv    = stStat.RecvCount;
+            nReportTime += 1000000;
+        }
+
+        // each bot acts once per step time
+        // no need to spin the CPU which is also used by the server in most tests
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto nStopTime = GetTimeUS();
+    if(!nSteadyTime){
+        std::printf("not all bots launched, increase --duration or reduce --ramp\n");
+        nSteadyTime = nStartTime;
+    }
+
+    std::vector<uint32_t> stRTTList(stStat.RTTList.begin() + nSteadyRTT, stStat.RTTList.end());
+    std::sort(stRTTList.begin(), stRTTList.end());
+
+    auto fSteadySecond = std::max<double>((nStopTime - nSteadyTime) / 1000000.0, 1e-6);
+
+    std::printf("\n");
+    std::printf("bots     : %d, steady for %.1f s\n", nBotCount, fSteadySecond);
+    std::printf("actions  : move %" PRIu64 ", attack %" PRIu64 ", pickup %" PRIu64 " (ok %" PRIu64 "), resync %" PRIu64 "\n",
+            stStat.MoveCount, stStat.AttackCount, stStat.PickUpCount, stStat.PickUpOKCount, stStat.ResyncCount);
+    std::printf("send     : %.1f msg/s\n", (stStat.SendCount - nSteadySend) / fSteadySecond);
+    std::printf("recv     : %.1f msg/s\n", (stStat.RecvCount - nSteadyRecv) / fSteadySecond);
+    std::printf("rtt (us) : count %zu, p50 %u, p90 %u, p99 %u, max %u\n",
+            stRTTList.size(),
+            Percentile(stRTTList, 50.0),
+            Percentile(stRTTList, 90.0),
+            Percentile(stRTTList, 99.0),
+            stRTTList.empty() ? 0 : stRTTList.back());
+
+    // NetIO logs by g_Log
+    // release bots before the logger
+    stBotList.clear();
+
+    delete g_MapBinDBN;
+    delete g_Log;
+    return 0;
+}
@@ -0,0 +1,298 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 10/18/2026 23:10:41
+ *  Last Modified: 10/18/2026 23:10:41
+ *
+ *    Description: check all Compress kernels against the scalar one and report speed
+ *
+ *                      compressbench
+ *                      compressbench --check=0 --density=10 --duration=500
+ *
+ *                 check part runs every kernel supported by the CPU on all lengths in
+ *                 [1, maxlen] and densities 0%, step, ..., 100%, input starts at varying
+ *                 offsets for unaligned heads and tails, compressed data and output are
+ *                 in heap buffers of the exact size, build with -fsanitize=address to
+ *                 catch over-read of the 16-byte loads in DecodeAVX2
+ *
+ *                 lengths beyond 255 * 32 bytes make the byte counters of CountDataSSE2
+ *                 and CountDataAVX2 flush, density 0% saturates every counter
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <algorithm>
+
+#include "compress.hpp"
+
+static uint64_t GetTimeUS()
+{
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void PrintUsage()
+{
+    std::printf("Usage: compressbench [--key=value] ...\n");
+    std::printf("    --check=1               compare all kernels with scalar, 0 to skip\n");
+    std::printf("    --maxlen=9000           check lengths 1 to maxlen\n");
+    std::printf("    --step=10               check densities 0%%, step%%, ..., 100%%\n");
+    std::printf("    --bench=1               report throughput per message size, 0 to skip\n");
+    std::printf("    --density=30            percent of non-zero bytes in benchmark messages\n");
+    std::printf("    --duration=200          ms to run for each kernel and message size\n");
+    std::printf("    --seed=1                seed of the random data\n");
+}
+
+// xorshift64, std::rand() is too slow to fill 9000 x 9000 x 11 bytes
+static uint64_t g_Seed = 1;
+static uint32_t RandU32()
+{
+    g_Seed ^= g_Seed << 13;
+    g_Seed ^= g_Seed >>  7;
+    g_Seed ^= g_Seed << 17;
+    return (uint32_t)(g_Seed >> 32);
+}
+
+// non-zero bytes with given percent, 100 gives no zero byte and 0 gives all zero
+static void FillData(uint8_t *pData, size_t nDataLen, int nDensity)
+{
+    for(size_t nIndex = 0; nIndex < nDataLen; ++nIndex){
+        pData[nIndex] = ((int)(RandU32() % 100) < nDensity) ? (uint8_t)(1 + RandU32() % 255) : 0;
+    }
+}
+
+// copy to a heap buffer of exactly nDataLen bytes
+// then any read beyond the end is caught by address sanitizer
+static std::unique_ptr<uint8_t[]> ExactCopy(const uint8_t *pData, size_t nDataLen)
+{
+    std::unique_ptr<uint8_t[]> pBuf(new uint8_t[std::max<size_t>(nDataLen, 1)]);
+    if(nDataLen){
+        std::memcpy(pBuf.get(), pData, nDataLen);
+    }
+    return pBuf;
+}
+
+static bool CheckOne(const Compress::KernelEntry &rstScalar, const Compress::KernelEntry &rstKernel, const uint8_t *pData, size_t nDataLen, int nDensity)
+{
+    auto nMaskLen = (nDataLen + 7) / 8;
+
+    auto fnFail = [&rstKernel, nDataLen, nDensity](const char *szWhat) -> bool
+    {
+        std::printf("FAIL: kernel %s, length %zu, density %d%%: %s\n", rstKernel.Name, nDataLen, nDensity, szWhat);
+        return false;
+    };
+
+    if(rstKernel.CountMask(pData, nDataLen) != rstScalar.CountMask(pData, nDataLen)){
+        return fnFail("CountMask");
+    }
+
+    auto nDataCount = rstScalar.CountData(pData, nDataLen);
+    if(rstKernel.CountData(pData, nDataLen) != nDataCount){
+        return fnFail("CountData");
+    }
+
+    std::vector<uint8_t> stRefBuf(nMaskLen + nDataCount);
+    rstScalar.Encode(stRefBuf.data(), pData, nDataLen);
+
+    // same size as the caller allocates, mask plus CountData() bytes
+    std::unique_ptr<uint8_t[]> pEncodeBuf(new uint8_t[nMaskLen + nDataCount]);
+    if(rstKernel.Encode(pEncodeBuf.get(), pData, nDataLen) != nDataCount){
+        return fnFail("Encode count");
+    }
+
+    if(std::memcmp(pEncodeBuf.get(), stRefBuf.data(), stRefBuf.size())){
+        return fnFail("Encode output");
+    }
+
+    // mask and compressed data in separate exact buffers
+    // the kernel can over-read either of them at the tail
+    auto pMask = ExactCopy(stRefBuf.data(), nMaskLen);
+    auto pComp = ExactCopy(stRefBuf.data() + nMaskLen, nDataCount);
+
+    std::unique_ptr<uint8_t[]> pOrig(new uint8_t[nDataLen]);
+    std::memset(pOrig.get(), 0XCD, nDataLen);
+
+    if(rstKernel.Decode(pOrig.get(), nDataLen, pMask.get(), pComp.get()) != nDataCount){
+        return fnFail("Decode count");
+    }
+
+    if(std::memcmp(pOrig.get(), pData, nDataLen)){
+        return fnFail("Decode output");
+    }
+    return true;
+}
+
+static bool RunCheck(const std::vector<Compress::KernelEntry> &rstKernelList, size_t nMaxLen, int nStep)
+{
+    std::vector<int> stDensityList;
+    for(int nDensity = 0; nDensity < 100; nDensity += nStep){
+        stDensityList.push_back(nDensity);
+    }
+    stDensityList.push_back(100);
+
+    // extra 32 bytes to shift the start
+    std::vector<uint8_t> stDataBuf(nMaxLen + 32);
+
+    uint64_t nCaseCount = 0;
+    auto     nStartTime = GetTimeUS();
+
+    for(size_t nDataLen = 1; nDataLen <= nMaxLen; ++nDataLen){
+        for(auto nDensity: stDensityList){
+            auto pData = stDataBuf.data() + (RandU32() % 32);
+            FillData(pData, nDataLen, nDensity);
+
+            // compare with scalar itself as well, checks the harness
+            for(auto &rstKernel: rstKernelList){
+                if(!CheckOne(rstKernelList.front(), rstKernel, pData, nDataLen, nDensity)){
+                    return false;
+                }
+                nCaseCount++;
+            }
+        }
+    }
+
+    std::printf("check    : %" PRIu64 " cases passed, %zu lengths x %zu densities, %.1f s\n",
+            nCaseCount, nMaxLen, stDensityList.size(), (GetTimeUS() - nStartTime) / 1000000.0);
+    return true;
+}
+
+static void RunBench(const std::vector<Compress::KernelEntry> &rstKernelList, int nDensity, int nDuration)
+{
+    const size_t nSizeList[] {8, 16, 32, 64, 128, 256, 512, 1024, 4096, 8192};
+
+    std::printf("\n");
+    std::printf("bench    : density %d%%, %d ms per case, encode and decode in ns/msg (MB/s)\n", nDensity, nDuration);
+    std::printf("%8s %8s %24s %24s\n", "size", "kernel", "encode", "decode");
+
+    // sink of return values, keeps the calls from being dropped
+    volatile int nSink = 0;
+
+    for(auto nDataLen: nSizeList){
+        std::vector<uint8_t> stData(nDataLen);
+        FillData(stData.data(), nDataLen, nDensity);
+
+        std::vector<uint8_t> stEncodeBuf((nDataLen + 7) / 8 + nDataLen);
+        std::vector<uint8_t> stOrig(nDataLen);
+
+        for(auto &rstKernel: rstKernelList){
+            // check the clock every 256 calls, reading the clock costs more than small messages
+            auto fnMeasure = [nDuration](auto &&fnOp) -> double
+            {
+                uint64_t nCount = 0;
+                auto nStartTime = GetTimeUS();
+                auto nDoneTime  = nStartTime + (uint64_t)(nDuration) * 1000;
+
+                uint64_t nCurrTime = nStartTime;
+                while(nCurrTime < nDoneTime){
+                    for(int nIndex = 0; nIndex < 256; ++nIndex){
+                        fnOp();
+                    }
+                    nCount   += 256;
+                    nCurrTime = GetTimeUS();
+                }
+                return (nCurrTime - nStartTime) * 1000.0 / nCount;
+            };
+
+            auto fEncodeNS = fnMeasure([&]()
+            {
+                nSink = nSink + rstKernel.CountData(stData.data(), nDataLen);
+                nSink = nSink + rstKernel.Encode(stEncodeBuf.data(), stData.data(), nDataLen);
+            });
+
+            auto pMask = stEncodeBuf.data();
+            auto pComp = stEncodeBuf.data() + (nDataLen + 7) / 8;
+            auto fDecodeNS = fnMeasure([&]()
+            {
+                nSink = nSink + rstKernel.Decode(stOrig.data(), nDataLen, pMask, pComp);
+            });
+
+            char szEncode[64];
+            char szDecode[64];
+            std::snprintf(szEncode, sizeof(szEncode), "%.1f (%.0f)", fEncodeNS, nDataLen * 1000.0 / fEncodeNS);
+            std::snprintf(szDecode, sizeof(szDecode), "%.1f (%.0f)", fDecodeNS, nDataLen * 1000.0 / fDecodeNS);
+            std::printf("%8zu %8s %24s %24s\n", nDataLen, rstKernel.Name, szEncode, szDecode);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool bCheck    = true;
+    bool bBench    = true;
+    int  nMaxLen   = 9000;
+    int  nStep     = 10;
+    int  nDensity  = 30;
+    int  nDuration = 200;
+
+    for(int nIndex = 1; nIndex < argc; ++nIndex){
+        std::string szArg = argv[nIndex];
+        if(szArg == "--help"){
+            PrintUsage();
+            return 0;
+        }
+
+        auto nLoc = szArg.find('=');
+        if(szArg.compare(0, 2, "--") || nLoc == std::string::npos){
+            std::printf("invalid option: %s, expect --key=value\n", szArg.c_str());
+            PrintUsage();
+            return 1;
+        }
+
+        auto szKey   = szArg.substr(2, nLoc - 2);
+        auto szValue = szArg.substr(nLoc + 1);
+
+        if(szKey == "check"   ){ bCheck    = std::atoi(szValue.c_str()) != 0;                 continue; }
+        if(szKey == "bench"   ){ bBench    = std::atoi(szValue.c_str()) != 0;                 continue; }
+        if(szKey == "maxlen"  ){ nMaxLen   = std::atoi(szValue.c_str());                      continue; }
+        if(szKey == "step"    ){ nStep     = std::atoi(szValue.c_str());                      continue; }
+        if(szKey == "density" ){ nDensity  = std::atoi(szValue.c_str());                      continue; }
+        if(szKey == "duration"){ nDuration = std::atoi(szValue.c_str());                      continue; }
+        if(szKey == "seed"    ){ g_Seed    = std::strtoull(szValue.c_str(), nullptr, 10) | 1; continue; }
+
+        std::printf("unknown option: %s\n", szArg.c_str());
+        PrintUsage();
+        return 1;
+    }
+
+    if(false
+            || nMaxLen   <= 0
+            || nStep     <= 0
+            || nDensity  <  0
+            || nDensity  >  100
+            || nDuration <= 0){
+        PrintUsage();
+        return 1;
+    }
+
+    auto stKernelList = Compress::KernelList();
+    std::printf("kernels  :");
+    for(auto &rstKernel: stKernelList){
+        std::printf(" %s", rstKernel.Name);
+    }
+    std::printf(", selected %s\n", Compress::KernelName());
+
+    if(bCheck && !RunCheck(stKernelList, (size_t)(nMaxLen), nStep)){
+        return 1;
+    }
+
+    if(bBench){
+        RunBench(stKernelList, nDensity, nDuration);
+    }
+    return 0;
+}
@@ -0,0 +1,266 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 10/19/2026 01:02:48
+ *  Last Modified: 10/19/2026 01:02:48
+ *
+ *    Description: throughput of MessagePack delivery by payload size and fan-out
+ *
+ *                      mpkbench
+ *                      mpkbench --fanout=1,16,128 --duration=500 --pool=0
+ *
+ *                 one round does what ActorPod::Forward() does without Theron: build a
+ *                 MessagePack from a MessageBuf once, copy it to each mailbox of the
+ *                 fan-out as Theron::Actor::Send() does, then receivers read the payload
+ *                 and drop the message
+ *
+ *                 payload <= 64 bytes stays in the inline buffer of MessagePack, larger
+ *                 ones are in SharedBuf and each copy only increases the reference count
+ *
+ *                 the legacy column is the MessagePack before SharedBuf, every copy of
+ *                 a large payload allocates and copies it again
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+
+#include "memorypn.hpp"
+#include "messagepack.hpp"
+
+// monoserver creates the pool in main()
+// its constructor logs by g_MonoServer, the bench only needs the pool itself
+MemoryPN *g_MemoryPN = nullptr;
+MemoryPN::MemoryPN()
+    : MemoryChunkPN<64, 256, 4>()
+{}
+
+// MessagePack before SharedBuf, only the part used by delivery
+// payload beyond the inline buffer is owned by each copy
+template<size_t SBufSize = 64> class LegacyMessagePack final
+{
+    private:
+        int m_Type;
+
+    private:
+        uint8_t  m_SBuf[SBufSize];
+        size_t   m_SBufUsedLen;
+
+    private:
+        uint8_t *m_DBuf;
+        size_t   m_DBufLen;
+
+    public:
+        LegacyMessagePack(const MessageBuf &rstMB)
+            : m_Type(rstMB.Type())
+            , m_SBufUsedLen(0)
+            , m_DBuf(nullptr)
+            , m_DBufLen(0)
+        {
+            if(rstMB.Data() && rstMB.DataLen()){
+                if(rstMB.DataLen() <= SBufSize){
+                    m_SBufUsedLen = rstMB.DataLen();
+                    std::memcpy(m_SBuf, rstMB.Data(), rstMB.DataLen());
+                }else{
+                    m_DBuf    = new uint8_t[rstMB.DataLen()];
+                    m_DBufLen = rstMB.DataLen();
+                    std::memcpy(m_DBuf, rstMB.Data(), rstMB.DataLen());
+                }
+            }
+        }
+
+        LegacyMessagePack(const LegacyMessagePack &rstMPK)
+            : LegacyMessagePack(MessageBuf(rstMPK.m_Type, rstMPK.Data(), rstMPK.DataLen()))
+        {}
+
+        LegacyMessagePack(LegacyMessagePack &&rstMPK)
+            : m_Type(rstMPK.m_Type)
+            , m_SBufUsedLen(rstMPK.m_SBufUsedLen)
+            , m_DBuf(rstMPK.m_DBuf)
+            , m_DBufLen(rstMPK.m_DBufLen)
+        {
+            if(m_SBufUsedLen){
+                std::memcpy(m_SBuf, rstMPK.m_SBuf, m_SBufUsedLen);
+            }
+
+            rstMPK.m_SBufUsedLen = 0;
+            rstMPK.m_DBuf        = nullptr;
+            rstMPK.m_DBufLen     = 0;
+        }
+
+       ~LegacyMessagePack()
+        {
+            delete [] m_DBuf;
+        }
+
+    public:
+        LegacyMessagePack &operator = (const LegacyMessagePack &) = delete;
+
+    public:
+        const uint8_t *Data() const
+        {
+            return m_SBufUsedLen ? m_SBuf : m_DBuf;
+        }
+
+        size_t DataLen() const
+        {
+            return m_SBufUsedLen ? m_SBufUsedLen : m_DBufLen;
+        }
+};
+
+static uint64_t GetTimeUS()
+{
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void PrintUsage()
+{
+    std::printf("Usage: mpkbench [--key=value] ...\n");
+    std::printf("    --fanout=1,8,64         receivers of each forward, 1 for unicast\n");
+    std::printf("    --duration=200          ms to run for each payload size and fan-out\n");
+    std::printf("    --pool=1                allocate SharedBuf from MemoryPN as monoserver, 0 for new []\n");
+}
+
+static std::vector<int> ParseIntList(const std::string &szValue)
+{
+    std::vector<int> stList;
+    for(size_t nBegin = 0; nBegin < szValue.size();){
+        auto nEnd = szValue.find(',', nBegin);
+        if(nEnd == std::string::npos){
+            nEnd = szValue.size();
+        }
+
+        auto nValue = std::atoi(szValue.substr(nBegin, nEnd - nBegin).c_str());
+        if(nValue > 0){
+            stList.push_back(nValue);
+        }
+        nBegin = nEnd + 1;
+    }
+    return stList;
+}
+
+// sum of bytes read by receivers, keeps the reads from being dropped
+static uint64_t g_CheckSum = 0;
+
+// return ns per delivery, one delivery is one copy to one mailbox
+template<typename MPK> static double RunForward(const std::vector<uint8_t> &rstPayload, int nFanOut, int nDuration)
+{
+    // mailboxes are reused, capacity is kept after clear()
+    std::vector<std::vector<MPK>> stMailBoxV(nFanOut);
+    for(auto &rstMailBox: stMailBoxV){
+        rstMailBox.reserve(16);
+    }
+
+    uint64_t nDelivery  = 0;
+    auto     nStartTime = GetTimeUS();
+    auto     nDoneTime  = nStartTime + (uint64_t)(nDuration) * 1000;
+    auto     nCurrTime  = nStartTime;
+
+    while(nCurrTime < nDoneTime){
+        for(int nRound = 0; nRound < 16; ++nRound){
+            MPK stMPK(MessageBuf(MPK_NETPACKAGE, rstPayload.data(), rstPayload.size()));
+            for(auto &rstMailBox: stMailBoxV){
+                rstMailBox.push_back(stMPK);
+            }
+        }
+
+        // receivers touch the head and tail of the payload
+        for(auto &rstMailBox: stMailBoxV){
+            for(auto &rstMPK: rstMailBox){
+                g_CheckSum += rstMPK.Data()[0] + rstMPK.Data()[rstMPK.DataLen() - 1];
+            }
+            rstMailBox.clear();
+        }
+
+        nDelivery += 16 * (uint64_t)(nFanOut);
+        nCurrTime  = GetTimeUS();
+    }
+    return (nCurrTime - nStartTime) * 1000.0 / nDelivery;
+}
+
+int main(int argc, char *argv[])
+{
+    int  nDuration = 200;
+    bool bPool     = true;
+
+    std::vector<int> stFanOutList {1, 8, 64};
+
+    for(int nIndex = 1; nIndex < argc; ++nIndex){
+        std::string szArg = argv[nIndex];
+        if(szArg == "--help"){
+            PrintUsage();
+            return 0;
+        }
+
+        auto nLoc = szArg.find('=');
+        if(szArg.compare(0, 2, "--") || nLoc == std::string::npos){
+            std::printf("invalid option: %s, expect --key=value\n", szArg.c_str());
+            PrintUsage();
+            return 1;
+        }
+
+        auto szKey   = szArg.substr(2, nLoc - 2);
+        auto szValue = szArg.substr(nLoc + 1);
+
+        if(szKey == "fanout"  ){ stFanOutList = ParseIntList(szValue);          continue; }
+        if(szKey == "duration"){ nDuration    = std::atoi(szValue.c_str());      continue; }
+        if(szKey == "pool"    ){ bPool        = std::atoi(szValue.c_str()) != 0; continue; }
+
+        std::printf("unknown option: %s\n", szArg.c_str());
+        PrintUsage();
+        return 1;
+    }
+
+    if(stFanOutList.empty() || nDuration <= 0){
+        PrintUsage();
+        return 1;
+    }
+
+    if(bPool){
+        g_MemoryPN = new MemoryPN();
+    }
+
+    // 64 is the last inline size, 65 is the first SharedBuf one
+    const size_t nSizeList[] {8, 32, 64, 65, 128, 256, 1024, 4096, 16384};
+
+    std::printf("forward  : SharedBuf from %s, %d ms per case, ns per delivery (MB/s of payload)\n", bPool ? "MemoryPN" : "new []", nDuration);
+    std::printf("%8s %8s %8s %22s %22s %9s\n", "size", "fanout", "buffer", "MessagePack", "legacy", "speedup");
+
+    for(auto nFanOut: stFanOutList){
+        for(auto nSize: nSizeList){
+            std::vector<uint8_t> stPayload(nSize);
+            for(size_t nIndex = 0; nIndex < nSize; ++nIndex){
+                stPayload[nIndex] = (uint8_t)(nIndex * 31 + 7);
+            }
+
+            auto fCurrNS   = RunForward<MessagePack            >(stPayload, nFanOut, nDuration);
+            auto fLegacyNS = RunForward<LegacyMessagePack<64>  >(stPayload, nFanOut, nDuration);
+
+            char szCurr[64];
+            char szLegacy[64];
+            std::snprintf(szCurr,   sizeof(szCurr),   "%.1f (%.0f)", fCurrNS,   nSize * 1000.0 / fCurrNS);
+            std::snprintf(szLegacy, sizeof(szLegacy), "%.1f (%.0f)", fLegacyNS, nSize * 1000.0 / fLegacyNS);
+            std::printf("%8zu %8d %8s %22s %22s %8.2fx\n", nSize, nFanOut, (nSize <= 64) ? "inline" : "shared", szCurr, szLegacy, fLegacyNS / fCurrNS);
+        }
+        std::printf("\n");
+    }
+
+    std::printf("checksum : %" PRIu64 "\n", g_CheckSum);
+    delete g_MemoryPN;
+    return 0;
+}
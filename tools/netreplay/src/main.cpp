@@ -0,0 +1,341 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 10/18/2026 21:40:08
+ *  Last Modified: 10/18/2026 21:40:08
+ *
+ *    Description: feed a capture of monoserver --capture=file back to a server
+ *
+ *                      netreplay --capture=mir2x.cap --speed=1
+ *                      netreplay --capture=mir2x.cap --speed=max
+ *
+ *                 each captured session is replayed by one connection, with --speed=1 the
+ *                 connection starts and sends messages at the captured time, with a larger
+ *                 speed the capture is compressed in time, with --speed=max all sessions
+ *                 start at once and send messages as fast as possible
+ *
+ *                 the server should have the same database and maps as when capturing,
+ *                 otherwise logins fail or actions are refused
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <algorithm>
+#include <unordered_map>
+
+#include "log.hpp"
+#include "message.hpp"
+#include "netcapture.hpp"
+#include "replaysession.hpp"
+
+Log *g_Log = nullptr;
+
+struct CaptureSession
+{
+    uint32_t ID;
+    uint32_t UID;
+
+    uint64_t CloseTick;
+    std::vector<ReplayFrame> FrameList;
+};
+
+static uint64_t GetTimeUS()
+{
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void PrintUsage()
+{
+    std::printf("Usage: netreplay --capture=file [--key=value] ...\n");
+    std::printf("    --capture=file          capture written by monoserver --capture=file\n");
+    std::printf("    --ip=127.0.0.1          server address\n");
+    std::printf("    --port=5000             server port\n");
+    std::printf("    --speed=1               time scale of the replay, max for no wait\n");
+    std::printf("    --linger=1000           ms to wait for responses after all messages sent\n");
+}
+
+static uint32_t Percentile(const std::vector<uint32_t> &rstSortedList, double fPercent)
+{
+    if(rstSortedList.empty()){
+        return 0;
+    }
+
+    auto nIndex = (size_t)(fPercent / 100.0 * (rstSortedList.size() - 1) + 0.5);
+    return rstSortedList[std::min<size_t>(nIndex, rstSortedList.size() - 1)];
+}
+
+// load all CM_* messages to sessions, SM_* messages are only counted
+// return false if the capture can't be read
+static bool LoadCapture(const char *szFileName, std::vector<CaptureSession> *pSessionList, std::vector<uint8_t> *pDataBuf, uint64_t *pSMCount)
+{
+    NetCaptureReader stReader;
+    if(!stReader.Open(szFileName)){
+        std::printf("can't open capture: %s\n", szFileName);
+        return false;
+    }
+
+    // session ID -> index in pSessionList of current connection
+    // removed when closed since the ID can be reused
+    std::unordered_map<uint32_t, size_t> stOpenList;
+
+    NetCapture::RecordHead stHead;
+    std::vector<uint8_t>   stData;
+
+    while(true){
+        switch(auto nRet = stReader.Read(&stHead, &stData)){
+            case 0:
+                {
+                    return true;
+                }
+            case 1:
+                {
+                    break;
+                }
+            default:
+                {
+                    // the server may be killed when capturing
+                    // a truncated tail is not an error
+                    std::printf("capture is truncated or corrupted, replay records before it: %d\n", nRet);
+                    return true;
+                }
+        }
+
+        if(stHead.SessionID == NetCapture::BROADCAST_SESSIONID){
+            (*pSMCount)++;
+            continue;
+        }
+
+        auto pOpen = stOpenList.find(stHead.SessionID);
+        switch(stHead.Dir){
+            case NetCapture::DIR_CLOSE:
+                {
+                    if(pOpen != stOpenList.end()){
+                        (*pSessionList)[pOpen->second].CloseTick = stHead.Tick;
+                        stOpenList.erase(pOpen);
+                    }
+                    continue;
+                }
+            case NetCapture::DIR_SM:
+                {
+                    (*pSMCount)++;
+                    if(true
+                            && pOpen != stOpenList.end()
+                            && stHead.HC == SM_LOGINOK
+                            && stData.size() == sizeof(SMLoginOK)){
+
+                        SMLoginOK stSMLOK;
+                        std::memcpy(&stSMLOK, stData.data(), sizeof(stSMLOK));
+                        (*pSessionList)[pOpen->second].UID = stSMLOK.UID;
+                    }
+                    continue;
+                }
+            case NetCapture::DIR_CM:
+                {
+                    if(pOpen == stOpenList.end()){
+                        pOpen = stOpenList.emplace(stHead.SessionID, pSessionList->size()).first;
+                        pSessionList->push_back({stHead.SessionID, 0, 0, {}});
+                    }
+
+                    (*pSessionList)[pOpen->second].FrameList.push_back({stHead.Tick, stHead.HC, pDataBuf->size(), stData.size()});
+                    pDataBuf->insert(pDataBuf->end(), stData.begin(), stData.end());
+                    continue;
+                }
+            default:
+                {
+                    continue;
+                }
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string szCapture;
+    std::string szIP   = "127.0.0.1";
+    std::string szPort = "5000";
+
+    double fSpeed  = 1.0;
+    int    nLinger = 1000;
+
+    for(int nIndex = 1; nIndex < argc; ++nIndex){
+        std::string szArg = argv[nIndex];
+        if(szArg == "--help"){
+            PrintUsage();
+            return 0;
+        }
+
+        auto nLoc = szArg.find('=');
+        if(szArg.compare(0, 2, "--") || nLoc == std::string::npos){
+            std::printf("invalid option: %s, expect --key=value\n", szArg.c_str());
+            PrintUsage();
+            return 1;
+        }
+
+        auto szKey   = szArg.substr(2, nLoc - 2);
+        auto szValue = szArg.substr(nLoc + 1);
+
+        if(szKey == "capture"){ szCapture = szValue; continue; }
+        if(szKey == "ip"     ){ szIP      = szValue; continue; }
+        if(szKey == "port"   ){ szPort    = szValue; continue; }
+
+        if(szKey == "speed"  ){ fSpeed  = (szValue == "max") ? 0.0 : std::atof(szValue.c_str()); continue; }
+        if(szKey == "linger" ){ nLinger = std::atoi(szValue.c_str());                             continue; }
+
+        std::printf("unknown option: %s\n", szArg.c_str());
+        PrintUsage();
+        return 1;
+    }
+
+    if(szCapture.empty() || fSpeed < 0.0 || nLinger < 0){
+        PrintUsage();
+        return 1;
+    }
+
+    g_Log = new Log("netreplay");
+
+    std::vector<CaptureSession> stCaptureList;
+    std::vector<uint8_t>        stDataBuf;
+    uint64_t                    nCaptureSMCount = 0;
+
+    if(!LoadCapture(szCapture.c_str(), &stCaptureList, &stDataBuf, &nCaptureSMCount)){
+        return 1;
+    }
+
+    // all ticks are shifted by the first message
+    // the capture may start long before the first connection
+    uint64_t nFirstTick = UINT64_MAX;
+    size_t   nFrameCount = 0;
+    for(auto &rstSession: stCaptureList){
+        nFirstTick   = std::min<uint64_t>(nFirstTick, rstSession.FrameList.front().Tick);
+        nFrameCount += rstSession.FrameList.size();
+    }
+
+    std::printf("capture  : %zu sessions, %zu client messages, %" PRIu64 " server messages\n", stCaptureList.size(), nFrameCount, nCaptureSMCount);
+    if(stCaptureList.empty()){
+        return 0;
+    }
+
+    // tick of frames becomes due time since replay starts
+    // at max speed all frames are due at once and only the order keeps
+    auto fnScale = [fSpeed, nFirstTick](uint64_t nTick) -> uint64_t
+    {
+        return (fSpeed > 0.0) ? (uint64_t)((nTick - nFirstTick) / fSpeed) : 0;
+    };
+
+    ReplayStat stStat;
+    std::unordered_map<uint32_t, uint32_t> stUIDTable;
+    std::vector<std::unique_ptr<ReplaySession>> stSessionList;
+
+    for(auto &rstSession: stCaptureList){
+        for(auto &rstFrame: rstSession.FrameList){
+            rstFrame.Tick = fnScale(rstFrame.Tick);
+        }
+
+        auto nCloseTick = (rstSession.CloseTick && fSpeed > 0.0) ? std::max<uint64_t>(1, fnScale(rstSession.CloseTick)) : 0;
+        stSessionList.emplace_back(std::make_unique<ReplaySession>(rstSession.ID, rstSession.UID, std::move(rstSession.FrameList), stDataBuf, nCloseTick, stUIDTable, &stStat));
+    }
+
+    // sessions are created at their first message so they are almost sorted
+    // records of different sessions can be slightly out of order in the capture
+    std::stable_sort(stSessionList.begin(), stSessionList.end(), [](const auto &pLHS, const auto &pRHS) -> bool
+    {
+        return pLHS->LaunchTick() < pRHS->LaunchTick();
+    });
+
+    auto nStartTime  = GetTimeUS();
+    auto nReportTime = nStartTime + 1000000;
+
+    uint64_t nLastSend = 0;
+    uint64_t nLastRecv = 0;
+
+    size_t nLaunched = 0;
+    while(true){
+        auto nNow = GetTimeUS() - nStartTime;
+        while(true
+                && nLaunched < stSessionList.size()
+                && stSessionList[nLaunched]->LaunchTick() <= nNow){
+            stSessionList[nLaunched++]->Launch(szIP.c_str(), szPort.c_str());
+        }
+
+        size_t nDone     = 0;
+        size_t nFinished = 0;
+        for(size_t nIndex = 0; nIndex < nLaunched; ++nIndex){
+            stSessionList[nIndex]->Update(nNow);
+            if(stSessionList[nIndex]->State() == ReplaySession::REPLAYSTATE_DONE){
+                nDone++;
+            }
+
+            if(stSessionList[nIndex]->Finished()){
+                nFinished++;
+            }
+        }
+
+        if(nNow + nStartTime >= nReportTime){
+            std::printf("[%4d s] sessions %zu/%zu, sent %" PRIu64 "/%zu, send %" PRIu64 "/s, recv %" PRIu64 "/s\n",
+                    (int)(nNow / 1000000), nLaunched - nDone, stSessionList.size(), stStat.SendCount, nFrameCount, stStat.SendCount - nLastSend, stStat.RecvCount - nLastRecv);
+
+            nLastSend    = stStat.SendCount;
+            nLastRecv    = stStat.RecvCount;
+            nReportTime += 1000000;
+        }
+
+        // every session has sent all its messages or is done
+        // then wait a while for responses of the last messages
+        if(nFinished == stSessionList.size()){
+            break;
+        }
+
+        // at max speed never sleep
+        // otherwise sleep a little, 1ms is the resolution of timed replay
+        if(fSpeed > 0.0){
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    auto nSendDoneTime = GetTimeUS();
+    while(GetTimeUS() < nSendDoneTime + (uint64_t)(nLinger) * 1000){
+        for(auto &pSession: stSessionList){
+            pSession->Update(GetTimeUS() - nStartTime);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto fSendSecond = std::max<double>((nSendDoneTime - nStartTime) / 1000000.0, 1e-6);
+    std::sort(stStat.LagList.begin(), stStat.LagList.end());
+
+    std::printf("\n");
+    std::printf("replay   : %.1f s at speed %s, linger %d ms\n", fSendSecond, (fSpeed > 0.0) ? std::to_string(fSpeed).c_str() : "max", nLinger);
+    std::printf("sessions : %zu, login failed %" PRIu64 ", disconnected %" PRIu64 "\n", stSessionList.size(), stStat.LoginFailCount, stStat.DisconnectCount);
+    std::printf("send     : %" PRIu64 "/%zu, %.1f msg/s\n", stStat.SendCount, nFrameCount, stStat.SendCount / fSendSecond);
+    std::printf("recv     : %" PRIu64 ", captured %" PRIu64 " (broadcast counted once)\n", stStat.RecvCount, nCaptureSMCount);
+
+    if(fSpeed > 0.0){
+        std::printf("lag (us) : p50 %u, p90 %u, p99 %u, max %u\n",
+                Percentile(stStat.LagList, 50.0),
+                Percentile(stStat.LagList, 90.0),
+                Percentile(stStat.LagList, 99.0),
+                stStat.LagList.empty() ? 0 : stStat.LagList.back());
+    }
+
+    stSessionList.clear();
+    delete g_Log;
+    return 0;
+}
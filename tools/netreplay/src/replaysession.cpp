@@ -0,0 +1,226 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: replaysession.cpp
+ *        Created: 10/18/2026 21:40:08
+ *  Last Modified: 10/18/2026 21:40:08
+ *
+ *    Description:
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <cstring>
+#include <algorithm>
+#include "log.hpp"
+#include "message.hpp"
+#include "netbundle.hpp"
+#include "replaysession.hpp"
+
+ReplaySession::ReplaySession(
+        uint32_t nCaptureID,
+        uint32_t nCaptureUID,
+        std::vector<ReplayFrame> stFrameList,
+        const std::vector<uint8_t> &rstDataBuf,
+        uint64_t nCloseTick,
+        std::unordered_map<uint32_t, uint32_t> &rstUIDTable,
+        ReplayStat *pStat)
+    : m_CaptureID(nCaptureID)
+    , m_CaptureUID(nCaptureUID)
+    , m_FrameList(std::move(stFrameList))
+    , m_DataBuf(rstDataBuf)
+    , m_CloseTick(nCloseTick)
+    , m_NetIO()
+    , m_State(REPLAYSTATE_NONE)
+    , m_FrameIndex(0)
+    , m_SendBuf()
+    , m_BundleBuf()
+    , m_UIDTable(rstUIDTable)
+    , m_Stat(pStat)
+{}
+
+bool ReplaySession::Launch(const char *szIP, const char *szPort)
+{
+    m_State = REPLAYSTATE_CONNECT;
+    return m_NetIO.InitIO(szIP, szPort, [this](uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+    {
+        OnServerMessage(nHC, pData, nDataLen);
+    });
+}
+
+void ReplaySession::Update(uint64_t nNow)
+{
+    m_NetIO.PollIO();
+
+    switch(m_State){
+        case REPLAYSTATE_CONNECT:
+            {
+                if(m_NetIO.Connected()){
+                    m_State = REPLAYSTATE_RUN;
+                }
+                break;
+            }
+        case REPLAYSTATE_RUN:
+        case REPLAYSTATE_WAITLOGIN:
+            {
+                if(!m_NetIO.Connected()){
+                    extern Log *g_Log;
+                    g_Log->AddLog(LOGTYPE_WARNING, "Replay of session %d disconnected", (int)(m_CaptureID));
+
+                    m_Stat->DisconnectCount++;
+                    m_State = REPLAYSTATE_DONE;
+                    return;
+                }
+                break;
+            }
+        default:
+            {
+                return;
+            }
+    }
+
+    while(true
+            && m_State == REPLAYSTATE_RUN
+            && m_FrameIndex < m_FrameList.size()
+            && m_FrameList[m_FrameIndex].Tick <= nNow){
+
+        const auto &rstFrame = m_FrameList[m_FrameIndex++];
+        SendFrame(rstFrame);
+
+        // lag shows if the replay can keep up with the capture
+        // it's meaningless at max speed since all frames are due at 0
+        m_Stat->LagList.push_back((uint32_t)(std::min<uint64_t>(nNow - rstFrame.Tick, 0XFFFFFFFF)));
+
+        if(rstFrame.HC == CM_LOGIN){
+            m_State = REPLAYSTATE_WAITLOGIN;
+        }
+    }
+
+    if(true
+            && m_State == REPLAYSTATE_RUN
+            && m_FrameIndex == m_FrameList.size()
+            && m_CloseTick
+            && m_CloseTick <= nNow){
+        Close();
+    }
+}
+
+void ReplaySession::Close()
+{
+    // shutdown is done by next PollIO()
+    // this can be called inside the read handler, which is already in poll
+    m_NetIO.StopIO();
+    m_State = REPLAYSTATE_DONE;
+}
+
+void ReplaySession::MapUID(uint32_t *pUID) const
+{
+    auto pRecord = m_UIDTable.find(*pUID);
+    if(pRecord != m_UIDTable.end()){
+        *pUID = pRecord->second;
+    }
+}
+
+void ReplaySession::SendFrame(const ReplayFrame &rstFrame)
+{
+    m_SendBuf.assign(m_DataBuf.begin() + rstFrame.Offset, m_DataBuf.begin() + rstFrame.Offset + rstFrame.DataLen);
+    switch(rstFrame.HC){
+        case CM_ACTION:
+            {
+                if(m_SendBuf.size() == sizeof(CMAction)){
+                    CMAction stCMA;
+                    std::memcpy(&stCMA, m_SendBuf.data(), sizeof(stCMA));
+
+                    MapUID(&stCMA.UID);
+                    MapUID(&stCMA.AimUID);
+                    std::memcpy(m_SendBuf.data(), &stCMA, sizeof(stCMA));
+                }
+                break;
+            }
+        case CM_QUERYCORECORD:
+            {
+                if(m_SendBuf.size() == sizeof(CMQueryCORecord)){
+                    CMQueryCORecord stCMQCOR;
+                    std::memcpy(&stCMQCOR, m_SendBuf.data(), sizeof(stCMQCOR));
+
+                    MapUID(&stCMQCOR.UID);
+                    std::memcpy(m_SendBuf.data(), &stCMQCOR, sizeof(stCMQCOR));
+                }
+                break;
+            }
+        case CM_PICKUP:
+            {
+                if(m_SendBuf.size() == sizeof(CMPickUp)){
+                    CMPickUp stCMPU;
+                    std::memcpy(&stCMPU, m_SendBuf.data(), sizeof(stCMPU));
+
+                    MapUID(&stCMPU.UID);
+                    std::memcpy(m_SendBuf.data(), &stCMPU, sizeof(stCMPU));
+                }
+                break;
+            }
+        default:
+            {
+                break;
+            }
+    }
+
+    if(m_NetIO.Send(rstFrame.HC, m_SendBuf.empty() ? nullptr : m_SendBuf.data(), m_SendBuf.size())){
+        m_Stat->SendCount++;
+    }
+}
+
+void ReplaySession::OnServerMessage(uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+{
+    if(nHC != SM_BUNDLE){
+        m_Stat->RecvCount++;
+    }
+
+    switch(nHC){
+        case SM_BUNDLE:
+            {
+                NetBundle::Unpack<SMSGParam>(pData, nDataLen, &m_BundleBuf, [this](uint8_t nBundleHC, const uint8_t *pBundleData, size_t nBundleDataLen)
+                {
+                    OnServerMessage(nBundleHC, pBundleData, nBundleDataLen);
+                });
+                break;
+            }
+        case SM_LOGINOK:
+            {
+                if(pData && (nDataLen == sizeof(SMLoginOK))){
+                    SMLoginOK stSMLOK;
+                    std::memcpy(&stSMLOK, pData, nDataLen);
+
+                    if(m_CaptureUID){
+                        m_UIDTable[m_CaptureUID] = stSMLOK.UID;
+                    }
+                }
+
+                if(m_State == REPLAYSTATE_WAITLOGIN){
+                    m_State = REPLAYSTATE_RUN;
+                }
+                break;
+            }
+        case SM_LOGINFAIL:
+            {
+                extern Log *g_Log;
+                g_Log->AddLog(LOGTYPE_WARNING, "Replay of session %d login failed", (int)(m_CaptureID));
+
+                m_Stat->LoginFailCount++;
+                Close();
+                break;
+            }
+        default:
+            {
+                break;
+            }
+    }
+}
@@ -0,0 +1,140 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: replaysession.hpp
+ *        Created: 10/18/2026 21:40:08
+ *  Last Modified: 10/18/2026 21:40:08
+ *
+ *    Description: one connection of the capture fed back to the server
+ *
+ *                 sends captured CM_* messages of one session in order, each message is
+ *                 sent when its due time comes, due time is decided by the caller:
+ *
+ *                      1. scaled capture tick for timed replay
+ *                      2. zero for replay at max speed
+ *
+ *                 messages after CM_LOGIN are held until SM_LOGINOK comes, otherwise
+ *                 the server drops them since the session is not bound to a player yet
+ *
+ *                 UID of player is decided by server, it's different from the capture
+ *                 UIDs in CM_ACTION / CM_QUERYCORECORD / CM_PICKUP are mapped by the UID
+ *                 table shared by all sessions, monster UIDs can't be mapped
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "netio.hpp"
+
+struct ReplayFrame
+{
+    uint64_t Tick;      // due time in us since replay starts
+    uint8_t  HC;
+
+    size_t Offset;      // data in the buffer shared by all frames
+    size_t DataLen;
+};
+
+struct ReplayStat
+{
+    uint64_t SendCount;
+    uint64_t RecvCount;
+    uint64_t LoginFailCount;
+    uint64_t DisconnectCount;
+
+    // delay of sending than the due time, in us
+    std::vector<uint32_t> LagList;
+
+    ReplayStat()
+        : SendCount(0)
+        , RecvCount(0)
+        , LoginFailCount(0)
+        , DisconnectCount(0)
+        , LagList()
+    {}
+};
+
+class ReplaySession final
+{
+    public:
+        enum: int
+        {
+            REPLAYSTATE_NONE = 0,
+            REPLAYSTATE_CONNECT,
+            REPLAYSTATE_RUN,
+            REPLAYSTATE_WAITLOGIN,
+            REPLAYSTATE_DONE,
+        };
+
+    private:
+        const uint32_t m_CaptureID;
+        const uint32_t m_CaptureUID;
+
+    private:
+        const std::vector<ReplayFrame> m_FrameList;
+        const std::vector<uint8_t>    &m_DataBuf;
+
+    private:
+        // time to close the connection after all frames sent
+        // session closed by server in capture closes at the same time
+        const uint64_t m_CloseTick;
+
+    private:
+        NetIO m_NetIO;
+
+    private:
+        int    m_State;
+        size_t m_FrameIndex;
+
+    private:
+        std::vector<uint8_t> m_SendBuf;
+        std::vector<uint8_t> m_BundleBuf;
+
+    private:
+        std::unordered_map<uint32_t, uint32_t> &m_UIDTable;
+        ReplayStat                             *m_Stat;
+
+    public:
+        ReplaySession(uint32_t, uint32_t, std::vector<ReplayFrame>, const std::vector<uint8_t> &, uint64_t, std::unordered_map<uint32_t, uint32_t> &, ReplayStat *);
+
+    public:
+        bool Launch(const char *, const char *);
+        void Update(uint64_t);
+
+    public:
+        int State() const
+        {
+            return m_State;
+        }
+
+        uint64_t LaunchTick() const
+        {
+            return m_FrameList.empty() ? 0 : m_FrameList.front().Tick;
+        }
+
+        bool Finished() const
+        {
+            return (m_State == REPLAYSTATE_DONE) || (m_FrameIndex == m_FrameList.size());
+        }
+
+    private:
+        void OnServerMessage(uint8_t, const uint8_t *, size_t);
+
+    private:
+        void SendFrame(const ReplayFrame &);
+        void MapUID(uint32_t *) const;
+
+    private:
+        void Close();
+};
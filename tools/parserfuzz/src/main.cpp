@@ -0,0 +1,520 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 10/18/2026 23:42:17
+ *  Last Modified: 10/18/2026 23:42:17
+ *
+ *    Description: feed byte streams to NetFrameParser by arbitrary chunks
+ *
+ *                      parserfuzz
+ *                      parserfuzz --capture=mir2x.cap --round=200
+ *
+ *                 messages of a capture by monoserver --capture=file, or random ones,
+ *                 are encoded the same way as Session / NetIO send them, the stream is
+ *                 then read by random chunk sizes, 1 byte per read included, result must
+ *                 be the same as parsing the whole stream by one read
+ *
+ *                 each round also checks a truncated stream, which should give all
+ *                 messages before the cut and keep the rest pending, and a random
+ *                 byte stream, which should give the same messages and the same error
+ *                 for whole and chunked reads
+ *
+ *                 after the check reports parsed messages per second by read size
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <algorithm>
+
+#include "message.hpp"
+#include "compress.hpp"
+#include "netcapture.hpp"
+#include "netframeparser.hpp"
+
+struct FuzzMessage
+{
+    uint8_t HC;
+    std::vector<uint8_t> Data;
+
+    bool operator == (const FuzzMessage &rstOther) const
+    {
+        return HC == rstOther.HC && Data == rstOther.Data;
+    }
+};
+
+// messages parsed out of a stream
+// Error is the return of the failed Parse(), stream after it is not checked
+struct ParseResult
+{
+    std::vector<FuzzMessage> MessageList;
+
+    bool   Error;
+    size_t PendingLen;
+};
+
+static uint64_t GetTimeUS()
+{
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void PrintUsage()
+{
+    std::printf("Usage: parserfuzz [--key=value] ...\n");
+    std::printf("    --capture=file          capture written by monoserver --capture=file, optional\n");
+    std::printf("    --round=100             rounds of random streams\n");
+    std::printf("    --count=2000            random messages per round\n");
+    std::printf("    --duration=500          ms to run for each read size in benchmark, 0 to skip\n");
+    std::printf("    --seed=1                seed of the random data\n");
+}
+
+static uint64_t g_Seed = 1;
+static uint32_t RandU32()
+{
+    g_Seed ^= g_Seed << 13;
+    g_Seed ^= g_Seed >>  7;
+    g_Seed ^= g_Seed << 17;
+    return (uint32_t)(g_Seed >> 32);
+}
+
+// mostly small reads as tcp segments, sometimes big ones
+static size_t RandChunk()
+{
+    switch(RandU32() % 4){
+        case 0  : return 1;
+        case 1  : return 1 + RandU32() % 16;
+        case 2  : return 1 + RandU32() % 1500;
+        default : return 1 + RandU32() % 70000;
+    }
+}
+
+// encode one message as Session::Send() and NetIO::Send() do
+// return false if it can't be sent, type 1 with more than 255 + 255 non-zero bytes
+template<typename MSGParam> static bool EncodeFrame(std::vector<uint8_t> *pStream, const FuzzMessage &rstMessage)
+{
+    MSGParam stMSG(rstMessage.HC);
+    switch(stMSG.Type()){
+        case 0:
+            {
+                pStream->push_back(rstMessage.HC);
+                return true;
+            }
+        case 1:
+            {
+                auto nCountData = Compress::CountData(rstMessage.Data.data(), rstMessage.Data.size());
+                if(nCountData < 0 || nCountData > 255 + 255){
+                    return false;
+                }
+
+                pStream->push_back(rstMessage.HC);
+                if(nCountData <= 254){
+                    pStream->push_back((uint8_t)(nCountData));
+                }else{
+                    pStream->push_back(255);
+                    pStream->push_back((uint8_t)(nCountData - 255));
+                }
+
+                auto nOffset = pStream->size();
+                pStream->resize(nOffset + stMSG.MaskLen() + nCountData);
+                Compress::Encode(pStream->data() + nOffset, rstMessage.Data.data(), rstMessage.Data.size());
+                return true;
+            }
+        case 2:
+            {
+                pStream->push_back(rstMessage.HC);
+                pStream->insert(pStream->end(), rstMessage.Data.begin(), rstMessage.Data.end());
+                return true;
+            }
+        case 3:
+            {
+                auto nDataLenU32 = (uint32_t)(rstMessage.Data.size());
+                uint8_t nLenBuf[4];
+                std::memcpy(nLenBuf, &nDataLenU32, 4);
+
+                pStream->push_back(rstMessage.HC);
+                pStream->insert(pStream->end(), nLenBuf, nLenBuf + 4);
+                pStream->insert(pStream->end(), rstMessage.Data.begin(), rstMessage.Data.end());
+                return true;
+            }
+        default:
+            {
+                return false;
+            }
+    }
+}
+
+// read the stream by chunks given by fnChunk
+// stop at the first error as the session closes the connection
+template<typename MSGParam, typename F> static ParseResult ParseStream(const std::vector<uint8_t> &rstStream, size_t nReadChunk, F &&fnChunk)
+{
+    ParseResult stResult {{}, false, 0};
+    NetFrameParser<MSGParam> stParser(nReadChunk);
+
+    auto fnOnMessage = [&stResult](uint8_t nHC, const uint8_t *pData, size_t nDataLen)
+    {
+        stResult.MessageList.push_back({nHC, std::vector<uint8_t>(pData, pData + nDataLen)});
+    };
+
+    size_t nOffset = 0;
+    while(nOffset < rstStream.size()){
+        auto nReadLen = std::min<size_t>({fnChunk(), stParser.WriteLen(), rstStream.size() - nOffset});
+        std::memcpy(stParser.WriteBuf(), rstStream.data() + nOffset, nReadLen);
+        stParser.Commit(nReadLen);
+        nOffset += nReadLen;
+
+        if(stParser.Parse(fnOnMessage) < 0){
+            stResult.Error = true;
+            break;
+        }
+    }
+
+    stResult.PendingLen = stParser.PendingLen();
+    return stResult;
+}
+
+template<typename MSGParam> static ParseResult ParseWhole(const std::vector<uint8_t> &rstStream)
+{
+    // parser buffer takes the whole stream by one read
+    return ParseStream<MSGParam>(rstStream, rstStream.size(), [&rstStream]() -> size_t
+    {
+        return rstStream.size();
+    });
+}
+
+template<typename MSGParam> static ParseResult ParseChunked(const std::vector<uint8_t> &rstStream)
+{
+    return ParseStream<MSGParam>(rstStream, 4096, []() -> size_t
+    {
+        return RandChunk();
+    });
+}
+
+template<typename MSGParam> static std::vector<uint8_t> RandomMessageHCList()
+{
+    // unknown HC gets the attribute of HC 0, skip them
+    // otherwise most random messages are empty ones
+    std::vector<uint8_t> stHCList;
+    for(int nHC = 0; nHC < 256; ++nHC){
+        MSGParam stMSG((uint8_t)(nHC));
+        if(true
+                && stMSG.Type() >= 0
+                && stMSG.Type() <= 3
+                && (nHC == 0 || stMSG.Name() != MSGParam(0).Name())){
+            stHCList.push_back((uint8_t)(nHC));
+        }
+    }
+    return stHCList;
+}
+
+template<typename MSGParam> static FuzzMessage RandomMessage(const std::vector<uint8_t> &rstHCList)
+{
+    FuzzMessage stMessage;
+    stMessage.HC = rstHCList[RandU32() % rstHCList.size()];
+
+    MSGParam stMSG(stMessage.HC);
+    switch(stMSG.Type()){
+        case 1:
+        case 2:
+            {
+                stMessage.Data.resize(stMSG.DataLen());
+                break;
+            }
+        case 3:
+            {
+                // mostly short as login, sometimes up to the limit
+                stMessage.Data.resize((RandU32() % 64) ? (RandU32() % 256) : (RandU32() % (SYS_MAXMSGLEN + 1)));
+                break;
+            }
+        default:
+            {
+                break;
+            }
+    }
+
+    auto nDensity = RandU32() % 101;
+    for(auto &rnByte: stMessage.Data){
+        rnByte = ((RandU32() % 100) < nDensity) ? (uint8_t)(RandU32()) : 0;
+    }
+    return stMessage;
+}
+
+// check one stream of valid messages, whole and chunked reads give all of them
+// then cut the stream and check messages before the cut
+template<typename MSGParam> static bool CheckMessageList(const char *szName, const std::vector<FuzzMessage> &rstMessageList)
+{
+    std::vector<uint8_t>     stStream;
+    std::vector<size_t>      stFrameEnd;
+    std::vector<FuzzMessage> stSentList;
+
+    for(auto &rstMessage: rstMessageList){
+        if(EncodeFrame<MSGParam>(&stStream, rstMessage)){
+            stSentList.push_back(rstMessage);
+            stFrameEnd.push_back(stStream.size());
+        }
+    }
+
+    auto stWhole = ParseWhole<MSGParam>(stStream);
+    if(stWhole.Error || stWhole.PendingLen || !(stWhole.MessageList == stSentList)){
+        std::printf("FAIL: %s, whole stream of %zu messages gives %zu, error %d\n", szName, stSentList.size(), stWhole.MessageList.size(), (int)(stWhole.Error));
+        return false;
+    }
+
+    auto stChunked = ParseChunked<MSGParam>(stStream);
+    if(stChunked.Error || stChunked.PendingLen || !(stChunked.MessageList == stSentList)){
+        std::printf("FAIL: %s, chunked stream of %zu messages gives %zu, error %d\n", szName, stSentList.size(), stChunked.MessageList.size(), (int)(stChunked.Error));
+        return false;
+    }
+
+    if(stStream.empty()){
+        return true;
+    }
+
+    // cut at a random byte, the half frame stays pending
+    auto nCut   = RandU32() % stStream.size();
+    auto nFull  = (size_t)(std::upper_bound(stFrameEnd.begin(), stFrameEnd.end(), nCut) - stFrameEnd.begin());
+    auto nStart = nFull ? stFrameEnd[nFull - 1] : 0;
+
+    std::vector<uint8_t> stCutStream(stStream.begin(), stStream.begin() + nCut);
+    auto stCut = ParseChunked<MSGParam>(stCutStream);
+
+    if(false
+            || stCut.Error
+            || stCut.PendingLen != nCut - nStart
+            || stCut.MessageList.size() != nFull
+            || !std::equal(stCut.MessageList.begin(), stCut.MessageList.end(), stSentList.begin())){
+        std::printf("FAIL: %s, stream cut at %zu of %zu gives %zu messages and %zu pending, expect %zu and %zu\n",
+                szName, (size_t)(nCut), stStream.size(), stCut.MessageList.size(), stCut.PendingLen, nFull, nCut - nStart);
+        return false;
+    }
+    return true;
+}
+
+// random bytes, mostly corrupted
+// no expected messages, whole and chunked reads should agree
+template<typename MSGParam> static bool CheckRandomBytes(const char *szName, size_t nStreamLen)
+{
+    std::vector<uint8_t> stStream(nStreamLen);
+    for(auto &rnByte: stStream){
+        rnByte = (uint8_t)(RandU32());
+    }
+
+    auto stWhole   = ParseWhole  <MSGParam>(stStream);
+    auto stChunked = ParseChunked<MSGParam>(stStream);
+
+    // after an error the pending length depends on where the read stops
+    if(false
+            || stWhole.Error != stChunked.Error
+            || !(stWhole.MessageList == stChunked.MessageList)
+            || (!stWhole.Error && stWhole.PendingLen != stChunked.PendingLen)){
+        std::printf("FAIL: %s, random bytes give %zu messages (error %d) by whole read, %zu (error %d) by chunked\n",
+                szName, stWhole.MessageList.size(), (int)(stWhole.Error), stChunked.MessageList.size(), (int)(stChunked.Error));
+        return false;
+    }
+    return true;
+}
+
+template<typename MSGParam> static bool RunRandomCheck(const char *szName, int nRound, int nCount)
+{
+    auto stHCList = RandomMessageHCList<MSGParam>();
+    for(int nIndex = 0; nIndex < nRound; ++nIndex){
+        std::vector<FuzzMessage> stMessageList;
+        for(int nMessage = 0; nMessage < nCount; ++nMessage){
+            stMessageList.push_back(RandomMessage<MSGParam>(stHCList));
+        }
+
+        if(!CheckMessageList<MSGParam>(szName, stMessageList)){
+            return false;
+        }
+
+        if(!CheckRandomBytes<MSGParam>(szName, 1 + RandU32() % 100000)){
+            return false;
+        }
+    }
+
+    std::printf("check    : %s, %d rounds of %d random messages and random bytes passed\n", szName, nRound, nCount);
+    return true;
+}
+
+// report parsed messages per second, read size 0 means the whole stream by one read
+template<typename MSGParam> static void RunBench(const char *szName, const std::vector<FuzzMessage> &rstMessageList, int nDuration)
+{
+    std::vector<uint8_t> stStream;
+    size_t nMessageCount = 0;
+
+    for(auto &rstMessage: rstMessageList){
+        if(EncodeFrame<MSGParam>(&stStream, rstMessage)){
+            nMessageCount++;
+        }
+    }
+
+    if(stStream.empty()){
+        return;
+    }
+
+    std::printf("\n");
+    std::printf("bench    : %s, %zu messages, %zu bytes\n", szName, nMessageCount, stStream.size());
+    std::printf("%10s %14s %12s\n", "read", "msg/s", "MB/s");
+
+    for(size_t nReadSize: {(size_t)(64), (size_t)(1460), (size_t)(4096), (size_t)(65536), (size_t)(0)}){
+        uint64_t nParsed = 0;
+        uint64_t nBytes  = 0;
+
+        auto nStartTime = GetTimeUS();
+        auto nDoneTime  = nStartTime + (uint64_t)(nDuration) * 1000;
+        auto nCurrTime  = nStartTime;
+
+        while(nCurrTime < nDoneTime){
+            NetFrameParser<MSGParam> stParser(nReadSize ? 4096 : stStream.size());
+            auto fnOnMessage = [&nParsed](uint8_t, const uint8_t *, size_t)
+            {
+                nParsed++;
+            };
+
+            for(size_t nOffset = 0; nOffset < stStream.size();){
+                auto nReadLen = std::min<size_t>({nReadSize ? nReadSize : stStream.size(), stParser.WriteLen(), stStream.size() - nOffset});
+                std::memcpy(stParser.WriteBuf(), stStream.data() + nOffset, nReadLen);
+                stParser.Commit(nReadLen);
+                stParser.Parse(fnOnMessage);
+                nOffset += nReadLen;
+            }
+
+            nBytes   += stStream.size();
+            nCurrTime = GetTimeUS();
+        }
+
+        auto fSecond = std::max<double>((nCurrTime - nStartTime) / 1000000.0, 1e-6);
+        std::printf("%10s %14.0f %12.1f\n", nReadSize ? std::to_string(nReadSize).c_str() : "whole", nParsed / fSecond, nBytes / fSecond / 1000000.0);
+    }
+}
+
+static bool LoadCapture(const char *szFileName, std::vector<FuzzMessage> *pCMList, std::vector<FuzzMessage> *pSMList)
+{
+    NetCaptureReader stReader;
+    if(!stReader.Open(szFileName)){
+        std::printf("can't open capture: %s\n", szFileName);
+        return false;
+    }
+
+    NetCapture::RecordHead stHead;
+    std::vector<uint8_t>   stData;
+
+    while(true){
+        auto nRet = stReader.Read(&stHead, &stData);
+        if(nRet == 0){
+            return true;
+        }
+
+        if(nRet < 0){
+            std::printf("capture is truncated or corrupted, use records before it\n");
+            return true;
+        }
+
+        switch(stHead.Dir){
+            case NetCapture::DIR_CM : pCMList->push_back({stHead.HC, stData}); break;
+            case NetCapture::DIR_SM : pSMList->push_back({stHead.HC, stData}); break;
+            default                 :                                          break;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    std::string szCapture;
+
+    int nRound    = 100;
+    int nCount    = 2000;
+    int nDuration = 500;
+
+    for(int nIndex = 1; nIndex < argc; ++nIndex){
+        std::string szArg = argv[nIndex];
+        if(szArg == "--help"){
+            PrintUsage();
+            return 0;
+        }
+
+        auto nLoc = szArg.find('=');
+        if(szArg.compare(0, 2, "--") || nLoc == std::string::npos){
+            std::printf("invalid option: %s, expect --key=value\n", szArg.c_str());
+            PrintUsage();
+            return 1;
+        }
+
+        auto szKey   = szArg.substr(2, nLoc - 2);
+        auto szValue = szArg.substr(nLoc + 1);
+
+        if(szKey == "capture" ){ szCapture = szValue;                                         continue; }
+        if(szKey == "round"   ){ nRound    = std::atoi(szValue.c_str());                      continue; }
+        if(szKey == "count"   ){ nCount    = std::atoi(szValue.c_str());                      continue; }
+        if(szKey == "duration"){ nDuration = std::atoi(szValue.c_str());                      continue; }
+        if(szKey == "seed"    ){ g_Seed    = std::strtoull(szValue.c_str(), nullptr, 10) | 1; continue; }
+
+        std::printf("unknown option: %s\n", szArg.c_str());
+        PrintUsage();
+        return 1;
+    }
+
+    if(nRound < 0 || nCount <= 0 || nDuration < 0){
+        PrintUsage();
+        return 1;
+    }
+
+    std::vector<FuzzMessage> stCMList;
+    std::vector<FuzzMessage> stSMList;
+
+    if(!szCapture.empty()){
+        if(!LoadCapture(szCapture.c_str(), &stCMList, &stSMList)){
+            return 1;
+        }
+
+        std::printf("capture  : %zu client messages, %zu server messages\n", stCMList.size(), stSMList.size());
+        for(int nIndex = 0; nIndex < std::max<int>(1, nRound / 10); ++nIndex){
+            if(false
+                    || !CheckMessageList<CMSGParam>("capture CM", stCMList)
+                    || !CheckMessageList<SMSGParam>("capture SM", stSMList)){
+                return 1;
+            }
+        }
+        std::printf("check    : capture streams passed\n");
+    }
+
+    if(false
+            || !RunRandomCheck<CMSGParam>("random CM", nRound, nCount)
+            || !RunRandomCheck<SMSGParam>("random SM", nRound, nCount)){
+        return 1;
+    }
+
+    if(nDuration > 0){
+        if(stCMList.empty()){
+            auto stHCList = RandomMessageHCList<CMSGParam>();
+            for(int nIndex = 0; nIndex < nCount; ++nIndex){
+                stCMList.push_back(RandomMessage<CMSGParam>(stHCList));
+            }
+        }
+
+        if(stSMList.empty()){
+            auto stHCList = RandomMessageHCList<SMSGParam>();
+            for(int nIndex = 0; nIndex < nCount; ++nIndex){
+                stSMList.push_back(RandomMessage<SMSGParam>(stHCList));
+            }
+        }
+
+        RunBench<CMSGParam>(szCapture.empty() ? "random CM" : "capture CM", stCMList, nDuration);
+        RunBench<SMSGParam>(szCapture.empty() ? "random SM" : "capture SM", stSMList, nDuration);
+    }
+    return 0;
+}
@@ -0,0 +1,535 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 10/18/2026 08:20:37
+ *  Last Modified: 10/18/2026 08:20:37
+ *
+ *    Description: compare GridPathFinder with AStarPathFinder on server path queries
+ *
+ *                      pathbench
+ *                      pathbench --map=DESC.bin --range=12,40 --count=500 --budget=0
+ *
+ *                 map is loaded from a Mir2xMapData .bin file if given, otherwise a
+ *                 synthetic one of buildings, walls and rocks is generated, CO and
+ *                 locked cells are put at random
+ *
+ *                 AStarPathFinder uses the checker and cost of the removed
+ *                 ServerMap::ServerPathFinder, GridPathFinder gets the same cell state
+ *                 as PathService, both are run on the same random queries
+ *
+ *                 for queries both engines solved, paths are checked to be valid and
+ *                 the path costs are compared, the turn cost is not counted when JPS
+ *                 is used since JPS ignores it
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+
+#include "sysconst.hpp"
+#include "mathfunc.hpp"
+#include "groundmask.hpp"
+#include "pathfinder.hpp"
+#include "mir2xmapdata.hpp"
+#include "gridpathfinder.hpp"
+
+static uint64_t GetTimeUS()
+{
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void PrintUsage()
+{
+    std::printf("Usage: pathbench [--key=value] ...\n");
+    std::printf("    --map=                  Mir2xMapData .bin file, synthetic 400 x 400 map if not given\n");
+    std::printf("    --range=12,40           max distance of start and goal in each coordinate\n");
+    std::printf("    --count=500             queries of each range\n");
+    std::printf("    --budget=%-4d           node budget of GridPathFinder, 0 for no limit\n", SYS_MAXPATHEXPAND);
+    std::printf("    --co=3.3                percent of cells with CO\n");
+    std::printf("    --lock=0.5              percent of locked cells\n");
+    std::printf("    --seed=7                seed of the map and queries\n");
+}
+
+static uint64_t g_Seed = 7;
+static uint32_t RandU32()
+{
+    g_Seed ^= g_Seed << 13;
+    g_Seed ^= g_Seed >>  7;
+    g_Seed ^= g_Seed << 17;
+    return (uint32_t)(g_Seed >> 32);
+}
+
+static std::vector<int> ParseIntList(const std::string &szValue)
+{
+    std::vector<int> stList;
+    for(size_t nBegin = 0; nBegin < szValue.size();){
+        auto nEnd = szValue.find(',', nBegin);
+        if(nEnd == std::string::npos){
+            nEnd = szValue.size();
+        }
+
+        auto nValue = std::atoi(szValue.substr(nBegin, nEnd - nBegin).c_str());
+        if(nValue > 0){
+            stList.push_back(nValue);
+        }
+        nBegin = nEnd + 1;
+    }
+    return stList;
+}
+
+// buildings as rectangles, thin walls and rocks
+// cell is walkable if bit 23 of Param is set, see Mir2xMapData::CELL::CanWalk()
+static void MakeSyntheticMap(Mir2xMapData *pMapData, int nW, int nH)
+{
+    pMapData->Allocate((uint16_t)(nW), (uint16_t)(nH));
+    for(int nY = 0; nY < nH; ++nY){
+        for(int nX = 0; nX < nW; ++nX){
+            pMapData->Cell(nX, nY).Param |= 0X00800000;
+        }
+    }
+
+    auto fnBlock = [pMapData, nW, nH](int nX, int nY)
+    {
+        if(true
+                && nX >= 0
+                && nY >= 0
+                && nX < nW
+                && nY < nH){
+            pMapData->Cell(nX, nY).Param &= ~(uint32_t)(0X00800000);
+        }
+    };
+
+    for(int nIndex = 0; nIndex < nW * nH / 178; ++nIndex){
+        int nX0 = (int)(RandU32() % nW);
+        int nY0 = (int)(RandU32() % nH);
+        int nBW = (int)(2 + RandU32() % 12);
+        int nBH = (int)(2 + RandU32() % 12);
+        for(int nY = nY0; nY < nY0 + nBH; ++nY){
+            for(int nX = nX0; nX < nX0 + nBW; ++nX){
+                fnBlock(nX, nY);
+            }
+        }
+    }
+
+    for(int nIndex = 0; nIndex < nW * nH / 800; ++nIndex){
+        int  nX0    = (int)(RandU32() % nW);
+        int  nY0    = (int)(RandU32() % nH);
+        int  nLen   = (int)(10 + RandU32() % 40);
+        bool bHoriz = (RandU32() % 2) != 0;
+        for(int nStep = 0; nStep < nLen; ++nStep){
+            fnBlock(nX0 + (bHoriz ? nStep : 0), nY0 + (bHoriz ? 0 : nStep));
+        }
+    }
+
+    for(int nIndex = 0; nIndex < nW * nH / 20; ++nIndex){
+        fnBlock((int)(RandU32() % nW), (int)(RandU32() % nH));
+    }
+}
+
+class PathBench final
+{
+    private:
+        const GroundMask &m_Ground;
+
+    private:
+        std::vector<uint8_t> m_COV;
+        std::vector<uint8_t> m_LockV;
+
+    public:
+        PathBench(const GroundMask &rstGround, double fCO, double fLock)
+            : m_Ground(rstGround)
+            , m_COV((size_t)(rstGround.W()) * (size_t)(rstGround.H()), 0)
+            , m_LockV((size_t)(rstGround.W()) * (size_t)(rstGround.H()), 0)
+        {
+            for(auto &nCO: m_COV){
+                nCO = (RandU32() % 10000) < (uint32_t)(fCO * 100.0);
+            }
+
+            for(auto &nLock: m_LockV){
+                nLock = (RandU32() % 10000) < (uint32_t)(fLock * 100.0);
+            }
+        }
+
+    public:
+        bool CellHasCO(int nX, int nY) const
+        {
+            return m_COV[nY * m_Ground.W() + nX];
+        }
+
+        bool CellLocked(int nX, int nY) const
+        {
+            return m_LockV[nY * m_Ground.W() + nX];
+        }
+
+    public:
+        // ServerMap::MoveCost(true, true, true, ...)
+        double MoveCost(int nX0, int nY0, int nX1, int nY1) const
+        {
+            int nMaxIndex = -1;
+            switch(LDistance2(nX0, nY0, nX1, nY1)){
+                case  1: case  2: nMaxIndex = 1; break;
+                case  4: case  8: nMaxIndex = 2; break;
+                case  9: case 18: nMaxIndex = 3; break;
+                default         : return 10000.00;
+            }
+
+            if(!m_Ground.LineValid(nX0, nY0, nX1, nY1)){
+                return 10000.00;
+            }
+
+            int nDX = (nX1 > nX0) - (nX1 < nX0);
+            int nDY = (nY1 > nY0) - (nY1 < nY0);
+
+            double fMoveCost = 0.0;
+            for(int nIndex = 0; nIndex <= nMaxIndex; ++nIndex){
+                auto nCurrX = nX0 + nDX * nIndex;
+                auto nCurrY = nY0 + nDY * nIndex;
+
+                bool bCheckCurrLock = (nIndex == 0) || (nIndex == nMaxIndex);
+                if(false
+                        || CellHasCO(nCurrX, nCurrY)
+                        || (bCheckCurrLock && CellLocked(nCurrX, nCurrY))){
+                    fMoveCost += 100.00;
+                }else{
+                    fMoveCost += 1.00;
+                }
+            }
+            return fMoveCost;
+        }
+
+        // cost lambda of ServerMap::ServerPathFinder
+        double HopCost(int nX0, int nY0, int nX1, int nY1, bool bCheckCO) const
+        {
+            double fExtraPen = 0.00;
+            switch(LDistance2(nX0, nY0, nX1, nY1)){
+                case  1: fExtraPen = 0.00 + 0.01; break;
+                case  2: fExtraPen = 0.10 + 0.01; break;
+                case  4: fExtraPen = 0.00 + 0.02; break;
+                case  8: fExtraPen = 0.10 + 0.02; break;
+                case  9: fExtraPen = 0.00 + 0.03; break;
+                case 18: fExtraPen = 0.10 + 0.03; break;
+                default: return 10000.00;
+            }
+            return (bCheckCO ? MoveCost(nX0, nY0, nX1, nY1) : 1.00) + fExtraPen;
+        }
+
+        // cost of the path by the model of AStarPathFinderNode::GetCost()
+        // return -1.0 if any hop is invalid
+        double PathCost(const std::vector<PathFind::PathNode> &rstPathV, int nMaxStep, bool bCheckCO, bool bTurnCost) const
+        {
+            double fCost   = 0.00;
+            int    nOldDir = -1;
+
+            for(size_t nIndex = 1; nIndex < rstPathV.size(); ++nIndex){
+                auto &rstNode0 = rstPathV[nIndex - 1];
+                auto &rstNode1 = rstPathV[nIndex    ];
+
+                auto nDistance2 = LDistance2(rstNode0.X, rstNode0.Y, rstNode1.X, rstNode1.Y);
+                if(false
+                        || !m_Ground.LineValid(rstNode0.X, rstNode0.Y, rstNode1.X, rstNode1.Y)
+                        || !(false
+                            || nDistance2 == 1
+                            || nDistance2 == 2
+                            || nDistance2 == nMaxStep * nMaxStep
+                            || nDistance2 == nMaxStep * nMaxStep * 2)){
+                    return -1.00;
+                }
+
+                fCost += HopCost(rstNode0.X, rstNode0.Y, rstNode1.X, rstNode1.Y, bCheckCO);
+
+                auto nNewDir = PathFind::GetDirection(rstNode0.X, rstNode0.Y, rstNode1.X, rstNode1.Y) - (DIR_NONE + 1);
+                if(bTurnCost && nOldDir >= 0){
+                    auto nDDir = ((nNewDir - nOldDir) + 8) % 8;
+                    fCost += std::min<int>(nDDir, 8 - nDDir);
+                }
+                nOldDir = nNewDir;
+            }
+            return fCost;
+        }
+
+    public:
+        bool SearchAStar(int nX0, int nY0, int nX1, int nY1, int nMaxStep, bool bCheckCO, std::vector<PathFind::PathNode> *pPathV) const
+        {
+            AStarPathFinder stFinder([this](int nSrcX, int nSrcY, int nDstX, int nDstY) -> bool
+            {
+                return m_Ground.LineValid(nSrcX, nSrcY, nDstX, nDstY);
+            },
+
+            [this, bCheckCO](int nSrcX, int nSrcY, int nDstX, int nDstY) -> double
+            {
+                return HopCost(nSrcX, nSrcY, nDstX, nDstY, bCheckCO);
+            }, nMaxStep);
+
+            pPathV->clear();
+            if(stFinder.Search(nX0, nY0, nX1, nY1) && stFinder.GetSolutionStart()){
+                pPathV->emplace_back(nX0, nY0);
+                while(auto pNode = stFinder.GetSolutionNext()){
+                    pPathV->emplace_back(pNode->X(), pNode->Y());
+                }
+                return true;
+            }
+            return false;
+        }
+
+        // cell state as PathService with CO everywhere
+        int SearchGrid(GridPathFinder *pFinder, int nX0, int nY0, int nX1, int nY1, int nMaxStep, bool bCheckCO, size_t nBudget) const
+        {
+            return pFinder->Search(m_Ground.W(), m_Ground.H(), nX0, nY0, nX1, nY1, nMaxStep, bCheckCO, nBudget, [this, bCheckCO](int nX, int nY) -> uint8_t
+            {
+                if(!m_Ground.Valid(nX, nY)){
+                    return GridPathFinder::CELL_BLOCK;
+                }
+
+                uint8_t nState = GridPathFinder::CELL_FREE;
+                if(bCheckCO){
+                    if(CellHasCO(nX, nY)){
+                        nState |= GridPathFinder::CELL_CO;
+                    }
+
+                    if(CellLocked(nX, nY)){
+                        nState |= GridPathFinder::CELL_LOCK;
+                    }
+                }
+                return nState;
+            });
+        }
+};
+
+struct RowResult
+{
+    double AllSpeedup;
+    double BothSpeedup;
+    double CostDiff;
+    double MaxWorse;
+};
+
+static bool RunRow(const PathBench &rstBench, const std::vector<std::array<int, 4>> &rstQueryV, int nMaxStep, bool bCheckCO, size_t nBudget, RowResult *pResult)
+{
+    GridPathFinder stGridFinder;
+    std::vector<PathFind::PathNode> stAStarPathV;
+
+    uint64_t nAStarUS     = 0;
+    uint64_t nGridUS      = 0;
+    uint64_t nBothAStarUS = 0;
+    uint64_t nBothGridUS  = 0;
+
+    int nAStarDone = 0;
+    int nGridDone  = 0;
+    int nBothDone  = 0;
+    int nWorse     = 0;
+    int nBetter    = 0;
+
+    double fAStarSum   = 0.00;
+    double fGridSum    = 0.00;
+    double fMaxWorse   = 0.00;
+
+    auto bJPS = (nMaxStep == 1) && !bCheckCO;
+    for(auto &rstQuery: rstQueryV){
+        auto nTime0  = GetTimeUS();
+        auto bAStar  = rstBench.SearchAStar(rstQuery[0], rstQuery[1], rstQuery[2], rstQuery[3], nMaxStep, bCheckCO, &stAStarPathV);
+        auto nTime1  = GetTimeUS();
+        auto bGrid   = rstBench.SearchGrid(&stGridFinder, rstQuery[0], rstQuery[1], rstQuery[2], rstQuery[3], nMaxStep, bCheckCO, nBudget) == GridPathFinder::SEARCH_SUCCEEDED;
+        auto nTime2  = GetTimeUS();
+
+        nAStarUS += (nTime1 - nTime0);
+        nGridUS  += (nTime2 - nTime1);
+
+        nAStarDone += (bAStar ? 1 : 0);
+        nGridDone  += (bGrid  ? 1 : 0);
+
+        if(!(bAStar && bGrid)){
+            continue;
+        }
+
+        nBothDone++;
+        nBothAStarUS += (nTime1 - nTime0);
+        nBothGridUS  += (nTime2 - nTime1);
+
+        auto &rstGridPathV = stGridFinder.Path();
+        if(false
+                || rstGridPathV.empty()
+                || rstGridPathV.front().X != rstQuery[0]
+                || rstGridPathV.front().Y != rstQuery[1]
+                || rstGridPathV.back ().X != rstQuery[2]
+                || rstGridPathV.back ().Y != rstQuery[3]){
+            std::printf("FAIL: grid path of (%d, %d) -> (%d, %d) has wrong ends\n", rstQuery[0], rstQuery[1], rstQuery[2], rstQuery[3]);
+            return false;
+        }
+
+        // JPS path is in single steps
+        auto fGridCost  = rstBench.PathCost(rstGridPathV, bJPS ? 1 : nMaxStep, bCheckCO, !bJPS);
+        auto fAStarCost = rstBench.PathCost(stAStarPathV, nMaxStep, bCheckCO, !bJPS);
+
+        if(fGridCost < 0.00){
+            std::printf("FAIL: grid path of (%d, %d) -> (%d, %d) has invalid hop\n", rstQuery[0], rstQuery[1], rstQuery[2], rstQuery[3]);
+            return false;
+        }
+
+        fGridSum  += fGridCost;
+        fAStarSum += fAStarCost;
+
+        if(fGridCost > fAStarCost + 0.001){ nWorse++;  }
+        if(fGridCost < fAStarCost - 0.001){ nBetter++; }
+
+        // grid can be better by a lot since stlastar keeps one state per cell with path dependent turn cost
+        // only the worse side is a regression
+        if(fAStarCost > 0.00){
+            fMaxWorse = std::max<double>(fMaxWorse, (fGridCost - fAStarCost) / fAStarCost);
+        }
+    }
+
+    auto fAllAStarUS  = (double)(nAStarUS)     / rstQueryV.size();
+    auto fAllGridUS   = (double)(nGridUS)      / rstQueryV.size();
+    auto fBothAStarUS = (double)(nBothAStarUS) / std::max<int>(nBothDone, 1);
+    auto fBothGridUS  = (double)(nBothGridUS)  / std::max<int>(nBothDone, 1);
+
+    pResult->AllSpeedup  = fAllAStarUS  / std::max<double>(fAllGridUS,  0.001);
+    pResult->BothSpeedup = fBothAStarUS / std::max<double>(fBothGridUS, 0.001);
+    pResult->CostDiff    = (fAStarSum > 0.00) ? (fGridSum - fAStarSum) / fAStarSum : 0.00;
+    pResult->MaxWorse    = fMaxWorse;
+
+    char szAll [64];
+    char szBoth[64];
+    std::snprintf(szAll,  sizeof(szAll),  "%.0f / %.0f (%.1fx)", fAllAStarUS,  fAllGridUS,  pResult->AllSpeedup);
+    std::snprintf(szBoth, sizeof(szBoth), "%.0f / %.0f (%.1fx)", fBothAStarUS, fBothGridUS, pResult->BothSpeedup);
+
+    std::printf("%4d %3s %4s %24s %24s %7d %7d %8.2f%% %8.2f%% %6d %6d\n",
+            nMaxStep, bCheckCO ? "co" : "-", bJPS ? "JPS" : "", szAll, szBoth, nAStarDone, nGridDone, pResult->CostDiff * 100.0, fMaxWorse * 100.0, nWorse, nBetter);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string szMapName;
+    std::vector<int> stRangeList {12, 40};
+
+    int    nCount  = 500;
+    int    nBudget = SYS_MAXPATHEXPAND;
+    double fCO     = 3.3;
+    double fLock   = 0.5;
+
+    for(int nIndex = 1; nIndex < argc; ++nIndex){
+        std::string szArg = argv[nIndex];
+        if(szArg == "--help"){
+            PrintUsage();
+            return 0;
+        }
+
+        auto nLoc = szArg.find('=');
+        if(szArg.compare(0, 2, "--") || nLoc == std::string::npos){
+            std::printf("invalid option: %s, expect --key=value\n", szArg.c_str());
+            PrintUsage();
+            return 1;
+        }
+
+        auto szKey   = szArg.substr(2, nLoc - 2);
+        auto szValue = szArg.substr(nLoc + 1);
+
+        if(szKey == "map"   ){ szMapName   = szValue;                                         continue; }
+        if(szKey == "range" ){ stRangeList = ParseIntList(szValue);                           continue; }
+        if(szKey == "count" ){ nCount      = std::atoi(szValue.c_str());                      continue; }
+        if(szKey == "budget"){ nBudget     = std::atoi(szValue.c_str());                      continue; }
+        if(szKey == "co"    ){ fCO         = std::atof(szValue.c_str());                      continue; }
+        if(szKey == "lock"  ){ fLock       = std::atof(szValue.c_str());                      continue; }
+        if(szKey == "seed"  ){ g_Seed      = std::strtoull(szValue.c_str(), nullptr, 10) | 1; continue; }
+
+        std::printf("unknown option: %s\n", szArg.c_str());
+        PrintUsage();
+        return 1;
+    }
+
+    if(false
+            || stRangeList.empty()
+            || nCount  <= 0
+            || nBudget <  0){
+        PrintUsage();
+        return 1;
+    }
+
+    Mir2xMapData stMapData;
+    if(!szMapName.empty()){
+        if(!stMapData.Load(szMapName.c_str())){
+            std::printf("failed to load map: %s\n", szMapName.c_str());
+            return 1;
+        }
+    }else{
+        MakeSyntheticMap(&stMapData, 400, 400);
+    }
+
+    GroundMask stGround(stMapData);
+    PathBench  stBench(stGround, fCO, fLock);
+
+    int nValidCount = 0;
+    for(int nY = 0; nY < stGround.H(); ++nY){
+        for(int nX = 0; nX < stGround.W(); ++nX){
+            nValidCount += (stGround.Valid(nX, nY) ? 1 : 0);
+        }
+    }
+
+    if(!nValidCount){
+        std::printf("no walkable cell in map\n");
+        return 1;
+    }
+
+    std::printf("map      : %s, %d x %d, %.1f%% blocked, CO on %.1f%%, locked %.1f%%, budget %d\n",
+            szMapName.empty() ? "synthetic" : szMapName.c_str(), stGround.W(), stGround.H(), 100.0 - 100.0 * nValidCount / (stGround.W() * stGround.H()), fCO, fLock, nBudget);
+
+    double fMinSpeedup = 0.00;
+    double fMaxSpeedup = 0.00;
+    double fMaxDiff    = 0.00;
+    double fMaxWorse   = 0.00;
+
+    for(auto nRange: stRangeList){
+        // both ends walkable, start and goal can be the same
+        std::vector<std::array<int, 4>> stQueryV;
+        while((int)(stQueryV.size()) < nCount){
+            int nX0 = (int)(RandU32() % stGround.W());
+            int nY0 = (int)(RandU32() % stGround.H());
+            int nX1 = nX0 + (int)(RandU32() % (2 * nRange + 1)) - nRange;
+            int nY1 = nY0 + (int)(RandU32() % (2 * nRange + 1)) - nRange;
+
+            if(stGround.Valid(nX0, nY0) && stGround.Valid(nX1, nY1)){
+                stQueryV.push_back({nX0, nY0, nX1, nY1});
+            }
+        }
+
+        std::printf("\n");
+        std::printf("range %d, %d queries, us per query of stlastar / grid, cost diff of grid to stlastar on queries both solved\n", nRange, nCount);
+        std::printf("%4s %3s %4s %24s %24s %7s %7s %9s %9s %6s %6s\n", "step", "co", "", "all", "both solved", "stlastar", "grid", "sum diff", "max worse", "worse", "better");
+
+        for(int nMaxStep = 1; nMaxStep <= 3; ++nMaxStep){
+            for(int nCheckCO = 0; nCheckCO < 2; ++nCheckCO){
+                RowResult stResult;
+                if(!RunRow(stBench, stQueryV, nMaxStep, nCheckCO != 0, (size_t)(nBudget), &stResult)){
+                    return 1;
+                }
+
+                fMinSpeedup = (fMinSpeedup == 0.00) ? stResult.BothSpeedup : std::min<double>(fMinSpeedup, stResult.BothSpeedup);
+                fMaxSpeedup = std::max<double>(fMaxSpeedup, stResult.BothSpeedup);
+                fMaxDiff    = std::max<double>(fMaxDiff, std::fabs(stResult.CostDiff));
+                fMaxWorse   = std::max<double>(fMaxWorse, stResult.MaxWorse);
+            }
+        }
+    }
+
+    std::printf("\n");
+    std::printf("summary  : grid is %.1fx ~ %.1fx faster on queries both solved\n", fMinSpeedup, fMaxSpeedup);
+    std::printf("summary  : sum of path cost differs by %.2f%% at most, one grid path is at most %.2f%% worse\n", fMaxDiff * 100.0, fMaxWorse * 100.0);
+    return 0;
+}
@@ -0,0 +1,456 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 10/18/2026 08:05:12
+ *  Last Modified: 10/18/2026 08:05:12
+ *
+ *    Description: per message cost of the send queue with and without callback
+ *
+ *                      sendbench
+ *                      sendbench --count=1000000 --batch=16 --size=128 --pool=0
+ *
+ *                 one round does what Session does without asio: Send() copies the
+ *                 message to the memory pool and pushes a task under the queue lock,
+ *                 the drain swaps the queues, releases the batch, takes the callbacks
+ *                 from the table and invokes them
+ *
+ *                 the legacy column is the SendTask before DoneTable, it carries the
+ *                 callback by std::function and is queued in std::queue
+ *
+ *                 global operator new is counted, the first round warms up the pool,
+ *                 queues and table, after it sending must not touch the heap at all
+ *                 except a callback capturing more than std::function keeps inline
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <new>
+#include <mutex>
+#include <queue>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cinttypes>
+#include <functional>
+#include <type_traits>
+
+#include "donetable.hpp"
+#include "memorychunkpn.hpp"
+
+// count of heap allocations by any thread
+// the bench is single-threaded but the counter is cheap enough to be atomic
+static std::atomic<uint64_t> g_HeapAllocCount(0);
+
+void *operator new(std::size_t nSize)
+{
+    g_HeapAllocCount.fetch_add(1, std::memory_order_relaxed);
+    if(auto pData = std::malloc(nSize ? nSize : 1)){
+        return pData;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t nSize)
+{
+    return operator new(nSize);
+}
+
+void operator delete(void *pData) noexcept
+{
+    std::free(pData);
+}
+
+void operator delete[](void *pData) noexcept
+{
+    std::free(pData);
+}
+
+void operator delete(void *pData, std::size_t) noexcept
+{
+    std::free(pData);
+}
+
+void operator delete[](void *pData, std::size_t) noexcept
+{
+    std::free(pData);
+}
+
+// copy messages to the memory pool as Session does
+static bool g_UsePool = true;
+
+// send queue of Session, only the part on the path of each message
+// coalescing, bundling and watermarks are skipped, they don't allocate either
+class SendQueue final
+{
+    private:
+        struct SendTask
+        {
+            uint8_t  HC;
+            uint32_t DoneToken;
+            uint64_t Key;
+
+            const uint8_t *Data;
+            size_t         DataLen;
+            const void    *Shared;
+        };
+
+        static_assert(std::is_pod<SendTask>::value, "SendTask should be trivial to keep sending free of heap allocation");
+
+    private:
+        std::mutex m_NextQLock;
+
+    private:
+        std::vector<SendTask>  m_SendQBuf0;
+        std::vector<SendTask>  m_SendQBuf1;
+        std::vector<SendTask> *m_CurrSendQ;
+        std::vector<SendTask> *m_NextSendQ;
+
+    private:
+        DoneTable                          m_DoneTable;
+        std::vector<std::function<void()>> m_DoneCallV;
+
+    private:
+        MemoryChunkPN<64, 256, 2> m_MemoryPN;
+
+    public:
+        SendQueue()
+            : m_NextQLock()
+            , m_SendQBuf0()
+            , m_SendQBuf1()
+            , m_CurrSendQ(&m_SendQBuf0)
+            , m_NextSendQ(&m_SendQBuf1)
+            , m_DoneTable()
+            , m_DoneCallV()
+            , m_MemoryPN()
+        {}
+
+    private:
+        // Session encodes each message to the pool
+        // without the pool the task refers to the caller buffer, only the queue is measured
+        const uint8_t *CopyData(const uint8_t *pData, size_t nDataLen)
+        {
+            if(!g_UsePool){
+                return pData;
+            }
+
+            auto pEncodeData = (uint8_t *)(m_MemoryPN.Get(nDataLen));
+            std::memcpy(pEncodeData, pData, nDataLen);
+            return pEncodeData;
+        }
+
+        void FreeData(const uint8_t *pData)
+        {
+            if(g_UsePool){
+                m_MemoryPN.Free(const_cast<uint8_t *>(pData));
+            }
+        }
+
+    public:
+        void Send(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::function<void()> &&fnDone)
+        {
+            SendTask stTask {nHC, 0, 0, CopyData(pData, nDataLen), nDataLen, nullptr};
+            {
+                std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
+                stTask.DoneToken = m_DoneTable.Add(std::move(fnDone));
+                m_NextSendQ->push_back(stTask);
+            }
+        }
+
+        // DoSendQ() and DoSendDone() for everything pending as one batch
+        size_t Drain()
+        {
+            {
+                std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
+                std::swap(m_CurrSendQ, m_NextSendQ);
+            }
+
+            bool   bHasDone  = false;
+            size_t nSentByte = 0;
+
+            for(auto &rstTask: *m_CurrSendQ){
+                nSentByte += (1 + rstTask.DataLen);
+                bHasDone   = bHasDone || (rstTask.DoneToken != 0);
+                FreeData(rstTask.Data);
+            }
+
+            if(bHasDone){
+                {
+                    std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
+                    for(auto &rstTask: *m_CurrSendQ){
+                        if(rstTask.DoneToken){
+                            m_DoneCallV.emplace_back(m_DoneTable.Take(rstTask.DoneToken));
+                        }
+                    }
+                }
+
+                for(auto &fnDone: m_DoneCallV){
+                    fnDone();
+                }
+                m_DoneCallV.clear();
+            }
+
+            m_CurrSendQ->clear();
+            return nSentByte;
+        }
+};
+
+// send queue before DoneTable
+// the callback is moved into each task and the queue is std::queue of std::deque
+class LegacySendQueue final
+{
+    private:
+        struct SendTask
+        {
+            uint8_t HC;
+
+            const uint8_t *Data;
+            size_t         DataLen;
+
+            std::function<void()> OnDone;
+        };
+
+    private:
+        std::mutex m_NextQLock;
+
+    private:
+        std::queue<SendTask>  m_SendQBuf0;
+        std::queue<SendTask>  m_SendQBuf1;
+        std::queue<SendTask> *m_CurrSendQ;
+        std::queue<SendTask> *m_NextSendQ;
+
+    private:
+        MemoryChunkPN<64, 256, 2> m_MemoryPN;
+
+    public:
+        LegacySendQueue()
+            : m_NextQLock()
+            , m_SendQBuf0()
+            , m_SendQBuf1()
+            , m_CurrSendQ(&m_SendQBuf0)
+            , m_NextSendQ(&m_SendQBuf1)
+            , m_MemoryPN()
+        {}
+
+    private:
+        // same as SendQueue
+        const uint8_t *CopyData(const uint8_t *pData, size_t nDataLen)
+        {
+            if(!g_UsePool){
+                return pData;
+            }
+
+            auto pEncodeData = (uint8_t *)(m_MemoryPN.Get(nDataLen));
+            std::memcpy(pEncodeData, pData, nDataLen);
+            return pEncodeData;
+        }
+
+        void FreeData(const uint8_t *pData)
+        {
+            if(g_UsePool){
+                m_MemoryPN.Free(const_cast<uint8_t *>(pData));
+            }
+        }
+
+    public:
+        void Send(uint8_t nHC, const uint8_t *pData, size_t nDataLen, std::function<void()> &&fnDone)
+        {
+            SendTask stTask {nHC, CopyData(pData, nDataLen), nDataLen, std::move(fnDone)};
+            {
+                std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
+                m_NextSendQ->emplace(std::move(stTask));
+            }
+        }
+
+        // DoSendNext() of each task, callback first then the buffer
+        size_t Drain()
+        {
+            {
+                std::lock_guard<std::mutex> stLockGuard(m_NextQLock);
+                std::swap(m_CurrSendQ, m_NextSendQ);
+            }
+
+            size_t nSentByte = 0;
+            while(!m_CurrSendQ->empty()){
+                auto &rstTask = m_CurrSendQ->front();
+                if(rstTask.OnDone){
+                    rstTask.OnDone();
+                }
+
+                nSentByte += (1 + rstTask.DataLen);
+                FreeData(rstTask.Data);
+                m_CurrSendQ->pop();
+            }
+            return nSentByte;
+        }
+};
+
+static uint64_t GetTimeUS()
+{
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void PrintUsage()
+{
+    std::printf("Usage: sendbench [--key=value] ...\n");
+    std::printf("    --count=4000000         messages of each case\n");
+    std::printf("    --batch=64              messages sent before one drain\n");
+    std::printf("    --size=32               bytes of each message\n");
+    std::printf("    --pool=1                copy messages to the memory pool, 0 to measure the queue only\n");
+}
+
+// callbacks write the count here, keeps them from being dropped
+static uint64_t g_DoneCount = 0;
+
+struct CaseResult
+{
+    double NSPerMsg;
+    double AllocPerMsg;
+};
+
+// nCallback: 0 for none, 1 for a callback capturing a pointer, 2 for one capturing 48 bytes
+template<typename Q> static CaseResult RunCase(int nCount, int nBatch, size_t nSize, int nCallback)
+{
+    std::vector<uint8_t> stPayload(nSize);
+    for(size_t nIndex = 0; nIndex < nSize; ++nIndex){
+        stPayload[nIndex] = (uint8_t)(nIndex * 31 + 7);
+    }
+
+    struct BigCapture
+    {
+        uint64_t Value[6];
+    };
+
+    BigCapture stBig;
+    std::memset(&stBig, 0, sizeof(stBig));
+
+    auto fnRound = [&](Q &rstQ) -> size_t
+    {
+        for(int nIndex = 0; nIndex < nBatch; ++nIndex){
+            switch(nCallback){
+                case 1:
+                    {
+                        auto pDoneCount = &g_DoneCount;
+                        rstQ.Send(1, stPayload.data(), nSize, [pDoneCount](){ (*pDoneCount)++; });
+                        break;
+                    }
+                case 2:
+                    {
+                        rstQ.Send(1, stPayload.data(), nSize, [stBig](){ g_DoneCount += 1 + stBig.Value[0]; });
+                        break;
+                    }
+                default:
+                    {
+                        rstQ.Send(1, stPayload.data(), nSize, std::function<void()>());
+                        break;
+                    }
+            }
+        }
+        return rstQ.Drain();
+    };
+
+    // queue is big, keep it out of the stack
+    // first rounds grow the pool, queues and table to the size of one batch
+    std::unique_ptr<Q> pQ(new Q());
+    for(int nRound = 0; nRound < 4; ++nRound){
+        fnRound(*pQ);
+    }
+
+    auto nRoundCount = std::max<int>(1, nCount / nBatch);
+    auto nAllocCount = g_HeapAllocCount.load();
+    auto nStartTime  = GetTimeUS();
+
+    for(int nRound = 0; nRound < nRoundCount; ++nRound){
+        fnRound(*pQ);
+    }
+
+    auto nTimeUS = GetTimeUS() - nStartTime;
+    auto nMsg    = (double)(nRoundCount) * nBatch;
+
+    return {nTimeUS * 1000.0 / nMsg, (g_HeapAllocCount.load() - nAllocCount) / nMsg};
+}
+
+int main(int argc, char *argv[])
+{
+    int nCount = 4000000;
+    int nBatch = 64;
+    int nSize  = 32;
+
+    for(int nIndex = 1; nIndex < argc; ++nIndex){
+        std::string szArg = argv[nIndex];
+        if(szArg == "--help"){
+            PrintUsage();
+            return 0;
+        }
+
+        auto nLoc = szArg.find('=');
+        if(szArg.compare(0, 2, "--") || nLoc == std::string::npos){
+            std::printf("invalid option: %s, expect --key=value\n", szArg.c_str());
+            PrintUsage();
+            return 1;
+        }
+
+        auto szKey   = szArg.substr(2, nLoc - 2);
+        auto szValue = szArg.substr(nLoc + 1);
+
+        if(szKey == "count"){ nCount    = std::atoi(szValue.c_str());      continue; }
+        if(szKey == "batch"){ nBatch    = std::atoi(szValue.c_str());      continue; }
+        if(szKey == "size" ){ nSize     = std::atoi(szValue.c_str());      continue; }
+        if(szKey == "pool" ){ g_UsePool = std::atoi(szValue.c_str()) != 0; continue; }
+
+        std::printf("unknown option: %s\n", szArg.c_str());
+        PrintUsage();
+        return 1;
+    }
+
+    if(false
+            || nCount <= 0
+            || nBatch <= 0
+            || nSize  <= 0){
+        PrintUsage();
+        return 1;
+    }
+
+    const char *szCallbackList[] {"none", "pointer", "48 bytes"};
+
+    std::printf("send     : %d messages of %d bytes, drain every %d, %s, ns and heap allocations per message\n", nCount, nSize, nBatch, g_UsePool ? "copied to pool" : "no copy");
+    std::printf("%10s %22s %22s %9s\n", "callback", "SendTask + DoneTable", "legacy", "speedup");
+
+    bool bHeapFree = true;
+    for(int nCallback = 0; nCallback < 3; ++nCallback){
+        auto stCurr   = RunCase<SendQueue      >(nCount, nBatch, (size_t)(nSize), nCallback);
+        auto stLegacy = RunCase<LegacySendQueue>(nCount, nBatch, (size_t)(nSize), nCallback);
+
+        char szCurr[64];
+        char szLegacy[64];
+        std::snprintf(szCurr,   sizeof(szCurr),   "%.1f ns, %.2f",   stCurr.NSPerMsg,   stCurr.AllocPerMsg);
+        std::snprintf(szLegacy, sizeof(szLegacy), "%.1f ns, %.2f", stLegacy.NSPerMsg, stLegacy.AllocPerMsg);
+        std::printf("%10s %22s %22s %8.2fx\n", szCallbackList[nCallback], szCurr, szLegacy, stLegacy.NSPerMsg / stCurr.NSPerMsg);
+
+        // big capture allocates in std::function before Send() is called
+        if(nCallback < 2 && stCurr.AllocPerMsg != 0.0){
+            bHeapFree = false;
+        }
+    }
+
+    std::printf("\n");
+    std::printf("callback : %" PRIu64 " invoked\n", g_DoneCount);
+
+    if(!bHeapFree){
+        std::printf("FAIL: steady state sending allocates from the heap\n");
+        return 1;
+    }
+    return 0;
+}
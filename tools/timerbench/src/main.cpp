@@ -0,0 +1,472 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 10/19/2026 01:48:30
+ *  Last Modified: 10/19/2026 01:48:30
+ *
+ *    Description: check expiry order and lateness of the EventTaskHub timing wheel
+ *
+ *                      timerbench
+ *                      timerbench --count=100000 --span=3000
+ *
+ *                 wheel part: drive the wheel by a virtual clock, add timers with mixed
+ *                 delays at different ticks, from less than one root slot up to 3 times
+ *                 WHEEL_MAXDELAY which get parked and re-inserted by Cascade(), dismiss a
+ *                 random half before they expire, then every other timer must come out of
+ *                 RunTick() exactly at its expire tick and in expire order
+ *
+ *                 realtime part: launch the hub, add timers with delays in [0, span) ms
+ *                 from the main thread, dismiss half, and report how late the rest run
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+#include <algorithm>
+
+#include "eventtaskhub.hpp"
+
+// EventTaskHub driven by a virtual clock
+// MainLoop() is never launched, ticks are advanced by Advance() only
+class WheelSimHub final: public EventTaskHub
+{
+    public:
+        struct ExpireRecord
+        {
+            uint32_t ID;
+            uint64_t ExpireTick;
+            uint64_t RunTick;
+        };
+
+    private:
+        uint32_t m_SimID;
+
+    public:
+        WheelSimHub()
+            : EventTaskHub()
+            , m_SimID(0)
+        {
+            // Add() and Dismiss() refuse to work if the hub is not running
+            State(true);
+        }
+
+       ~WheelSimHub()
+        {
+            Shutdown();
+        }
+
+    public:
+        constexpr static uint64_t MaxDelay()
+        {
+            return WHEEL_MAXDELAY;
+        }
+
+    public:
+        uint64_t SimTick() const
+        {
+            return m_CurrTick;
+        }
+
+        size_t PendingCount() const
+        {
+            return m_EventIDRecord.size();
+        }
+
+    public:
+        // add a timer expiring nDelay ticks after current tick
+        // same as Add() but take the virtual clock instead of steady_clock
+        uint32_t SimAdd(uint64_t nDelay)
+        {
+            auto pTask = CreateEventTask(0, [](){});
+            if(!pTask){
+                return 0;
+            }
+
+            std::lock_guard<std::mutex> stLockGuard(m_EventLock);
+            pTask->ID(++m_SimID);
+            ExpireTick(pTask, m_CurrTick + nDelay);
+
+            m_EventIDRecord[pTask->ID()] = pTask;
+            InsertTask(pTask);
+            return pTask->ID();
+        }
+
+        // run all ticks till nTargetTick, included
+        // empty ticks are skipped by NextWakeTick() as MainLoop() waits on them
+        void Advance(uint64_t nTargetTick, std::vector<ExpireRecord> *pRecordV)
+        {
+            std::vector<EventTask *> stExpiredV;
+            std::lock_guard<std::mutex> stLockGuard(m_EventLock);
+
+            while(m_CurrTick <= nTargetTick){
+                auto nWakeTick = NextWakeTick();
+                if(nWakeTick > nTargetTick){
+                    m_CurrTick = nTargetTick + 1;
+                    break;
+                }
+
+                m_CurrTick = std::max<uint64_t>(m_CurrTick, nWakeTick);
+
+                auto nRunTick = m_CurrTick;
+                RunTick(stExpiredV);
+
+                for(auto pTask: stExpiredV){
+                    pRecordV->push_back({pTask->ID(), ExpireTick(pTask), nRunTick});
+                    DeleteEventTask(pTask);
+                }
+                stExpiredV.clear();
+            }
+        }
+
+    private:
+        void MainLoop()
+        {
+        }
+};
+
+static uint64_t GetTimeUS()
+{
+    return (uint64_t)(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+static void PrintUsage()
+{
+    std::printf("Usage: timerbench [--key=value] ...\n");
+    std::printf("    --count=100000          timers added in each part, half of them get dismissed\n");
+    std::printf("    --span=2000             max delay in ms of the realtime part, 0 to skip it\n");
+    std::printf("    --seed=1                seed of delays and dismissed timers\n");
+}
+
+static uint64_t g_Seed = 1;
+static uint32_t RandU32()
+{
+    g_Seed ^= g_Seed << 13;
+    g_Seed ^= g_Seed >>  7;
+    g_Seed ^= g_Seed << 17;
+    return (uint32_t)(g_Seed >> 32);
+}
+
+static uint64_t RandU64(uint64_t nRange)
+{
+    return ((((uint64_t)(RandU32()) << 32) | RandU32()) % nRange);
+}
+
+template<typename T> static T Percentile(const std::vector<T> &rstSortedList, double fPercent)
+{
+    if(rstSortedList.empty()){
+        return 0;
+    }
+
+    auto nIndex = (size_t)(fPercent / 100.0 * (rstSortedList.size() - 1) + 0.5);
+    return rstSortedList[std::min<size_t>(nIndex, rstSortedList.size() - 1)];
+}
+
+// 256, 16384, 2^20, 2^26 are the spans of level 0 ~ 3
+// a few go beyond the whole wheel and get parked in the last slot
+static uint64_t RandDelay(uint64_t nMaxDelay)
+{
+    auto nRoll = RandU32() % 100;
+    if(nRoll < 40){ return RandU64(256);          }
+    if(nRoll < 65){ return RandU64(1 << 14);      }
+    if(nRoll < 80){ return RandU64(1 << 20);      }
+    if(nRoll < 93){ return RandU64(nMaxDelay + 1); }
+    return nMaxDelay + 1 + RandU64(2 * nMaxDelay);
+}
+
+static bool RunWheel(int nCount)
+{
+    struct TimerPlan
+    {
+        uint64_t AddTick;
+        uint64_t Delay;
+        uint64_t DismissTick;
+
+        uint32_t ID;
+        bool     Dismissed;
+    };
+
+    auto nMaxDelay = WheelSimHub::MaxDelay();
+
+    // timers are added one per tick, so they are inserted at all positions of the root wheel
+    // a dismissed one is dismissed at a random tick before its expiry
+    std::vector<TimerPlan> stPlanV(nCount);
+    for(int nIndex = 0; nIndex < nCount; ++nIndex){
+        auto &rstPlan = stPlanV[nIndex];
+        rstPlan.AddTick     = (uint64_t)(nIndex);
+        rstPlan.Delay       = RandDelay(nMaxDelay);
+        rstPlan.DismissTick = UINT64_MAX;
+        rstPlan.ID          = 0;
+        rstPlan.Dismissed   = false;
+
+        if((RandU32() % 2) && rstPlan.Delay){
+            rstPlan.DismissTick = rstPlan.AddTick + RandU64(rstPlan.Delay);
+        }
+    }
+
+    // event list: add or dismiss at given tick, add goes first at the same tick
+    std::vector<std::pair<uint64_t, int>> stEventV;
+    for(int nIndex = 0; nIndex < nCount; ++nIndex){
+        stEventV.emplace_back(stPlanV[nIndex].AddTick * 2, nIndex);
+        if(stPlanV[nIndex].DismissTick != UINT64_MAX){
+            stEventV.emplace_back(stPlanV[nIndex].DismissTick * 2 + 1, nIndex);
+        }
+    }
+    std::sort(stEventV.begin(), stEventV.end());
+
+    auto pHub = std::make_unique<WheelSimHub>();
+    std::vector<WheelSimHub::ExpireRecord> stRecordV;
+    std::vector<int> stIDToPlan(nCount + 1, -1);
+
+    uint64_t nAddUS     = 0;
+    uint64_t nDismissUS = 0;
+    uint64_t nDismissed = 0;
+
+    auto nStartTime = GetTimeUS();
+    for(auto &rstEvent: stEventV){
+        auto nTick = rstEvent.first / 2;
+        if(nTick > 0){
+            pHub->Advance(nTick - 1, &stRecordV);
+        }
+
+        auto &rstPlan = stPlanV[rstEvent.second];
+        if(rstEvent.first % 2){
+            auto nTime = GetTimeUS();
+            if(!pHub->Dismiss(rstPlan.ID)){
+                std::printf("FAIL: can't dismiss timer %u, add at %" PRIu64 ", delay %" PRIu64 ", dismiss at %" PRIu64 "\n", rstPlan.ID, rstPlan.AddTick, rstPlan.Delay, nTick);
+                return false;
+            }
+            nDismissUS += GetTimeUS() - nTime;
+            nDismissed++;
+            rstPlan.Dismissed = true;
+        }else{
+            auto nTime = GetTimeUS();
+            rstPlan.ID = pHub->SimAdd(rstPlan.Delay);
+            nAddUS += GetTimeUS() - nTime;
+            stIDToPlan[rstPlan.ID] = rstEvent.second;
+        }
+    }
+
+    // run till all left expire
+    auto nLastTick = pHub->SimTick();
+    for(auto &rstPlan: stPlanV){
+        nLastTick = std::max<uint64_t>(nLastTick, rstPlan.AddTick + rstPlan.Delay);
+    }
+    pHub->Advance(nLastTick, &stRecordV);
+    auto nTotalUS = GetTimeUS() - nStartTime;
+
+    // check every record against the plan
+    std::vector<bool> stSeen(nCount, false);
+    uint64_t nLastExpire = 0;
+    uint64_t nMaxLate    = 0;
+
+    for(auto &rstRecord: stRecordV){
+        auto nPlanIndex = stIDToPlan[rstRecord.ID];
+        auto &rstPlan   = stPlanV[nPlanIndex];
+
+        if(rstPlan.Dismissed || stSeen[nPlanIndex]){
+            std::printf("FAIL: timer %u runs after dismissed or runs twice\n", rstRecord.ID);
+            return false;
+        }
+        stSeen[nPlanIndex] = true;
+
+        auto nExpectTick = rstPlan.AddTick + rstPlan.Delay;
+        if(rstRecord.RunTick < nExpectTick){
+            std::printf("FAIL: timer %u runs early at %" PRIu64 ", expire at %" PRIu64 "\n", rstRecord.ID, rstRecord.RunTick, nExpectTick);
+            return false;
+        }
+
+        if(rstRecord.ExpireTick < nLastExpire){
+            std::printf("FAIL: timer %u expiring at %" PRIu64 " runs after one expiring at %" PRIu64 "\n", rstRecord.ID, rstRecord.ExpireTick, nLastExpire);
+            return false;
+        }
+
+        nLastExpire = rstRecord.ExpireTick;
+        nMaxLate    = std::max<uint64_t>(nMaxLate, rstRecord.RunTick - nExpectTick);
+    }
+
+    if(stRecordV.size() + nDismissed != (size_t)(nCount) || pHub->PendingCount()){
+        std::printf("FAIL: %zu timers run, %" PRIu64 " dismissed, %zu pending, %d added\n", stRecordV.size(), nDismissed, pHub->PendingCount(), nCount);
+        return false;
+    }
+
+    size_t nParked = 0;
+    for(auto &rstPlan: stPlanV){
+        nParked += (!rstPlan.Dismissed && rstPlan.Delay > nMaxDelay) ? 1 : 0;
+    }
+
+    std::printf("wheel    : %d added, %" PRIu64 " dismissed, %zu run in order, %zu of them parked beyond %" PRIu64 " ticks\n",
+            nCount, nDismissed, stRecordV.size(), nParked, nMaxDelay);
+    std::printf("wheel    : max lateness %" PRIu64 " ticks, %.1f s for %" PRIu64 " virtual ticks, add %.0f ns, dismiss %.0f ns\n",
+            nMaxLate, nTotalUS / 1000000.0, nLastTick, nAddUS * 1000.0 / nCount, nDismissed ? (nDismissUS * 1000.0 / nDismissed) : 0.0);
+
+    if(nMaxLate){
+        std::printf("FAIL: timers should run exactly at the expire tick by the virtual clock\n");
+        return false;
+    }
+    return true;
+}
+
+static bool RunRealtime(int nCount, int nSpan)
+{
+    struct TimerRecord
+    {
+        uint64_t DueUS;
+        uint64_t RunUS;
+
+        uint32_t ID;
+        bool     Dismissed;
+    };
+
+    std::vector<TimerRecord> stRecordV(nCount);
+    std::vector<uint32_t>    stRunOrder;
+    std::atomic<int>         nRunCount(0);
+
+    stRunOrder.reserve(nCount);
+
+    // hub thread writes RunUS and stRunOrder, main thread reads them after nRunCount
+    // gets the expected value or after the hub is shut down
+    auto pHub = std::make_unique<EventTaskHub>();
+    pHub->Launch();
+
+    uint64_t nAddUS = 0;
+    for(int nIndex = 0; nIndex < nCount; ++nIndex){
+        auto nDelay = RandU32() % (uint32_t)(nSpan);
+        auto nTime  = GetTimeUS();
+
+        stRecordV[nIndex].DueUS     = nTime + nDelay * 1000;
+        stRecordV[nIndex].RunUS     = 0;
+        stRecordV[nIndex].Dismissed = false;
+        stRecordV[nIndex].ID        = pHub->Add(nDelay, [nIndex, &stRecordV, &stRunOrder, &nRunCount]()
+        {
+            stRecordV[nIndex].RunUS = GetTimeUS();
+            stRunOrder.push_back((uint32_t)(nIndex));
+            nRunCount.fetch_add(1);
+        });
+        nAddUS += GetTimeUS() - nTime;
+    }
+
+    // dismiss a random half, some of them may have already run
+    int nDismissed = 0;
+    for(int nIndex = 0; nIndex < nCount; ++nIndex){
+        if(RandU32() % 2){
+            if(pHub->Dismiss(stRecordV[nIndex].ID)){
+                stRecordV[nIndex].Dismissed = true;
+                nDismissed++;
+            }
+        }
+    }
+
+    auto nWaitDone = GetTimeUS() + (uint64_t)(nSpan + 1000) * 1000;
+    while(nRunCount.load() < nCount - nDismissed && GetTimeUS() < nWaitDone){
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    pHub->Shutdown();
+    pHub.reset();
+
+    std::vector<int64_t> stLateV;
+    int nEarly  = 0;
+    int nMissed = 0;
+
+    for(auto &rstRecord: stRecordV){
+        if(rstRecord.Dismissed){
+            if(rstRecord.RunUS){
+                std::printf("FAIL: timer %u runs after dismissed\n", rstRecord.ID);
+                return false;
+            }
+            continue;
+        }
+
+        if(!rstRecord.RunUS){
+            nMissed++;
+            continue;
+        }
+
+        // DueUS is taken before Add(), a timer running before it is early
+        auto nLate = (int64_t)(rstRecord.RunUS) - (int64_t)(rstRecord.DueUS);
+        if(nLate < 0){
+            nEarly++;
+        }
+        stLateV.push_back(nLate);
+    }
+
+    // a timer running before another one due more than 1ms earlier breaks the order
+    int nOutOfOrder = 0;
+    for(size_t nIndex = 1; nIndex < stRunOrder.size(); ++nIndex){
+        if(stRecordV[stRunOrder[nIndex]].DueUS + 1000 < stRecordV[stRunOrder[nIndex - 1]].DueUS){
+            nOutOfOrder++;
+        }
+    }
+
+    std::sort(stLateV.begin(), stLateV.end());
+    std::printf("\n");
+    std::printf("realtime : %d added in %d ms span, %d dismissed, %zu run, %d missed, add %.0f ns\n",
+            nCount, nSpan, nDismissed, stLateV.size(), nMissed, nAddUS * 1000.0 / nCount);
+    std::printf("realtime : lateness (us) p50 %" PRId64 ", p99 %" PRId64 ", max %" PRId64 ", %d early, %d out of order\n",
+            Percentile(stLateV, 50.0), Percentile(stLateV, 99.0), stLateV.empty() ? (int64_t)(0) : stLateV.back(), nEarly, nOutOfOrder);
+
+    return nMissed == 0 && nEarly == 0 && nOutOfOrder == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int nCount = 100000;
+    int nSpan  = 2000;
+
+    for(int nIndex = 1; nIndex < argc; ++nIndex){
+        std::string szArg = argv[nIndex];
+        if(szArg == "--help"){
+            PrintUsage();
+            return 0;
+        }
+
+        auto nLoc = szArg.find('=');
+        if(szArg.compare(0, 2, "--") || nLoc == std::string::npos){
+            std::printf("invalid option: %s, expect --key=value\n", szArg.c_str());
+            PrintUsage();
+            return 1;
+        }
+
+        auto szKey   = szArg.substr(2, nLoc - 2);
+        auto szValue = szArg.substr(nLoc + 1);
+
+        if(szKey == "count"){ nCount = std::atoi(szValue.c_str());                      continue; }
+        if(szKey == "span" ){ nSpan  = std::atoi(szValue.c_str());                      continue; }
+        if(szKey == "seed" ){ g_Seed = std::strtoull(szValue.c_str(), nullptr, 10) | 1; continue; }
+
+        std::printf("unknown option: %s\n", szArg.c_str());
+        PrintUsage();
+        return 1;
+    }
+
+    if(nCount <= 0 || nSpan < 0){
+        PrintUsage();
+        return 1;
+    }
+
+    if(!RunWheel(nCount)){
+        return 1;
+    }
+
+    if(nSpan > 0 && !RunRealtime(nCount, nSpan)){
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,378 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename: main.cpp
+ *        Created: 10/19/2026 00:21:05
+ *  Last Modified: 10/19/2026 00:21:05
+ *
+ *    Description: stress and thread scaling test of UIDRegistry
+ *
+ *                      uidbench
+ *                      uidbench --stress=0 --threads=1,4,16,64 --duration=2000
+ *
+ *                 stress part: 6 readers look up random live UIDs while one writer keeps
+ *                 linking new UIDs and unlinking the one 100 behind, unlinked objects are
+ *                 poisoned and deleted, a reader seeing a poisoned or wrong object means
+ *                 the grace period is broken, build with -fsanitize=address to catch the
+ *                 use-after-free directly
+ *
+ *                 scaling part: compare UIDRegistry with the 17 mutex shards of
+ *                 std::unordered_map which MonoServer used before, N readers do the
+ *                 lookup as GetUIDRecord() while one writer links and unlinks at a given
+ *                 rate as objects spawn and die
+ *
+ *        Version: 1.0
+ *       Revision: none
+ *       Compiler: gcc
+ *
+ *         Author: ANHONG
+ *          Email: anhonghe@gmail.com
+ *   Organization: USTC
+ *
+ * =====================================================================================
+ */
+
+#include <array>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+#include <unordered_map>
+
+#include "uidregistry.hpp"
+
+// UIDRegistry only keeps the pointer
+// the bench doesn't link the server, a minimal object is enough to check the UID
+class ServerObject
+{
+    private:
+        std::atomic<uint32_t> m_UID;
+
+    public:
+        ServerObject(uint32_t nUID)
+            : m_UID(nUID)
+        {}
+
+    public:
+        uint32_t UID() const
+        {
+            return m_UID.load(std::memory_order_relaxed);
+        }
+
+        void Poison()
+        {
+            m_UID.store(0XDEADBEEF, std::memory_order_relaxed);
+        }
+};
+
+// UID table used by MonoServer before UIDRegistry
+// lookup holds the shard lock while the object is read
+class ShardedUIDMap final
+{
+    private:
+        struct UIDLockRecord
+        {
+            std::mutex Lock;
+            std::unordered_map<uint32_t, const ServerObject *> Record;
+        };
+
+    private:
+        std::array<UIDLockRecord, 17> m_UIDArray;
+
+    public:
+        bool Link(uint32_t nUID, const ServerObject *pObject)
+        {
+            auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
+            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
+            return rstRecord.Record.emplace(nUID, pObject).second;
+        }
+
+        void Erase(uint32_t nUID)
+        {
+            auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
+            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
+
+            auto pRecord = rstRecord.Record.find(nUID);
+            if(pRecord != rstRecord.Record.end()){
+                delete pRecord->second;
+                rstRecord.Record.erase(pRecord);
+            }
+        }
+
+        uint32_t LookupUID(uint32_t nUID)
+        {
+            auto &rstRecord = m_UIDArray[nUID % m_UIDArray.size()];
+            std::lock_guard<std::mutex> stLockGuard(rstRecord.Lock);
+
+            auto pRecord = rstRecord.Record.find(nUID);
+            return (pRecord != rstRecord.Record.end()) ? pRecord->second->UID() : 0;
+        }
+};
+
+// lookup of UIDRegistry the same way as MonoServer::GetUIDRecord()
+class RegistryUIDMap final
+{
+    private:
+        UIDRegistry m_Registry;
+
+    public:
+        bool Link(uint32_t nUID, const ServerObject *pObject)
+        {
+            return m_Registry.Link(nUID, pObject);
+        }
+
+        void Erase(uint32_t nUID)
+        {
+            delete m_Registry.Unlink(nUID);
+        }
+
+        uint32_t LookupUID(uint32_t nUID)
+        {
+            UIDRegistry::ReadGuard stGuard(&m_Registry);
+            if(auto pObject = m_Registry.Get(nUID)){
+                return pObject->UID();
+            }
+            return 0;
+        }
+};
+
+// sum of looked up UIDs, keeps the lookups from being dropped
+static std::atomic<uint64_t> g_CheckSum(0);
+
+static void PrintUsage()
+{
+    std::printf("Usage: uidbench [--key=value] ...\n");
+    std::printf("    --stress=600000         UIDs linked by the writer in stress test, 0 to skip\n");
+    std::printf("    --threads=1,4,16,64     reader threads of each scaling run, empty to skip\n");
+    std::printf("    --live=100000           live UIDs in the table during scaling runs\n");
+    std::printf("    --writerate=10000       link + unlink per second during scaling runs\n");
+    std::printf("    --duration=1000         ms of each scaling run\n");
+}
+
+static uint32_t NextRand(uint32_t *pSeed)
+{
+    *pSeed = *pSeed * 1103515245 + 12345;
+    return *pSeed >> 8;
+}
+
+static bool RunStress(uint32_t nLinkCount)
+{
+    // 512KB segment table, don't put it on the stack
+    auto pRegistry = std::make_unique<UIDRegistry>();
+    auto &rstRegistry = *pRegistry;
+
+    std::atomic<bool>     bStop(false);
+    std::atomic<uint32_t> nMaxUID(1);
+    std::atomic<uint64_t> nHitCount(0);
+    std::atomic<uint64_t> nBadCount(0);
+
+    auto nStartTime = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> stReaderList;
+    for(int nIndex = 0; nIndex < 6; ++nIndex){
+        stReaderList.emplace_back([&, nIndex]()
+        {
+            uint64_t nHit  = 0;
+            uint64_t nBad  = 0;
+            uint32_t nSeed = 7919 * (nIndex + 1);
+
+            while(!bStop.load()){
+                auto nUID = 1 + NextRand(&nSeed) % nMaxUID.load();
+                UIDRegistry::ReadGuard stGuard(&rstRegistry);
+                if(auto pObject = rstRegistry.Get(nUID)){
+                    nHit++;
+                    if(pObject->UID() != nUID){
+                        nBad++;
+                    }
+                }
+            }
+
+            nHitCount += nHit;
+            nBadCount += nBad;
+        });
+    }
+
+    std::thread stWriter([&]()
+    {
+        for(uint32_t nUID = 1; nUID <= nLinkCount; ++nUID){
+            rstRegistry.Link(nUID, new ServerObject(nUID));
+            nMaxUID.store(nUID);
+
+            if(nUID > 100){
+                if(auto pObject = const_cast<ServerObject *>(rstRegistry.Unlink(nUID - 100))){
+                    pObject->Poison();
+                    delete pObject;
+                }
+            }
+        }
+        bStop.store(true);
+    });
+
+    stWriter.join();
+    for(auto &rstReader: stReaderList){
+        rstReader.join();
+    }
+
+    // clean the last 100
+    for(uint32_t nUID = (nLinkCount > 100) ? (nLinkCount - 99) : 1; nUID <= nLinkCount; ++nUID){
+        delete rstRegistry.Unlink(nUID);
+    }
+
+    auto fSecond = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - nStartTime).count() / 1000.0;
+    std::printf("stress   : 6 readers, 1 writer, %" PRIu32 " link + unlink in %.1f s, %" PRIu64 " hits, %" PRIu64 " bad\n",
+            nLinkCount, fSecond, nHitCount.load(), nBadCount.load());
+    return nBadCount.load() == 0;
+}
+
+// return lookups per second of all readers
+template<typename UIDMap> static double RunScaling(int nThread, uint32_t nLiveCount, int nWriteRate, int nDuration)
+{
+    auto pMap = std::make_unique<UIDMap>();
+    auto &rstMap = *pMap;
+    for(uint32_t nUID = 1; nUID <= nLiveCount; ++nUID){
+        rstMap.Link(nUID, new ServerObject(nUID));
+    }
+
+    // live UIDs are in [nMinUID, nMinUID + nLiveCount)
+    std::atomic<uint32_t> nMinUID(1);
+    std::atomic<bool>     bStop(false);
+    std::atomic<uint64_t> nLookupCount(0);
+
+    std::vector<std::thread> stReaderList;
+    for(int nIndex = 0; nIndex < nThread; ++nIndex){
+        stReaderList.emplace_back([&, nIndex]()
+        {
+            uint64_t nLookup = 0;
+            uint64_t nSum    = 0;
+            uint32_t nSeed   = 7919 * (nIndex + 1);
+
+            while(!bStop.load(std::memory_order_relaxed)){
+                for(int nRound = 0; nRound < 64; ++nRound){
+                    nSum += rstMap.LookupUID(nMinUID.load(std::memory_order_relaxed) + NextRand(&nSeed) % nLiveCount);
+                }
+                nLookup += 64;
+            }
+
+            nLookupCount += nLookup;
+            g_CheckSum   += nSum;
+        });
+    }
+
+    std::thread stWriter([&]()
+    {
+        auto nStartTime = std::chrono::steady_clock::now();
+        auto nDoneTime  = nStartTime + std::chrono::milliseconds(nDuration);
+
+        uint64_t nWriteCount = 0;
+        while(std::chrono::steady_clock::now() < nDoneTime){
+            // pace by the rate, spawn one and kill the oldest
+            auto nDue = nStartTime + std::chrono::microseconds(nWriteCount * 1000000 / (uint64_t)(std::max<int>(nWriteRate, 1)));
+            if(nWriteRate > 0 && std::chrono::steady_clock::now() < nDue){
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+
+            auto nOldUID = nMinUID.load();
+            rstMap.Link(nOldUID + nLiveCount, new ServerObject(nOldUID + nLiveCount));
+            nMinUID.store(nOldUID + 1);
+            rstMap.Erase(nOldUID);
+            nWriteCount++;
+        }
+        bStop.store(true);
+    });
+
+    stWriter.join();
+    for(auto &rstReader: stReaderList){
+        rstReader.join();
+    }
+
+    for(uint32_t nUID = nMinUID.load(); nUID < nMinUID.load() + nLiveCount; ++nUID){
+        rstMap.Erase(nUID);
+    }
+    return nLookupCount.load() * 1000.0 / nDuration;
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t nStress    = 600000;
+    uint32_t nLiveCount = 100000;
+    int      nWriteRate = 10000;
+    int      nDuration  = 1000;
+
+    std::vector<int> stThreadList {1, 4, 16, 64};
+
+    for(int nIndex = 1; nIndex < argc; ++nIndex){
+        std::string szArg = argv[nIndex];
+        if(szArg == "--help"){
+            PrintUsage();
+            return 0;
+        }
+
+        auto nLoc = szArg.find('=');
+        if(szArg.compare(0, 2, "--") || nLoc == std::string::npos){
+            std::printf("invalid option: %s, expect --key=value\n", szArg.c_str());
+            PrintUsage();
+            return 1;
+        }
+
+        auto szKey   = szArg.substr(2, nLoc - 2);
+        auto szValue = szArg.substr(nLoc + 1);
+
+        if(szKey == "stress"   ){ nStress    = (uint32_t)(std::strtoul(szValue.c_str(), nullptr, 10)); continue; }
+        if(szKey == "live"     ){ nLiveCount = (uint32_t)(std::strtoul(szValue.c_str(), nullptr, 10)); continue; }
+        if(szKey == "writerate"){ nWriteRate = std::atoi(szValue.c_str());                             continue; }
+        if(szKey == "duration" ){ nDuration  = std::atoi(szValue.c_str());                             continue; }
+
+        if(szKey == "threads"){
+            stThreadList.clear();
+            for(size_t nBegin = 0; nBegin < szValue.size();){
+                auto nEnd = szValue.find(',', nBegin);
+                if(nEnd == std::string::npos){
+                    nEnd = szValue.size();
+                }
+
+                auto nThread = std::atoi(szValue.substr(nBegin, nEnd - nBegin).c_str());
+                if(nThread > 0){
+                    stThreadList.push_back(nThread);
+                }
+                nBegin = nEnd + 1;
+            }
+            continue;
+        }
+
+        std::printf("unknown option: %s\n", szArg.c_str());
+        PrintUsage();
+        return 1;
+    }
+
+    if(nLiveCount == 0 || nWriteRate < 0 || nDuration <= 0){
+        PrintUsage();
+        return 1;
+    }
+
+    if(nStress && !RunStress(nStress)){
+        std::printf("FAIL: reader got an unlinked object\n");
+        return 1;
+    }
+
+    if(stThreadList.empty()){
+        return 0;
+    }
+
+    std::printf("\n");
+    std::printf("scaling  : %" PRIu32 " live UIDs, writer %d link + unlink/s, %d ms per run, %u cores\n", nLiveCount, nWriteRate, nDuration, std::thread::hardware_concurrency());
+    std::printf("%8s %18s %18s %10s\n", "threads", "registry (M/s)", "sharded (M/s)", "speedup");
+
+    for(auto nThread: stThreadList){
+        auto fRegistry = RunScaling<RegistryUIDMap>(nThread, nLiveCount, nWriteRate, nDuration);
+        auto fSharded  = RunScaling<ShardedUIDMap >(nThread, nLiveCount, nWriteRate, nDuration);
+        std::printf("%8d %18.2f %18.2f %9.2fx\n", nThread, fRegistry / 1000000.0, fSharded / 1000000.0, fRegistry / std::max<double>(fSharded, 1.0));
+    }
+    return 0;
+}